@@ -71,6 +71,7 @@ BASE_SCRIPTS= [
     'mempool_spendcoinbase.py',
     'mempool_reorg.py',
     'httpbasics.py',
+    'rpcqueues.py',
     'multi_rpc.py',
     'proxy_test.py',
     'signrawtransactions.py',
@@ -118,7 +119,9 @@ EXTENDED_SCRIPTS = [
     # vv Tests less than 2m vv
     'bip68-sequence.py',
     'getblocktemplate_longpoll.py',  # FIXME: "socket.error: [Errno 54] Connection reset by peer" on my Mac, same as  https://github.com/bitcoin/bitcoin/issues/6651
+    'stratum.py',
     'p2p-timeouts.py',
+    'p2p-socketevents.py',
     # vv Tests less than 60s vv
     'bip9-softforks.py',
     'rpcbind_test.py',
@@ -66,6 +66,14 @@ class LLMQSigningTest(DashTestFramework):
         self.mninfo[2].node.quorum("sign", 100, id, msgHash)
         wait_for_sigs(True, False, True, 15)
 
+        # The recovery must show up in the latency statistics of the nodes which recovered or received shares
+        recoveries = 0
+        for mn in self.mninfo:
+            stats = mn.node.quorum("sigsharestats")
+            assert_equal(set(stats.keys()), set(["chainlocks", "instantsend", "other"]))
+            recoveries += sum(lane["recoveryLatency"]["count"] for lane in stats.values())
+        assert(recoveries > 0)
+
         # Mine one more quorum, so that we have 2 active ones, nothing should change
         self.mine_quorum()
         assert_sigs_nochange(True, False, True, 3)
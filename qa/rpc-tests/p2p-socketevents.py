@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The DAC Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Stress the socket handler with many loopback peers.
+
+For each supported -socketevents mode:
+
+- Start a node allowing a few hundred inbound connections
+- Open NUM_PEERS loopback connections and wait for all handshakes
+- Let every peer send PINGS_PER_PEER pings and wait for all pongs
+- Report the CPU time the node process spent per message
+"""
+
+import os
+import sys
+import time
+
+from test_framework.mininode import *
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+NUM_PEERS = 300
+PINGS_PER_PEER = 20
+
+class PingPeer(NodeConnCB):
+    def __init__(self):
+        NodeConnCB.__init__(self)
+        self.pongs = 0
+        self.closed = False
+
+    def on_pong(self, conn, message):
+        self.pongs += 1
+
+    def on_close(self, conn):
+        self.closed = True
+
+def process_cpu_seconds(pid):
+    # utime and stime are the 14th and 15th fields of /proc/<pid>/stat, in clock ticks
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf(os.sysconf_names["SC_CLK_TCK"])
+
+class SocketEventsTest(BitcoinTestFramework):
+    def __init__(self):
+        super().__init__()
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def setup_network(self):
+        self.nodes = []
+
+    def run_mode(self, mode):
+        self.nodes = [start_node(0, self.options.tmpdir, ["-socketevents=%s" % mode, "-maxconnections=%d" % (NUM_PEERS + 50)])]
+        assert_equal(self.nodes[0].getnetworkinfo()["socketevents"], mode)
+
+        peers = []
+        connections = []
+        for i in range(NUM_PEERS):
+            peer = PingPeer()
+            peers.append(peer)
+            connections.append(NodeConn('127.0.0.1', p2p_port(0), self.nodes[0], peer))
+        NetworkThread().start()
+
+        for peer in peers:
+            peer.wait_for_verack()
+        assert_equal(self.nodes[0].getconnectioncount(), NUM_PEERS)
+
+        pid = bitcoind_processes[0].pid
+        cpu_start = process_cpu_seconds(pid)
+        time_start = time.time()
+
+        for n in range(PINGS_PER_PEER):
+            for conn in connections:
+                conn.send_message(msg_ping(nonce=n + 1))
+
+        def all_pongs_received():
+            with mininode_lock:
+                return all(peer.pongs == PINGS_PER_PEER for peer in peers)
+        assert wait_until(all_pongs_received, timeout=120)
+
+        cpu_used = process_cpu_seconds(pid) - cpu_start
+        elapsed = time.time() - time_start
+        num_messages = NUM_PEERS * PINGS_PER_PEER * 2
+        print("%s: %d peers, %d messages in %.2fs, %.2fus CPU per message" %
+              (mode, NUM_PEERS, num_messages, elapsed, cpu_used * 1000000 / num_messages))
+
+        for conn in connections:
+            conn.disconnect_node()
+        wait_until(lambda: all(peer.closed for peer in peers), timeout=30)
+        stop_nodes(self.nodes)
+        self.nodes = []
+
+    def run_test(self):
+        self.run_mode("select")
+        if sys.platform.startswith("linux"):
+            self.run_mode("epoll")
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The DAC Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the RPC execution classes and getrpcqueueinfo.
+
+- Check the per-class thread and queue limits
+- Check that calls are executed by the queue of their class
+- Check that a batch is executed by the queue of its heaviest call
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+class RPCQueuesTest(BitcoinTestFramework):
+    def __init__(self):
+        super().__init__()
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir, ["-rpcheavythreads=1", "-rpcheavyworkqueue=3"])]
+
+    def executed(self, name):
+        return self.nodes[0].getrpcqueueinfo()[name]["executed"]
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(10)
+
+        info = node.getrpcqueueinfo()
+        assert_equal(sorted(info.keys()), ["external", "fast", "heavy", "normal"])
+        assert_equal(info["heavy"]["threads"], 1)
+        assert_equal(info["heavy"]["maxdepth"], 3)
+        assert_equal(info["fast"]["threads"], 2)
+        for queue in info.values():
+            assert_equal(queue["rejected"], 0)
+
+        self.log.info("Dispatching calls by class")
+        fast = self.executed("fast")
+        for i in range(5):
+            node.getblockcount()
+        # the getrpcqueueinfo calls are fast as well
+        assert_equal(self.executed("fast"), fast + 5 + 1)
+
+        normal = self.executed("normal")
+        node.getblock(node.getbestblockhash())
+        assert_equal(self.executed("normal"), normal + 1)
+
+        heavy = self.executed("heavy")
+        node.gettxoutsetinfo()
+        assert_equal(self.executed("heavy"), heavy + 1)
+
+        self.log.info("Dispatching a batch by its heaviest call")
+        fast = self.executed("fast")
+        heavy = self.executed("heavy")
+        results = node._batch([{"method": "getblockcount", "id": 1}, {"method": "verifychain", "params": [1, 1], "id": 2}])
+        assert_equal(results[0]["result"], 10)
+        assert_equal(results[1]["result"], True)
+        assert_equal(self.executed("heavy"), heavy + 1)
+        assert_equal(self.executed("fast"), fast + 1)
+
+        info = node.getrpcqueueinfo()
+        assert(info["heavy"]["maxexec_ms"] > 0)
+        assert(info["heavy"]["avgexec_ms"] <= info["heavy"]["maxexec_ms"])
+        assert_equal(info["fast"]["active"], 1)
+
+if __name__ == '__main__':
+    RPCQueuesTest().main()
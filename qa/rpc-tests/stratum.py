@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The DAC Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the stratum server (-stratumport) with a scripted client.
+
+- Subscribe and receive the first (clean) job
+- Authorize with an invalid and a valid payout address
+- Submit malformed, unauthorized, duplicate and stale shares and check they are rejected
+- Mine a block and receive a clean job for the new tip
+- Send a transaction and receive a non-clean job once the mempool threshold is reached
+- Reject a share resubmitted for another job of the same tip
+- Reject subscriptions once all RandomX VMs are bound to other seeds
+"""
+
+import json
+import socket
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+class StratumClient():
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=30)
+        self.buf = b""
+        self.next_id = 1
+        self.notifications = []
+
+    def read_message(self):
+        while b"\n" not in self.buf:
+            data = self.sock.recv(4096)
+            assert data, "connection closed"
+            self.buf += data
+        line, self.buf = self.buf.split(b"\n", 1)
+        return json.loads(line.decode())
+
+    def call(self, method, params):
+        request_id = self.next_id
+        self.next_id += 1
+        self.sock.sendall((json.dumps({"id": request_id, "method": method, "params": params}) + "\n").encode())
+        while True:
+            message = self.read_message()
+            if message.get("method") == "mining.notify":
+                self.notifications.append(message["params"])
+            elif message["id"] == request_id:
+                return message
+
+    def wait_for_job(self, predicate=lambda job: True):
+        while True:
+            while not self.notifications:
+                message = self.read_message()
+                if message.get("method") == "mining.notify":
+                    self.notifications.append(message["params"])
+            job = self.notifications.pop(0)
+            if predicate(job):
+                return job
+
+    def close(self):
+        self.sock.close()
+
+class StratumTest(BitcoinTestFramework):
+    def __init__(self):
+        super().__init__()
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def setup_network(self):
+        self.stratum_port = p2p_port(1)
+        self.nodes = [start_node(0, self.options.tmpdir, ["-stratumport=%d" % self.stratum_port, "-stratummempoolthreshold=1", "-debug=stratum"])]
+
+    def assert_rejected(self, response, code, reason):
+        assert_equal(response["result"], None)
+        assert_equal(response["error"][0], code)
+        assert_equal(response["error"][1], reason)
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+
+        client = StratumClient(self.stratum_port)
+        seed = "11" * 32
+        response = client.call("mining.subscribe", ["stratum.py", seed])
+        assert_equal(response["error"], None)
+        extranonce = response["result"]["extranonce_start"]
+        assert_equal(response["result"]["extranonce_size"], 65536)
+
+        job = client.wait_for_job()
+        job_id, prevhash, job_seed, target, height, bits, ntime, clean = job
+        assert_equal(prevhash, node.getbestblockhash())
+        assert_equal(job_seed, seed)
+        assert_equal(height, node.getblockcount() + 1)
+        assert_equal(clean, True)
+
+        self.log.info("Authorizing")
+        share = [job_id, extranonce, "00" * 76, ntime]
+        self.assert_rejected(client.call("mining.submit", share), 24, "unauthorized")
+        self.assert_rejected(client.call("mining.authorize", ["notanaddress", "x"]), 24, "invalid-address")
+        response = client.call("mining.authorize", [node.getnewaddress() + ".worker1", "x"])
+        assert_equal(response["result"], True)
+
+        self.log.info("Rejecting malformed shares")
+        self.assert_rejected(client.call("mining.submit", [job_id]), 20, "invalid-parameters")
+        self.assert_rejected(client.call("mining.submit", [job_id, extranonce, "zz", ntime]), 20, "invalid-randomx-header")
+        self.assert_rejected(client.call("mining.submit", [job_id, extranonce, "00" * 257, ntime]), 20, "invalid-randomx-header")
+        self.assert_rejected(client.call("mining.submit", ["nosuchjob", extranonce, "00" * 76, ntime]), 21, "job-not-found")
+        self.assert_rejected(client.call("mining.submit", [job_id, extranonce + 65536, "01" * 76, ntime]), 20, "extranonce-out-of-range")
+        self.assert_rejected(client.call("mining.submit", [job_id, extranonce, "02" * 76, ntime + 3600]), 20, "ntime-out-of-range")
+
+        self.log.info("Validating shares")
+        # whether this RandomX hash meets the (regtest) share target is up to chance
+        response = client.call("mining.submit", [job_id, extranonce, "02" * 76, ntime])
+        assert(response["result"] == True or response["error"][0] == 23)
+        duplicate = client.call("mining.submit", [job_id, extranonce + 1, "02" * 76, ntime])
+        if response["result"] == True:
+            # on regtest the share target is the block target, so the job may have gone stale already
+            assert(duplicate["error"][0] in (21, 22))
+        else:
+            self.assert_rejected(duplicate, 22, "duplicate-share")
+        assert_equal(client.call("mining.unknown", [])["error"][1], "unknown-method")
+
+        self.log.info("Pushing a clean job on a new tip")
+        node.generate(1)
+        job = client.wait_for_job(lambda job: job[1] == node.getbestblockhash())
+        assert_equal(job[4], node.getblockcount() + 1)
+        assert_equal(job[7], True)
+        self.assert_rejected(client.call("mining.submit", [job_id, extranonce, "03" * 76, ntime]), 21, "job-not-found")
+
+        self.log.info("Pushing a new job on mempool changes")
+        node.sendtoaddress(node.getnewaddress(), 1)
+        new_job = client.wait_for_job()
+        assert_equal(new_job[1], job[1])
+        assert(new_job[0] != job[0])
+        assert_equal(new_job[7], False)
+
+        info = node.getstratuminfo()
+        assert_equal(info["running"], True)
+        assert_equal(info["clients"], 1)
+        assert_equal(info["job"], new_job[0])
+        assert_equal(info["accepted"] + info["rejected"], 10)
+
+        self.log.info("Rejecting a share resubmitted for another job")
+        response = client.call("mining.submit", [job[0], extranonce, "04" * 76, job[6]])
+        assert(response["result"] == True or response["error"][0] == 23)
+        resubmitted = client.call("mining.submit", [new_job[0], extranonce + 1, "04" * 76, new_job[6]])
+        if response["result"] == True:
+            # the share may have been a block, which makes both jobs stale
+            assert(resubmitted["error"][0] in (21, 22))
+        else:
+            self.assert_rejected(resubmitted, 22, "duplicate-share")
+        info = node.getstratuminfo()
+        assert_equal(info["accepted"] + info["rejected"], 12)
+
+        self.log.info("Limiting the number of RandomX seeds")
+        clients = []
+        for seed in ["22" * 32, "33" * 32, "44" * 32]:
+            clients.append(StratumClient(self.stratum_port))
+            assert_equal(clients[-1].call("mining.subscribe", ["stratum.py", seed])["error"], None)
+        other = StratumClient(self.stratum_port)
+        self.assert_rejected(other.call("mining.subscribe", ["stratum.py", "55" * 32]), 20, "too-many-randomx-seeds")
+        # a seed which already has a VM is fine
+        assert_equal(other.call("mining.subscribe", ["stratum.py", "22" * 32])["error"], None)
+        for c in clients + [other]:
+            c.close()
+
+        self.log.info("Handling disconnects")
+        client.close()
+        client = StratumClient(self.stratum_port)
+        client.sock.sendall(b"not json\n")
+        assert_equal(client.sock.recv(4096), b"")
+        for i in range(100):
+            if node.getstratuminfo()["clients"] == 0:
+                break
+            time.sleep(0.1)
+        assert_equal(node.getstratuminfo()["clients"], 0)
+
+if __name__ == '__main__':
+    StratumTest().main()
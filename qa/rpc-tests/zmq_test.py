@@ -6,6 +6,7 @@
 
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import *
+import json
 import zmq
 import struct
 
@@ -23,8 +24,14 @@ class ZMQTest (BitcoinTestFramework):
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % self.port)
+        # dacmessage gets its own socket, so it doesn't interleave with the hashes checked below
+        self.zmqDACSocket = self.zmqContext.socket(zmq.SUB)
+        self.zmqDACSocket.setsockopt(zmq.SUBSCRIBE, b"dacmessage")
+        self.zmqDACSocket.setsockopt(zmq.RCVTIMEO, 60000)
+        self.zmqDACSocket.connect("tcp://127.0.0.1:%i" % self.port)
         return start_nodes(self.num_nodes, self.options.tmpdir, extra_args=[
-            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port)],
+            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashtxhwm=500',
+             '-zmqpubdacmessage=tcp://127.0.0.1:'+str(self.port)],
             [],
             [],
             []
@@ -54,6 +61,9 @@ class ZMQTest (BitcoinTestFramework):
 
         assert_equal(genhashes[0], blkhash) #blockhash from generate must be equal to the hash received over zmq
 
+        # the coinbase carries the version message, so it is published on dacmessage
+        self.check_dacmessage(genhashes[0], 0)
+
         n = 10
         genhashes = self.nodes[1].generate(n)
         self.sync_all()
@@ -73,6 +83,10 @@ class ZMQTest (BitcoinTestFramework):
         for x in range(0,n):
             assert_equal(genhashes[x], zmqHashes[x]) #blockhash from generate must be equal to the hash received over zmq
 
+        # one dacmessage per coinbase, numbered without gaps
+        for x in range(0,n):
+            self.check_dacmessage(genhashes[x], x+1)
+
         #test tx from a second node
         hashRPC = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1.0)
         self.sync_all()
@@ -89,6 +103,25 @@ class ZMQTest (BitcoinTestFramework):
 
         assert_equal(hashRPC, hashZMQ) #blockhash from generate must be equal to the hash received over zmq
 
+        notifications = sorted(self.nodes[0].getzmqnotifications(), key=lambda n: n["type"])
+        assert_equal([n["type"] for n in notifications], ["pubdacmessage", "pubhashblock", "pubhashtx"])
+        for n in notifications:
+            assert_equal(n["address"], "tcp://127.0.0.1:%i" % self.port)
+            assert_equal(n["dropped"], 0)
+        assert_equal(notifications[0]["hwm"], 1000)
+        assert_equal(notifications[1]["hwm"], 1000)
+        assert_equal(notifications[2]["hwm"], 500)
+        assert_equal(self.nodes[1].getzmqnotifications(), [])
+
+    def check_dacmessage(self, blockhash, sequence):
+        msg = self.zmqDACSocket.recv_multipart()
+        assert_equal(msg[0], b"dacmessage")
+        msgSequence = struct.unpack('<I', msg[-1])[-1]
+        assert_equal(msgSequence, sequence)
+        body = json.loads(msg[1].decode('utf-8'))
+        assert_equal(body["txid"], self.nodes[0].getblock(blockhash)["tx"][0])
+        assert("type" not in body)
+
 
 if __name__ == '__main__':
     ZMQTest ().main ()
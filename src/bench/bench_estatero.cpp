@@ -4,6 +4,8 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
+#include "crypto/x11.h"
 #include "key.h"
 #include "stacktraces.h"
 #include "validation.h"
@@ -20,6 +22,8 @@ main(int argc, char** argv)
     RegisterPrettySignalHandlers();
     RegisterPrettyTerminateHander();
 
+    SHA256AutoDetect();
+    X11AutoDetect();
     ECC_Start();
     ECCVerifyHandle verifyHandle;
 
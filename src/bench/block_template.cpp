@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "consensus/merkle.h"
+#include "miner.h"
+#include "pubkey.h"
+#include "random.h"
+#include "script/standard.h"
+
+// Handing out stratum work for a block template of a full mempool. The template itself is built once, each work unit
+// only gets its own coinbase (payee, extra nonce) and RandomX header.
+
+static const size_t TEMPLATE_TX_COUNT = 3000;
+
+static CBlock BuildTemplateBlock()
+{
+    CBlock block;
+    block.hashPrevBlock = GetRandHash();
+
+    CMutableTransaction coinbaseTx;
+    coinbaseTx.vin.resize(1);
+    coinbaseTx.vin[0].prevout.SetNull();
+    coinbaseTx.vout.resize(1);
+    coinbaseTx.vout[0].nValue = 5000 * COIN;
+    block.vtx.emplace_back(MakeTransactionRef(std::move(coinbaseTx)));
+
+    for (size_t i = 0; i < TEMPLATE_TX_COUNT; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        tx.vout.resize(2);
+        tx.vout[0].nValue = COIN;
+        tx.vout[0].scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, 3))));
+        tx.vout[1].nValue = COIN;
+        tx.vout[1].scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, 4))));
+        block.vtx.emplace_back(MakeTransactionRef(std::move(tx)));
+    }
+    return block;
+}
+
+// What every stratum request did before: copy the new template and hash the whole merkle tree again
+static void BlockTemplateFullMerkle(benchmark::State& state)
+{
+    CBlock blockTemplate = BuildTemplateBlock();
+    CBlockIndex indexPrev;
+    indexPrev.nHeight = 100000;
+    CScript scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, 5))));
+    unsigned int nExtraNonce = 0;
+
+    while (state.KeepRunning()) {
+        CBlock block = blockTemplate;
+        CMutableTransaction txCoinbase(*block.vtx[0]);
+        txCoinbase.vout[0].scriptPubKey = scriptPubKey;
+        block.vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+        IncrementExtraNonce(&block, &indexPrev, nExtraNonce);
+    }
+}
+
+static void BlockTemplateCachedWork(benchmark::State& state)
+{
+    CBlock blockTemplate = BuildTemplateBlock();
+    std::vector<uint256> vCoinbaseMerkleBranch = BlockMerkleBranch(blockTemplate, 0);
+    CScript scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, 5))));
+    uint256 uRandomXKey = GetRandHash();
+    std::vector<unsigned char> vRandomXHeader(32, 6);
+    unsigned int nExtraNonce = 0;
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        CreateWorkFromTemplate(blockTemplate, vCoinbaseMerkleBranch, 100001, scriptPubKey, true, uRandomXKey, vRandomXHeader, ++nExtraNonce, block);
+    }
+
+    // the merkle root from the branch must match the one of the full tree
+    CBlock block;
+    CreateWorkFromTemplate(blockTemplate, vCoinbaseMerkleBranch, 100001, scriptPubKey, true, uRandomXKey, vRandomXHeader, nExtraNonce, block);
+    assert(block.hashMerkleRoot == BlockMerkleRoot(block));
+}
+
+BENCHMARK(BlockTemplateFullMerkle);
+BENCHMARK(BlockTemplateCachedWork);
@@ -14,6 +14,7 @@
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
+#include "crypto/x11.h"
 
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
@@ -42,6 +43,17 @@ static void HASH_SHA256(benchmark::State& state)
         CSHA256().Write(in.data(), in.size()).Finalize(hash);
 }
 
+/** Run a hash bench on one SHA256 backend only; a backend the CPU lacks falls back to the standard one. */
+static void SHA256Using(sha256_implementation::UseImplementation use, void (*bench)(benchmark::State&), benchmark::State& state)
+{
+    SHA256AutoDetect(use);
+    bench(state);
+    SHA256AutoDetect();
+}
+
+static void HASH_SHA256_STANDARD(benchmark::State& state) { SHA256Using(sha256_implementation::STANDARD, HASH_SHA256, state); }
+static void HASH_SHA256_SHANI(benchmark::State& state) { SHA256Using(sha256_implementation::USE_SHANI, HASH_SHA256, state); }
+
 static void HASH_SHA256_0032b(benchmark::State& state)
 {
     std::vector<uint8_t> in(32,0);
@@ -60,6 +72,22 @@ static void HASH_DSHA256(benchmark::State& state)
         CHash256().Write(in.data(), in.size()).Finalize(hash);
 }
 
+static void HASH_DSHA256_STANDARD(benchmark::State& state) { SHA256Using(sha256_implementation::STANDARD, HASH_DSHA256, state); }
+static void HASH_DSHA256_SHANI(benchmark::State& state) { SHA256Using(sha256_implementation::USE_SHANI, HASH_DSHA256, state); }
+
+/** One level of a 2048 leaf merkle tree. */
+static void HASH_SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+        SHA256D64(in.data(), in.data(), 1024);
+}
+
+static void HASH_SHA256D64_1024_STANDARD(benchmark::State& state) { SHA256Using(sha256_implementation::STANDARD, HASH_SHA256D64_1024, state); }
+static void HASH_SHA256D64_1024_SSE41(benchmark::State& state) { SHA256Using(sha256_implementation::USE_SSE41, HASH_SHA256D64_1024, state); }
+static void HASH_SHA256D64_1024_AVX2(benchmark::State& state) { SHA256Using(sha256_implementation::USE_AVX2, HASH_SHA256D64_1024, state); }
+static void HASH_SHA256D64_1024_SHANI(benchmark::State& state) { SHA256Using(sha256_implementation::USE_SHANI, HASH_SHA256D64_1024, state); }
+
 static void HASH_DSHA256_0032b(benchmark::State& state)
 {
     std::vector<uint8_t> in(32,0);
@@ -186,12 +214,30 @@ static void HASH_X11_2048b_single(benchmark::State& state)
         hash = HashX11(in.begin(), in.end());
 }
 
+static void HASH_X11_0080b_batch(benchmark::State& state)
+{
+    // a full headers message
+    std::vector<uint8_t> in(80 * 2000, 0);
+    std::vector<uint8_t> out(32 * 2000);
+    while (state.KeepRunning())
+        X11Batch(out.data(), in.data(), 80, 2000);
+}
+
 BENCHMARK(HASH_RIPEMD160);
 BENCHMARK(HASH_SHA1);
 BENCHMARK(HASH_SHA256);
 BENCHMARK(HASH_DSHA256);
 BENCHMARK(HASH_SHA512);
 BENCHMARK(HASH_X11);
+BENCHMARK(HASH_SHA256_STANDARD);
+BENCHMARK(HASH_SHA256_SHANI);
+BENCHMARK(HASH_DSHA256_STANDARD);
+BENCHMARK(HASH_DSHA256_SHANI);
+BENCHMARK(HASH_SHA256D64_1024);
+BENCHMARK(HASH_SHA256D64_1024_STANDARD);
+BENCHMARK(HASH_SHA256D64_1024_SSE41);
+BENCHMARK(HASH_SHA256D64_1024_AVX2);
+BENCHMARK(HASH_SHA256D64_1024_SHANI);
 
 BENCHMARK(HASH_SHA256_0032b);
 BENCHMARK(HASH_DSHA256_0032b);
@@ -209,3 +255,4 @@ BENCHMARK(HASH_X11_0128b_single);
 BENCHMARK(HASH_X11_0512b_single);
 BENCHMARK(HASH_X11_1024b_single);
 BENCHMARK(HASH_X11_2048b_single);
+BENCHMARK(HASH_X11_0080b_batch);
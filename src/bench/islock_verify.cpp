@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "dbwrapper.h"
+#include "random.h"
+
+#include "bls/bls_batchverifier.h"
+#include "llmq/quorums_signing.h"
+
+// Synthetic ISLOCKs signed by a few quorums, verified the way CInstantSendManager::ProcessPendingInstantSendLocks does
+// it. Every lock comes from a different node, so that a sub batch only falls back to per source verification when
+// it contains a bad sig.
+
+static const size_t ISLOCK_COUNT = 2000;
+static const size_t QUORUM_COUNT = 4;
+
+struct SyntheticISLock {
+    uint256 hash;
+    uint256 signHash;
+    size_t quorumIdx;
+    CBLSLazySignature sig;
+};
+
+static void BuildISLocks(std::vector<CBLSPublicKey>& quorumPubKeys, std::vector<SyntheticISLock>& islocks)
+{
+    std::vector<CBLSSecretKey> quorumSecKeys(QUORUM_COUNT);
+    quorumPubKeys.resize(QUORUM_COUNT);
+    for (size_t i = 0; i < QUORUM_COUNT; i++) {
+        quorumSecKeys[i].MakeNewKey();
+        quorumPubKeys[i] = quorumSecKeys[i].GetPublicKey();
+    }
+
+    islocks.resize(ISLOCK_COUNT);
+    for (size_t i = 0; i < ISLOCK_COUNT; i++) {
+        auto& islock = islocks[i];
+        islock.hash = GetRandHash();
+        islock.signHash = GetRandHash();
+        islock.quorumIdx = i % QUORUM_COUNT;
+        islock.sig.Set(quorumSecKeys[islock.quorumIdx].Sign(islock.signHash));
+    }
+}
+
+static void VerifyISLocks(benchmark::State& state, size_t subBatchSize)
+{
+    std::vector<CBLSPublicKey> quorumPubKeys;
+    std::vector<SyntheticISLock> islocks;
+    BuildISLocks(quorumPubKeys, islocks);
+
+    while (state.KeepRunning()) {
+        CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, subBatchSize);
+        NodeId nodeId = 0;
+        for (const auto& islock : islocks) {
+            batchVerifier.PushMessage(nodeId++, islock.hash, islock.signHash, islock.sig.Get(), quorumPubKeys[islock.quorumIdx]);
+        }
+        batchVerifier.Verify();
+        assert(batchVerifier.badSources.empty());
+    }
+}
+
+static void ISLockVerifyBatch8(benchmark::State& state)
+{
+    VerifyISLocks(state, 8);
+}
+
+static void ISLockVerifyBatch32(benchmark::State& state)
+{
+    VerifyISLocks(state, 32);
+}
+
+static void ISLockVerifyBatch128(benchmark::State& state)
+{
+    VerifyISLocks(state, 128);
+}
+
+// All recovered sigs were verified before (e.g. received as QSIGREC first), so every lock is accepted from the cache
+static void ISLockVerifyCached(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+
+    std::vector<CBLSPublicKey> quorumPubKeys;
+    std::vector<SyntheticISLock> islocks;
+    BuildISLocks(quorumPubKeys, islocks);
+
+    CDBWrapper llmqDb("", 1 << 20, true, true);
+    llmq::CSigningManager signingManager(llmqDb, true);
+    for (const auto& islock : islocks) {
+        signingManager.AddVerifiedSig(islock.signHash, islock.sig);
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& islock : islocks) {
+            assert(signingManager.IsVerifiedSig(islock.signHash, islock.sig));
+        }
+    }
+}
+
+BENCHMARK(ISLockVerifyBatch8);
+BENCHMARK(ISLockVerifyBatch32);
+BENCHMARK(ISLockVerifyBatch128);
+BENCHMARK(ISLockVerifyCached);
@@ -0,0 +1,136 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "mempoolindex.h"
+#include "random.h"
+
+#include <atomic>
+#include <thread>
+
+// The mempool address and spent indexes of -addressindex/-spentindex with 50k txs, each spending one coin of and
+// paying to two of 5000 addresses.
+
+static const size_t MEMPOOL_TX_COUNT = 50000;
+static const size_t ADDRESS_COUNT = 5000;
+
+struct IndexedTx {
+    uint256 txhash;
+    std::vector<CMempoolAddressIndex::Entry> addressEntries;
+    std::vector<CMempoolSpentIndex::Entry> spentEntries;
+};
+
+static std::vector<uint160> BuildAddresses()
+{
+    std::vector<uint160> addresses(ADDRESS_COUNT);
+    for (auto& address : addresses) {
+        GetRandBytes(address.begin(), address.size());
+    }
+    return addresses;
+}
+
+static std::vector<IndexedTx> BuildTxs(const std::vector<uint160>& addresses, size_t nCount)
+{
+    FastRandomContext rng(true);
+    std::vector<IndexedTx> txs(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        IndexedTx& tx = txs[i];
+        tx.txhash = GetRandHash();
+        uint256 prevHash = GetRandHash();
+
+        const uint160& from = addresses[rng.rand32() % addresses.size()];
+        tx.addressEntries.emplace_back(CMempoolAddressDeltaKey(1, from, tx.txhash, 0, 1), CMempoolAddressDelta(i, -2 * COIN, prevHash, 0));
+        for (unsigned int n = 0; n < 2; n++) {
+            const uint160& to = addresses[rng.rand32() % addresses.size()];
+            tx.addressEntries.emplace_back(CMempoolAddressDeltaKey(1, to, tx.txhash, n, 0), CMempoolAddressDelta(i, COIN));
+        }
+        tx.spentEntries.emplace_back(CSpentIndexKey(prevHash, 0), CSpentIndexValue(tx.txhash, 0, -1, 2 * COIN, 1, from));
+    }
+    return txs;
+}
+
+static void MempoolAddressIndexAddRemove(benchmark::State& state)
+{
+    std::vector<uint160> addresses = BuildAddresses();
+    std::vector<IndexedTx> txs = BuildTxs(addresses, MEMPOOL_TX_COUNT);
+
+    CMempoolAddressIndex addressIndex;
+    CMempoolSpentIndex spentIndex;
+    while (state.KeepRunning()) {
+        for (const auto& tx : txs) {
+            addressIndex.Insert(tx.txhash, tx.addressEntries);
+            spentIndex.Insert(tx.txhash, tx.spentEntries);
+        }
+        for (const auto& tx : txs) {
+            addressIndex.Remove(tx.txhash);
+            spentIndex.Remove(tx.txhash);
+        }
+    }
+}
+
+static void LookupAddresses(benchmark::State& state, bool fContended)
+{
+    std::vector<uint160> addresses = BuildAddresses();
+    std::vector<IndexedTx> txs = BuildTxs(addresses, MEMPOOL_TX_COUNT);
+    std::vector<IndexedTx> txsChurn = BuildTxs(addresses, 1000);
+
+    CMempoolAddressIndex addressIndex;
+    CMempoolSpentIndex spentIndex;
+    for (const auto& tx : txs) {
+        addressIndex.Insert(tx.txhash, tx.addressEntries);
+        spentIndex.Insert(tx.txhash, tx.spentEntries);
+    }
+
+    // transaction acceptance and block connection going on in the background
+    std::atomic<bool> fStop{false};
+    std::thread churnThread;
+    if (fContended) {
+        churnThread = std::thread([&]() {
+            while (!fStop) {
+                for (const auto& tx : txsChurn) {
+                    addressIndex.Insert(tx.txhash, tx.addressEntries);
+                    spentIndex.Insert(tx.txhash, tx.spentEntries);
+                }
+                for (const auto& tx : txsChurn) {
+                    addressIndex.Remove(tx.txhash);
+                    spentIndex.Remove(tx.txhash);
+                }
+            }
+        });
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (size_t j = 0; j < 100; j++, i++) {
+            std::vector<std::pair<uint160, int> > query{{addresses[i % addresses.size()], 1}};
+            std::vector<CMempoolAddressIndex::Entry> results;
+            addressIndex.Get(query, results);
+            assert(!results.empty() || fContended);
+
+            CSpentIndexValue value;
+            spentIndex.Get(txs[i % txs.size()].spentEntries[0].first, value);
+        }
+    }
+
+    if (fContended) {
+        fStop = true;
+        churnThread.join();
+    }
+}
+
+static void MempoolAddressIndexLookup(benchmark::State& state)
+{
+    LookupAddresses(state, false);
+}
+
+static void MempoolAddressIndexLookupContended(benchmark::State& state)
+{
+    LookupAddresses(state, true);
+}
+
+BENCHMARK(MempoolAddressIndexAddRemove);
+BENCHMARK(MempoolAddressIndexLookup);
+BENCHMARK(MempoolAddressIndexLookupContended);
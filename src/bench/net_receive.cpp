@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "net.h"
+#include "net_processing.h"
+#include "streams.h"
+
+#include "bench/data/block813851.raw.h"
+
+// Feeds a serialized block through the receive path of a peer the way the socket handler does and lets the message
+// handler pick it up. The peer has not sent a VERSION yet, so ProcessMessage rejects the block right after the checksum
+// check, which keeps block validation out of the measurement.
+
+static const size_t RECV_CHUNK_SIZE = 0x10000;
+
+static std::vector<unsigned char> MakeBlockMessage()
+{
+    std::vector<unsigned char> vPayload(raw_bench::block813851, raw_bench::block813851 + sizeof(raw_bench::block813851));
+    CMessageHeader hdr(Params().MessageStart(), NetMsgType::BLOCK, vPayload.size());
+    uint256 hash = Hash(vPayload.begin(), vPayload.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+
+    std::vector<unsigned char> vMsg;
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, vMsg, 0, hdr};
+    vMsg.insert(vMsg.end(), vPayload.begin(), vPayload.end());
+    return vMsg;
+}
+
+static void ReceiveBlock(benchmark::State& state, bool fDirect)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const std::vector<unsigned char> vMsg = MakeBlockMessage();
+
+    CConnman connman(0x1337, 0x1337);
+    std::atomic<bool> interrupt(false);
+    CAddress addr(CService(CNetAddr(), Params().GetDefaultPort()), NODE_NONE);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+    node.fSuccessfullyConnected = true;
+
+    while (state.KeepRunning()) {
+        size_t nPos = 0;
+        while (nPos < vMsg.size()) {
+            bool complete = false;
+            char* pch;
+            unsigned int nSize;
+            if (fDirect && (nSize = node.GetRecvDataBuffer(pch)) != 0) {
+                // stands in for recv() writing into the message buffer
+                nSize = std::min<size_t>(nSize, std::min(RECV_CHUNK_SIZE, vMsg.size() - nPos));
+                memcpy(pch, &vMsg[nPos], nSize);
+                assert(node.ReceivedMsgData(nSize, complete));
+            } else {
+                char pchBuf[RECV_CHUNK_SIZE];
+                nSize = std::min(RECV_CHUNK_SIZE, vMsg.size() - nPos);
+                memcpy(pchBuf, &vMsg[nPos], nSize);
+                assert(node.ReceiveMsgBytes(pchBuf, nSize, complete));
+            }
+            nPos += nSize;
+            if (complete)
+                node.QueueCompletedMessages(connman.GetReceiveFloodSize());
+        }
+        ProcessMessages(&node, connman, interrupt);
+    }
+}
+
+static void ReceiveBlockCopy(benchmark::State& state)
+{
+    ReceiveBlock(state, false);
+}
+
+static void ReceiveBlockInPlace(benchmark::State& state)
+{
+    ReceiveBlock(state, true);
+}
+
+BENCHMARK(ReceiveBlockCopy);
+BENCHMARK(ReceiveBlockInPlace);
@@ -0,0 +1,89 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "random.h"
+
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "llmq/quorums_utils.h"
+
+static const size_t MN_COUNT = 5000;
+
+static CDeterministicMNList BuildMNList(const uint256& blockHash, size_t nCount)
+{
+    CDeterministicMNList mnList(blockHash, 0, 0);
+    for (size_t i = 0; i < nCount; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        dmn->internalId = i;
+        dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+        dmn->nOperatorReward = 0;
+
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        GetRandBytes(dmnState->keyIDOwner.begin(), dmnState->keyIDOwner.size());
+        dmnState->UpdateConfirmedHash(dmn->proTxHash, GetRandHash());
+        dmn->pdmnState = dmnState;
+
+        mnList.AddMN(dmn);
+    }
+    mnList.SetTotalRegisteredCount(nCount);
+    return mnList;
+}
+
+// Scores all MNs and selects the members, which is what every lookup did before members were cached
+static void QuorumCalculate5000(benchmark::State& state)
+{
+    auto mnList = BuildMNList(GetRandHash(), MN_COUNT);
+    uint256 modifier = GetRandHash();
+
+    while (state.KeepRunning()) {
+        auto members = mnList.CalculateQuorum(50, modifier);
+        assert(members.size() == 50);
+    }
+}
+
+static void QuorumScores5000(benchmark::State& state)
+{
+    auto mnList = BuildMNList(GetRandHash(), MN_COUNT);
+    uint256 modifier = GetRandHash();
+
+    while (state.KeepRunning()) {
+        auto scores = mnList.CalculateScores(modifier);
+        assert(scores.size() == MN_COUNT);
+    }
+}
+
+// Repeated member lookups for the same quorum, as done while signing and routing sig shares
+static void QuorumMembersCached5000(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+
+    uint256 blockHash = GetRandHash();
+    CBlockIndex index;
+    index.phashBlock = &blockHash;
+    index.nHeight = 0;
+
+    evoDb = new CEvoDB(1 << 20, true, true);
+    deterministicMNManager = new CDeterministicMNManager(*evoDb);
+    // store the list as a snapshot for the quorum block, so that the first lookup finds it
+    evoDb->Write(std::make_pair(std::string("dmn_S"), blockHash), BuildMNList(blockHash, MN_COUNT));
+
+    while (state.KeepRunning()) {
+        auto members = llmq::CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQ_50_60, &index);
+        assert(members.size() == 50);
+    }
+
+    delete deterministicMNManager;
+    deterministicMNManager = nullptr;
+    delete evoDb;
+    evoDb = nullptr;
+}
+
+BENCHMARK(QuorumCalculate5000);
+BENCHMARK(QuorumScores5000);
+BENCHMARK(QuorumMembersCached5000);
@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "random.h"
+
+#include "evo/simplifiedmns.h"
+
+static const size_t MN_COUNT = 5000;
+// roughly what a block changes in the MN list (PoSe punishments, confirmations, new registrations)
+static const size_t CHANGES_PER_BLOCK = 3;
+
+static std::vector<CSimplifiedMNListEntry> BuildEntries(size_t nCount)
+{
+    std::vector<CSimplifiedMNListEntry> entries(nCount);
+    for (auto& e : entries) {
+        e.proRegTxHash = GetRandHash();
+        e.confirmedHash = GetRandHash();
+        GetRandBytes(e.keyIDVoting.begin(), e.keyIDVoting.size());
+        e.isValid = true;
+    }
+    return entries;
+}
+
+// What CalcCbTxMerkleRootMNList did for every block before the tree was kept between blocks
+static void SimplifiedMNListMerkleRootFull5000(benchmark::State& state)
+{
+    auto entries = BuildEntries(MN_COUNT);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < CHANGES_PER_BLOCK; i++) {
+            entries[GetRand(entries.size())].confirmedHash = GetRandHash();
+        }
+        CSimplifiedMNList sml(entries);
+        bool mutated;
+        sml.CalcMerkleRoot(&mutated);
+        assert(!mutated);
+    }
+}
+
+static void SimplifiedMNListMerkleRootIncremental5000(benchmark::State& state)
+{
+    auto entries = BuildEntries(MN_COUNT);
+    CSimplifiedMNListMerkleTree tree;
+    for (const auto& e : entries) {
+        tree.AddOrUpdate(e);
+    }
+    tree.CalcMerkleRoot();
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < CHANGES_PER_BLOCK; i++) {
+            auto& e = entries[GetRand(entries.size())];
+            e.confirmedHash = GetRandHash();
+            tree.AddOrUpdate(e);
+        }
+        bool mutated;
+        tree.CalcMerkleRoot(&mutated);
+        assert(!mutated);
+    }
+}
+
+BENCHMARK(SimplifiedMNListMerkleRootFull5000);
+BENCHMARK(SimplifiedMNListMerkleRootIncremental5000);
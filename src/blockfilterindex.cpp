@@ -0,0 +1,177 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilterindex.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "undo.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+static const char DB_FILTER = 'f';
+static const char DB_BEST_BLOCK = 'B';
+
+CBlockFilterIndex* blockFilterIndex;
+
+CBlockFilterIndex::CBlockFilterIndex(BlockFilterType _filterType, size_t nCacheSize, bool fMemory, bool fWipe) :
+    filterType(_filterType)
+{
+    const std::string& name = BlockFilterTypeName(filterType);
+    if (name.empty()) {
+        throw std::invalid_argument("unknown filter type");
+    }
+    db.reset(new CDBWrapper(fMemory ? "" : (GetDataDir() / "indexes" / "blockfilter" / name), nCacheSize, fMemory, fWipe));
+
+    uint256 bestBlockHash;
+    if (db->Read(DB_BEST_BLOCK, bestBlockHash)) {
+        LOCK(cs_main);
+        auto it = mapBlockIndex.find(bestBlockHash);
+        if (it != mapBlockIndex.end()) {
+            // all ancestors of the best block have a filter as well, so continue at the fork point in case the best
+            // block got disconnected while we were not running
+            pindexBest = chainActive.FindFork(it->second);
+        }
+    }
+}
+
+CBlockFilterIndex::~CBlockFilterIndex()
+{
+}
+
+void CBlockFilterIndex::StartWorkerThread()
+{
+    // can't start new thread if we have one running already
+    if (workThread.joinable()) {
+        assert(false);
+    }
+
+    workThread = std::thread(&TraceThread<std::function<void()> >,
+        "blockfilter",
+        std::function<void()>(std::bind(&CBlockFilterIndex::WorkThreadMain, this)));
+}
+
+void CBlockFilterIndex::InterruptWorkerThread()
+{
+    workInterrupt();
+}
+
+void CBlockFilterIndex::StopWorkerThread()
+{
+    // make sure to call InterruptWorkerThread() first
+    if (!workInterrupt) {
+        assert(false);
+    }
+
+    if (workThread.joinable()) {
+        workThread.join();
+    }
+}
+
+const CBlockIndex* CBlockFilterIndex::GetBestBlockIndex() const
+{
+    LOCK(cs);
+    return pindexBest;
+}
+
+bool CBlockFilterIndex::LookupFilter(const CBlockIndex* pindex, BlockFilter& filterRet) const
+{
+    std::pair<uint256, std::vector<unsigned char>> entry;
+    if (!db->Read(std::make_pair(DB_FILTER, pindex->GetBlockHash()), entry)) {
+        return false;
+    }
+
+    try {
+        filterRet = BlockFilter(filterType, pindex->GetBlockHash(), std::move(entry.second));
+    } catch (const std::exception& e) {
+        return error("%s: invalid filter for block %s: %s", __func__, pindex->GetBlockHash().ToString(), e.what());
+    }
+    return true;
+}
+
+bool CBlockFilterIndex::LookupFilterHeader(const CBlockIndex* pindex, uint256& headerRet) const
+{
+    std::pair<uint256, std::vector<unsigned char>> entry;
+    if (!db->Read(std::make_pair(DB_FILTER, pindex->GetBlockHash()), entry)) {
+        return false;
+    }
+    headerRet = entry.first;
+    return true;
+}
+
+bool CBlockFilterIndex::WriteFilter(const CBlockIndex* pindex)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    CBlockUndo blockUndo;
+    uint256 prevHeader;
+    if (pindex->pprev) {
+        CDiskBlockPos pos;
+        {
+            LOCK(cs_main);
+            pos = pindex->GetUndoPos();
+        }
+        if (pos.IsNull() || !UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
+            return error("%s: failed to read undo data of block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!LookupFilterHeader(pindex->pprev, prevHeader)) {
+            return error("%s: missing filter header of block %s", __func__, pindex->pprev->GetBlockHash().ToString());
+        }
+    }
+
+    BlockFilter filter(filterType, block, blockUndo);
+
+    CDBBatch batch(*db);
+    batch.Write(std::make_pair(DB_FILTER, pindex->GetBlockHash()), std::make_pair(filter.ComputeHeader(prevHeader), filter.GetEncodedFilter()));
+    batch.Write(DB_BEST_BLOCK, pindex->GetBlockHash());
+    return db->WriteBatch(batch);
+}
+
+void CBlockFilterIndex::WorkThreadMain()
+{
+    int64_t nLastLogTime = GetTimeMillis();
+
+    while (!workInterrupt) {
+        const CBlockIndex* pindexNext;
+        {
+            LOCK2(cs_main, cs);
+            if (pindexBest && !chainActive.Contains(pindexBest)) {
+                // filters are stored by block hash, so the ones of the disconnected blocks can simply stay
+                pindexBest = chainActive.FindFork(pindexBest);
+            }
+            pindexNext = pindexBest ? chainActive.Next(pindexBest) : chainActive.Genesis();
+        }
+
+        if (!pindexNext) {
+            if (!fSynced) {
+                LogPrintf("CBlockFilterIndex::%s -- %s filter index is synced at height %d\n", __func__,
+                          BlockFilterTypeName(filterType), GetBestBlockIndex() ? GetBestBlockIndex()->nHeight : -1);
+                fSynced = true;
+            }
+            workInterrupt.sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        if (!WriteFilter(pindexNext)) {
+            LogPrintf("CBlockFilterIndex::%s -- failed to index block %s, stopping %s filter index\n", __func__,
+                      pindexNext->GetBlockHash().ToString(), BlockFilterTypeName(filterType));
+            return;
+        }
+
+        {
+            LOCK(cs);
+            pindexBest = pindexNext;
+        }
+
+        if (!fSynced && GetTimeMillis() - nLastLogTime >= 30000) {
+            nLastLogTime = GetTimeMillis();
+            LogPrintf("CBlockFilterIndex::%s -- building %s filter index, at height %d\n", __func__,
+                      BlockFilterTypeName(filterType), pindexNext->nHeight);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_BLOCKFILTERINDEX_H
+#define COIN_BLOCKFILTERINDEX_H
+
+#include "blockfilter.h"
+#include "dbwrapper.h"
+#include "sync.h"
+#include "threadinterrupt.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+class CBlockIndex;
+
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+
+/**
+ * Keeps BIP158 block filters of all blocks of the active chain in its own database (indexes/blockfilter/<type>).
+ * Filters and filter headers are stored by block hash, so that entries of blocks which got disconnected stay valid
+ * and a reorg only needs to move the best block back to the fork point.
+ *
+ * A worker thread builds the filters for the existing chain in the background and then follows the active chain.
+ * It reads blocks and undo data from disk and only takes cs_main briefly to find the next block.
+ */
+class CBlockFilterIndex
+{
+private:
+    BlockFilterType filterType;
+    std::unique_ptr<CDBWrapper> db;
+
+    mutable CCriticalSection cs;
+    // the last block of the active chain which has a filter, null before the genesis block was indexed
+    const CBlockIndex* pindexBest{nullptr};
+    std::atomic<bool> fSynced{false};
+
+    std::thread workThread;
+    CThreadInterrupt workInterrupt;
+
+public:
+    CBlockFilterIndex(BlockFilterType _filterType, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CBlockFilterIndex();
+
+    void StartWorkerThread();
+    void InterruptWorkerThread();
+    void StopWorkerThread();
+
+    BlockFilterType GetFilterType() const { return filterType; }
+
+    /** Whether the index caught up with the active chain at least once */
+    bool IsSynced() const { return fSynced; }
+    const CBlockIndex* GetBestBlockIndex() const;
+
+    bool LookupFilter(const CBlockIndex* pindex, BlockFilter& filterRet) const;
+    bool LookupFilterHeader(const CBlockIndex* pindex, uint256& headerRet) const;
+
+private:
+    void WorkThreadMain();
+    // builds and stores the filter of pindex, the filter of its parent must exist already
+    bool WriteFilter(const CBlockIndex* pindex);
+};
+
+extern CBlockFilterIndex* blockFilterIndex;
+
+#endif // COIN_BLOCKFILTERINDEX_H
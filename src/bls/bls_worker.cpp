@@ -887,6 +887,14 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
     return sigVerifyBatchesInProgress != 0;
 }
 
+std::future<void> CBLSWorker::AsyncRun(std::function<void()> func)
+{
+    auto f = [func](int threadId) {
+        func();
+    };
+    return workerPool.push(f);
+}
+
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
@@ -139,6 +139,9 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Runs work which is already batched by the caller (e.g. a CBLSBatchVerifier) on the worker pool
+    std::future<void> AsyncRun(std::function<void()> func);
+
 private:
     void PushSigVerifyBatch();
 };
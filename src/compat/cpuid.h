@@ -0,0 +1,35 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COMPAT_CPUID_H
+#define BITCOIN_COMPAT_CPUID_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#define HAVE_GETCPUID
+
+#include <cpuid.h>
+
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+inline void GetCPUID(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+}
+
+/** Check whether the OS saves the AVX (ymm) registers on context switches. */
+inline bool AVXEnabled()
+{
+    uint32_t a, b, c, d;
+    GetCPUID(1, 0, a, b, c, d);
+    if (!((c >> 27) & 1)) { // OSXSAVE
+        return false;
+    }
+    uint32_t xcr0, xcr0h;
+    __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0h) : "c"(0));
+    return (xcr0 & 6) == 6; // XMM and YMM state
+}
+
+#endif // defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#endif // BITCOIN_COMPAT_CPUID_H
@@ -0,0 +1,200 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA-256 using the Intel SHA extensions. The state lives in two registers in the order the sha256rnds2 instruction
+// expects (ABEF and CDGH), and each QuadRound runs four rounds.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(16) const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/** The second block of a 64-byte message is only padding, so its expanded schedule (plus the round constants) is fixed. */
+alignas(16) const uint32_t PADDING_SCHEDULE[64] = {
+    0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf374,
+    0x649b69c1, 0xf0fe4786, 0x0fe1edc6, 0x240cf254, 0x4fe9346f, 0x6cc984be, 0x61b9411e, 0x16f988fa,
+    0xf2c65152, 0xa88e5a6d, 0xb019fc65, 0xb9d99ec7, 0x9a1231c3, 0xe70eeaa0, 0xfdb1232b, 0xc7353eb0,
+    0x3069bad5, 0xcb976d5f, 0x5a0f118f, 0xdc1eeefd, 0x0a35b689, 0xde0b7a04, 0x58f4ca9d, 0xe15d5b16,
+    0x007f3e86, 0x37088980, 0xa507ea32, 0x6fab9537, 0x17406110, 0x0d8cd6f1, 0xcdaa3b6d, 0xc0bbbe37,
+    0x83613bda, 0xdb48a363, 0x0b02e931, 0x6fd15ca7, 0x521afaca, 0x31338431, 0x6ed41a95, 0x6d437890,
+    0xc39c91f2, 0x9eccabbd, 0xb5c9a0e6, 0x532fb63c, 0xd2c741c6, 0x07237ea3, 0xa4954b68, 0x4c191d76,
+};
+
+alignas(16) const uint32_t INIT[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+
+/** Byte swap each 32-bit word. */
+__m128i inline BSwap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+}
+
+/** Turn s[0..3], s[4..7] into ABEF, CDGH. */
+void inline Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** Turn ABEF, CDGH back into s[0..3], s[4..7]. */
+void inline Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+/** Four rounds, k holds the round constants plus the message words. */
+void inline QuadRound(__m128i& s0, __m128i& s1, __m128i k)
+{
+    s1 = _mm_sha256rnds2_epu32(s1, s0, k);
+    s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(k, 0x0e));
+}
+
+/** Rounds 4i..4i+3, with m[i & 3] holding message words 4i..4i+3. Also expands the schedule for the later rounds. */
+template<int i>
+void inline Step(__m128i& s0, __m128i& s1, __m128i* m)
+{
+    QuadRound(s0, s1, _mm_add_epi32(m[i & 3], _mm_load_si128((const __m128i*)(K256 + 4 * i))));
+    if (i >= 3 && i <= 14) {
+        m[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(m[(i + 1) & 3], _mm_alignr_epi8(m[i & 3], m[(i + 3) & 3], 4)), m[i & 3]);
+    }
+    if (i >= 1 && i <= 12) {
+        m[(i + 3) & 3] = _mm_sha256msg1_epu32(m[(i + 3) & 3], m[i & 3]);
+    }
+}
+
+/** One block on the shuffled state. */
+void inline Rounds(__m128i& s0, __m128i& s1, __m128i* m)
+{
+    const __m128i so0 = s0, so1 = s1;
+    Step<0>(s0, s1, m); Step<1>(s0, s1, m); Step<2>(s0, s1, m); Step<3>(s0, s1, m);
+    Step<4>(s0, s1, m); Step<5>(s0, s1, m); Step<6>(s0, s1, m); Step<7>(s0, s1, m);
+    Step<8>(s0, s1, m); Step<9>(s0, s1, m); Step<10>(s0, s1, m); Step<11>(s0, s1, m);
+    Step<12>(s0, s1, m); Step<13>(s0, s1, m); Step<14>(s0, s1, m); Step<15>(s0, s1, m);
+    s0 = _mm_add_epi32(s0, so0);
+    s1 = _mm_add_epi32(s1, so1);
+}
+
+/** Two independent blocks, interleaved so the rounds of one fill the latency of the other. */
+template<int i>
+void inline Step2(__m128i& as0, __m128i& as1, __m128i* am, __m128i& bs0, __m128i& bs1, __m128i* bm)
+{
+    Step<i>(as0, as1, am);
+    Step<i>(bs0, bs1, bm);
+}
+
+void inline Rounds2(__m128i& as0, __m128i& as1, __m128i* am, __m128i& bs0, __m128i& bs1, __m128i* bm)
+{
+    const __m128i aso0 = as0, aso1 = as1, bso0 = bs0, bso1 = bs1;
+    Step2<0>(as0, as1, am, bs0, bs1, bm); Step2<1>(as0, as1, am, bs0, bs1, bm);
+    Step2<2>(as0, as1, am, bs0, bs1, bm); Step2<3>(as0, as1, am, bs0, bs1, bm);
+    Step2<4>(as0, as1, am, bs0, bs1, bm); Step2<5>(as0, as1, am, bs0, bs1, bm);
+    Step2<6>(as0, as1, am, bs0, bs1, bm); Step2<7>(as0, as1, am, bs0, bs1, bm);
+    Step2<8>(as0, as1, am, bs0, bs1, bm); Step2<9>(as0, as1, am, bs0, bs1, bm);
+    Step2<10>(as0, as1, am, bs0, bs1, bm); Step2<11>(as0, as1, am, bs0, bs1, bm);
+    Step2<12>(as0, as1, am, bs0, bs1, bm); Step2<13>(as0, as1, am, bs0, bs1, bm);
+    Step2<14>(as0, as1, am, bs0, bs1, bm); Step2<15>(as0, as1, am, bs0, bs1, bm);
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, bso0);
+    bs1 = _mm_add_epi32(bs1, bso1);
+}
+
+/** The padding block of a 64-byte message, for two states. */
+void inline PaddingRounds2(__m128i& as0, __m128i& as1, __m128i& bs0, __m128i& bs1)
+{
+    const __m128i aso0 = as0, aso1 = as1, bso0 = bs0, bso1 = bs1;
+    for (int i = 0; i < 16; i++) {
+        const __m128i k = _mm_load_si128((const __m128i*)(PADDING_SCHEDULE + 4 * i));
+        QuadRound(as0, as1, k);
+        QuadRound(bs0, bs1, k);
+    }
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, bso0);
+    bs1 = _mm_add_epi32(bs1, bso1);
+}
+
+/** Load message words from a block. */
+void inline Load(__m128i* m, const unsigned char* in)
+{
+    for (int i = 0; i < 4; i++) {
+        m[i] = BSwap(_mm_loadu_si128((const __m128i*)(in + 16 * i)));
+    }
+}
+
+} // namespace
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s), s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+    while (blocks--) {
+        __m128i m[4];
+        Load(m, chunk);
+        Rounds(s0, s1, m);
+        chunk += 64;
+    }
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i as0 = _mm_load_si128((const __m128i*)INIT), as1 = _mm_load_si128((const __m128i*)(INIT + 4));
+    Shuffle(as0, as1);
+    const __m128i init0 = as0, init1 = as1;
+    __m128i bs0 = as0, bs1 = as1;
+    __m128i am[4], bm[4];
+
+    // first hash: the message block, then the padding block
+    Load(am, in);
+    Load(bm, in + 64);
+    Rounds2(as0, as1, am, bs0, bs1, bm);
+    PaddingRounds2(as0, as1, bs0, bs1);
+
+    // second hash: the 32-byte first hash, padded to one block
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    am[0] = as0;
+    am[1] = as1;
+    bm[0] = bs0;
+    bm[1] = bs1;
+    am[2] = bm[2] = _mm_set_epi32(0, 0, 0, 0x80000000);
+    am[3] = bm[3] = _mm_set_epi32(0x100, 0, 0, 0);
+    as0 = bs0 = init0;
+    as1 = bs1 = init1;
+    Rounds2(as0, as1, am, bs0, bs1, bm);
+
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    _mm_storeu_si128((__m128i*)out, BSwap(as0));
+    _mm_storeu_si128((__m128i*)(out + 16), BSwap(as1));
+    _mm_storeu_si128((__m128i*)(out + 32), BSwap(bs0));
+    _mm_storeu_si128((__m128i*)(out + 48), BSwap(bs1));
+}
+} // namespace sha256d64_shani
+
+#endif
@@ -0,0 +1,239 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/x11.h"
+
+#include "compat/cpuid.h"
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_cubehash.h"
+#include "crypto/sph_echo.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_simd.h"
+#include "crypto/sph_skein.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace x11_aesni
+{
+void Groestl512(unsigned char* out, const unsigned char* in);
+void Shavite512(unsigned char* out, const unsigned char* in);
+void Echo512(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace x11_avx2
+{
+void Luffa512(unsigned char* out, const unsigned char* in);
+void Keccak512_4way(unsigned char* out, const unsigned char* in);
+}
+#endif
+#endif
+
+#if defined(__SSE2__)
+namespace x11_sse2
+{
+void CubeHash512(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+// Internal implementation code.
+namespace
+{
+/** One of the stages after blake: hashes 64 bytes into 64 bytes, the output may alias the input. */
+typedef void (*StageFn)(unsigned char* out, const unsigned char* in);
+
+namespace sph
+{
+#define SPH_X11_STAGE(name, algo) \
+void name(unsigned char* out, const unsigned char* in) \
+{ \
+    sph_##algo##_context ctx; \
+    sph_##algo##_init(&ctx); \
+    sph_##algo(&ctx, in, 64); \
+    sph_##algo##_close(&ctx, out); \
+}
+
+SPH_X11_STAGE(Bmw512, bmw512)
+SPH_X11_STAGE(Groestl512, groestl512)
+SPH_X11_STAGE(Skein512, skein512)
+SPH_X11_STAGE(Jh512, jh512)
+SPH_X11_STAGE(Keccak512, keccak512)
+SPH_X11_STAGE(Luffa512, luffa512)
+SPH_X11_STAGE(CubeHash512, cubehash512)
+SPH_X11_STAGE(Shavite512, shavite512)
+SPH_X11_STAGE(Simd512, simd512)
+SPH_X11_STAGE(Echo512, echo512)
+
+#undef SPH_X11_STAGE
+} // namespace sph
+
+struct Stage
+{
+    const char* name;
+    const StageFn generic;
+    /** The implementation in use. */
+    StageFn fn;
+    /** Optional implementation hashing 4 consecutive messages at once, used by X11Batch. */
+    StageFn fn4;
+};
+
+Stage stages[] = {
+    {"bmw", sph::Bmw512, sph::Bmw512, nullptr},
+    {"groestl", sph::Groestl512, sph::Groestl512, nullptr},
+    {"skein", sph::Skein512, sph::Skein512, nullptr},
+    {"jh", sph::Jh512, sph::Jh512, nullptr},
+    {"keccak", sph::Keccak512, sph::Keccak512, nullptr},
+    {"luffa", sph::Luffa512, sph::Luffa512, nullptr},
+    {"cubehash", sph::CubeHash512, sph::CubeHash512, nullptr},
+    {"shavite", sph::Shavite512, sph::Shavite512, nullptr},
+    {"simd", sph::Simd512, sph::Simd512, nullptr},
+    {"echo", sph::Echo512, sph::Echo512, nullptr},
+};
+
+const size_t STAGES = sizeof(stages) / sizeof(stages[0]);
+
+void Blake512(unsigned char* out, const unsigned char* in, size_t len)
+{
+    static const unsigned char blank[1] = {0};
+    sph_blake512_context ctx;
+    sph_blake512_init(&ctx);
+    sph_blake512(&ctx, len == 0 ? blank : in, len);
+    sph_blake512_close(&ctx, out);
+}
+
+/** Compare an implementation of a stage against the sph reference on a few fixed messages. */
+bool SelfTest(const Stage& stage, StageFn fn, bool fFourWay)
+{
+    unsigned char in[4 * 64], out[4 * 64], ref[4 * 64];
+    for (int n = 0; n < 4; n++) {
+        for (int i = 0; i < 64; i++) {
+            in[64 * n + i] = (unsigned char)((n * 64 + i) * 0x9d + n);
+        }
+        stage.generic(ref + 64 * n, in + 64 * n);
+    }
+    if (fFourWay) {
+        fn(out, in);
+    } else {
+        for (int n = 0; n < 4; n++) {
+            fn(out + 64 * n, in + 64 * n);
+        }
+    }
+    if (memcmp(out, ref, sizeof(ref)) != 0) {
+        return false;
+    }
+    // in place, as used by X11 and X11Batch
+    if (fFourWay) {
+        fn(in, in);
+    } else {
+        for (int n = 0; n < 4; n++) {
+            fn(in + 64 * n, in + 64 * n);
+        }
+    }
+    return memcmp(in, ref, sizeof(ref)) == 0;
+}
+
+/** Use fn for the named stage if it passes the self test. */
+void Select(std::string& ret, const char* name, StageFn fn, const char* impl, bool fFourWay = false)
+{
+    for (size_t i = 0; i < STAGES; i++) {
+        Stage& stage = stages[i];
+        if (strcmp(stage.name, name) != 0 || !SelfTest(stage, fn, fFourWay)) {
+            continue;
+        }
+        if (fFourWay) {
+            stage.fn4 = fn;
+        } else {
+            stage.fn = fn;
+        }
+        ret += ret.empty() ? "" : ",";
+        ret += std::string(name) + "(" + impl + ")";
+    }
+}
+
+} // namespace
+
+void X11(unsigned char* output, const unsigned char* input, size_t len)
+{
+    unsigned char hash[64];
+    Blake512(hash, input, len);
+    for (size_t i = 0; i < STAGES; i++) {
+        stages[i].fn(hash, hash);
+    }
+    memcpy(output, hash, 32);
+}
+
+void X11Batch(unsigned char* output, const unsigned char* input, size_t len, size_t count)
+{
+    std::vector<unsigned char> buf(64 * count);
+    for (size_t n = 0; n < count; n++) {
+        Blake512(&buf[64 * n], input + len * n, len);
+    }
+    for (size_t i = 0; i < STAGES; i++) {
+        const Stage& stage = stages[i];
+        size_t n = 0;
+        if (stage.fn4) {
+            for (; n + 4 <= count; n += 4) {
+                stage.fn4(&buf[64 * n], &buf[64 * n]);
+            }
+        }
+        for (; n < count; n++) {
+            stage.fn(&buf[64 * n], &buf[64 * n]);
+        }
+    }
+    for (size_t n = 0; n < count; n++) {
+        memcpy(output + 32 * n, &buf[64 * n], 32);
+    }
+}
+
+std::string X11AutoDetect()
+{
+    std::string ret;
+    for (size_t i = 0; i < STAGES; i++) {
+        stages[i].fn = stages[i].generic;
+        stages[i].fn4 = nullptr;
+    }
+
+#if defined(__SSE2__)
+    Select(ret, "cubehash", x11_sse2::CubeHash512, "sse2");
+#endif
+
+#if defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    bool have_aesni = ((ecx >> 25) & 1) && ((ecx >> 19) & 1); // AES-NI and SSE4.1
+    bool have_avx2 = false;
+    if (AVXEnabled()) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+    (void)have_aesni;
+    (void)have_avx2;
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_aesni) {
+        Select(ret, "groestl", x11_aesni::Groestl512, "aesni");
+        Select(ret, "shavite", x11_aesni::Shavite512, "aesni");
+        Select(ret, "echo", x11_aesni::Echo512, "aesni");
+    }
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2) {
+        Select(ret, "luffa", x11_avx2::Luffa512, "avx2");
+        Select(ret, "keccak", x11_avx2::Keccak512_4way, "avx2-4way", true);
+    }
+#endif
+#endif
+
+    return ret.empty() ? "standard" : ret;
+}
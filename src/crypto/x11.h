@@ -0,0 +1,34 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_X11_H
+#define BITCOIN_CRYPTO_X11_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Compute the X11 hash of a message.
+ *  output:  pointer to a 32-byte output buffer
+ *  input:   pointer to the message
+ *  len:     the length of the message
+ */
+void X11(unsigned char* output, const unsigned char* input, size_t len);
+
+/** Compute the X11 hashes of many messages of the same length, e.g. 80-byte block headers.
+ *  The stages run one after another over all messages, which keeps each stage's tables and code hot and lets the
+ *  vectorized backends work on several messages at once.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointer to count messages of len bytes each, stored back to back
+ *  len:     the length of every message
+ *  count:   the number of messages
+ */
+void X11Batch(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+/** Switch the X11 stages to the fastest implementations this CPU supports. Every implementation is checked
+ *  against the sph reference first and only used if it matches. Returns a description of the selection.
+ */
+std::string X11AutoDetect();
+
+#endif // BITCOIN_CRYPTO_X11_H
@@ -0,0 +1,352 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-NI implementations of the Groestl-512, SHAvite-512 and ECHO-512 X11 stages, specialized for the 64-byte
+// messages that flow between the stages. They are bit-exact with the sph implementations.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace x11_aesni {
+namespace {
+
+/** Multiply every byte by x in GF(2^8) mod x^8 + x^4 + x^3 + x + 1. */
+__m128i inline Mul2(__m128i x)
+{
+    const __m128i poly = _mm_set1_epi8(0x1b);
+    __m128i msb = _mm_cmpgt_epi8(_mm_setzero_si128(), x);
+    return _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(msb, poly));
+}
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* Groestl-512                                                                                                       */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+// The 1024-bit state is kept as 8 rows of 16 bytes. SubBytes is done with AESENCLAST, whose ShiftRows is undone by
+// the same byte shuffle that rotates the row for ShiftBytes.
+alignas(16) const uint8_t GROESTL_SHUFFLE_P[8][16] = {
+    { 0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3},
+    { 1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4},
+    { 2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5},
+    { 3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6},
+    { 4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7},
+    { 5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8},
+    { 6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9},
+    {11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14},
+};
+
+alignas(16) const uint8_t GROESTL_SHUFFLE_Q[8][16] = {
+    { 1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4},
+    { 3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6},
+    { 5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8},
+    {11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14},
+    { 0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3},
+    { 2, 15, 12,  9,  6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5},
+    { 4,  1, 14, 11,  8,  5,  2, 15, 12,  9,  6,  3,  0, 13, 10,  7},
+    { 6,  3,  0, 13, 10,  7,  4,  1, 14, 11,  8,  5,  2, 15, 12,  9},
+};
+
+/** Load a column-major 128-byte block (byte 8*j+i is row i, column j) into rows. */
+void inline GroestlLoad(__m128i* rows, const unsigned char* in)
+{
+    alignas(16) unsigned char t[8][16];
+    for (int j = 0; j < 16; j++) {
+        for (int i = 0; i < 8; i++) {
+            t[i][j] = in[8 * j + i];
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        rows[i] = _mm_load_si128((const __m128i*)t[i]);
+    }
+}
+
+/** MixBytes: multiply every column by the circulant matrix (02, 02, 03, 04, 05, 03, 05, 07).
+ *  With t_i = a_i + a_(i+1) and u_i = a_(i+2) + t_(i+6), row i becomes
+ *  (u_i + t_(i+4)) + 2 * ((u_i + t_i + t_(i+5)) + 2 * (t_(i+3) + t_(i+6))).
+ */
+#define GROESTL_MIX_ROW(i) do { \
+        __m128i u = _mm_xor_si128(a[((i) + 2) & 7], t[((i) + 6) & 7]); \
+        __m128i s4 = _mm_xor_si128(t[((i) + 3) & 7], t[((i) + 6) & 7]); \
+        __m128i s2 = _mm_xor_si128(_mm_xor_si128(u, t[i]), t[((i) + 5) & 7]); \
+        b[i] = _mm_xor_si128(_mm_xor_si128(u, t[((i) + 4) & 7]), Mul2(_mm_xor_si128(s2, Mul2(s4)))); \
+    } while (0)
+
+void inline GroestlMixBytes(__m128i* a)
+{
+    __m128i t[8], b[8];
+    t[0] = _mm_xor_si128(a[0], a[1]);
+    t[1] = _mm_xor_si128(a[1], a[2]);
+    t[2] = _mm_xor_si128(a[2], a[3]);
+    t[3] = _mm_xor_si128(a[3], a[4]);
+    t[4] = _mm_xor_si128(a[4], a[5]);
+    t[5] = _mm_xor_si128(a[5], a[6]);
+    t[6] = _mm_xor_si128(a[6], a[7]);
+    t[7] = _mm_xor_si128(a[7], a[0]);
+    GROESTL_MIX_ROW(0);
+    GROESTL_MIX_ROW(1);
+    GROESTL_MIX_ROW(2);
+    GROESTL_MIX_ROW(3);
+    GROESTL_MIX_ROW(4);
+    GROESTL_MIX_ROW(5);
+    GROESTL_MIX_ROW(6);
+    GROESTL_MIX_ROW(7);
+    a[0] = b[0];
+    a[1] = b[1];
+    a[2] = b[2];
+    a[3] = b[3];
+    a[4] = b[4];
+    a[5] = b[5];
+    a[6] = b[6];
+    a[7] = b[7];
+}
+
+#undef GROESTL_MIX_ROW
+
+void GroestlP(__m128i* a)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i col = _mm_set_epi8(0xf0, 0xe0, 0xd0, 0xc0, 0xb0, 0xa0, 0x90, 0x80, 0x70, 0x60, 0x50, 0x40, 0x30, 0x20, 0x10, 0x00);
+    for (int r = 0; r < 14; r++) {
+        a[0] = _mm_xor_si128(a[0], _mm_xor_si128(col, _mm_set1_epi8(r)));
+        for (int i = 0; i < 8; i++) {
+            a[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[i], _mm_load_si128((const __m128i*)GROESTL_SHUFFLE_P[i])), zero);
+        }
+        GroestlMixBytes(a);
+    }
+}
+
+void GroestlQ(__m128i* a)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(0xff);
+    const __m128i col = _mm_set_epi8(0xf0, 0xe0, 0xd0, 0xc0, 0xb0, 0xa0, 0x90, 0x80, 0x70, 0x60, 0x50, 0x40, 0x30, 0x20, 0x10, 0x00);
+    for (int r = 0; r < 14; r++) {
+        for (int i = 0; i < 7; i++) {
+            a[i] = _mm_xor_si128(a[i], ones);
+        }
+        a[7] = _mm_xor_si128(a[7], _mm_xor_si128(_mm_xor_si128(col, ones), _mm_set1_epi8(r)));
+        for (int i = 0; i < 8; i++) {
+            a[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[i], _mm_load_si128((const __m128i*)GROESTL_SHUFFLE_Q[i])), zero);
+        }
+        GroestlMixBytes(a);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* SHAvite-512                                                                                                       */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+alignas(16) const uint32_t SHAVITE_IV512[16] = {
+    0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC,
+    0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+    0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47,
+    0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+};
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* ECHO-512                                                                                                          */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+void inline EchoMixColumn(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    __m128i ab = _mm_xor_si128(a, b);
+    __m128i bc = _mm_xor_si128(b, c);
+    __m128i cd = _mm_xor_si128(c, d);
+    __m128i abx = Mul2(ab);
+    __m128i bcx = Mul2(bc);
+    __m128i cdx = Mul2(cd);
+    __m128i na = _mm_xor_si128(abx, _mm_xor_si128(bc, d));
+    __m128i nb = _mm_xor_si128(bcx, _mm_xor_si128(a, cd));
+    __m128i nc = _mm_xor_si128(cdx, _mm_xor_si128(ab, d));
+    __m128i nd = _mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(cdx, _mm_xor_si128(ab, c)));
+    a = na;
+    b = nb;
+    c = nc;
+    d = nd;
+}
+
+} // namespace
+
+void Groestl512(unsigned char* out, const unsigned char* in)
+{
+    // 64 bytes of message, the 0x80 padding byte and the big-endian block count fit in a single block
+    alignas(16) unsigned char block[128] = {0};
+    memcpy(block, in, 64);
+    block[64] = 0x80;
+    block[127] = 1;
+
+    __m128i m[8], p[8], q[8], h[8];
+    GroestlLoad(m, block);
+    for (int i = 0; i < 8; i++) {
+        // the IV only has the output size (512, big-endian) in its last column
+        h[i] = _mm_setzero_si128();
+    }
+    h[6] = _mm_insert_epi8(h[6], 0x02, 15);
+
+    for (int i = 0; i < 8; i++) {
+        p[i] = _mm_xor_si128(h[i], m[i]);
+        q[i] = m[i];
+    }
+    GroestlP(p);
+    GroestlQ(q);
+    for (int i = 0; i < 8; i++) {
+        h[i] = _mm_xor_si128(h[i], _mm_xor_si128(p[i], q[i]));
+        p[i] = h[i];
+    }
+
+    // output transformation, truncated to the last 8 columns
+    GroestlP(p);
+    alignas(16) unsigned char t[8][16];
+    for (int i = 0; i < 8; i++) {
+        _mm_store_si128((__m128i*)t[i], _mm_xor_si128(p[i], h[i]));
+    }
+    for (int j = 8; j < 16; j++) {
+        for (int i = 0; i < 8; i++) {
+            out[8 * (j - 8) + i] = t[i][j];
+        }
+    }
+}
+
+void Shavite512(unsigned char* out, const unsigned char* in)
+{
+    // 64 bytes of message, padding, the 128-bit bit count and the 16-bit output size fit in a single block
+    alignas(16) unsigned char block[128] = {0};
+    memcpy(block, in, 64);
+    block[64] = 0x80;
+    block[111] = 0x02; // 512 bits, little-endian at offset 110
+    block[127] = 0x02; // output size 512, little-endian at offset 126
+
+    // message expansion: 14 rounds of 8 128-bit round keys
+    __m128i rk[112];
+    for (int i = 0; i < 8; i++) {
+        rk[i] = _mm_load_si128((const __m128i*)(block + 16 * i));
+    }
+    const __m128i zero = _mm_setzero_si128();
+    // the bit counter (512, 0, 0, 0) enters the key schedule at four places, with its last word complemented
+    const __m128i cnt0 = _mm_set_epi32(~0, 0, 0, 512);
+    const __m128i cnt1 = _mm_set_epi32(~512, 0, 0, 0);
+    const __m128i cnt2 = _mm_set_epi32(~0, 512, 0, 0);
+    const __m128i cnt3 = _mm_set_epi32(~0, 0, 512, 0);
+    int u = 8;
+    for (;;) {
+        for (int s = 0; s < 8; s++) {
+            __m128i x = _mm_aesenc_si128(_mm_shuffle_epi32(rk[u - 8], 0x39), zero);
+            rk[u] = _mm_xor_si128(x, rk[u - 1]);
+            if (u == 8) {
+                rk[u] = _mm_xor_si128(rk[u], cnt0);
+            } else if (u == 41) {
+                rk[u] = _mm_xor_si128(rk[u], cnt1);
+            } else if (u == 79) {
+                rk[u] = _mm_xor_si128(rk[u], cnt2);
+            } else if (u == 110) {
+                rk[u] = _mm_xor_si128(rk[u], cnt3);
+            }
+            u++;
+        }
+        if (u == 112) {
+            break;
+        }
+        for (int s = 0; s < 8; s++) {
+            rk[u] = _mm_xor_si128(rk[u - 8], _mm_alignr_epi8(rk[u - 1], rk[u - 2], 4));
+            u++;
+        }
+    }
+
+    const __m128i* iv = (const __m128i*)SHAVITE_IV512;
+    __m128i p0 = _mm_load_si128(iv), p1 = _mm_load_si128(iv + 1), p2 = _mm_load_si128(iv + 2), p3 = _mm_load_si128(iv + 3);
+    u = 0;
+    for (int r = 0; r < 14; r++) {
+        __m128i x = _mm_xor_si128(p1, rk[u]);
+        x = _mm_aesenc_si128(x, rk[u + 1]);
+        x = _mm_aesenc_si128(x, rk[u + 2]);
+        x = _mm_aesenc_si128(x, rk[u + 3]);
+        x = _mm_aesenc_si128(x, zero);
+        p0 = _mm_xor_si128(p0, x);
+        x = _mm_xor_si128(p3, rk[u + 4]);
+        x = _mm_aesenc_si128(x, rk[u + 5]);
+        x = _mm_aesenc_si128(x, rk[u + 6]);
+        x = _mm_aesenc_si128(x, rk[u + 7]);
+        x = _mm_aesenc_si128(x, zero);
+        p2 = _mm_xor_si128(p2, x);
+        u += 8;
+
+        __m128i t = p3;
+        p3 = p2;
+        p2 = p1;
+        p1 = p0;
+        p0 = t;
+    }
+    _mm_storeu_si128((__m128i*)out, _mm_xor_si128(_mm_load_si128(iv), p0));
+    _mm_storeu_si128((__m128i*)(out + 16), _mm_xor_si128(_mm_load_si128(iv + 1), p1));
+    _mm_storeu_si128((__m128i*)(out + 32), _mm_xor_si128(_mm_load_si128(iv + 2), p2));
+    _mm_storeu_si128((__m128i*)(out + 48), _mm_xor_si128(_mm_load_si128(iv + 3), p3));
+}
+
+void Echo512(unsigned char* out, const unsigned char* in)
+{
+    // chaining value (8 words of the output size), then the message block: 64 bytes of message, the padding byte,
+    // the 16-bit output size and the 128-bit bit count
+    const __m128i v = _mm_set_epi32(0, 0, 0, 512);
+    __m128i m[4], w[16];
+    for (int i = 0; i < 4; i++) {
+        m[i] = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+    }
+    for (int i = 0; i < 8; i++) {
+        w[i] = v;
+    }
+    for (int i = 0; i < 4; i++) {
+        w[8 + i] = m[i];
+    }
+    w[12] = _mm_set_epi32(0, 0, 0, 0x80);
+    w[13] = _mm_setzero_si128();
+    w[14] = _mm_set_epi32(0x02000000, 0, 0, 0);
+    w[15] = v;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+    __m128i k = v;
+    for (int r = 0; r < 10; r++) {
+        // BIG.SubWords: two AES rounds per word, keyed with the running counter and the (zero) salt
+        for (int i = 0; i < 16; i++) {
+            w[i] = _mm_aesenc_si128(_mm_aesenc_si128(w[i], k), zero);
+            k = _mm_add_epi32(k, one);
+        }
+
+        // BIG.ShiftRows
+        __m128i t = w[1];
+        w[1] = w[5];
+        w[5] = w[9];
+        w[9] = w[13];
+        w[13] = t;
+        t = w[2];
+        w[2] = w[10];
+        w[10] = t;
+        t = w[6];
+        w[6] = w[14];
+        w[14] = t;
+        t = w[15];
+        w[15] = w[11];
+        w[11] = w[7];
+        w[7] = w[3];
+        w[3] = t;
+
+        // BIG.MixColumns
+        EchoMixColumn(w[0], w[1], w[2], w[3]);
+        EchoMixColumn(w[4], w[5], w[6], w[7]);
+        EchoMixColumn(w[8], w[9], w[10], w[11]);
+        EchoMixColumn(w[12], w[13], w[14], w[15]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        __m128i o = _mm_xor_si128(_mm_xor_si128(v, m[i]), _mm_xor_si128(w[i], w[i + 8]));
+        _mm_storeu_si128((__m128i*)(out + 16 * i), o);
+    }
+}
+
+} // namespace x11_aesni
+
+#endif
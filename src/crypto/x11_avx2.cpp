@@ -0,0 +1,345 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AVX2 implementations of X11 stages, specialized for 64-byte messages and bit-exact with the sph implementations:
+// Luffa-512 with its five 256-bit lanes side by side in one register per word, and a 4-way Keccak-512 that hashes
+// four messages at once for the multi-buffer path.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace x11_avx2 {
+namespace {
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* Luffa-512                                                                                                         */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+// Register k holds word k of the five lanes in its first five elements, the last three elements are unused.
+alignas(32) const uint32_t LUFFA_IV[8][8] = {
+    { 0x6d251e69, 0xc3b44b95, 0xf7efc89d, 0x858075d5, 0x6c68e9be, 0, 0, 0 },
+    { 0x44b051e0, 0xd9d2f256, 0x5dba5781, 0x36d79cce, 0x5ec41e22, 0, 0, 0 },
+    { 0x4eaa6fb4, 0x70eee9a0, 0x04016ce5, 0xe571f7d7, 0xc825b7c7, 0, 0, 0 },
+    { 0xdbf78465, 0xde099fa3, 0xad659c05, 0x204b1f67, 0xaffb4363, 0, 0, 0 },
+    { 0x6e292011, 0x5d9b0557, 0x0306194f, 0x35870c6a, 0xf5df3999, 0, 0, 0 },
+    { 0x90152df4, 0x8fc944b3, 0x666d1836, 0x57e9e923, 0x0fc688f1, 0, 0, 0 },
+    { 0xee058139, 0xcf1ccf0e, 0x24aa230a, 0x14bcb808, 0xb07224cc, 0, 0, 0 },
+    { 0xdef610bb, 0x746cd581, 0x8b264ae7, 0x7cde72ce, 0x03e86cea, 0, 0, 0 },
+};
+
+// Step constants added to words 0 and 4 of every lane, one register per step.
+alignas(32) const uint32_t LUFFA_RC0[8][8] = {
+    { 0x303994a6, 0xb6de10ed, 0xfc20d9d2, 0xb213afa5, 0xf0d2e9e3, 0, 0, 0 },
+    { 0xc0e65299, 0x70f47aae, 0x34552e25, 0xc84ebe95, 0xac11d7fa, 0, 0, 0 },
+    { 0x6cc33a12, 0x0707a3d4, 0x7ad8818f, 0x4e608a22, 0x1bcb66f2, 0, 0, 0 },
+    { 0xdc56983e, 0x1c1e8f51, 0x8438764a, 0x56d858fe, 0x6f2d9bc9, 0, 0, 0 },
+    { 0x1e00108f, 0x707a3d45, 0xbb6de032, 0x343b138f, 0x78602649, 0, 0, 0 },
+    { 0x7800423d, 0xaeb28562, 0xedb780c8, 0xd0ec4e3d, 0x8edae952, 0, 0, 0 },
+    { 0x8f5b7882, 0xbaca1589, 0xd9847356, 0x2ceb4882, 0x3b6ba548, 0, 0, 0 },
+    { 0x96e1db12, 0x40a46f3e, 0xa2c78434, 0xb3ad2208, 0xedae9520, 0, 0, 0 },
+};
+
+alignas(32) const uint32_t LUFFA_RC4[8][8] = {
+    { 0xe0337818, 0x01685f3d, 0xe25e72c1, 0xe028c9bf, 0x5090d577, 0, 0, 0 },
+    { 0x441ba90d, 0x05a17cf4, 0xe623bb72, 0x44756f91, 0x2d1925ab, 0, 0, 0 },
+    { 0x7f34d442, 0xbd09caca, 0x5c58a4a4, 0x7e8fce32, 0xb46496ac, 0, 0, 0 },
+    { 0x9389217f, 0xf4272b28, 0x1e38e2e7, 0x956548be, 0xd1925ab0, 0, 0, 0 },
+    { 0xe5a8bce6, 0x144ae5cc, 0x78e38b9d, 0xfe191be2, 0x29131ab6, 0, 0, 0 },
+    { 0x5274baf4, 0xfaa7ae2b, 0x27586719, 0x3cb226e5, 0x0fc053c3, 0, 0, 0 },
+    { 0x26889ba7, 0x2e48f1c1, 0x36eda57f, 0x5944a28e, 0x3f014f0c, 0, 0, 0 },
+    { 0x9a226e9d, 0xb923c704, 0x703aace7, 0xa1c4c355, 0xfc053c31, 0, 0, 0 },
+};
+
+template<int n>
+__m256i inline Rotl32(__m256i x)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+/** Multiplication by 2 in the ring of the message injection, word-wise; d may alias s. */
+void inline LuffaM2(__m256i* d, const __m256i* s)
+{
+    __m256i tmp = s[7];
+    d[7] = s[6];
+    d[6] = s[5];
+    d[5] = s[4];
+    d[4] = _mm256_xor_si256(s[3], tmp);
+    d[3] = _mm256_xor_si256(s[2], tmp);
+    d[2] = s[1];
+    d[1] = _mm256_xor_si256(s[0], tmp);
+    d[0] = tmp;
+}
+
+void inline LuffaM2Scalar(uint32_t* d, const uint32_t* s)
+{
+    uint32_t tmp = s[7];
+    d[7] = s[6];
+    d[6] = s[5];
+    d[5] = s[4];
+    d[4] = s[3] ^ tmp;
+    d[3] = s[2] ^ tmp;
+    d[2] = s[1];
+    d[1] = s[0] ^ tmp;
+    d[0] = tmp;
+}
+
+/** Message injection MI5 of a big-endian 32-byte block (or of a zero block if msg is null). */
+void LuffaMI(__m256i* v, const unsigned char* msg)
+{
+    const __m256i next = _mm256_setr_epi32(1, 2, 3, 4, 0, 5, 6, 7);
+    const __m256i prev = _mm256_setr_epi32(4, 0, 1, 2, 3, 5, 6, 7);
+    const __m256i rot2 = _mm256_setr_epi32(2, 3, 4, 0, 1, 5, 6, 7);
+
+    // the xor of all lanes, times 2, is added to every lane
+    __m256i a[8];
+    for (int k = 0; k < 8; k++) {
+        __m256i x = _mm256_xor_si256(v[k], _mm256_permutevar8x32_epi32(v[k], next));
+        __m256i y = _mm256_xor_si256(x, _mm256_permutevar8x32_epi32(x, rot2));
+        a[k] = _mm256_xor_si256(y, _mm256_permutevar8x32_epi32(v[k], prev));
+    }
+    LuffaM2(a, a);
+    for (int k = 0; k < 8; k++) {
+        v[k] = _mm256_xor_si256(v[k], a[k]);
+    }
+
+    // lane j becomes 2 * lane j + lane (j + 1), then 2 * lane j + lane (j - 1)
+    __m256i t[8];
+    LuffaM2(t, v);
+    for (int k = 0; k < 8; k++) {
+        v[k] = _mm256_xor_si256(t[k], _mm256_permutevar8x32_epi32(v[k], next));
+    }
+    LuffaM2(t, v);
+    for (int k = 0; k < 8; k++) {
+        v[k] = _mm256_xor_si256(t[k], _mm256_permutevar8x32_epi32(v[k], prev));
+    }
+
+    // lane j gets the message times 2^j
+    if (msg) {
+        alignas(32) uint32_t m[8][8] = {{0}};
+        uint32_t mj[8];
+        for (int k = 0; k < 8; k++) {
+            mj[k] = ReadBE32(msg + 4 * k);
+        }
+        for (int j = 0; j < 5; j++) {
+            for (int k = 0; k < 8; k++) {
+                m[k][j] = mj[k];
+            }
+            LuffaM2Scalar(mj, mj);
+        }
+        for (int k = 0; k < 8; k++) {
+            v[k] = _mm256_xor_si256(v[k], _mm256_load_si256((const __m256i*)m[k]));
+        }
+    }
+}
+
+void inline LuffaSubCrumb(__m256i& a0, __m256i& a1, __m256i& a2, __m256i& a3)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i tmp = a0;
+    a0 = _mm256_or_si256(a0, a1);
+    a2 = _mm256_xor_si256(a2, a3);
+    a1 = _mm256_xor_si256(a1, ones);
+    a0 = _mm256_xor_si256(a0, a3);
+    a3 = _mm256_and_si256(a3, tmp);
+    a1 = _mm256_xor_si256(a1, a3);
+    a3 = _mm256_xor_si256(a3, a2);
+    a2 = _mm256_and_si256(a2, a0);
+    a0 = _mm256_xor_si256(a0, ones);
+    a2 = _mm256_xor_si256(a2, a1);
+    a1 = _mm256_or_si256(a1, a3);
+    tmp = _mm256_xor_si256(tmp, a1);
+    a3 = _mm256_xor_si256(a3, a2);
+    a2 = _mm256_and_si256(a2, a1);
+    a1 = _mm256_xor_si256(a1, a0);
+    a0 = tmp;
+}
+
+void inline LuffaMixWord(__m256i& u, __m256i& v)
+{
+    v = _mm256_xor_si256(v, u);
+    u = _mm256_xor_si256(Rotl32<2>(u), v);
+    v = _mm256_xor_si256(Rotl32<14>(v), u);
+    u = _mm256_xor_si256(Rotl32<10>(u), v);
+    v = Rotl32<1>(v);
+}
+
+/** The permutations of all five lanes at once. */
+void LuffaP(__m256i* v)
+{
+    // tweak: words 4..7 of lane j are rotated by j
+    const __m256i tweakl = _mm256_setr_epi32(0, 1, 2, 3, 4, 0, 0, 0);
+    const __m256i tweakr = _mm256_setr_epi32(32, 31, 30, 29, 28, 32, 32, 32);
+    for (int k = 4; k < 8; k++) {
+        v[k] = _mm256_or_si256(_mm256_sllv_epi32(v[k], tweakl), _mm256_srlv_epi32(v[k], tweakr));
+    }
+    for (int r = 0; r < 8; r++) {
+        LuffaSubCrumb(v[0], v[1], v[2], v[3]);
+        LuffaSubCrumb(v[5], v[6], v[7], v[4]);
+        LuffaMixWord(v[0], v[4]);
+        LuffaMixWord(v[1], v[5]);
+        LuffaMixWord(v[2], v[6]);
+        LuffaMixWord(v[3], v[7]);
+        v[0] = _mm256_xor_si256(v[0], _mm256_load_si256((const __m256i*)LUFFA_RC0[r]));
+        v[4] = _mm256_xor_si256(v[4], _mm256_load_si256((const __m256i*)LUFFA_RC4[r]));
+    }
+}
+
+/** Output the xor of all lanes as 8 big-endian words. */
+void LuffaOutput(unsigned char* out, const __m256i* v)
+{
+    alignas(32) uint32_t t[8];
+    for (int k = 0; k < 8; k++) {
+        _mm256_store_si256((__m256i*)t, v[k]);
+        WriteBE32(out + 4 * k, t[0] ^ t[1] ^ t[2] ^ t[3] ^ t[4]);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------------------- */
+/* Keccak-512, 4-way                                                                                                 */
+/* ---------------------------------------------------------------------------------------------------------------- */
+
+const uint64_t KECCAK_RC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+template<int n>
+__m256i inline Rotl64(__m256i x)
+{
+    return _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n));
+}
+
+#define KECCAK_XOR5(a, b, c, d, e) _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(c, d)), e)
+
+/** One row of chi. */
+#define KECCAK_CHI(y) do { \
+        a[5 * (y) + 0] = _mm256_xor_si256(b[5 * (y) + 0], _mm256_andnot_si256(b[5 * (y) + 1], b[5 * (y) + 2])); \
+        a[5 * (y) + 1] = _mm256_xor_si256(b[5 * (y) + 1], _mm256_andnot_si256(b[5 * (y) + 2], b[5 * (y) + 3])); \
+        a[5 * (y) + 2] = _mm256_xor_si256(b[5 * (y) + 2], _mm256_andnot_si256(b[5 * (y) + 3], b[5 * (y) + 4])); \
+        a[5 * (y) + 3] = _mm256_xor_si256(b[5 * (y) + 3], _mm256_andnot_si256(b[5 * (y) + 4], b[5 * (y) + 0])); \
+        a[5 * (y) + 4] = _mm256_xor_si256(b[5 * (y) + 4], _mm256_andnot_si256(b[5 * (y) + 0], b[5 * (y) + 1])); \
+    } while (0)
+
+void KeccakF(__m256i* a)
+{
+    __m256i b[25], c[5], d[5];
+    for (int round = 0; round < 24; round++) {
+        // theta
+        c[0] = KECCAK_XOR5(a[0], a[5], a[10], a[15], a[20]);
+        c[1] = KECCAK_XOR5(a[1], a[6], a[11], a[16], a[21]);
+        c[2] = KECCAK_XOR5(a[2], a[7], a[12], a[17], a[22]);
+        c[3] = KECCAK_XOR5(a[3], a[8], a[13], a[18], a[23]);
+        c[4] = KECCAK_XOR5(a[4], a[9], a[14], a[19], a[24]);
+        d[0] = _mm256_xor_si256(c[4], Rotl64<1>(c[1]));
+        d[1] = _mm256_xor_si256(c[0], Rotl64<1>(c[2]));
+        d[2] = _mm256_xor_si256(c[1], Rotl64<1>(c[3]));
+        d[3] = _mm256_xor_si256(c[2], Rotl64<1>(c[4]));
+        d[4] = _mm256_xor_si256(c[3], Rotl64<1>(c[0]));
+        for (int i = 0; i < 25; i++) {
+            a[i] = _mm256_xor_si256(a[i], d[i % 5]);
+        }
+
+        // rho and pi
+        b[0] = a[0];
+        b[1] = Rotl64<44>(a[6]);
+        b[2] = Rotl64<43>(a[12]);
+        b[3] = Rotl64<21>(a[18]);
+        b[4] = Rotl64<14>(a[24]);
+        b[5] = Rotl64<28>(a[3]);
+        b[6] = Rotl64<20>(a[9]);
+        b[7] = Rotl64<3>(a[10]);
+        b[8] = Rotl64<45>(a[16]);
+        b[9] = Rotl64<61>(a[22]);
+        b[10] = Rotl64<1>(a[1]);
+        b[11] = Rotl64<6>(a[7]);
+        b[12] = Rotl64<25>(a[13]);
+        b[13] = Rotl64<8>(a[19]);
+        b[14] = Rotl64<18>(a[20]);
+        b[15] = Rotl64<27>(a[4]);
+        b[16] = Rotl64<36>(a[5]);
+        b[17] = Rotl64<10>(a[11]);
+        b[18] = Rotl64<15>(a[17]);
+        b[19] = Rotl64<56>(a[23]);
+        b[20] = Rotl64<62>(a[2]);
+        b[21] = Rotl64<55>(a[8]);
+        b[22] = Rotl64<39>(a[14]);
+        b[23] = Rotl64<41>(a[15]);
+        b[24] = Rotl64<2>(a[21]);
+
+        // chi
+        KECCAK_CHI(0);
+        KECCAK_CHI(1);
+        KECCAK_CHI(2);
+        KECCAK_CHI(3);
+        KECCAK_CHI(4);
+
+        // iota
+        a[0] = _mm256_xor_si256(a[0], _mm256_set1_epi64x(KECCAK_RC[round]));
+    }
+}
+
+#undef KECCAK_XOR5
+#undef KECCAK_CHI
+
+} // namespace
+
+void Luffa512(unsigned char* out, const unsigned char* in)
+{
+    __m256i v[8];
+    for (int k = 0; k < 8; k++) {
+        v[k] = _mm256_load_si256((const __m256i*)LUFFA_IV[k]);
+    }
+
+    // two 32-byte message blocks and the padding block
+    const unsigned char pad[32] = {0x80};
+    LuffaMI(v, in);
+    LuffaP(v);
+    LuffaMI(v, in + 32);
+    LuffaP(v);
+    LuffaMI(v, pad);
+    LuffaP(v);
+
+    // two blank rounds, each producing half of the output
+    LuffaMI(v, nullptr);
+    LuffaP(v);
+    LuffaOutput(out, v);
+    LuffaMI(v, nullptr);
+    LuffaP(v);
+    LuffaOutput(out + 32, v);
+}
+
+void Keccak512_4way(unsigned char* out, const unsigned char* in)
+{
+    // one block per message: 64 bytes of message and the 0x01 ... 0x80 padding of the 72-byte rate
+    __m256i st[25];
+    for (int i = 0; i < 8; i++) {
+        st[i] = _mm256_set_epi64x(ReadLE64(in + 192 + 8 * i), ReadLE64(in + 128 + 8 * i), ReadLE64(in + 64 + 8 * i), ReadLE64(in + 8 * i));
+    }
+    st[8] = _mm256_set1_epi64x(0x8000000000000001ULL);
+    for (int i = 9; i < 25; i++) {
+        st[i] = _mm256_setzero_si256();
+    }
+
+    KeccakF(st);
+
+    alignas(32) uint64_t t[4];
+    for (int i = 0; i < 8; i++) {
+        _mm256_store_si256((__m256i*)t, st[i]);
+        for (int n = 0; n < 4; n++) {
+            WriteLE64(out + 64 * n + 8 * i, t[n]);
+        }
+    }
+}
+
+} // namespace x11_avx2
+
+#endif
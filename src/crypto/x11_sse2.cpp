@@ -0,0 +1,105 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SSE2 implementation of the CubeHash-512 X11 stage, specialized for 64-byte messages. SSE2 is part of the x86-64
+// baseline, so this is compiled without extra flags and used without a CPUID check.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+namespace x11_sse2 {
+namespace {
+
+alignas(16) const uint32_t CUBEHASH_IV512[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E,
+    0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537,
+    0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532,
+    0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576,
+    0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+template<int n>
+__m128i inline Rotl(__m128i x)
+{
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+/** x[0..15] live in x0..x3, x[16..31] in x4..x7. */
+void inline Rounds(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3, __m128i& x4, __m128i& x5, __m128i& x6, __m128i& x7, int rounds)
+{
+    for (int r = 0; r < rounds; r++) {
+        x4 = _mm_add_epi32(x0, x4);
+        x5 = _mm_add_epi32(x1, x5);
+        x6 = _mm_add_epi32(x2, x6);
+        x7 = _mm_add_epi32(x3, x7);
+        // rotate x[0..15] by 7 and swap x[0..7] with x[8..15]
+        __m128i y0 = Rotl<7>(x2);
+        __m128i y1 = Rotl<7>(x3);
+        __m128i y2 = Rotl<7>(x0);
+        __m128i y3 = Rotl<7>(x1);
+        x0 = _mm_xor_si128(y0, x4);
+        x1 = _mm_xor_si128(y1, x5);
+        x2 = _mm_xor_si128(y2, x6);
+        x3 = _mm_xor_si128(y3, x7);
+        // swap x[16 + i] with x[16 + (i ^ 2)]
+        x4 = _mm_shuffle_epi32(x4, 0x4e);
+        x5 = _mm_shuffle_epi32(x5, 0x4e);
+        x6 = _mm_shuffle_epi32(x6, 0x4e);
+        x7 = _mm_shuffle_epi32(x7, 0x4e);
+        x4 = _mm_add_epi32(x0, x4);
+        x5 = _mm_add_epi32(x1, x5);
+        x6 = _mm_add_epi32(x2, x6);
+        x7 = _mm_add_epi32(x3, x7);
+        // rotate x[0..15] by 11 and swap x[i] with x[i ^ 4]
+        y0 = Rotl<11>(x1);
+        y1 = Rotl<11>(x0);
+        y2 = Rotl<11>(x3);
+        y3 = Rotl<11>(x2);
+        x0 = _mm_xor_si128(y0, x4);
+        x1 = _mm_xor_si128(y1, x5);
+        x2 = _mm_xor_si128(y2, x6);
+        x3 = _mm_xor_si128(y3, x7);
+        // swap x[16 + i] with x[16 + (i ^ 1)]
+        x4 = _mm_shuffle_epi32(x4, 0xb1);
+        x5 = _mm_shuffle_epi32(x5, 0xb1);
+        x6 = _mm_shuffle_epi32(x6, 0xb1);
+        x7 = _mm_shuffle_epi32(x7, 0xb1);
+    }
+}
+
+} // namespace
+
+void CubeHash512(unsigned char* out, const unsigned char* in)
+{
+    const __m128i* iv = (const __m128i*)CUBEHASH_IV512;
+    __m128i x0 = _mm_load_si128(iv), x1 = _mm_load_si128(iv + 1), x2 = _mm_load_si128(iv + 2), x3 = _mm_load_si128(iv + 3);
+    __m128i x4 = _mm_load_si128(iv + 4), x5 = _mm_load_si128(iv + 5), x6 = _mm_load_si128(iv + 6), x7 = _mm_load_si128(iv + 7);
+
+    // two 32-byte message blocks
+    for (int i = 0; i < 2; i++) {
+        x0 = _mm_xor_si128(x0, _mm_loadu_si128((const __m128i*)(in + 32 * i)));
+        x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)(in + 32 * i + 16)));
+        Rounds(x0, x1, x2, x3, x4, x5, x6, x7, 16);
+    }
+
+    // padding block, then the finalization flag and 10 * 16 more rounds
+    x0 = _mm_xor_si128(x0, _mm_set_epi32(0, 0, 0, 0x80));
+    Rounds(x0, x1, x2, x3, x4, x5, x6, x7, 16);
+    x7 = _mm_xor_si128(x7, _mm_set_epi32(1, 0, 0, 0));
+    Rounds(x0, x1, x2, x3, x4, x5, x6, x7, 160);
+
+    _mm_storeu_si128((__m128i*)out, x0);
+    _mm_storeu_si128((__m128i*)(out + 16), x1);
+    _mm_storeu_si128((__m128i*)(out + 32), x2);
+    _mm_storeu_si128((__m128i*)(out + 48), x3);
+}
+
+} // namespace x11_sse2
+
+#endif
@@ -133,32 +133,35 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
 	if (fDebugSpam && fDebugBench)
 		LogPrint("bench", "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-    CSimplifiedMNList sml(tmpMNList);
+    // The tree is kept between calls and brought to the state of the new list by only touching the entries which
+    // differ. Lists from consecutive blocks share most of their MN objects, so this is usually cheap.
+    static CSimplifiedMNListMerkleTree smlTree;
+    static CDeterministicMNList smlTreeMNList;
+
+    tmpMNList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        auto oldDmn = smlTreeMNList.GetMN(dmn->proTxHash);
+        if (oldDmn != dmn) {
+            smlTree.AddOrUpdate(CSimplifiedMNListEntry(*dmn));
+        }
+    });
+    smlTreeMNList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        if (!tmpMNList.HasMN(dmn->proTxHash)) {
+            smlTree.Remove(dmn->proTxHash);
+        }
+    });
+    smlTreeMNList = tmpMNList;
 
     int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
 	if (fDebugSpam && fDebugBench)
-		LogPrint("bench", "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
-
-    static CSimplifiedMNList smlCached;
-    static uint256 merkleRootCached;
-    static bool mutatedCached{false};
-
-    if (sml.mnList == smlCached.mnList) {
-        merkleRootRet = merkleRootCached;
-        return !mutatedCached;
-    }
+		LogPrint("bench", "            - CSimplifiedMNListMerkleTree update: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
 
     bool mutated = false;
-    merkleRootRet = sml.CalcMerkleRoot(&mutated);
+    merkleRootRet = smlTree.CalcMerkleRoot(&mutated);
 
     int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
 	if (fDebugSpam && fDebugBench)
 		LogPrint("bench", "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
 
-    smlCached = std::move(sml);
-    merkleRootCached = merkleRootRet;
-    mutatedCached = mutated;
-
     return !mutated;
 }
 
@@ -9,6 +9,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "core_io.h"
+#include "crypto/sha256.h"
 #include "script/standard.h"
 #include "ui_interface.h"
 #include "validation.h"
@@ -21,6 +22,16 @@
 
 static const std::string DB_LIST_SNAPSHOT = "dmn_S";
 static const std::string DB_LIST_DIFF = "dmn_D";
+static const std::string DB_LIST_RANGE_DIFF = "dmn_R";
+
+// Rough per-MN cost of a cached list, which is dominated by the nodes of the MN, internalId and unique property maps.
+// The MN objects themselves are shared between lists and not counted.
+static const size_t LIST_BYTES_PER_MN = 360;
+
+static size_t EstimateListSize(const CDeterministicMNList& list)
+{
+    return sizeof(CDeterministicMNList) + list.GetAllMNsCount() * LIST_BYTES_PER_MN;
+}
 
 CDeterministicMNManager* deterministicMNManager;
 
@@ -259,18 +270,19 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 {
     auto scores = CalculateScores(modifier);
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    // sort is descending order, only the top maxSize entries need to be in order
+    size_t nResultSize = std::min(maxSize, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + nResultSize, scores.end(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
+        return b.first < a.first;
     });
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nResultSize);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -279,27 +291,39 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 
 std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
 {
-    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
-    scores.reserve(GetAllMNsCount());
+    std::vector<CDeterministicMNCPtr> dmns;
+    dmns.reserve(GetAllMNsCount());
     ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         if (dmn->pdmnState->confirmedHash.IsNull()) {
             // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
             // future quorums
             return;
         }
-        // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
-        // Please note that this is not a double-sha256 but a single-sha256
-        // The first part is already precalculated (confirmedHashWithProRegTxHash)
-        // TODO When https://github.com/bitcoin/bitcoin/pull/13191 gets backported, implement something that is similar but for single-sha256
-        uint256 h;
-        CSHA256 sha256;
-        sha256.Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), dmn->pdmnState->confirmedHashWithProRegTxHash.size());
-        sha256.Write(modifier.begin(), modifier.size());
-        sha256.Finalize(h.begin());
-
-        scores.emplace_back(UintToArith256(h), dmn);
+        dmns.emplace_back(dmn);
     });
 
+    // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
+    // Please note that this is not a double-sha256 but a single-sha256
+    // The first part is already precalculated (confirmedHashWithProRegTxHash)
+    // Both parts are 32 bytes, so all scores can be computed in one batch of 64 byte blobs
+    std::vector<unsigned char> vInput(dmns.size() * 64);
+    std::vector<unsigned char> vOutput(dmns.size() * 32);
+    for (size_t i = 0; i < dmns.size(); i++) {
+        memcpy(&vInput[i * 64], dmns[i]->pdmnState->confirmedHashWithProRegTxHash.begin(), 32);
+        memcpy(&vInput[i * 64 + 32], modifier.begin(), 32);
+    }
+    if (!dmns.empty()) {
+        SHA256Batch64(vOutput.data(), vInput.data(), dmns.size());
+    }
+
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
+    scores.reserve(dmns.size());
+    for (size_t i = 0; i < dmns.size(); i++) {
+        uint256 h;
+        memcpy(h.begin(), &vOutput[i * 32], 32);
+        scores.emplace_back(UintToArith256(h), std::move(dmns[i]));
+    }
+
     return scores;
 }
 
@@ -448,6 +472,30 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CBlockIndex* pindex,
     return result;
 }
 
+CDeterministicMNList CDeterministicMNList::ApplyRangeDiff(const CBlockIndex* pindex, const CDeterministicMNListRangeDiff& rangeDiff) const
+{
+    CDeterministicMNList result = *this;
+    result.blockHash = pindex->GetBlockHash();
+    result.nHeight = pindex->nHeight;
+
+    for (const auto& id : rangeDiff.diff.removedMns) {
+        auto dmn = result.GetMNByInternalId(id);
+        assert(dmn);
+        result.RemoveMN(dmn->proTxHash);
+    }
+    for (const auto& dmn : rangeDiff.diff.addedMNs) {
+        assert(dmn->internalId >= result.GetTotalRegisteredCount() && dmn->internalId < rangeDiff.nTotalRegisteredCount);
+        result.AddMN(dmn);
+    }
+    for (const auto& p : rangeDiff.diff.updatedMNs) {
+        auto dmn = result.GetMNByInternalId(p.first);
+        result.UpdateMN(dmn, p.second);
+    }
+    result.SetTotalRegisteredCount(rangeDiff.nTotalRegisteredCount);
+
+    return result;
+}
+
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
 {
     assert(!mnMap.find(dmn->proTxHash));
@@ -511,6 +559,8 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
 CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
     evoDb(_evoDb)
 {
+    nMaxListsCacheBytes = std::max(GetArg("-dmnlistcachesize", DEFAULT_DMN_LIST_CACHE_SIZE), (int64_t)1) << 20;
+    nSnapshotInterval = std::max((int)GetArg("-dmnsnapshotinterval", DEFAULT_DMN_SNAPSHOT_INTERVAL), 0);
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck)
@@ -597,8 +647,11 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
 
         evoDb.Erase(std::make_pair(DB_LIST_DIFF, blockHash));
         evoDb.Erase(std::make_pair(DB_LIST_SNAPSHOT, blockHash));
+        evoDb.Erase(std::make_pair(DB_LIST_RANGE_DIFF, blockHash));
 
-        mnListsCache.erase(blockHash);
+        EraseCachedList(blockHash);
+        mnListSnapshots.erase(blockHash);
+        nLastCompactedHeight = std::min(nLastCompactedHeight, nHeight - 1);
     }
 
     if (diff.HasChanges()) {
@@ -905,46 +958,81 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
 {
     LOCK(cs);
 
+    struct DiffToApply
+    {
+        const CBlockIndex* pindex;
+        CDeterministicMNListRangeDiff rangeDiff;
+        bool fRange;
+    };
+
     CDeterministicMNList snapshot;
-    std::list<std::pair<const CBlockIndex*, CDeterministicMNListDiff>> listDiff;
+    std::list<DiffToApply> listDiff;
 
     while (true) {
         // try using cache before reading from disk
-        auto it = mnListsCache.find(pindex->GetBlockHash());
-        if (it != mnListsCache.end()) {
-            snapshot = it->second;
+        if (GetCachedList(pindex->GetBlockHash(), snapshot)) {
+            break;
+        }
+
+        auto itSnapshot = mnListSnapshots.find(pindex->GetBlockHash());
+        if (itSnapshot != mnListSnapshots.end()) {
+            snapshot = itSnapshot->second;
+            cacheStats.nMemSnapshotHits++;
             break;
         }
 
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            cacheStats.nDbSnapshotHits++;
             break;
         }
 
-        CDeterministicMNListDiff diff;
-        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+        DiffToApply toApply{pindex, CDeterministicMNListRangeDiff(), true};
+        if (evoDb.Read(std::make_pair(DB_LIST_RANGE_DIFF, pindex->GetBlockHash()), toApply.rangeDiff)) {
+            const CBlockIndex* pindexBase = pindex->GetAncestor(toApply.rangeDiff.nBaseHeight);
+            if (pindexBase && pindexBase->GetBlockHash() == toApply.rangeDiff.baseBlockHash) {
+                listDiff.emplace_front(std::move(toApply));
+                cacheStats.nRangeDiffsUsed++;
+                pindex = pindexBase;
+                continue;
+            }
+        }
+
+        toApply.fRange = false;
+        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), toApply.rangeDiff.diff)) {
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
             break;
         }
 
-        listDiff.emplace_front(pindex, std::move(diff));
+        listDiff.emplace_front(std::move(toApply));
         pindex = pindex->pprev;
     }
 
+    size_t nBucket = 0;
+    for (size_t n = listDiff.size(); n != 0 && nBucket < HIT_BUCKETS - 1; n >>= 1) {
+        nBucket++;
+    }
+    cacheStats.nLookups++;
+    cacheStats.nDiffsApplied[nBucket]++;
+
     for (const auto& p : listDiff) {
-        auto diffIndex = p.first;
-        auto& diff = p.second;
-        if (diff.HasChanges()) {
-            snapshot = snapshot.ApplyDiff(diffIndex, diff);
+        auto diffIndex = p.pindex;
+        if (p.fRange) {
+            snapshot = snapshot.ApplyRangeDiff(diffIndex, p.rangeDiff);
+        } else if (p.rangeDiff.diff.HasChanges()) {
+            snapshot = snapshot.ApplyDiff(diffIndex, p.rangeDiff.diff);
         } else {
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
 
-        mnListsCache.emplace(diffIndex->GetBlockHash(), snapshot);
+        if (nSnapshotInterval != 0 && diffIndex->nHeight % nSnapshotInterval == 0) {
+            mnListSnapshots.emplace(diffIndex->GetBlockHash(), snapshot);
+        }
     }
 
+    // only the requested list goes into the LRU, intermediate lists would push out the ones around the tip
+    AddCachedList(snapshot);
+
     return snapshot;
 }
 
@@ -990,19 +1078,228 @@ bool CDeterministicMNManager::IsDIP3Enforced(int nHeight)
     return nHeight >= Params().GetConsensus().DIP0003EnforcementHeight;
 }
 
+bool CDeterministicMNManager::GetCachedList(const uint256& blockHash, CDeterministicMNList& listRet)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsCache.find(blockHash);
+    if (it == mnListsCache.end()) {
+        return false;
+    }
+    mnListsLru.splice(mnListsLru.begin(), mnListsLru, it->second.itLru);
+    listRet = it->second.list;
+    return true;
+}
+
+void CDeterministicMNManager::AddCachedList(const CDeterministicMNList& list)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsCache.find(list.GetBlockHash());
+    if (it != mnListsCache.end()) {
+        mnListsLru.splice(mnListsLru.begin(), mnListsLru, it->second.itLru);
+        return;
+    }
+
+    size_t nSize = EstimateListSize(list);
+    mnListsLru.emplace_front(list.GetBlockHash());
+    mnListsCache.emplace(list.GetBlockHash(), CachedList{list, nSize, mnListsLru.begin()});
+    nListsCacheBytes += nSize;
+
+    // always keep the most recent list, even if it alone exceeds the limit
+    while (nListsCacheBytes > nMaxListsCacheBytes && mnListsLru.size() > 1) {
+        EraseCachedList(mnListsLru.back());
+        cacheStats.nEvicted++;
+    }
+}
+
+void CDeterministicMNManager::EraseCachedList(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsCache.find(blockHash);
+    if (it == mnListsCache.end()) {
+        return;
+    }
+    nListsCacheBytes -= it->second.nSize;
+    mnListsLru.erase(it->second.itLru);
+    mnListsCache.erase(it);
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
 
-    std::vector<uint256> toDelete;
-    for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LISTS_CACHE_SIZE < nHeight) {
-            toDelete.emplace_back(p.first);
+    // the LRU is bounded by AddCachedList already, only the in-memory snapshots are pruned by height
+    for (auto it = mnListSnapshots.begin(); it != mnListSnapshots.end(); ) {
+        if (it->second.GetHeight() + nSnapshotInterval * MAX_MEM_SNAPSHOTS < nHeight) {
+            it = mnListSnapshots.erase(it);
+        } else {
+            ++it;
         }
     }
-    for (const auto& h : toDelete) {
-        mnListsCache.erase(h);
+}
+
+template <typename T>
+static bool IsUniquePropertyMoved(const CDeterministicMNList& baseList, const CDeterministicMNList& list, const CDeterministicMNCPtr& dmn, const T& v)
+{
+    auto oldDmn = baseList.GetUniquePropertyMN(v);
+    return oldDmn && oldDmn->proTxHash != dmn->proTxHash && list.HasMN(oldDmn->proTxHash);
+}
+
+// ApplyRangeDiff applies all removals, then all additions, then all updates, which loses the order of the blocks in
+// the range. That's only safe if no unique property (collateral, address, keys) went from one MN to another which is
+// still in the list, as the new holder could otherwise be added or updated before the old one released it.
+static bool CanApplyAsRangeDiff(const CDeterministicMNList& baseList, const CDeterministicMNList& list, const CDeterministicMNListDiff& diff)
+{
+    auto hasMovedProperty = [&](const CDeterministicMNCPtr& dmn) {
+        return IsUniquePropertyMoved(baseList, list, dmn, dmn->collateralOutpoint) ||
+               (dmn->pdmnState->addr != CService() && IsUniquePropertyMoved(baseList, list, dmn, dmn->pdmnState->addr)) ||
+               IsUniquePropertyMoved(baseList, list, dmn, dmn->pdmnState->keyIDOwner) ||
+               (dmn->pdmnState->pubKeyOperator.Get().IsValid() && IsUniquePropertyMoved(baseList, list, dmn, dmn->pdmnState->pubKeyOperator));
+    };
+
+    for (const auto& dmn : diff.addedMNs) {
+        if (hasMovedProperty(dmn)) {
+            return false;
+        }
+    }
+    for (const auto& p : diff.updatedMNs) {
+        if (hasMovedProperty(list.GetMNByInternalId(p.first))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CDeterministicMNManager::CompactDiffRange(const CBlockIndex* pindexEnd, CDeterministicMNList& baseList)
+{
+    // the diffs are read without holding cs_main or cs, so that neither validation nor list lookups wait for the disk
+    if (evoDb.Exists(std::make_pair(DB_LIST_RANGE_DIFF, pindexEnd->GetBlockHash()))) {
+        return false;
+    }
+
+    // ranges never cross a DB snapshot, as GetListForBlock would otherwise jump over the point where it can stop
+    int nBaseHeight = std::max(pindexEnd->nHeight - DIFF_RANGE_SIZE, ((pindexEnd->nHeight - 1) / SNAPSHOT_LIST_PERIOD) * SNAPSHOT_LIST_PERIOD);
+
+    std::vector<std::pair<const CBlockIndex*, CDeterministicMNListDiff>> vDiffs;
+    const CBlockIndex* pindex = pindexEnd;
+    while (pindex->nHeight > nBaseHeight) {
+        if (pindex != pindexEnd && evoDb.Exists(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()))) {
+            break;
+        }
+        CDeterministicMNListDiff diff;
+        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+            return false;
+        }
+        vDiffs.emplace_back(pindex, std::move(diff));
+        pindex = pindex->pprev;
+    }
+    if (vDiffs.size() < 2) {
+        return false;
     }
+
+    if (baseList.GetBlockHash() != pindex->GetBlockHash()) {
+        baseList = GetListForBlock(pindex);
+    }
+
+    CDeterministicMNList list = baseList;
+    for (auto it = vDiffs.rbegin(); it != vDiffs.rend(); ++it) {
+        if (it->second.HasChanges()) {
+            list = list.ApplyDiff(it->first, it->second);
+        } else {
+            list.SetBlockHash(it->first->GetBlockHash());
+            list.SetHeight(it->first->nHeight);
+        }
+    }
+
+    CDeterministicMNListRangeDiff rangeDiff;
+    rangeDiff.baseBlockHash = pindex->GetBlockHash();
+    rangeDiff.nBaseHeight = pindex->nHeight;
+    rangeDiff.nTotalRegisteredCount = list.GetTotalRegisteredCount();
+    rangeDiff.diff = baseList.BuildDiff(list);
+
+    bool fCanApply = CanApplyAsRangeDiff(baseList, list, rangeDiff.diff);
+    baseList = std::move(list);
+    if (!fCanApply) {
+        LogPrint("masternode", "CDeterministicMNManager::%s -- not compacting diffs up to height %d, a unique property moved between MNs\n", __func__, pindexEnd->nHeight);
+        return false;
+    }
+
+    // evoDb transactions are only safe under cs_main, as block processing writes into the same one
+    LOCK2(cs_main, cs);
+    // UndoBlock erases range diffs together with their last block, so don't write one for a disconnected block
+    if (!chainActive.Contains(pindexEnd)) {
+        return false;
+    }
+
+    auto dbTx = evoDb.BeginTransaction();
+    evoDb.Write(std::make_pair(DB_LIST_RANGE_DIFF, pindexEnd->GetBlockHash()), rangeDiff);
+    dbTx->Commit();
+
+    cacheStats.nRangeDiffsWritten++;
+    return true;
+}
+
+void CDeterministicMNManager::DoMaintenance()
+{
+    // during IBD the diffs are still being written and compacting them would only compete with validation
+    if (fReindex || fImporting || IsInitialBlockDownload()) {
+        return;
+    }
+
+    // only pick the ranges under the locks, the disk I/O happens in CompactDiffRange
+    std::vector<const CBlockIndex*> vRangeEnds;
+    int nPrevEndHeight;
+    {
+        LOCK2(cs_main, cs);
+
+        const CBlockIndex* pindexTip = chainActive.Tip();
+        if (!pindexTip) {
+            return;
+        }
+
+        if (nLastCompactedHeight == -1) {
+            nLastCompactedHeight = Params().GetConsensus().DIP0003Height;
+        }
+        nPrevEndHeight = nLastCompactedHeight;
+
+        int nEndHeight = (nLastCompactedHeight / DIFF_RANGE_SIZE + 1) * DIFF_RANGE_SIZE;
+        for (; nEndHeight <= pindexTip->nHeight - DIFF_RANGE_MIN_DEPTH && vRangeEnds.size() < MAX_DIFF_RANGES_PER_RUN; nEndHeight += DIFF_RANGE_SIZE) {
+            vRangeEnds.emplace_back(chainActive[nEndHeight]);
+        }
+    }
+
+    // the list at the end of the previous range is the base of the next one
+    CDeterministicMNList baseList;
+    int nWritten = 0;
+    for (const auto pindexEnd : vRangeEnds) {
+        if (CompactDiffRange(pindexEnd, baseList)) {
+            nWritten++;
+        }
+
+        LOCK(cs);
+        // UndoBlock moved it back below the ranges picked above, the next run picks them again
+        if (nLastCompactedHeight != nPrevEndHeight) {
+            break;
+        }
+        nLastCompactedHeight = nPrevEndHeight = pindexEnd->nHeight;
+    }
+
+    if (nWritten != 0) {
+        LogPrint("masternode", "CDeterministicMNManager::%s -- compacted %d diff ranges up to height %d\n", __func__, nWritten, nPrevEndHeight);
+    }
+}
+
+void CDeterministicMNManager::GetCacheStats(CacheStats& statsRet, size_t& nEntriesRet, size_t& nBytesRet, size_t& nMaxBytesRet, size_t& nSnapshotsRet, int& nSnapshotIntervalRet)
+{
+    LOCK(cs);
+    statsRet = cacheStats;
+    nEntriesRet = mnListsCache.size();
+    nBytesRet = nListsCacheBytes;
+    nMaxBytesRet = nMaxListsCacheBytes;
+    nSnapshotsRet = mnListSnapshots.size();
+    nSnapshotIntervalRet = nSnapshotInterval;
 }
 
 bool CDeterministicMNManager::UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList)
@@ -10,13 +10,16 @@
 #include "dbwrapper.h"
 #include "evodb.h"
 #include "providertx.h"
+#include "saltedhasher.h"
 #include "simplifiedmns.h"
 #include "sync.h"
 
 #include "immer/map.hpp"
 #include "immer/map_transient.hpp"
 
+#include <list>
 #include <map>
+#include <unordered_map>
 
 class CBlock;
 class CBlockIndex;
@@ -270,6 +273,8 @@ inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal>& obj, CSerActi
 }
 
 
+class CDeterministicMNListRangeDiff;
+
 class CDeterministicMNList
 {
 public:
@@ -467,6 +472,8 @@ public:
     CDeterministicMNListDiff BuildDiff(const CDeterministicMNList& to) const;
     CSimplifiedMNListDiff BuildSimplifiedDiff(const CDeterministicMNList& to) const;
     CDeterministicMNList ApplyDiff(const CBlockIndex* pindex, const CDeterministicMNListDiff& diff) const;
+    // Unlike per-block diffs, range diffs may skip internalIds of MNs which were added and removed inside the range
+    CDeterministicMNList ApplyRangeDiff(const CBlockIndex* pindex, const CDeterministicMNListRangeDiff& rangeDiff) const;
 
     void AddMN(const CDeterministicMNCPtr& dmn);
     void UpdateMN(const CDeterministicMNCPtr& oldDmn, const CDeterministicMNStateCPtr& pdmnState);
@@ -592,6 +599,29 @@ public:
     }
 };
 
+// Combined diff over a run of consecutive blocks, written by the background compaction of per-block diffs. It is
+// stored under the hash of the last block of the run and applies to the list of the block at nBaseHeight
+class CDeterministicMNListRangeDiff
+{
+public:
+    uint256 baseBlockHash;
+    int nBaseHeight{-1};
+    uint32_t nTotalRegisteredCount{0};
+    CDeterministicMNListDiff diff;
+
+public:
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(baseBlockHash);
+        READWRITE(nBaseHeight);
+        READWRITE(nTotalRegisteredCount);
+        READWRITE(diff);
+    }
+};
+
 // TODO can be removed in a future version
 class CDeterministicMNListDiff_OldFormat
 {
@@ -623,18 +653,61 @@ public:
     }
 };
 
+static const int64_t DEFAULT_DMN_LIST_CACHE_SIZE = 128;
+static const int DEFAULT_DMN_SNAPSHOT_INTERVAL = 24;
+
 class CDeterministicMNManager
 {
     static const int SNAPSHOT_LIST_PERIOD = 205; // once per day
-    static const int LISTS_CACHE_SIZE = 205;
+    // how many of the in-memory snapshots to keep, counted back from the tip
+    static const int MAX_MEM_SNAPSHOTS = 256;
+    // per-block diffs are compacted into range diffs of this many blocks, once they are buried deep enough
+    static const int DIFF_RANGE_SIZE = 16;
+    static const int DIFF_RANGE_MIN_DEPTH = 10;
+    // bounds the disk I/O of a single DoMaintenance call
+    static const size_t MAX_DIFF_RANGES_PER_RUN = 8;
 
 public:
     CCriticalSection cs;
 
+    // Buckets of the cache-hit histogram by the number of diffs that had to be applied in GetListForBlock
+    static const size_t HIT_BUCKETS = 9;
+
+    struct CacheStats
+    {
+        uint64_t nLookups{0};
+        // [0] = exact cache hit, [i] = between 2^(i-1) and 2^i-1 diffs applied, last bucket is open ended
+        uint64_t nDiffsApplied[HIT_BUCKETS]{};
+        uint64_t nMemSnapshotHits{0};
+        uint64_t nDbSnapshotHits{0};
+        uint64_t nRangeDiffsUsed{0};
+        uint64_t nRangeDiffsWritten{0};
+        uint64_t nEvicted{0};
+    };
+
 private:
     CEvoDB& evoDb;
 
-    std::map<uint256, CDeterministicMNList> mnListsCache;
+    // LRU of recently used lists, bounded by the estimated memory usage of the lists
+    struct CachedList
+    {
+        CDeterministicMNList list;
+        size_t nSize;
+        std::list<uint256>::iterator itLru;
+    };
+    std::unordered_map<uint256, CachedList, StaticSaltedHasher> mnListsCache;
+    std::list<uint256> mnListsLru; // most recently used first
+    size_t nListsCacheBytes{0};
+    size_t nMaxListsCacheBytes;
+
+    // lists at every nSnapshotInterval'th height, kept independently of the LRU so that a diff replay never needs
+    // more than nSnapshotInterval steps for recent heights
+    std::map<uint256, CDeterministicMNList> mnListSnapshots;
+    int nSnapshotInterval;
+
+    int nLastCompactedHeight{-1};
+    CacheStats cacheStats;
+
     const CBlockIndex* tipIndex{nullptr};
 
 public:
@@ -658,13 +731,22 @@ public:
 
     bool IsDIP3Enforced(int nHeight = -1);
 
+    // Compacts runs of per-block diffs below the tip into range diffs, called regularly from the scheduler
+    void DoMaintenance();
+
+    void GetCacheStats(CacheStats& statsRet, size_t& nEntriesRet, size_t& nBytesRet, size_t& nMaxBytesRet, size_t& nSnapshotsRet, int& nSnapshotIntervalRet);
+
 public:
     // TODO these can all be removed in a future version
     bool UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList);
     void UpgradeDBIfNeeded();
 
 private:
+    bool GetCachedList(const uint256& blockHash, CDeterministicMNList& listRet);
+    void AddCachedList(const CDeterministicMNList& list);
+    void EraseCachedList(const uint256& blockHash);
     void CleanupCache(int nHeight);
+    bool CompactDiffRange(const CBlockIndex* pindexEnd, CDeterministicMNList& baseList);
 };
 
 extern CDeterministicMNManager* deterministicMNManager;
@@ -18,6 +18,8 @@
 #include "univalue.h"
 #include "validation.h"
 
+#include <limits>
+
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
     proRegTxHash(dmn.proTxHash),
     confirmedHash(dmn.pdmnState->confirmedHash),
@@ -89,6 +91,154 @@ uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
     return ComputeMerkleRoot(leaves, pmutated);
 }
 
+static const size_t NOTHING_MOVED = std::numeric_limits<size_t>::max();
+
+static bool CompareEntryProRegTxHash(const CSimplifiedMNListEntry& a, const uint256& proRegTxHash)
+{
+    return a.proRegTxHash < proRegTxHash;
+}
+
+CSimplifiedMNListMerkleTree::CSimplifiedMNListMerkleTree()
+{
+    Clear();
+}
+
+void CSimplifiedMNListMerkleTree::AddOrUpdate(const CSimplifiedMNListEntry& entry)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), entry.proRegTxHash, CompareEntryProRegTxHash);
+    size_t nPos = it - entries.begin();
+
+    if (it != entries.end() && it->proRegTxHash == entry.proRegTxHash) {
+        if (*it == entry) {
+            return;
+        }
+        *it = entry;
+        levels[0][nPos] = entry.CalcHash();
+        if (nPos < nFirstMovedLeaf) {
+            vDirtyLeaves.emplace_back(nPos);
+        }
+        return;
+    }
+
+    entries.insert(it, entry);
+    levels[0].insert(levels[0].begin() + nPos, entry.CalcHash());
+    nFirstMovedLeaf = std::min(nFirstMovedLeaf, nPos);
+}
+
+void CSimplifiedMNListMerkleTree::Remove(const uint256& proRegTxHash)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), proRegTxHash, CompareEntryProRegTxHash);
+    if (it == entries.end() || it->proRegTxHash != proRegTxHash) {
+        return;
+    }
+    size_t nPos = it - entries.begin();
+
+    entries.erase(it);
+    levels[0].erase(levels[0].begin() + nPos);
+    nFirstMovedLeaf = std::min(nFirstMovedLeaf, nPos);
+}
+
+void CSimplifiedMNListMerkleTree::Clear()
+{
+    entries.clear();
+    levels.assign(1, std::vector<uint256>());
+    equalChildren.clear();
+    nEqualChildren = 0;
+    vDirtyLeaves.clear();
+    nFirstMovedLeaf = NOTHING_MOVED;
+}
+
+uint256 CSimplifiedMNListMerkleTree::CalcMerkleRoot(bool* pmutated)
+{
+    std::vector<size_t> vDirty;
+    vDirty.swap(vDirtyLeaves);
+    size_t nFirstMoved = nFirstMovedLeaf;
+    nFirstMovedLeaf = NOTHING_MOVED;
+
+    size_t nLevel = 0;
+    while (levels[nLevel].size() > 1) {
+        UpdateLevel(nLevel, vDirty, nFirstMoved);
+        nLevel++;
+    }
+
+    // removals might have made the tree lower
+    for (size_t i = nLevel; i < equalChildren.size(); i++) {
+        nEqualChildren -= std::count(equalChildren[i].begin(), equalChildren[i].end(), true);
+    }
+    equalChildren.resize(nLevel);
+    levels.resize(nLevel + 1);
+
+    if (pmutated) {
+        *pmutated = nEqualChildren != 0;
+    }
+    if (levels[nLevel].empty()) {
+        return uint256();
+    }
+    return levels[nLevel][0];
+}
+
+void CSimplifiedMNListMerkleTree::UpdateLevel(size_t nLevel, std::vector<size_t>& vDirty, size_t& nFirstMoved)
+{
+    if (levels.size() < nLevel + 2) {
+        levels.resize(nLevel + 2);
+        equalChildren.resize(nLevel + 1);
+    }
+    const auto& children = levels[nLevel];
+    auto& parents = levels[nLevel + 1];
+    auto& equal = equalChildren[nLevel];
+
+    size_t nLeaves = levels[0].size();
+    size_t nParents = (children.size() + 1) / 2;
+    // parents which did not exist before must be calculated as well
+    size_t nFirstParent = std::min(nFirstMoved / 2, parents.size());
+
+    for (size_t i = nParents; i < equal.size(); i++) {
+        nEqualChildren -= equal[i];
+    }
+    parents.resize(nParents);
+    equal.resize(nParents, false);
+
+    auto calcParent = [&](size_t nParent) {
+        size_t nLeft = nParent * 2;
+        size_t nRight = nLeft + 1;
+        const uint256& left = children[nLeft];
+        const uint256& right = nRight < children.size() ? children[nRight] : left;
+        // ComputeMerkleRoot only reports a mutation when two complete subtrees are equal, not for the duplicated odd
+        // node on each level
+        bool fEqual = ((nRight + 1) << nLevel) <= nLeaves && left == right;
+        if (equal[nParent] != fEqual) {
+            equal[nParent] = fEqual;
+            if (fEqual) {
+                nEqualChildren++;
+            } else {
+                nEqualChildren--;
+            }
+        }
+        parents[nParent] = Hash(left.begin(), left.end(), right.begin(), right.end());
+    };
+
+    std::sort(vDirty.begin(), vDirty.end());
+    std::vector<size_t> vDirtyParents;
+    vDirtyParents.reserve(vDirty.size());
+    for (size_t nChild : vDirty) {
+        size_t nParent = nChild / 2;
+        if (nChild >= nFirstMoved || nParent >= nFirstParent) {
+            break;
+        }
+        if (!vDirtyParents.empty() && vDirtyParents.back() == nParent) {
+            continue;
+        }
+        calcParent(nParent);
+        vDirtyParents.emplace_back(nParent);
+    }
+    for (size_t nParent = nFirstParent; nParent < nParents; nParent++) {
+        calcParent(nParent);
+    }
+
+    vDirty.swap(vDirtyParents);
+    nFirstMoved = nFirstParent;
+}
+
 CSimplifiedMNListDiff::CSimplifiedMNListDiff()
 {
 }
@@ -13,6 +13,7 @@
 #include "version.h"
 
 class UniValue;
+class CBlockIndex;
 class CDeterministicMNList;
 class CDeterministicMN;
 
@@ -84,6 +85,42 @@ public:
     uint256 CalcMerkleRoot(bool* pmutated = NULL) const;
 };
 
+/**
+ * Merkle tree over a simplified MN list which is kept between blocks. Leaf hashes and inner nodes are cached, so that
+ * after adding, updating or removing a few entries only the paths above the touched leaves need to be rehashed.
+ * The resulting root (and mutated flag) is the same as CSimplifiedMNList::CalcMerkleRoot() for the same entries.
+ */
+class CSimplifiedMNListMerkleTree
+{
+private:
+    // sorted by proRegTxHash, same order as in CSimplifiedMNList
+    std::vector<CSimplifiedMNListEntry> entries;
+    // levels[0] holds the leaf hashes, each following level the parents of the previous one
+    std::vector<std::vector<uint256>> levels;
+    // for each inner node, whether both of its children were equal (see ComputeMerkleRoot)
+    std::vector<std::vector<bool>> equalChildren;
+    size_t nEqualChildren{0};
+
+    // leaves which changed in place, only valid below nFirstMovedLeaf
+    std::vector<size_t> vDirtyLeaves;
+    // all leaves from this one on moved due to inserts/removals and must be rehashed upwards
+    size_t nFirstMovedLeaf{0};
+
+public:
+    CSimplifiedMNListMerkleTree();
+
+    size_t size() const { return entries.size(); }
+
+    void AddOrUpdate(const CSimplifiedMNListEntry& entry);
+    void Remove(const uint256& proRegTxHash);
+    void Clear();
+
+    uint256 CalcMerkleRoot(bool* pmutated = NULL);
+
+private:
+    void UpdateLevel(size_t nLevel, std::vector<size_t>& vDirty, size_t& nFirstMoved);
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
@@ -217,10 +217,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
 				LogPrint("gobject", "CGovernanceTriggerManager::CleanAndRemove -- Removing trigger object\n");
             // mark corresponding object for deletion
             if (pObj) {
-                pObj->fCachedDelete = true;
-                if (pObj->nDeletionTime == 0) {
-                    pObj->nDeletionTime = GetAdjustedTime();
-                }
+                pObj->PrepareDeletion(GetAdjustedTime());
             }
             // delete the trigger
             mapTrigger.erase(it++);
@@ -986,6 +983,7 @@ bool CSuperblock::IsExpired()
 				LogPrint("gobject", "CSuperblock::IsExpired -- Expiring outdated object: %s\n", pgovobj->GetHash().ToString());
             pgovobj->fExpired = true;
             pgovobj->nDeletionTime = GetAdjustedTime();
+            pgovobj->fDirtyDB = true;
         }
     }
 
@@ -0,0 +1,168 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-db.h"
+
+#include "governance.h"
+#include "governance-object.h"
+#include "util.h"
+
+static const char DB_MANAGER = 'm';
+static const char DB_OBJECT = 'o';
+static const char DB_VOTE = 'v';
+static const char DB_VOTE_HASH = 'h';
+
+// (DB_VOTE, parent hash, masternode outpoint, signal), the key of the newest vote of a masternode per object and signal
+typedef std::tuple<char, uint256, COutPoint, int> VoteKey;
+
+static VoteKey MakeVoteKey(const CGovernanceVote& vote)
+{
+    return std::make_tuple(DB_VOTE, vote.GetParentHash(), vote.GetMasternodeOutpoint(), int(vote.GetSignal()));
+}
+
+CGovernanceDB* governanceDb;
+
+CGovernanceDB::CGovernanceDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "governance"), nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CGovernanceDB::WriteManager(const CGovernanceManager& govman)
+{
+    return db.Write(DB_MANAGER, govman);
+}
+
+bool CGovernanceDB::ReadManager(CGovernanceManager& govman)
+{
+    return db.Read(DB_MANAGER, govman);
+}
+
+bool CGovernanceDB::WriteObject(const CGovernanceObject& govobj)
+{
+    return db.Write(std::make_pair(DB_OBJECT, govobj.GetHash()), govobj);
+}
+
+void CGovernanceDB::EraseObject(const uint256& nHash)
+{
+    CDBBatch batch(db);
+    batch.Erase(std::make_pair(DB_OBJECT, nHash));
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, nHash));
+    while (pcursor->Valid()) {
+        VoteKey key;
+        if (!pcursor->GetKey(key) || std::get<0>(key) != DB_VOTE || std::get<1>(key) != nHash) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (pcursor->GetValue(vote)) {
+            batch.Erase(std::make_pair(DB_VOTE_HASH, vote.GetHash()));
+        }
+        batch.Erase(key);
+        pcursor->Next();
+    }
+    pcursor.reset();
+
+    db.WriteBatch(batch);
+}
+
+void CGovernanceDB::ReadObjects(std::map<uint256, CGovernanceObject>& mapObjects)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_OBJECT, uint256()));
+    while (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_OBJECT) {
+            break;
+        }
+        CGovernanceObject govobj;
+        if (pcursor->GetValue(govobj)) {
+            mapObjects.emplace(key.second, govobj);
+        } else {
+            LogPrintf("CGovernanceDB::%s -- failed to read object %s\n", __func__, key.second.ToString());
+        }
+        pcursor->Next();
+    }
+}
+
+void CGovernanceDB::WriteVote(const CGovernanceVote& vote)
+{
+    VoteKey key = MakeVoteKey(vote);
+
+    CDBBatch batch(db);
+    CGovernanceVote oldVote;
+    if (db.Read(key, oldVote)) {
+        batch.Erase(std::make_pair(DB_VOTE_HASH, oldVote.GetHash()));
+    }
+    batch.Write(key, vote);
+    batch.Write(std::make_pair(DB_VOTE_HASH, vote.GetHash()), key);
+    db.WriteBatch(batch);
+}
+
+bool CGovernanceDB::HasVote(const uint256& nVoteHash) const
+{
+    return db.Exists(std::make_pair(DB_VOTE_HASH, nVoteHash));
+}
+
+bool CGovernanceDB::ReadVote(const uint256& nVoteHash, CGovernanceVote& vote) const
+{
+    VoteKey key;
+    return db.Read(std::make_pair(DB_VOTE_HASH, nVoteHash), key) && db.Read(key, vote);
+}
+
+std::vector<CGovernanceVote> CGovernanceDB::ReadVotes(const uint256& nParentHash)
+{
+    std::vector<CGovernanceVote> vecVotes;
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, nParentHash));
+    while (pcursor->Valid()) {
+        VoteKey key;
+        if (!pcursor->GetKey(key) || std::get<0>(key) != DB_VOTE || std::get<1>(key) != nParentHash) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (pcursor->GetValue(vote)) {
+            vecVotes.emplace_back(std::move(vote));
+        }
+        pcursor->Next();
+    }
+
+    return vecVotes;
+}
+
+void CGovernanceDB::EraseVote(const uint256& nVoteHash)
+{
+    VoteKey key;
+    if (!db.Read(std::make_pair(DB_VOTE_HASH, nVoteHash), key)) {
+        return;
+    }
+    CDBBatch batch(db);
+    batch.Erase(key);
+    batch.Erase(std::make_pair(DB_VOTE_HASH, nVoteHash));
+    db.WriteBatch(batch);
+}
+
+void CGovernanceDB::EraseVotes(const uint256& nParentHash, const COutPoint& mnOutpoint)
+{
+    CDBBatch batch(db);
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_tuple(DB_VOTE, nParentHash, mnOutpoint));
+    while (pcursor->Valid()) {
+        VoteKey key;
+        if (!pcursor->GetKey(key) || std::get<0>(key) != DB_VOTE || std::get<1>(key) != nParentHash || std::get<2>(key) != mnOutpoint) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (pcursor->GetValue(vote)) {
+            batch.Erase(std::make_pair(DB_VOTE_HASH, vote.GetHash()));
+        }
+        batch.Erase(key);
+        pcursor->Next();
+    }
+    pcursor.reset();
+
+    db.WriteBatch(batch);
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_DB_H
+#define GOVERNANCE_DB_H
+
+#include "dbwrapper.h"
+#include "governance-vote.h"
+#include "uint256.h"
+
+#include <map>
+#include <vector>
+
+class CGovernanceManager;
+class CGovernanceObject;
+
+static const size_t GOVERNANCE_DB_CACHE = 8 << 20;
+
+/**
+ * Persistent store of governance objects and votes (<datadir>/governance), replacing the governance.dat dumps.
+ *
+ * Objects and votes are written as they are accepted, so neither flushing nor shutdown depends on the number of
+ * votes. Objects are stored without their votes and loaded at startup. The votes of an object are only read when
+ * the object needs them (vote counts, RPC, syncing a peer), see CGovernanceObject::LoadVotes.
+ *
+ * Only the newest vote of a masternode per object and signal is stored, a newer vote overwrites the older one.
+ */
+class CGovernanceDB
+{
+private:
+    CDBWrapper db;
+
+public:
+    CGovernanceDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool WriteManager(const CGovernanceManager& govman);
+    bool ReadManager(CGovernanceManager& govman);
+
+    bool WriteObject(const CGovernanceObject& govobj);
+    /** Erases the object and all its votes */
+    void EraseObject(const uint256& nHash);
+    /** Reads all objects, without votes */
+    void ReadObjects(std::map<uint256, CGovernanceObject>& mapObjects);
+
+    void WriteVote(const CGovernanceVote& vote);
+    bool HasVote(const uint256& nVoteHash) const;
+    bool ReadVote(const uint256& nVoteHash, CGovernanceVote& vote) const;
+    std::vector<CGovernanceVote> ReadVotes(const uint256& nParentHash);
+    void EraseVote(const uint256& nVoteHash);
+    void EraseVotes(const uint256& nParentHash, const COutPoint& mnOutpoint);
+};
+
+extern CGovernanceDB* governanceDb;
+
+#endif
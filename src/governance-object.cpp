@@ -6,6 +6,7 @@
 #include "governance-object.h"
 #include "core_io.h"
 #include "governance-classes.h"
+#include "governance-db.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
 #include "governance.h"
@@ -40,8 +41,11 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
-    fileVotes()
+    fileVotes(),
+    fVotesLoaded(true),
+    fDirtyDB(false)
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
@@ -68,8 +72,11 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
-    fileVotes()
+    fileVotes(),
+    fVotesLoaded(true),
+    fDirtyDB(false)
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
@@ -96,8 +103,11 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteTally(other.voteTally),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
-    fileVotes(other.fileVotes)
+    fileVotes(other.fileVotes),
+    fVotesLoaded(other.fVotesLoaded),
+    fDirtyDB(other.fDirtyDB)
 {
 }
 
@@ -107,6 +117,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     CConnman& connman)
 {
     LOCK(cs);
+    LoadVotes();
 
     // do not process already known valid votes twice
     if (fileVotes.HasVote(vote.GetHash())) {
@@ -220,8 +231,12 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, vote.GetOutcome());
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp(), vote.GetMultipleChoiceData());
     fileVotes.AddVote(vote);
+    if (governanceDb) {
+        governanceDb->WriteVote(vote);
+    }
     fDirtyCache = true;
     return true;
 }
@@ -229,6 +244,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
 void CGovernanceObject::ClearMasternodeVotes()
 {
     LOCK(cs);
+    LoadVotes();
 
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
@@ -236,6 +252,12 @@ void CGovernanceObject::ClearMasternodeVotes()
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            if (governanceDb) {
+                governanceDb->EraseVotes(GetHash(), it->first);
+            }
+            for (const auto& instancePair : it->second.mapInstances) {
+                UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, VOTE_OUTCOME_NONE);
+            }
             mapCurrentMNVotes.erase(it++);
         } else {
             ++it;
@@ -246,6 +268,7 @@ void CGovernanceObject::ClearMasternodeVotes()
 std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpoint)
 {
     LOCK(cs);
+    LoadVotes();
 
     auto it = mapCurrentMNVotes.find(mnOutpoint);
     if (it == mapCurrentMNVotes.end()) {
@@ -257,12 +280,18 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
     if (removedVotes.empty()) {
         return {};
     }
+    if (governanceDb) {
+        for (const auto& voteHash : removedVotes) {
+            governanceDb->EraseVote(voteHash);
+        }
+    }
 
     auto nParentHash = GetHash();
     for (auto jt = it->second.mapInstances.begin(); jt != it->second.mapInstances.end(); ) {
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome, "0");
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            UpdateVoteTally(jt->first, jt->second.eOutcome, VOTE_OUTCOME_NONE);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -619,16 +648,13 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     LOCK(cs);
+    LoadVotes();
 
-    int nCount = 0;
-    for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+    if (eVoteSignalIn <= VOTE_SIGNAL_NONE || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL ||
+        eVoteOutcomeIn <= VOTE_OUTCOME_NONE || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return 0;
     }
-    return nCount;
+    return voteTally[eVoteSignalIn][eVoteOutcomeIn];
 }
 
 std::string CGovernanceObject::ReturnWinner() const
@@ -637,7 +663,7 @@ std::string CGovernanceObject::ReturnWinner() const
 	
     std::string sOut;
     
-	auto fileVotes = GetVoteFile();
+	const auto& fileVotes = GetVoteFile();
 
     for (const auto& vote : fileVotes.GetVotes()) 
 	{
@@ -685,6 +711,7 @@ int CGovernanceObject::GetAbstainCount(vote_signal_enum_t eVoteSignalIn) const
 bool CGovernanceObject::GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const
 {
     LOCK(cs);
+    LoadVotes();
 
     vote_m_cit it = mapCurrentMNVotes.find(mnCollateralOutpoint);
     if (it == mapCurrentMNVotes.end()) {
@@ -730,10 +757,7 @@ void CGovernanceObject::UpdateSentinelVariables()
 
     if (GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING) >= nAbsVoteReq) fCachedFunding = true;
     if ((GetAbsoluteYesCount(VOTE_SIGNAL_DELETE) >= nAbsDeleteReq) && !fCachedDelete) {
-        fCachedDelete = true;
-        if (nDeletionTime == 0) {
-            nDeletionTime = GetAdjustedTime();
-        }
+        PrepareDeletion(GetAdjustedTime());
     }
     if (GetAbsoluteYesCount(VOTE_SIGNAL_ENDORSED) >= nAbsVoteReq) fCachedEndorsed = true;
 
@@ -770,3 +794,40 @@ void CGovernanceObject::CheckOrphanVotes(CConnman& connman)
         }
     }
 }
+
+void CGovernanceObject::LoadVotes() const
+{
+    AssertLockHeld(cs);
+
+    if (fVotesLoaded) {
+        return;
+    }
+    fVotesLoaded = true;
+    if (!governanceDb) {
+        return;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    std::vector<CGovernanceVote> vecVotes = governanceDb->ReadVotes(GetHash());
+    for (const auto& vote : vecVotes) {
+        // the db only has the newest vote per masternode and signal, and not the time we received it
+        vote_instance_t& voteInstance = mapCurrentMNVotes[vote.GetMasternodeOutpoint()].mapInstances[int(vote.GetSignal())];
+        UpdateVoteTally(vote.GetSignal(), voteInstance.eOutcome, vote.GetOutcome());
+        voteInstance = vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp(), vote.GetMultipleChoiceData());
+        fileVotes.AddVote(vote);
+    }
+    LogPrint("gobject", "CGovernanceObject::%s -- loaded %d votes for %s, %dms\n", __func__, vecVotes.size(), GetHash().ToString(), GetTimeMillis() - nStart);
+}
+
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOldOutcome, vote_outcome_enum_t eNewOutcome) const
+{
+    if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) {
+        return;
+    }
+    if (eOldOutcome > VOTE_OUTCOME_NONE && eOldOutcome <= VOTE_OUTCOME_ABSTAIN) {
+        --voteTally[nSignal][eOldOutcome];
+    }
+    if (eNewOutcome > VOTE_OUTCOME_NONE && eNewOutcome <= VOTE_OUTCOME_ABSTAIN) {
+        ++voteTally[nSignal][eNewOutcome];
+    }
+}
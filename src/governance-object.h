@@ -21,6 +21,8 @@
 
 #include <univalue.h>
 
+#include <array>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -188,12 +190,21 @@ private:
     /// Failed to parse object data
     bool fUnparsable;
 
-    vote_m_t mapCurrentMNVotes;
+    mutable vote_m_t mapCurrentMNVotes;
+
+    /// number of current masternode votes by signal and outcome, kept in step with mapCurrentMNVotes
+    mutable std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> voteTally;
 
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
-    CGovernanceObjectVoteFile fileVotes;
+    mutable CGovernanceObjectVoteFile fileVotes;
+
+    /// false for objects read from the governance db until their votes were read as well
+    mutable bool fVotesLoaded;
+
+    /// nDeletionTime or fExpired changed since the object was written to the governance db
+    bool fDirtyDB;
 
 public:
     CGovernanceObject();
@@ -214,6 +225,16 @@ public:
         return nDeletionTime;
     }
 
+    /// Flag the object for deletion, the deletion time is only set the first time
+    void PrepareDeletion(int64_t nDeletionTimeIn)
+    {
+        fCachedDelete = true;
+        if (nDeletionTime == 0) {
+            nDeletionTime = nDeletionTimeIn;
+            fDirtyDB = true;
+        }
+    }
+
     int GetObjectType() const
     {
         return nObjectType;
@@ -262,6 +283,8 @@ public:
 
     const CGovernanceObjectVoteFile& GetVoteFile() const
     {
+        LOCK(cs);
+        LoadVotes();
         return fileVotes;
     }
 
@@ -335,13 +358,13 @@ public:
 		{
             // Only include these for the disk file format
             if (fDebugSpam)
-				LogPrint("gobject", "CGovernanceObject::SerializationOp Reading/writing votes from/to disk\n");
+				LogPrint("gobject", "CGovernanceObject::SerializationOp Reading/writing object from/to disk\n");
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
-            READWRITE(mapCurrentMNVotes);
-            READWRITE(fileVotes);
-            if (fDebugSpam)
-				LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
+            // votes are stored separately in the governance db
+            if (ser_action.ForRead()) {
+                fVotesLoaded = false;
+            }
         }
 
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
@@ -367,6 +390,12 @@ private:
     std::set<uint256> RemoveInvalidVotes(const COutPoint& mnOutpoint);
 
     void CheckOrphanVotes(CConnman& connman);
+
+    /// Reads the votes of an object from the governance db when they are needed for the first time
+    void LoadVotes() const;
+
+    /// Moves a masternode's vote for a signal from one outcome to another in voteTally
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOldOutcome, vote_outcome_enum_t eNewOutcome) const;
 };
 
 
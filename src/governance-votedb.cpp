@@ -4,20 +4,7 @@
 
 #include "governance-votedb.h"
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
-    nMemoryVotes(0),
-    listVotes(),
-    mapVoteIndex()
-{
-}
-
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other) :
-    nMemoryVotes(other.nMemoryVotes),
-    listVotes(other.listVotes),
-    mapVoteIndex()
-{
-    RebuildIndex();
-}
+#include <algorithm>
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
@@ -25,47 +12,66 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
     // make sure to never add/update already known votes
     if (HasVote(nHash))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
-    ++nMemoryVotes;
-    RemoveOldVotes(vote);
+
+    if (vecHash.empty()) {
+        nParentHash = vote.GetParentHash();
+    }
+
+    auto mnpair = mapMasternodeIndex.emplace(vote.GetMasternodeOutpoint(), (uint32_t)vecMasternodes.size());
+    uint32_t nMasternode = mnpair.first->second;
+    if (mnpair.second) {
+        vecMasternodes.emplace_back(vote.GetMasternodeOutpoint());
+        vecMasternodeRows.emplace_back();
+    }
+
+    uint32_t nRow = (uint32_t)vecHash.size();
+    vecMasternode.emplace_back(nMasternode);
+    vecSignal.emplace_back(int(vote.GetSignal()));
+    vecOutcome.emplace_back(int(vote.GetOutcome()));
+    vecTime.emplace_back(vote.GetTimestamp());
+    vecSig.emplace_back(vote.GetSignature());
+    vecMultipleChoiceData.emplace_back(vote.GetMultipleChoiceData());
+    vecHash.emplace_back(nHash);
+    mapHashRow.emplace(nHash, nRow);
+    vecMasternodeRows[nMasternode].emplace_back(nRow);
+
+    RemoveOldVotes(vote, nMasternode);
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    return mapVoteIndex.find(nHash) != mapVoteIndex.end();
+    return mapHashRow.count(nHash) != 0;
 }
 
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if (it == mapVoteIndex.end()) {
+    auto it = mapHashRow.find(nHash);
+    if (it == mapHashRow.end()) {
         return false;
     }
-    ss << *(it->second);
+    ss << GetVote(it->second);
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for (vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    vecResult.reserve(vecHash.size());
+    for (uint32_t nRow = 0; nRow < vecHash.size(); ++nRow) {
+        vecResult.push_back(GetVote(nRow));
     }
     return vecResult;
 }
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
-        }
+    auto it = mapMasternodeIndex.find(outpointMasternode);
+    if (it == mapMasternodeIndex.end()) {
+        return;
+    }
+    std::vector<uint32_t>& vecRows = vecMasternodeRows[it->second];
+    while (!vecRows.empty()) {
+        RemoveVote(vecRows.back());
     }
 }
 
@@ -73,56 +79,83 @@ std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint&
 {
     std::set<uint256> removedVotes;
 
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
-            if (!it->IsValid(useVotingKey)) {
-                removedVotes.emplace(it->GetHash());
-                --nMemoryVotes;
-                mapVoteIndex.erase(it->GetHash());
-                listVotes.erase(it++);
-                continue;
-            }
+    auto it = mapMasternodeIndex.find(outpointMasternode);
+    if (it == mapMasternodeIndex.end()) {
+        return removedVotes;
+    }
+
+    // removing a row changes the row numbers, so collect the hashes first
+    std::vector<uint256> vecInvalid;
+    for (uint32_t nRow : vecMasternodeRows[it->second]) {
+        bool useVotingKey = fProposal && (vecSignal[nRow] == VOTE_SIGNAL_FUNDING);
+        if (!GetVote(nRow).IsValid(useVotingKey)) {
+            vecInvalid.emplace_back(vecHash[nRow]);
         }
-        ++it;
+    }
+    for (const uint256& nHash : vecInvalid) {
+        RemoveVote(mapHashRow.at(nHash));
+        removedVotes.emplace(nHash);
     }
 
     return removedVotes;
 }
 
-void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
+void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote, uint32_t nMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == vote.GetMasternodeOutpoint() // same masternode
-            && it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
-            && it->GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
-            && it->GetTimestamp() < vote.GetTimestamp()) // older than new vote
+    // all rows of a file have the same parent, so only the signal and the time need to be checked
+    std::vector<uint32_t>& vecRows = vecMasternodeRows[nMasternode];
+    size_t i = 0;
+    while (i < vecRows.size()) {
+        uint32_t nRow = vecRows[i];
+        if (vecSignal[nRow] == int(vote.GetSignal()) // same signal (e.g. "funding", "delete", etc.)
+            && vecTime[nRow] < vote.GetTimestamp()) // older than new vote
         {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+            // RemoveVote swaps the last row of this masternode to position i
+            RemoveVote(nRow);
         } else {
-            ++it;
+            ++i;
         }
     }
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+CGovernanceVote CGovernanceObjectVoteFile::GetVote(uint32_t nRow) const
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if (mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
-        } else {
-            listVotes.erase(it++);
-        }
+    CGovernanceVote vote(vecMasternodes[vecMasternode[nRow]], nParentHash, vote_signal_enum_t(vecSignal[nRow]), vote_outcome_enum_t(vecOutcome[nRow]), vecMultipleChoiceData[nRow]);
+    vote.SetTime(vecTime[nRow]);
+    vote.SetSignature(vecSig[nRow]);
+    return vote;
+}
+
+void CGovernanceObjectVoteFile::RemoveVote(uint32_t nRow)
+{
+    mapHashRow.erase(vecHash[nRow]);
+
+    std::vector<uint32_t>& vecRows = vecMasternodeRows[vecMasternode[nRow]];
+    auto it = std::find(vecRows.begin(), vecRows.end(), nRow);
+    *it = vecRows.back();
+    vecRows.pop_back();
+
+    // move the last row into the hole
+    uint32_t nLast = (uint32_t)vecHash.size() - 1;
+    if (nRow != nLast) {
+        vecMasternode[nRow] = vecMasternode[nLast];
+        vecSignal[nRow] = vecSignal[nLast];
+        vecOutcome[nRow] = vecOutcome[nLast];
+        vecTime[nRow] = vecTime[nLast];
+        vecSig[nRow] = std::move(vecSig[nLast]);
+        vecMultipleChoiceData[nRow] = std::move(vecMultipleChoiceData[nLast]);
+        vecHash[nRow] = vecHash[nLast];
+
+        mapHashRow[vecHash[nRow]] = nRow;
+        std::vector<uint32_t>& vecLastRows = vecMasternodeRows[vecMasternode[nRow]];
+        *std::find(vecLastRows.begin(), vecLastRows.end(), nLast) = nRow;
     }
+
+    vecMasternode.pop_back();
+    vecSignal.pop_back();
+    vecOutcome.pop_back();
+    vecTime.pop_back();
+    vecSig.pop_back();
+    vecMultipleChoiceData.pop_back();
+    vecHash.pop_back();
 }
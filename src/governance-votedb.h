@@ -5,51 +5,47 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "governance-vote.h"
+#include "saltedhasher.h"
 #include "serialize.h"
 #include "streams.h"
 #include "uint256.h"
 
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
  *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Votes are stored column-wise. A row only keeps the masternode index, signal, outcome, time and signature (plus the
+ * multiple choice data), the masternode outpoints are stored once per file and the parent hash once for all votes.
+ * Rows are indexed by vote hash and by masternode. Removing a row moves the last row into its place, so the order
+ * of GetVotes() is unspecified.
  */
 class CGovernanceObjectVoteFile
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
-
-    typedef vote_l_t::iterator vote_l_it;
-
-    typedef vote_l_t::const_iterator vote_l_cit;
-
-    typedef std::map<uint256, vote_l_it> vote_m_t;
-
-    typedef vote_m_t::iterator vote_m_it;
-
-    typedef vote_m_t::const_iterator vote_m_cit;
-
 private:
-    static const int MAX_MEMORY_VOTES = -1;
+    uint256 nParentHash;
 
-    int nMemoryVotes;
+    // masternode outpoints referenced by the rows, and the rows of each of them
+    std::vector<COutPoint> vecMasternodes;
+    std::map<COutPoint, uint32_t> mapMasternodeIndex;
+    std::vector<std::vector<uint32_t> > vecMasternodeRows;
 
-    vote_l_t listVotes;
+    // the columns, one entry per vote
+    std::vector<uint32_t> vecMasternode;
+    std::vector<int> vecSignal;
+    std::vector<int> vecOutcome;
+    std::vector<int64_t> vecTime;
+    std::vector<std::vector<unsigned char> > vecSig;
+    std::vector<std::string> vecMultipleChoiceData;
+    std::vector<uint256> vecHash;
 
-    vote_m_t mapVoteIndex;
+    std::unordered_map<uint256, uint32_t, StaticSaltedHasher> mapHashRow;
 
 public:
-    CGovernanceObjectVoteFile();
-
-    CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
-
     /**
      * Add a vote to the file
      */
@@ -65,33 +61,23 @@ public:
      */
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount()
+    int GetVoteCount() const
     {
-        return nMemoryVotes;
+        return (int)vecHash.size();
     }
 
     std::vector<CGovernanceVote> GetVotes() const;
+    const std::vector<uint256>& GetVoteHashes() const { return vecHash; }
 
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action)
-    {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if (ser_action.ForRead()) {
-            RebuildIndex();
-        }
-    }
-
 private:
     // Drop older votes for the same gobject from the same masternode
-    void RemoveOldVotes(const CGovernanceVote& vote);
+    void RemoveOldVotes(const CGovernanceVote& vote, uint32_t nMasternode);
 
-    void RebuildIndex();
+    CGovernanceVote GetVote(uint32_t nRow) const;
+    void RemoveVote(uint32_t nRow);
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include "governance.h"
 #include "consensus/validation.h"
 #include "governance-classes.h"
+#include "governance-db.h"
 #include "governance-object.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
@@ -25,7 +26,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-15";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-16";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -70,7 +71,11 @@ bool CGovernanceManager::HaveVoteForHash(const uint256& nHash) const
     LOCK(cs);
 
     CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().HasVote(nHash);
+    if (cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().HasVote(nHash)) {
+        return true;
+    }
+    // votes of earlier runs are only in the governance db until their object needs them
+    return governanceDb && governanceDb->HasVote(nHash);
 }
 
 int CGovernanceManager::GetVoteCount() const
@@ -84,7 +89,16 @@ bool CGovernanceManager::SerializeVoteForHash(const uint256& nHash, CDataStream&
     LOCK(cs);
 
     CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
+    if (cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss)) {
+        return true;
+    }
+
+    CGovernanceVote vote;
+    if (!governanceDb || !governanceDb->ReadVote(nHash, vote) || !mapObjects.count(vote.GetParentHash())) {
+        return false;
+    }
+    ss << vote;
+    return true;
 }
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -345,14 +359,17 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         if (!triggerman.AddNewTrigger(nHash)) {
             LogPrint("gobject", "CGovernanceManager::AddGovernanceObject -- undo adding invalid trigger object: hash = %s\n", nHash.ToString());
             CGovernanceObject& objref = objpair.first->second;
-            objref.fCachedDelete = true;
-            if (objref.nDeletionTime == 0) {
-                objref.nDeletionTime = GetAdjustedTime();
-            }
+            objref.PrepareDeletion(GetAdjustedTime());
+            // not written yet, the next flush stores it for the remaining time before deletion
+            objref.fDirtyDB = true;
             return;
         }
     }
 
+    if (governanceDb) {
+        governanceDb->WriteObject(objpair.first->second);
+    }
+
 	if (fDebugSpam)
 		LogPrintf("CGovernanceManager::AddGovernanceObject -- %s new, received from %s\n", strHash, pfrom ? pfrom->GetAddrName() : "nullptr");
     govobj.Relay(connman);
@@ -455,6 +472,9 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            if (governanceDb) {
+                governanceDb->EraseObject(nHash);
+            }
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -464,10 +484,7 @@ void CGovernanceManager::UpdateCachesAndClean()
 				{
                     if (fDebugSpam)
 						LogPrintf("CGovernanceManager::UpdateCachesAndClean -- set for deletion expired obj %s\n", (*it).first.ToString());
-                    pObj->fCachedDelete = true;
-                    if (pObj->nDeletionTime == 0) {
-                        pObj->nDeletionTime = nNow;
-                    }
+                    pObj->PrepareDeletion(nNow);
                 }
             }
             ++it;
@@ -585,6 +602,8 @@ void CGovernanceManager::DoMaintenance(CConnman& connman)
     // CHECK AND REMOVE - REPROCESS GOVERNANCE OBJECTS
 
     UpdateCachesAndClean();
+
+    FlushToDB();
 }
 
 bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
@@ -677,9 +696,7 @@ void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp,
         return;
     }
 
-    auto fileVotes = govobj.GetVoteFile();
-
-    for (const auto& vote : fileVotes.GetVotes()) {
+    for (const auto& vote : govobj.GetVoteFile().GetVotes()) {
         uint256 nVoteHash = vote.GetHash();
 
         bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
@@ -1035,10 +1052,10 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if (pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for (const auto& vote : vecVotes) {
-                filter.insert(vote.GetHash());
+            const std::vector<uint256>& vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+            nVoteCount = vecVoteHashes.size();
+            for (const auto& nVoteHash : vecVoteHashes) {
+                filter.insert(nVoteHash);
             }
         }
     }
@@ -1188,20 +1205,6 @@ bool CGovernanceManager::AcceptMessage(const uint256& nHash, hash_s_t& setHash)
     return true;
 }
 
-void CGovernanceManager::RebuildIndexes()
-{
-    LOCK(cs);
-
-    cmapVoteToObject.Clear();
-    for (auto& objPair : mapObjects) {
-        CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for (size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
-        }
-    }
-}
-
 void CGovernanceManager::AddCachedTriggers()
 {
     LOCK(cs);
@@ -1214,10 +1217,7 @@ void CGovernanceManager::AddCachedTriggers()
         }
 
         if (!triggerman.AddNewTrigger(govobj.GetHash())) {
-            govobj.fCachedDelete = true;
-            if (govobj.nDeletionTime == 0) {
-                govobj.nDeletionTime = GetAdjustedTime();
-            }
+            govobj.PrepareDeletion(GetAdjustedTime());
         }
     }
 }
@@ -1227,13 +1227,53 @@ void CGovernanceManager::InitOnLoad()
     LOCK(cs);
     int64_t nStart = GetTimeMillis();
 	if (fDebugSpam)
-		LogPrintf("Preparing masternode indexes and governance triggers...\n");
-    RebuildIndexes();
+		LogPrintf("Preparing governance triggers...\n");
+    // cmapVoteToObject only knows votes received in this run, the others are looked up in the governance db
     AddCachedTriggers();
-    LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
+    LogPrintf("Governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
     LogPrintf("     %s\n", ToString());
 }
 
+bool CGovernanceManager::LoadFromDB()
+{
+    if (!governanceDb) {
+        return false;
+    }
+
+    LOCK(cs);
+    int64_t nStart = GetTimeMillis();
+    // an unknown version leaves the manager cleared, objects and votes are kept in that case
+    if (!governanceDb->ReadManager(*this)) {
+        Clear();
+    }
+    governanceDb->ReadObjects(mapObjects);
+    LogPrintf("Loaded %d governance objects from the governance db  %dms\n", mapObjects.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+void CGovernanceManager::FlushToDB()
+{
+    if (!governanceDb) {
+        return;
+    }
+
+    LOCK(cs);
+    // votes and new objects are written as they come in, only the deletion state of objects changes later
+    int nWritten = 0;
+    for (auto& objPair : mapObjects) {
+        CGovernanceObject& govobj = objPair.second;
+        if (!govobj.fDirtyDB) {
+            continue;
+        }
+        if (governanceDb->WriteObject(govobj)) {
+            govobj.fDirtyDB = false;
+            nWritten++;
+        }
+    }
+    governanceDb->WriteManager(*this);
+    LogPrint("gobject", "CGovernanceManager::FlushToDB -- wrote %d changed objects\n", nWritten);
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
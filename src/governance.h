@@ -360,7 +360,6 @@ public:
         READWRITE(mapErasedGovernanceObjects);
         READWRITE(cmapInvalidVotes);
         READWRITE(cmmapOrphanVotes);
-        READWRITE(mapObjects);
         READWRITE(mapLastMasternodeObject);
         READWRITE(lastMNListForVotingKeys);
     }
@@ -421,6 +420,11 @@ public:
 
     void InitOnLoad();
 
+    /** Reads the objects (but not their votes) and the state of the manager from the governance db */
+    bool LoadFromDB();
+    /** Writes what's not written as it changes: the manager's state and objects whose deletion state changed */
+    void FlushToDB();
+
 
     int RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
@@ -450,8 +454,6 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman& connman);
 
-    void RebuildIndexes();
-
     void AddCachedTriggers();
 
     void RequestOrphanObjects(CConnman& connman);
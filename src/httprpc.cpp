@@ -7,6 +7,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "httpserver.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -18,6 +19,8 @@
 #include <stdio.h>
 #include "utilstrencodings.h"
 
+#include <map>
+
 #include <boost/algorithm/string.hpp> // boost::trim
 #include <boost/foreach.hpp> //BOOST_FOREACH
 
@@ -147,6 +150,108 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/** Larger requests are not parsed on the event loop thread to pick their work class */
+static const size_t MAX_CLASSIFIED_REQUEST_SIZE = 256 * 1024;
+
+/** Work class of a single JSON-RPC call; anything not listed here is HTTP_WORK_NORMAL */
+static HTTPWorkClass JSONRPCWorkClass(const UniValue& request)
+{
+    static const std::map<std::string, HTTPWorkClass> mapMethods = {
+        {"getbestblockhash", HTTP_WORK_FAST},
+        {"getblockcount", HTTP_WORK_FAST},
+        {"getblockforstratum", HTTP_WORK_FAST},
+        {"getblocktemplate", HTTP_WORK_FAST},
+        {"getmininginfo", HTTP_WORK_FAST},
+        {"getrpcqueueinfo", HTTP_WORK_FAST},
+        {"getstratuminfo", HTTP_WORK_FAST},
+        {"getzmqnotifications", HTTP_WORK_FAST},
+        {"sendrawtransaction", HTTP_WORK_FAST},
+        {"submitblock", HTTP_WORK_FAST},
+
+        {"dumpwallet", HTTP_WORK_HEAVY},
+        {"getaddressbalance", HTTP_WORK_HEAVY},
+        {"getaddressdeltas", HTTP_WORK_HEAVY},
+        {"getaddresstxids", HTTP_WORK_HEAVY},
+        {"getaddressutxos", HTTP_WORK_HEAVY},
+        {"gettxoutsetinfo", HTTP_WORK_HEAVY},
+        {"importaddress", HTTP_WORK_HEAVY},
+        {"importmulti", HTTP_WORK_HEAVY},
+        {"importprivkey", HTTP_WORK_HEAVY},
+        {"importpubkey", HTTP_WORK_HEAVY},
+        {"importwallet", HTTP_WORK_HEAVY},
+        {"invalidateblock", HTTP_WORK_HEAVY},
+        {"reconsiderblock", HTTP_WORK_HEAVY},
+        {"verifychain", HTTP_WORK_HEAVY},
+    };
+    // exec is classified by its subcommand
+    static const std::map<std::string, HTTPWorkClass> mapExec = {
+        {"analyze", HTTP_WORK_HEAVY},
+        {"auditabntx", HTTP_WORK_HEAVY},
+        {"cleantips", HTTP_WORK_HEAVY},
+        {"getdashstakereport", HTTP_WORK_HEAVY},
+        {"getdwsreport", HTTP_WORK_HEAVY},
+        {"getgobjectvotingdata", HTTP_WORK_HEAVY},
+        {"getpoints", HTTP_WORK_HEAVY},
+        {"reassesschains", HTTP_WORK_HEAVY},
+        {"search", HTTP_WORK_HEAVY},
+
+        {"associate", HTTP_WORK_EXTERNAL},
+        {"bipfs_file", HTTP_WORK_EXTERNAL},
+        {"bipfs_folder", HTTP_WORK_EXTERNAL},
+        {"bipfs_get", HTTP_WORK_EXTERNAL},
+        {"bipfs_list", HTTP_WORK_EXTERNAL},
+        {"boinc1", HTTP_WORK_EXTERNAL},
+        {"diagnosewcgpoints", HTTP_WORK_EXTERNAL},
+        {"funddsql", HTTP_WORK_EXTERNAL},
+        {"getwcgmemberid", HTTP_WORK_EXTERNAL},
+        {"navdsql", HTTP_WORK_EXTERNAL},
+        {"poostest", HTTP_WORK_EXTERNAL},
+        {"price", HTTP_WORK_EXTERNAL},
+        {"rac", HTTP_WORK_EXTERNAL},
+        {"testhttps", HTTP_WORK_EXTERNAL},
+    };
+
+    if (!request.isObject())
+        return HTTP_WORK_NORMAL;
+    const UniValue& method = find_value(request, "method");
+    if (!method.isStr())
+        return HTTP_WORK_NORMAL;
+    if (method.get_str() == "exec") {
+        const UniValue& params = find_value(request, "params");
+        UniValue command = params.isArray() && params.size() > 0 ? params[0] : params.isObject() ? find_value(params, "1") : NullUniValue;
+        std::map<std::string, HTTPWorkClass>::const_iterator it = command.isStr() ? mapExec.find(command.get_str()) : mapExec.end();
+        return it == mapExec.end() ? HTTP_WORK_NORMAL : it->second;
+    }
+    std::map<std::string, HTTPWorkClass>::const_iterator it = mapMethods.find(method.get_str());
+    return it == mapMethods.end() ? HTTP_WORK_NORMAL : it->second;
+}
+
+/**
+ * Work class of a JSON-RPC request; a batch gets the most expensive class of its calls.
+ * Runs on the event loop thread, so only authorized requests are parsed; everything else
+ * goes to the normal queue and is rejected there.
+ */
+static HTTPWorkClass HTTPReq_JSONRPCWorkClass(HTTPRequest* req)
+{
+    if (req->GetRequestMethod() != HTTPRequest::POST)
+        return HTTP_WORK_NORMAL;
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    std::string strAuthUser;
+    if (!authHeader.first || !RPCAuthorized(authHeader.second, strAuthUser))
+        return HTTP_WORK_NORMAL;
+    std::string strBody;
+    UniValue valRequest;
+    if (!req->PeekBody(strBody, MAX_CLASSIFIED_REQUEST_SIZE) || !valRequest.read(strBody))
+        return HTTP_WORK_NORMAL;
+    if (!valRequest.isArray())
+        return JSONRPCWorkClass(valRequest);
+    HTTPWorkClass workClass = HTTP_WORK_FAST;
+    for (size_t i = 0; i < valRequest.size(); i++) {
+        workClass = std::max(workClass, JSONRPCWorkClass(valRequest[i]));
+    }
+    return workClass;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -190,6 +295,24 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // large results are written out while they're produced
+            JSONStreamFn fnResult = tableRPC.prepareStreaming(jreq);
+            if (fnResult) {
+                StreamJSONReply(req, [&jreq, &fnResult](CJSONStreamWriter& writer) {
+                    writer.BeginObject();
+                    writer.Key("result");
+                    try {
+                        fnResult(writer);
+                    } catch (const std::exception& e) {
+                        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+                    }
+                    writer.KeyValue("error", NullUniValue);
+                    writer.KeyValue("id", jreq.id);
+                    writer.EndObject();
+                });
+                return true;
+            }
+
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
@@ -237,7 +360,7 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPCWorkClass);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -69,10 +69,18 @@ private:
     /** Mutex protects entire object */
     std::mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    /** Queued items with the time they were queued at */
+    std::deque<std::pair<std::unique_ptr<WorkItem>, int64_t>> queue;
     bool running;
     size_t maxDepth;
     int numThreads;
+    /** Counters for Stats() */
+    int numActive;
+    uint64_t numExecuted;
+    uint64_t numRejected;
+    int64_t waitTime;
+    int64_t runTime;
+    int64_t maxRunTime;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -95,7 +103,13 @@ private:
 public:
     WorkQueue(size_t _maxDepth) : running(true),
                                  maxDepth(_maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 numActive(0),
+                                 numExecuted(0),
+                                 numRejected(0),
+                                 waitTime(0),
+                                 runTime(0),
+                                 maxRunTime(0)
     {
     }
     /** Precondition: worker threads have all stopped
@@ -109,9 +123,10 @@ public:
     {
         std::unique_lock<std::mutex> lock(cs);
         if (queue.size() >= maxDepth) {
+            numRejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        queue.emplace_back(std::unique_ptr<WorkItem>(item), GetTimeMicros());
         cond.notify_one();
         return true;
     }
@@ -121,16 +136,26 @@ public:
         ThreadCounter count(*this);
         while (true) {
             std::unique_ptr<WorkItem> i;
+            int64_t nTimeStart;
             {
                 std::unique_lock<std::mutex> lock(cs);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().first);
+                nTimeStart = GetTimeMicros();
+                waitTime += nTimeStart - queue.front().second;
                 queue.pop_front();
+                numActive++;
             }
             (*i)();
+            int64_t nRunTime = GetTimeMicros() - nTimeStart;
+            std::unique_lock<std::mutex> lock(cs);
+            numActive--;
+            numExecuted++;
+            runTime += nRunTime;
+            maxRunTime = std::max(maxRunTime, nRunTime);
         }
     }
     /** Interrupt and exit loops */
@@ -155,18 +180,36 @@ public:
         std::unique_lock<std::mutex> lock(cs);
         return queue.size();
     }
+
+    /** Return the counters of the queue */
+    HTTPWorkQueueStats Stats()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        HTTPWorkQueueStats stats;
+        stats.threads = numThreads;
+        stats.maxDepth = maxDepth;
+        stats.depth = queue.size();
+        stats.active = numActive;
+        stats.executed = numExecuted;
+        stats.rejected = numRejected;
+        stats.waitTimeMicros = waitTime;
+        stats.runTimeMicros = runTime;
+        stats.maxRunTimeMicros = maxRunTime;
+        return stats;
+    }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPWorkClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkClassifier classifier;
 };
 
 /** HTTP module state */
@@ -177,8 +220,8 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkClass
+static WorkQueue<HTTPClosure>* workQueues[HTTP_WORK_CLASS_COUNT] = {};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -247,6 +290,46 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+std::string HTTPWorkClassName(HTTPWorkClass workClass)
+{
+    switch (workClass) {
+    case HTTP_WORK_FAST:
+        return "fast";
+    case HTTP_WORK_NORMAL:
+        return "normal";
+    case HTTP_WORK_HEAVY:
+        return "heavy";
+    case HTTP_WORK_EXTERNAL:
+        return "external";
+    default:
+        return "unknown";
+    }
+}
+
+/** Option setting the number of worker threads of a class; the normal class keeps the old -rpcthreads */
+static std::string WorkQueueThreadsArg(HTTPWorkClass workClass)
+{
+    return workClass == HTTP_WORK_NORMAL ? "-rpcthreads" : "-rpc" + HTTPWorkClassName(workClass) + "threads";
+}
+
+/** Option setting the queue depth of a class; the normal class keeps the old -rpcworkqueue */
+static std::string WorkQueueDepthArg(HTTPWorkClass workClass)
+{
+    return workClass == HTTP_WORK_NORMAL ? "-rpcworkqueue" : "-rpc" + HTTPWorkClassName(workClass) + "workqueue";
+}
+
+static int WorkQueueThreads(HTTPWorkClass workClass)
+{
+    static const int defaults[HTTP_WORK_CLASS_COUNT] = {DEFAULT_HTTP_FAST_THREADS, DEFAULT_HTTP_THREADS, DEFAULT_HTTP_HEAVY_THREADS, DEFAULT_HTTP_EXTERNAL_THREADS};
+    return std::max((int)GetArg(WorkQueueThreadsArg(workClass), defaults[workClass]), 1);
+}
+
+static int WorkQueueDepth(HTTPWorkClass workClass)
+{
+    static const int defaults[HTTP_WORK_CLASS_COUNT] = {DEFAULT_HTTP_WORKQUEUE, DEFAULT_HTTP_WORKQUEUE, DEFAULT_HTTP_HEAVY_WORKQUEUE, DEFAULT_HTTP_EXTERNAL_WORKQUEUE};
+    return std::max((int)GetArg(WorkQueueDepthArg(workClass), defaults[workClass]), 1);
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -296,12 +379,14 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass workClass = i->classifier ? i->classifier(hreq.get()) : HTTP_WORK_NORMAL;
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        assert(workQueues[workClass]);
+        if (workQueues[workClass]->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http %s work queue depth exceeded, it can be increased with the %s= setting\n",
+                      HTTPWorkClassName(workClass), WorkQueueDepthArg(workClass));
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -445,10 +530,12 @@ bool InitHTTPServer()
     }
 
     LogPrint("http", "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    for (int i = 0; i < HTTP_WORK_CLASS_COUNT; i++) {
+        HTTPWorkClass workClass = (HTTPWorkClass)i;
+        int workQueueDepth = WorkQueueDepth(workClass);
+        LogPrintf("HTTP: creating %s work queue of depth %d\n", HTTPWorkClassName(workClass), workQueueDepth);
+        workQueues[i] = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -460,15 +547,18 @@ std::future<bool> threadResult;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     std::packaged_task<bool(event_base*, evhttp*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase, eventHTTP);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        std::thread rpc_worker(HTTPWorkQueueRun, workQueue);
-        rpc_worker.detach();
+    for (int i = 0; i < HTTP_WORK_CLASS_COUNT; i++) {
+        HTTPWorkClass workClass = (HTTPWorkClass)i;
+        int rpcThreads = WorkQueueThreads(workClass);
+        LogPrintf("HTTP: starting %d %s worker threads\n", rpcThreads, HTTPWorkClassName(workClass));
+        for (int j = 0; j < rpcThreads; j++) {
+            std::thread rpc_worker(HTTPWorkQueueRun, workQueues[i]);
+            rpc_worker.detach();
+        }
     }
     return true;
 }
@@ -484,14 +574,18 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        if (workQueue)
+            workQueue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint("http", "Stopping HTTP server\n");
-    if (workQueue) {
+    for (WorkQueue<HTTPClosure>*& workQueue : workQueues) {
+        if (!workQueue)
+            continue;
         LogPrint("http", "Waiting for HTTP worker threads to exit\n");
 #ifndef WIN32
         // ToDo: Disabling WaitExit() for Windows platforms is an ugly workaround for the wallet not
@@ -500,6 +594,7 @@ void StopHTTPServer()
         workQueue->WaitExit();
 #endif        
         delete workQueue;
+        workQueue = 0;
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -526,6 +621,15 @@ void StopHTTPServer()
     LogPrint("http", "Stopped HTTP server\n");
 }
 
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> vStats;
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        vStats.push_back(workQueue ? workQueue->Stats() : HTTPWorkQueueStats());
+    }
+    return vStats;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -557,13 +661,49 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** Flow control of a chunked reply, shared by the worker producing it and the event loop thread sending it */
+struct HTTPChunkedReply
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! A chunk was handed to libevent but not yet written to the socket
+    bool fPending;
+    //! The client went away
+    bool fClosed;
+
+    HTTPChunkedReply() : fPending(false), fClosed(false) {}
+
+    void Notify(bool fClosedIn)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fPending = false;
+        fClosed = fClosed || fClosedIn;
+        cond.notify_all();
+    }
+};
+
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+static void http_chunk_written_cb(struct evhttp_connection*, void* arg)
+{
+    ((HTTPChunkedReply*)arg)->Notify(false);
+}
+#endif
+
+static void http_chunked_reply_closed_cb(struct evhttp_connection*, void* arg)
+{
+    ((HTTPChunkedReply*)arg)->Notify(true);
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
                                                        replySent(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (!replySent && chunkedReply) {
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        AbortReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -602,6 +742,22 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+bool HTTPRequest::PeekBody(std::string& strBody, size_t nMaxSize)
+{
+    strBody.clear();
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return true;
+    size_t size = evbuffer_get_length(buf);
+    // Check the size before linearizing the buffer, oversized bodies are left untouched
+    if (size > nMaxSize)
+        return false;
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (data)
+        strBody.assign(data, size);
+    return true;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -616,7 +772,7 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && req && !chunkedReply);
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
@@ -628,6 +784,98 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::StartReply(int nStatus)
+{
+    assert(!replySent && req && !chunkedReply);
+    chunkedReply = std::make_shared<HTTPChunkedReply>();
+    struct evhttp_request* r = req;
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply, nStatus]() {
+        struct evhttp_connection* evcon = evhttp_request_get_connection(r);
+        if (!evcon) {
+            reply->Notify(true);
+            return;
+        }
+        evhttp_connection_set_closecb(evcon, http_chunked_reply_closed_cb, reply.get());
+        evhttp_send_reply_start(r, nStatus, NULL);
+    });
+    ev->trigger(0);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && req && chunkedReply);
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+    {
+        std::unique_lock<std::mutex> lock(reply->cs);
+        reply->cond.wait(lock, [&reply] { return !reply->fPending || reply->fClosed; });
+        if (reply->fClosed)
+            return false;
+        reply->fPending = true;
+    }
+
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    struct evhttp_request* r = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply, evb]() {
+        if (!evhttp_request_get_connection(r)) {
+            reply->Notify(true);
+        } else {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+            evhttp_send_reply_chunk_with_cb(r, evb, http_chunk_written_cb, reply.get());
+#else
+            // no write completion callback, chunks are queued without flow control
+            evhttp_send_reply_chunk(r, evb);
+            reply->Notify(false);
+#endif
+        }
+        evbuffer_free(evb);
+    });
+    ev->trigger(0);
+    return true;
+}
+
+void HTTPRequest::EndReply()
+{
+    assert(!replySent && req && chunkedReply);
+    struct evhttp_request* r = req;
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply]() {
+        struct evhttp_connection* evcon = evhttp_request_get_connection(r);
+        if (evcon)
+            evhttp_connection_set_closecb(evcon, NULL, NULL);
+        // also frees the request if the connection is already gone
+        evhttp_send_reply_end(r);
+    });
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+void HTTPRequest::AbortReply()
+{
+    assert(!replySent && req && chunkedReply);
+    struct evhttp_request* r = req;
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply]() {
+        struct evhttp_connection* evcon = evhttp_request_get_connection(r);
+        if (!evcon) {
+            // nothing left to abort, this just frees the request
+            evhttp_send_reply_end(r);
+            return;
+        }
+        evhttp_connection_set_closecb(evcon, NULL, NULL);
+        // drop the connection without the terminating chunk, so the client sees
+        // a truncated transfer instead of a complete but cut-off body. This also
+        // frees the request.
+        evhttp_connection_free(evcon);
+    });
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -668,10 +916,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier& classifier)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -8,11 +8,49 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
+static const int DEFAULT_HTTP_FAST_THREADS=2;
+static const int DEFAULT_HTTP_HEAVY_THREADS=2;
+static const int DEFAULT_HTTP_HEAVY_WORKQUEUE=8;
+static const int DEFAULT_HTTP_EXTERNAL_THREADS=2;
+static const int DEFAULT_HTTP_EXTERNAL_WORKQUEUE=8;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
+/** Execution classes of HTTP requests. Every class has its own bounded work
+ * queue and worker threads, so slow requests can't starve cheap ones.
+ */
+enum HTTPWorkClass
+{
+    HTTP_WORK_FAST,      //!< cheap calls mining and transaction relay depend on
+    HTTP_WORK_NORMAL,
+    HTTP_WORK_HEAVY,     //!< chain and index scans
+    HTTP_WORK_EXTERNAL,  //!< calls waiting on external services (web, BIPFS)
+    HTTP_WORK_CLASS_COUNT
+};
+
+/** Name of a work class, as used in the -rpc<name>threads/-rpc<name>workqueue
+ * options and by getrpcqueueinfo
+ */
+std::string HTTPWorkClassName(HTTPWorkClass workClass);
+
+/** Counters of the work queue of one class */
+struct HTTPWorkQueueStats
+{
+    int threads;
+    size_t maxDepth;
+    size_t depth;
+    int active;
+    uint64_t executed;
+    uint64_t rejected;
+    int64_t waitTimeMicros;    //!< total time executed items spent queued
+    int64_t runTimeMicros;     //!< total time spent executing items
+    int64_t maxRunTimeMicros;
+};
+
 struct evhttp_request;
 struct event_base;
 class CService;
@@ -34,14 +72,20 @@ void StopHTTPServer();
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work class of a request, called on the event loop thread */
+typedef std::function<HTTPWorkClass(HTTPRequest* req)> HTTPWorkClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests are handled by the HTTP_WORK_NORMAL workers unless
+ * a classifier is given.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier& classifier = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Counters of the work queues, indexed by HTTPWorkClass */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -50,11 +94,14 @@ struct event_base* EventBase();
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
+struct HTTPChunkedReply;
+
 class HTTPRequest
 {
 private:
     struct evhttp_request* req;
     bool replySent;
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -94,6 +141,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Copy the request body without consuming it.
+     * Returns false without copying anything if the body is larger than nMaxSize.
+     */
+    bool PeekBody(std::string& strBody, size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -110,6 +163,37 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for bodies which are produced incrementally.
+     * The body is sent with WriteReplyChunk and the reply completed with EndReply.
+     *
+     * @note call WriteHeader before this, and don't call WriteReply on this request.
+     */
+    void StartReply(int nStatus);
+
+    /**
+     * Send the next chunk of a reply started with StartReply.
+     * Blocks until the previous chunk was written to the socket, so no more than
+     * one chunk per request is buffered. Returns false once the client went away.
+     */
+    bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Complete a reply started with StartReply.
+     *
+     * @note As with WriteReply, do not call any other HTTPRequest methods after calling this.
+     */
+    void EndReply();
+
+    /**
+     * Give up on a reply started with StartReply, e.g. when producing the body
+     * failed halfway. The connection is closed without completing the chunked
+     * encoding, so the client gets a transport error rather than a truncated body.
+     *
+     * @note As with WriteReply, do not call any other HTTPRequest methods after calling this.
+     */
+    void AbortReply();
 };
 
 /** Event handler closure.
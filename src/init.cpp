@@ -15,12 +15,15 @@
 #include "amount.h"
 #include "miner.h"
 #include "base58.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "rpcpog.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
+#include "crypto/x11.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -30,11 +33,13 @@
 #include "net.h"
 #include "net_processing.h"
 #include "policy/policy.h"
+#include "rpc/cache.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "stratum.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -51,6 +56,7 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-db.h"
 #include "instantx.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
@@ -95,7 +101,9 @@
 #include <openssl/crypto.h>
 
 #if ENABLE_ZMQ
+#include "zmq/zmqabstractnotifier.h"
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqrpc.h"
 #endif
 
 extern void ThreadSendAlert(CConnman& connman);
@@ -111,9 +119,6 @@ static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
 
-#if ENABLE_ZMQ
-static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
-#endif
 
 static CDSNotificationInterface* pdsNotificationInterface = NULL;
 
@@ -214,8 +219,11 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
 	//InterruptPOOS();
     llmq::InterruptLLMQSystem();
+    if (blockFilterIndex)
+        blockFilterIndex->InterruptWorkerThread();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
@@ -242,9 +250,15 @@ void PrepareShutdown()
 
     // DAC - Stop Miner Gracefully
     GenerateCoins(false, 0, Params());
+    StopStratumServer();
 
     StopHTTPServer();
+    StopRPCResponseCache();
     llmq::StopLLMQSystem();
+    if (blockFilterIndex) {
+        blockFilterIndex->InterruptWorkerThread();
+        blockFilterIndex->StopWorkerThread();
+    }
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
     // before a shutdown request was received
@@ -273,8 +287,7 @@ void PrepareShutdown()
         // STORE DATA CACHES INTO SERIALIZED DAT FILES
         CFlatDB<CMasternodeMetaMan> flatdb1("mncache.dat", "magicMasternodeCache");
         flatdb1.Dump(mmetaman);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
+        governance.FlushToDB();
         CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
         flatdb4.Dump(netfulfilledman);
         if(fEnableInstantSend)
@@ -314,11 +327,15 @@ void PrepareShutdown()
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete blockFilterIndex;
+        blockFilterIndex = NULL;
         llmq::DestroyLLMQSystem();
         delete deterministicMNManager;
         deterministicMNManager = NULL;
         delete evoDb;
         evoDb = NULL;
+        delete governanceDb;
+        governanceDb = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -374,6 +391,8 @@ void Shutdown()
    // Shutdown part 2: Stop TOR thread and delete wallet instance
     StopTorControl();
 #ifdef ENABLE_WALLET
+    if (pwalletMain)
+        mempool.NotifyEntryRemoved.disconnect(boost::bind(&CWallet::TransactionRemovedFromMempool, pwalletMain, _1, _2));
     delete pwalletMain;
     pwalletMain = NULL;
 #endif
@@ -475,6 +494,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of BIP158 basic block filters, used by the getblockfilter rpc call and to speed up wallet rescans (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -494,6 +514,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsModes(), GetSocketEventsModeName(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -537,6 +558,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstantSend) in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawinstantsenddoublespend=<address>", _("Enable publish raw transactions of attempted InstantSend double spend in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubdacmessage=<address>", _("Enable publish metadata of DAC transaction messages (prayers, GSC, DWS) as JSON in <address>"));
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf(_("Set the outbound message high water mark of the <type> notification; further messages are dropped and counted. Notifications sharing an address use the socket limit of the first one (default: %d)"), DEFAULT_ZMQ_SNDHWM));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -560,7 +583,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-bip9params=<deployment>:<start>:<end>(:<window>:<threshold>)", "Use given start/end times for specified BIP9 deployment (regtest-only). Specifying window and threshold is optional.");
         strUsage += HelpMessageOpt("-watchquorums=<n>", strprintf("Watch and validate quorum communication (default: %u)", llmq::DEFAULT_WATCH_QUORUMS));
     }
-    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
+    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, stratum, tor, zmq, "
                                   "dac/dash (or specifically: chainlocks, gobject, instantsend, keepass, llmq, llmq-dkg, llmq-sigs, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
@@ -577,6 +600,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-dmnlistcachesize=<n>", strprintf("Limit size of the deterministic masternode list cache to <n> MiB (default: %u)", DEFAULT_DMN_LIST_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-dmnsnapshotinterval=<n>", strprintf("Keep an in-memory snapshot of the deterministic masternode list every <n> blocks, 0 to disable (default: %u)", DEFAULT_DMN_SNAPSHOT_INTERVAL));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
@@ -632,6 +657,13 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Listen for stratum (RandomX pool mining) connections on <port>, 0 to disable (default: %u)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>[:port]", _("Bind the stratum server to the given address. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1)"));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Pay blocks found by stratum clients which don't authorize with a valid address to <addr>"));
+    strUsage += HelpMessageOpt("-stratumsharefactor=<n>", strprintf(_("Accept shares up to <n> times the block target (default: %u)"), DEFAULT_STRATUM_SHARE_FACTOR));
+    strUsage += HelpMessageOpt("-stratummempoolthreshold=<n>", strprintf(_("Push a new stratum job after <n> mempool updates (default: %u)"), DEFAULT_STRATUM_MEMPOOL_THRESHOLD));
+
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -642,9 +674,16 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcauth=<userpw>", _("Username and hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcuser. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), BaseParams(CBaseChainParams::MAIN).RPCPort(), BaseParams(CBaseChainParams::TESTNET).RPCPort()));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf(_("Cache the responses of read-only chain RPC calls and REST requests in up to <n> megabytes, 0 to disable (default: %u)"), DEFAULT_RPC_CACHE_SIZE));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcfastthreads=<n>", strprintf("Set the number of threads to service cheap mining and transaction submission RPC calls (default: %d)", DEFAULT_HTTP_FAST_THREADS));
+        strUsage += HelpMessageOpt("-rpcfastworkqueue=<n>", strprintf("Set the depth of the work queue to service cheap mining and transaction submission RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcheavythreads=<n>", strprintf("Set the number of threads to service RPC calls scanning the chain or indexes (default: %d)", DEFAULT_HTTP_HEAVY_THREADS));
+        strUsage += HelpMessageOpt("-rpcheavyworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls scanning the chain or indexes (default: %d)", DEFAULT_HTTP_HEAVY_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcexternalthreads=<n>", strprintf("Set the number of threads to service RPC calls waiting on external services (default: %d)", DEFAULT_HTTP_EXTERNAL_THREADS));
+        strUsage += HelpMessageOpt("-rpcexternalworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls waiting on external services (default: %d)", DEFAULT_HTTP_EXTERNAL_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -877,6 +916,7 @@ bool AppInitServers(boost::thread_group& threadGroup)
         return false;
     if (!StartRPC())
         return false;
+    InitRPCResponseCache();
     if (!StartHTTPRPC())
         return false;
     if (GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
@@ -1020,6 +1060,7 @@ namespace { // Variables internal to initialization process only
 ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
+SocketEventsMode socketEventsMode;
 int nFD;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
@@ -1107,6 +1148,8 @@ bool AppInitParameterInteraction()
     if (GetArg("-prune", 0)) {
         if (GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
     }
 
     if (IsArgSet("-devnet")) {
@@ -1129,8 +1172,14 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    std::string strSocketEventsMode = GetArg("-socketevents", GetSocketEventsModeName(DEFAULT_SOCKETEVENTS));
+    if (!ParseSocketEventsMode(strSocketEventsMode, socketEventsMode))
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEventsMode, GetSupportedSocketEventsModes()));
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    // select() can't handle file descriptors >= FD_SETSIZE, epoll is only limited by the file descriptor limit
+    if (socketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1270,6 +1319,9 @@ bool AppInitParameterInteraction()
 #ifdef ENABLE_WALLET
     RegisterWalletRPCCommands(tableRPC);
 #endif
+#if ENABLE_ZMQ
+    RegisterZMQRPCCommands(tableRPC);
+#endif
 
     nConnectTimeout = GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0)
@@ -1488,6 +1540,10 @@ bool AppInitSanityChecks()
     // ********************************************************* Step 4: sanity checks
 
     // Initialize elliptic curve code
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string x11_algo = X11AutoDetect();
+    LogPrintf("Using the '%s' X11 implementation\n", x11_algo);
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
 
@@ -1827,6 +1883,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nEvoDbCache = 1024 * 1024 * 16; // TODO
+    int64_t nBlockFilterIndexCache = 1024 * 1024 * 8;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
@@ -1986,6 +2043,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        // builds the filters of the existing chain in the background, see CBlockFilterIndex
+        blockFilterIndex = new CBlockFilterIndex(BlockFilterType::BASIC, nBlockFilterIndexCache, false, fReindex);
+        blockFilterIndex->StartWorkerThread();
+    }
+
     boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fopen(est_path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -2101,6 +2164,17 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
     bool fIgnoreCacheFiles = fLiteMode || fReindex || fReindexChainState;
+
+    if (!fLiteMode) {
+        // governance objects and votes used to be dumped to governance.dat as a whole
+        boost::filesystem::path pathGovOld = GetDataDir() / "governance.dat";
+        if (boost::filesystem::exists(pathGovOld)) {
+            LogPrintf("Removing obsolete %s\n", pathGovOld.string());
+            boost::filesystem::remove(pathGovOld);
+        }
+        governanceDb = new CGovernanceDB(GOVERNANCE_DB_CACHE, false, fReindex || fReindexChainState);
+    }
+
     if (!fIgnoreCacheFiles) {
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
@@ -2112,24 +2186,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
         }
 
-        strDBName = "governance.dat";
+        strDBName = "governance";
         uiInterface.InitMessage(_("Loading governance cache..."));
-
-		// Bloat Prevention of governance.dat:
-		// During forensic analysis the DAC Team has discovered that this file will grow bigger each time we deserialize governance objects, therefore we need to clear it if its bigger than 25 megs, and let it get reindexed.
-		boost::filesystem::path pathGov = GetDataDir() / "governance.dat";
-		int64_t nGovSz = GETFILESIZE(pathGov.string());
-		LogPrintf("Governance file size %f", nGovSz);
-		if (nGovSz > 25000000)
-		{
-			LogPrintf("Removing bloated governance file %f", nGovSz);
-			if(boost::filesystem::exists(pathGov))
-				boost::filesystem::remove(pathGov); 
-		}
-		// End of Bloat Prevention
-
-        CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-        if(!flatdb3.Load(governance)) {
+        if (!governance.LoadFromDB()) {
             return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
         }
         governance.InitOnLoad();
@@ -2171,6 +2230,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif // ENABLE_WALLET
     }
 
+    scheduler.scheduleEvery(boost::bind(&CDeterministicMNManager::DoMaintenance, deterministicMNManager), 10 * 1000);
+
     llmq::StartLLMQSystem();
 
     // ********************************************************* Step 11: import blocks
@@ -2247,6 +2308,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
+    connOptions.socketEventsMode = socketEventsMode;
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
@@ -2257,6 +2319,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Generate coins - Proof-of-Bible-Hash (POBH) - in the background
     GenerateCoins(GetBoolArg("-gen", false), GetArg("-genproclimit", 0), chainparams);
 
+    if (!InitStratumServer() || !StartStratumServer())
+        return InitError(_("Unable to start the stratum server. See debug log for details."));
+
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
@@ -26,9 +26,17 @@ namespace llmq
 
 static const std::string DB_QUORUM_SK_SHARE = "q_Qsk";
 static const std::string DB_QUORUM_QUORUM_VVEC = "q_Qqvvec";
+static const std::string DB_QUORUM_PUBKEY_SHARE = "q_Qpks";
 
 CQuorumManager* quorumManager;
 
+// The quorum vvec and thus the shares are deterministic for a mined commitment, and the members are deterministic for
+// the quorumHash. The vvec hash is part of the key because a reorg can mine a different commitment for the same quorum.
+static std::tuple<std::string, uint8_t, uint256, uint256, uint16_t> MakePubKeyShareKey(const CQuorum& q, size_t memberIdx)
+{
+    return std::make_tuple(DB_QUORUM_PUBKEY_SHARE, (uint8_t)q.params.type, q.qc.quorumHash, q.qc.quorumVvecHash, (uint16_t)memberIdx);
+}
+
 static uint256 MakeQuorumKey(const CQuorum& q)
 {
     CHashWriter hw(SER_NETWORK, 0);
@@ -57,6 +65,10 @@ void CQuorum::Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum
     pindexQuorum = _pindexQuorum;
     members = _members;
     minedBlockHash = _minedBlockHash;
+
+    LOCK(pubKeySharesCs);
+    pubKeyShares.assign(members.size(), CBLSLazyPublicKey());
+    pubKeySharesLoaded.assign(members.size(), false);
 }
 
 bool CQuorum::IsMember(const uint256& proTxHash) const
@@ -84,8 +96,43 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !qc.validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
-    auto& m = members[memberIdx];
-    return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId::FromHash(m->proTxHash));
+    if (!LoadPubKeyShare(memberIdx)) {
+        return CBLSPublicKey();
+    }
+    LOCK(pubKeySharesCs);
+    return pubKeyShares[memberIdx].Get();
+}
+
+// Makes sure that the public key share is in memory, either by reading it from evoDb or by recovering it from the
+// quorum vvec. Does not deserialize the share
+bool CQuorum::LoadPubKeyShare(size_t memberIdx) const
+{
+    {
+        LOCK(pubKeySharesCs);
+        if (pubKeySharesLoaded[memberIdx]) {
+            return true;
+        }
+    }
+
+    auto dbKey = MakePubKeyShareKey(*this, memberIdx);
+
+    CBLSLazyPublicKey pubKeyShare;
+    if (!evoDb.GetRawDB().Read(dbKey, pubKeyShare)) {
+        auto& m = members[memberIdx];
+        CBLSPublicKey pk = blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId::FromHash(m->proTxHash));
+        if (!pk.IsValid()) {
+            return false;
+        }
+        pubKeyShare.Set(pk);
+        evoDb.GetRawDB().Write(dbKey, pubKeyShare);
+    }
+
+    LOCK(pubKeySharesCs);
+    if (!pubKeySharesLoaded[memberIdx]) {
+        pubKeyShares[memberIdx] = pubKeyShare;
+        pubKeySharesLoaded[memberIdx] = true;
+    }
+    return true;
 }
 
 CBLSSecretKey CQuorum::GetSkShare() const
@@ -120,7 +167,8 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
     uint256 dbKey = MakeQuorumKey(*this);
 
     BLSVerificationVector qv;
-    if (evoDb.Read(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), qv)) {
+    // the vvec is stored per quorumHash and member list, so it may belong to a commitment which got reorged away
+    if (evoDb.Read(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), qv) && ::SerializeHash(qv) == qc.quorumVvecHash) {
         quorumVvec = std::make_shared<BLSVerificationVector>(std::move(qv));
     } else {
         return false;
@@ -148,6 +196,7 @@ void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
         RenameThread("dash-q-cachepop");
         for (size_t i = 0; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
             if (_this->qc.validMembers[i]) {
+                // after a restart, this only reads and deserializes the already recovered shares from evoDb
                 _this->GetPubKeyShare(i);
             }
         }
@@ -170,7 +219,47 @@ void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitial
 
     for (auto& p : Params().GetConsensus().llmqs) {
         EnsureQuorumConnections(p.first, pindexNew);
+        CleanupPubKeyShares(p.first, pindexNew);
+    }
+}
+
+void CQuorumManager::CleanupPubKeyShares(Consensus::LLMQType llmqType, const CBlockIndex* pindexNew)
+{
+    const auto& params = Params().GetConsensus().llmqs.at(llmqType);
+
+    auto lastQuorums = ScanQuorums(llmqType, pindexNew, (size_t)params.keepOldConnections);
+    // the set of kept quorums only changes when a new one is mined
+    if (lastQuorums.empty() || lastQuorums.front()->qc.quorumVvecHash == lastCleanedQuorums[llmqType]) {
+        return;
     }
+    lastCleanedQuorums[llmqType] = lastQuorums.front()->qc.quorumVvecHash;
+
+    std::set<std::pair<uint256, uint256>> keep;
+    for (auto& quorum : lastQuorums) {
+        keep.emplace(quorum->qc.quorumHash, quorum->qc.quorumVvecHash);
+    }
+
+    auto& db = evoDb.GetRawDB();
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(DB_QUORUM_PUBKEY_SHARE, (uint8_t)llmqType, uint256(), uint256(), (uint16_t)0);
+    it->Seek(firstKey);
+
+    CDBBatch batch(db);
+    size_t erased = 0;
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_QUORUM_PUBKEY_SHARE || std::get<1>(curKey) != (uint8_t)llmqType) {
+            break;
+        }
+        if (!keep.count(std::make_pair(std::get<2>(curKey), std::get<3>(curKey)))) {
+            batch.Erase(curKey);
+            erased++;
+        }
+        it->Next();
+    }
+    db.WriteBatch(batch);
+
+    LogPrint("llmq", "CQuorumManager::%s -- erased %d public key shares of old quorums\n", __func__, erased);
 }
 
 void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexNew)
@@ -401,7 +490,7 @@ CQuorumCPtr CQuorumManager::GetQuorum(Consensus::LLMQType llmqType, const CBlock
 
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
 
-    auto quorum = std::make_shared<CQuorum>(params, blsWorker);
+    auto quorum = std::make_shared<CQuorum>(params, blsWorker, evoDb);
 
     if (!BuildQuorumFromCommitment(qc, pindexQuorum, minedBlockHash, quorum)) {
         return nullptr;
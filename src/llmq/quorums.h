@@ -46,14 +46,22 @@ public:
     CBLSSecretKey skShare;
 
 private:
+    CEvoDB& evoDb;
+
     // Recovery of public key shares is very slow, so we start a background thread that pre-populates a cache so that
     // the public key shares are ready when needed later
     mutable CBLSWorkerCache blsCache;
     std::atomic<bool> stopCachePopulatorThread;
     std::thread cachePopulatorThread;
 
+    // Recovered public key shares are also stored in evoDb, so that they don't need to be recovered again after a
+    // restart. They are loaded on first use and only deserialized when actually needed for verification
+    mutable CCriticalSection pubKeySharesCs;
+    mutable std::vector<CBLSLazyPublicKey> pubKeyShares;
+    mutable std::vector<bool> pubKeySharesLoaded;
+
 public:
-    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
+    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker, CEvoDB& _evoDb) : params(_params), evoDb(_evoDb), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
     ~CQuorum();
     void Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum, const uint256& _minedBlockHash, const std::vector<CDeterministicMNCPtr>& _members);
 
@@ -65,6 +73,7 @@ public:
     CBLSSecretKey GetSkShare() const;
 
 private:
+    bool LoadPubKeyShare(size_t memberIdx) const;
     void WriteContributions(CEvoDB& evoDb);
     bool ReadContributions(CEvoDB& evoDb);
     static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this);
@@ -89,6 +98,9 @@ private:
     std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumPtr> quorumsCache;
     unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::vector<CQuorumCPtr>, StaticSaltedHasher, 32> scanQuorumsCache;
 
+    // vvec hash of the newest quorum at the last cleanup of the persisted public key shares, per LLMQ type
+    std::map<Consensus::LLMQType, uint256> lastCleanedQuorums;
+
 public:
     CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
 
@@ -107,6 +119,8 @@ public:
 private:
     // all private methods here are cs_main-free
     void EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex *pindexNew);
+    // erases the public key shares persisted for quorums which are not among the last keepOldConnections anymore
+    void CleanupPubKeyShares(Consensus::LLMQType llmqType, const CBlockIndex *pindexNew);
 
     bool BuildQuorumFromCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum, const uint256& minedBlockHash, std::shared_ptr<CQuorum>& quorum) const;
     bool BuildQuorumContributions(const CFinalCommitment& fqc, std::shared_ptr<CQuorum>& quorum) const;
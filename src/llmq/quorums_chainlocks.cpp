@@ -190,6 +190,8 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
     // don't call TrySignChainTip directly but instead let the scheduler call it. This way we ensure that cs_main is
     // never locked and TrySignChainTip is not called twice in parallel. Also avoids recursive calls due to
     // EnforceBestChainLock switching chains.
+    tipHeight = pindexNew->nHeight;
+
     LOCK(cs);
     if (tryLockChainTipScheduled) {
         return;
@@ -204,6 +206,21 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
     }, 0);
 }
 
+bool CChainLocksHandler::IsChainLockRequestId(const uint256& id) const
+{
+    // members sign the tip they know, which might be a block behind or ahead of ours
+    int32_t nHeight = tipHeight;
+    if (nHeight < 0) {
+        return false;
+    }
+    for (int32_t h = nHeight + 1; h >= std::max(nHeight - 2, 0); h--) {
+        if (id == ::SerializeHash(std::make_pair(CLSIG_REQUESTID_PREFIX, h))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static bool fColdBoot = false;
 void CChainLocksHandler::CheckActiveState()
 {
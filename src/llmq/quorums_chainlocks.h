@@ -76,6 +76,9 @@ private:
 
     int64_t lastCleanupTime{0};
 
+    // height of the chain tip, only used to recognize ChainLock request ids
+    std::atomic<int32_t> tipHeight{-1};
+
 public:
     CChainLocksHandler(CScheduler* _scheduler);
     ~CChainLocksHandler();
@@ -101,6 +104,10 @@ public:
 
     bool IsTxSafeForMining(const uint256& txid);
 
+    // Whether id is the signing request id of a ChainLock for a height around the tip. Doesn't lock anything, so that
+    // the sig shares manager can call it while holding its own lock.
+    bool IsChainLockRequestId(const uint256& id) const;
+
 private:
     // these require locks to be held already
     bool InternalHasChainLock(int nHeight, const uint256& blockHash);
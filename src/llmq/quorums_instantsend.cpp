@@ -15,6 +15,8 @@
 #include "spork.h"
 #include "validation.h"
 
+#include "cxxtimer.hpp"
+
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #endif
@@ -798,8 +800,14 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
 {
     auto llmqType = Params().GetConsensus().llmqForInstantSend;
 
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
+    // Locks signed by all quorums of the active set are verified in the same batches. The sub batch size adapts to
+    // the results of the previous round: while all sigs are valid, larger batches need less pairings, while a single
+    // bad sig makes its whole sub batch fall back to per source verification
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, islockVerifyBatchSize);
     std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
+    std::unordered_map<uint256, uint256> signHashes;
+    size_t verifyCount = 0;
+    size_t alreadyVerifiedCount = 0;
 
 	for (const auto& p : pend) {
         auto& hash = p.first;
@@ -828,7 +836,14 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             return {};
         }
         uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc.quorumHash, id, islock.txid);
-        batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
+        // the recovered sig might have been verified already while it is not yet in the recovered sigs db
+        if (quorumSigningManager->IsVerifiedSig(signHash, islock.sig)) {
+            alreadyVerifiedCount++;
+        } else {
+            batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
+            signHashes.emplace(hash, signHash);
+            verifyCount++;
+        }
 
         // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
         // avoids unnecessary double-verification of the signature. We however only do this when verification here
@@ -846,7 +861,20 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
         }
     }
 
+    cxxtimer::Timer verifyTimer(true);
     batchVerifier.Verify();
+    verifyTimer.stop();
+
+    LogPrint("instantsend", "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, batchSize=%d, vt=%d\n", __func__,
+             verifyCount, alreadyVerifiedCount, islockVerifyBatchSize, verifyTimer.count());
+
+    if (batchVerifier.badSources.empty()) {
+        if (islockVerifyBatchSize < MAX_ISLOCK_VERIFY_BATCH_SIZE) {
+            islockVerifyBatchSize *= 2;
+        }
+    } else if (islockVerifyBatchSize > MIN_ISLOCK_VERIFY_BATCH_SIZE) {
+        islockVerifyBatchSize /= 2;
+    }
 
     std::unordered_set<uint256> badISLocks;
 
@@ -870,6 +898,11 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             continue;
         }
 
+        auto itSignHash = signHashes.find(hash);
+        if (itSignHash != signHashes.end()) {
+            quorumSigningManager->AddVerifiedSig(itSignHash->second, islock.sig);
+        }
+
         ProcessInstantSendLock(nodeId, hash, islock);
 
         // See comment further on top. We pass a reconstructed recovered sig to the signing manager to avoid
@@ -74,6 +74,10 @@ public:
 
 class CInstantSendManager : public CRecoveredSigsListener
 {
+    // limits for the adaptive sub batch size used when verifying pending ISLOCKs
+    static const size_t MIN_ISLOCK_VERIFY_BATCH_SIZE = 4;
+    static const size_t MAX_ISLOCK_VERIFY_BATCH_SIZE = 128;
+
 private:
     CCriticalSection cs;
     CInstantSendDb db;
@@ -98,6 +102,8 @@ private:
 
     // Incoming and not verified yet
     std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>> pendingInstantSendLocks;
+    // only accessed from the worker thread
+    size_t islockVerifyBatchSize{8};
 
     // TXs which are neither IS locked nor ChainLocked. We use this to determine for which TXs we need to retry IS locking
     // of child TXs
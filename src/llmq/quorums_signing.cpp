@@ -599,11 +599,19 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
     CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
 
     size_t verifyCount = 0;
+    size_t alreadyVerifiedCount = 0;
     for (auto& p : recSigsByNode) {
         NodeId nodeId = p.first;
         auto& v = p.second;
 
         for (auto& recSig : v) {
+            auto signHash = CLLMQUtils::BuildSignHash(recSig);
+            // might have been verified already as part of an ISLOCK or CLSIG
+            if (IsVerifiedSig(signHash, recSig.sig)) {
+                alreadyVerifiedCount++;
+                continue;
+            }
+
             // we didn't verify the lazy signature until now
             if (!recSig.sig.Get().IsValid()) {
                 batchVerifier.badSources.emplace(nodeId);
@@ -611,7 +619,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
             }
 
             const auto& quorum = quorums.at(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.quorumHash));
-            batchVerifier.PushMessage(nodeId, recSig.GetHash(), CLLMQUtils::BuildSignHash(recSig), recSig.sig.Get(), quorum->qc.quorumPublicKey);
+            batchVerifier.PushMessage(nodeId, recSig.GetHash(), signHash, recSig.sig.Get(), quorum->qc.quorumPublicKey);
             verifyCount++;
         }
     }
@@ -620,7 +628,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
     batchVerifier.Verify();
     verifyTimer.stop();
 
-    LogPrint("llmq", "CSigningManager::%s -- verified recovered sig(s). count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), recSigsByNode.size());
+    LogPrint("llmq", "CSigningManager::%s -- verified recovered sig(s). count=%d, alreadyVerified=%d, vt=%d, nodes=%d\n", __func__, verifyCount, alreadyVerifiedCount, verifyTimer.count(), recSigsByNode.size());
 
     std::unordered_set<uint256, StaticSaltedHasher> processed;
     for (auto& p : recSigsByNode) {
@@ -692,6 +700,8 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
         db.WriteRecoveredSig(recoveredSig);
     }
 
+    AddVerifiedSig(CLLMQUtils::BuildSignHash(recoveredSig), recoveredSig.sig);
+
     CInv inv(MSG_QUORUM_RECOVERED_SIG, recoveredSig.GetHash());
     g_connman->ForEachNode([&](CNode* pnode) {
         if (pnode->nVersion >= LLMQS_PROTO_VERSION && pnode->fSendRecSigs) {
@@ -909,7 +919,32 @@ bool CSigningManager::VerifyRecoveredSig(Consensus::LLMQType llmqType, int signe
     }
 
     uint256 signHash = CLLMQUtils::BuildSignHash(llmqParams.type, quorum->qc.quorumHash, id, msgHash);
-    return sig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash);
+
+    CBLSLazySignature lazySig;
+    lazySig.Set(sig);
+    if (IsVerifiedSig(signHash, lazySig)) {
+        return true;
+    }
+    if (!sig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash)) {
+        return false;
+    }
+    AddVerifiedSig(signHash, lazySig);
+    return true;
+}
+
+bool CSigningManager::IsVerifiedSig(const uint256& signHash, const CBLSLazySignature& sig)
+{
+    uint256 sigHash = ::SerializeHash(sig);
+    uint256 verifiedSigHash;
+    LOCK(verifiedSigsCs);
+    return verifiedSigsCache.get(signHash, verifiedSigHash) && verifiedSigHash == sigHash;
+}
+
+void CSigningManager::AddVerifiedSig(const uint256& signHash, const CBLSLazySignature& sig)
+{
+    uint256 sigHash = ::SerializeHash(sig);
+    LOCK(verifiedSigsCs);
+    verifiedSigsCache.insert(signHash, sigHash);
 }
 
 }
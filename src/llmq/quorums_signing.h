@@ -134,6 +134,11 @@ private:
 
     std::vector<CRecoveredSigsListener*> recoveredSigsListeners;
 
+    // signHash -> hash of the serialized sig, for recovered sigs which are known to be valid. BLS signatures are unique
+    // for a key and message, so a sig arriving through another path (e.g. inside an ISLOCK) only needs to match
+    CCriticalSection verifiedSigsCs;
+    unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 30000> verifiedSigsCache;
+
 public:
     CSigningManager(CDBWrapper& llmqDb, bool fMemory);
 
@@ -180,6 +185,9 @@ public:
     std::vector<CQuorumCPtr> GetActiveQuorumSet(Consensus::LLMQType llmqType, int signHeight);
     CQuorumCPtr SelectQuorumForSigning(Consensus::LLMQType llmqType, int signHeight, const uint256& selectionHash);
 
+    bool IsVerifiedSig(const uint256& signHash, const CBLSLazySignature& sig);
+    void AddVerifiedSig(const uint256& signHash, const CBLSLazySignature& sig);
+
     // Verifies a recovered sig that was signed while the chain tip was at signedAtTip
     bool VerifyRecoveredSig(Consensus::LLMQType llmqType, int signedAtHeight, const uint256& id, const uint256& msgHash, const CBLSSignature& sig);
 };
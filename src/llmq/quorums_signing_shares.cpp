@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "quorums_chainlocks.h"
 #include "quorums_signing.h"
 #include "quorums_signing_shares.h"
 #include "quorums_utils.h"
@@ -11,6 +12,7 @@
 #include "init.h"
 #include "net_processing.h"
 #include "netmessagemaker.h"
+#include "univalue.h"
 #include "validation.h"
 
 #include "cxxtimer.hpp"
@@ -20,6 +22,49 @@ namespace llmq
 
 CSigSharesManager* quorumSigSharesManager = nullptr;
 
+static const char* const sigShareLaneNames[SIGSHARE_LANE_COUNT] = {"chainlocks", "instantsend", "other"};
+
+// upper bounds (in milliseconds) of all but the last bucket
+static const int64_t latencyBucketBounds[CSigShareLatencyHistogram::BUCKET_COUNT - 1] = {
+    1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500,
+};
+
+SigShareLane GetSigShareLane(Consensus::LLMQType llmqType, const uint256& id)
+{
+    const auto& consensus = Params().GetConsensus();
+    if (llmqType == consensus.llmqChainLocks && chainLocksHandler && chainLocksHandler->IsChainLockRequestId(id)) {
+        return SIGSHARE_LANE_CHAINLOCKS;
+    }
+    if (llmqType == consensus.llmqForInstantSend) {
+        return SIGSHARE_LANE_INSTANTSEND;
+    }
+    return SIGSHARE_LANE_OTHER;
+}
+
+void CSigShareLatencyHistogram::Add(int64_t latency)
+{
+    latency = std::max(latency, (int64_t)0);
+    size_t i = std::lower_bound(latencyBucketBounds, latencyBucketBounds + BUCKET_COUNT - 1, latency) - latencyBucketBounds;
+    buckets[i]++;
+    count++;
+    total += latency;
+    max = std::max(max, latency);
+}
+
+void CSigShareLatencyHistogram::ToJson(UniValue& obj) const
+{
+    obj.setObject();
+    obj.push_back(Pair("count", count));
+    obj.push_back(Pair("avg_ms", count != 0 ? (double)total / count : 0.0));
+    obj.push_back(Pair("max_ms", max));
+    UniValue bucketsObj(UniValue::VOBJ);
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        std::string name = i < BUCKET_COUNT - 1 ? strprintf("<=%d", latencyBucketBounds[i]) : strprintf(">%d", latencyBucketBounds[i - 1]);
+        bucketsObj.push_back(Pair(name, buckets[i]));
+    }
+    obj.push_back(Pair("buckets_ms", bucketsObj));
+}
+
 void CSigShare::UpdateKey()
 {
     key.first = CLLMQUtils::BuildSignHash(*this);
@@ -177,12 +222,15 @@ void CSigSharesNodeState::RemoveSession(const uint256& signHash)
         sessions.erase(it);
     }
     requestedSigShares.EraseAllForSignHash(signHash);
-    pendingIncomingSigShares.EraseAllForSignHash(signHash);
+    for (auto& pending : pendingIncomingSigShares) {
+        pending.EraseAllForSignHash(signHash);
+    }
 }
 
 //////////////////////
 
-CSigSharesManager::CSigSharesManager()
+CSigSharesManager::CSigSharesManager(CBLSWorker& _blsWorker) :
+    blsWorker(_blsWorker)
 {
     workInterrupt.reset();
 }
@@ -426,12 +474,15 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatc
     std::vector<CSigShare> sigShares;
     sigShares.reserve(batchedSigShares.sigShares.size());
 
+    int64_t now = GetTimeMillis();
+
     {
         LOCK(cs);
         auto& nodeState = nodeStates[pfrom->id];
 
         for (size_t i = 0; i < batchedSigShares.sigShares.size(); i++) {
             CSigShare sigShare = RebuildSigShare(sessionInfo, batchedSigShares, i);
+            sigShare.receiveTime = now;
             nodeState.requestedSigShares.Erase(sigShare.GetKey());
 
             // TODO track invalid sig shares received for PoSe?
@@ -460,9 +511,11 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatc
 
     LOCK(cs);
     auto& nodeState = nodeStates[pfrom->id];
+    auto& pending = nodeState.pendingIncomingSigShares[GetSigShareLane(sessionInfo.llmqType, sessionInfo.id)];
     for (auto& s : sigShares) {
-        nodeState.pendingIncomingSigShares.Add(s.GetKey(), s);
+        pending.Add(s.GetKey(), s);
     }
+    sessionStartTimes.emplace(sessionInfo.signHash, now);
     return true;
 }
 
@@ -510,9 +563,11 @@ bool CSigSharesManager::PreVerifyBatchedSigShares(NodeId nodeId, const CSigShare
 
 void CSigSharesManager::CollectPendingSigSharesToVerify(
         size_t maxUniqueSessions,
-        std::unordered_map<NodeId, std::vector<CSigShare>>& retSigShares,
+        std::vector<SigSharesByNode>& retSigSharesByLane,
         std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher>& retQuorums)
 {
+    retSigSharesByLane.resize(SIGSHARE_LANE_COUNT);
+
     {
         LOCK(cs);
         if (nodeStates.empty()) {
@@ -524,26 +579,33 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
         // other nodes would be able to poison us with a large batch with N-1 valid shares and the last one being
         // invalid, making batch verification fail and revert to per-share verification, which in turn would slow down
         // the whole verification process
+        // Lanes are served in order of their priority and lower priority lanes only get what's left of maxUniqueSessions
 
         std::unordered_set<std::pair<NodeId, uint256>, StaticSaltedHasher> uniqueSignHashes;
-        CLLMQUtils::IterateNodesRandom(nodeStates, [&]() {
-            return uniqueSignHashes.size() < maxUniqueSessions;
-        }, [&](NodeId nodeId, CSigSharesNodeState& ns) {
-            if (ns.pendingIncomingSigShares.Empty()) {
-                return false;
-            }
-            auto& sigShare = *ns.pendingIncomingSigShares.GetFirst();
+        bool haveAny = false;
+        for (size_t lane = 0; lane < SIGSHARE_LANE_COUNT; lane++) {
+            auto& retSigShares = retSigSharesByLane[lane];
+            CLLMQUtils::IterateNodesRandom(nodeStates, [&]() {
+                return uniqueSignHashes.size() < maxUniqueSessions;
+            }, [&](NodeId nodeId, CSigSharesNodeState& ns) {
+                auto& pending = ns.pendingIncomingSigShares[lane];
+                if (pending.Empty()) {
+                    return false;
+                }
+                auto& sigShare = *pending.GetFirst();
 
-            bool alreadyHave = this->sigShares.Has(sigShare.GetKey());
-            if (!alreadyHave) {
-                uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
-                retSigShares[nodeId].emplace_back(sigShare);
-            }
-            ns.pendingIncomingSigShares.Erase(sigShare.GetKey());
-            return !ns.pendingIncomingSigShares.Empty();
-        }, rnd);
+                bool alreadyHave = this->sigShares.Has(sigShare.GetKey());
+                if (!alreadyHave) {
+                    uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
+                    retSigShares[nodeId].emplace_back(sigShare);
+                }
+                pending.Erase(sigShare.GetKey());
+                return !pending.Empty();
+            }, rnd);
+            haveAny |= !retSigShares.empty();
+        }
 
-        if (retSigShares.empty()) {
+        if (!haveAny) {
             return;
         }
     }
@@ -553,18 +615,20 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
 
         // For the convenience of the caller, also build a map of quorumHash -> quorum
 
-        for (auto& p : retSigShares) {
-            for (auto& sigShare : p.second) {
-                auto llmqType = (Consensus::LLMQType) sigShare.llmqType;
+        for (auto& retSigShares : retSigSharesByLane) {
+            for (auto& p : retSigShares) {
+                for (auto& sigShare : p.second) {
+                    auto llmqType = (Consensus::LLMQType) sigShare.llmqType;
 
-                auto k = std::make_pair(llmqType, sigShare.quorumHash);
-                if (retQuorums.count(k)) {
-                    continue;
-                }
+                    auto k = std::make_pair(llmqType, sigShare.quorumHash);
+                    if (retQuorums.count(k)) {
+                        continue;
+                    }
 
-                CQuorumCPtr quorum = quorumManager->GetQuorum(llmqType, sigShare.quorumHash);
-                assert(quorum != nullptr);
-                retQuorums.emplace(k, quorum);
+                    CQuorumCPtr quorum = quorumManager->GetQuorum(llmqType, sigShare.quorumHash);
+                    assert(quorum != nullptr);
+                    retQuorums.emplace(k, quorum);
+                }
             }
         }
     }
@@ -572,70 +636,123 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
 
 bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
 {
-    std::unordered_map<NodeId, std::vector<CSigShare>> sigSharesByNodes;
+    std::vector<SigSharesByNode> sigSharesByLane;
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher> quorums;
 
-    CollectPendingSigSharesToVerify(32, sigSharesByNodes, quorums);
-    if (sigSharesByNodes.empty()) {
+    CollectPendingSigSharesToVerify(32, sigSharesByLane, quorums);
+    if (quorums.empty()) {
         return false;
     }
 
-    // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
-    // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    // Shares are split into batches per lane, with all shares of a node in the same batch so that a bad node can only
+    // spoil its own batch. The batches are verified in parallel on the BLS worker pool
+    struct VerifyBatch {
+        size_t lane;
+        std::vector<NodeId> nodes;
+        size_t count{0};
+        // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
+        // which are not craftable by individual entities, making the rogue public key attack impossible
+        CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier{false, true};
+    };
+    std::vector<std::unique_ptr<VerifyBatch>> batches;
+    std::unordered_set<NodeId> bannedNodes;
 
     size_t verifyCount = 0;
-    for (auto& p : sigSharesByNodes) {
-        auto nodeId = p.first;
-        auto& v = p.second;
+    size_t nodeCount = 0;
+    for (size_t lane = 0; lane < SIGSHARE_LANE_COUNT; lane++) {
+        for (auto& p : sigSharesByLane[lane]) {
+            auto nodeId = p.first;
+            auto& v = p.second;
 
-        for (auto& sigShare : v) {
-            if (quorumSigningManager->HasRecoveredSigForId((Consensus::LLMQType)sigShare.llmqType, sigShare.id)) {
+            if (bannedNodes.count(nodeId)) {
                 continue;
             }
-
-            // we didn't check this earlier because we use a lazy BLS signature and tried to avoid doing the expensive
-            // deserialization in the message thread
-            if (!sigShare.sigShare.Get().IsValid()) {
-                BanNode(nodeId);
-                // don't process any additional shares from this node
-                break;
+            if (batches.empty() || batches.back()->lane != lane || batches.back()->count >= VERIFY_BATCH_SIZE) {
+                batches.emplace_back(std::make_unique<VerifyBatch>());
+                batches.back()->lane = lane;
             }
+            auto& batch = *batches.back();
 
-            auto quorum = quorums.at(std::make_pair((Consensus::LLMQType)sigShare.llmqType, sigShare.quorumHash));
-            auto pubKeyShare = quorum->GetPubKeyShare(sigShare.quorumMember);
+            for (auto& sigShare : v) {
+                if (quorumSigningManager->HasRecoveredSigForId((Consensus::LLMQType)sigShare.llmqType, sigShare.id)) {
+                    continue;
+                }
 
-            if (!pubKeyShare.IsValid()) {
-                // this should really not happen (we already ensured we have the quorum vvec,
-                // so we should also be able to create all pubkey shares)
-                LogPrintf("CSigSharesManager::%s -- pubKeyShare is invalid, which should not be possible here");
-                assert(false);
-            }
+                // we didn't check this earlier because we use a lazy BLS signature and tried to avoid doing the expensive
+                // deserialization in the message thread
+                if (!sigShare.sigShare.Get().IsValid()) {
+                    BanNode(nodeId);
+                    // don't process any additional shares from this node
+                    bannedNodes.emplace(nodeId);
+                    break;
+                }
 
-            batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
-            verifyCount++;
+                auto quorum = quorums.at(std::make_pair((Consensus::LLMQType)sigShare.llmqType, sigShare.quorumHash));
+                auto pubKeyShare = quorum->GetPubKeyShare(sigShare.quorumMember);
+
+                if (!pubKeyShare.IsValid()) {
+                    // this should really not happen (we already ensured we have the quorum vvec,
+                    // so we should also be able to create all pubkey shares)
+                    LogPrintf("CSigSharesManager::%s -- pubKeyShare is invalid, which should not be possible here");
+                    assert(false);
+                }
+
+                batch.batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
+                batch.count++;
+                verifyCount++;
+            }
+            if (!bannedNodes.count(nodeId)) {
+                batch.nodes.emplace_back(nodeId);
+                nodeCount++;
+            }
         }
     }
 
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    if (batches.size() == 1) {
+        batches[0]->batchVerifier.Verify();
+    } else {
+        std::vector<std::future<void>> futures;
+        futures.reserve(batches.size());
+        for (auto& batch : batches) {
+            auto pbatch = batch.get();
+            futures.emplace_back(blsWorker.AsyncRun([pbatch]() {
+                pbatch->batchVerifier.Verify();
+            }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
     verifyTimer.stop();
 
-    LogPrint("llmq-sigs", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), sigSharesByNodes.size());
+    LogPrint("llmq-sigs", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d, batches=%d\n", __func__, verifyCount, verifyTimer.count(), nodeCount, batches.size());
 
-    for (auto& p : sigSharesByNodes) {
-        auto nodeId = p.first;
-        auto& v = p.second;
+    // batches are ordered by lane, so higher priority shares get processed (and recovered) first
+    int64_t now = GetTimeMillis();
+    for (auto& batch : batches) {
+        for (auto nodeId : batch->nodes) {
+            if (bannedNodes.count(nodeId)) {
+                continue;
+            }
+            if (batch->batchVerifier.badSources.count(nodeId)) {
+                LogPrintf("CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
+                         __func__, nodeId);
+                // this will also cause re-requesting of the shares that were sent by this node
+                BanNode(nodeId);
+                bannedNodes.emplace(nodeId);
+                continue;
+            }
 
-        if (batchVerifier.badSources.count(nodeId)) {
-            LogPrintf("CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
-                     __func__, nodeId);
-            // this will also cause re-requesting of the shares that were sent by this node
-            BanNode(nodeId);
-            continue;
+            auto& v = sigSharesByLane[batch->lane].at(nodeId);
+            {
+                LOCK(cs);
+                for (auto& sigShare : v) {
+                    verifyLatency[batch->lane].Add(now - sigShare.receiveTime);
+                }
+            }
+            ProcessPendingSigSharesFromNode(nodeId, v, quorums, connman);
         }
-
-        ProcessPendingSigSharesFromNode(nodeId, v, quorums, connman);
     }
 
     return true;
@@ -1251,6 +1368,16 @@ void CSigSharesManager::Cleanup()
             }
             RemoveSigSharesForSession(signHash);
         }
+
+        // Sessions for which we never accepted a share are not covered by timeSeenForSessions
+        int64_t nowMillis = GetTimeMillis();
+        for (auto it = sessionStartTimes.begin(); it != sessionStartTimes.end(); ) {
+            if (nowMillis - it->second >= SESSION_NEW_SHARES_TIMEOUT * 1000 && !sigShares.CountForSignHash(it->first)) {
+                it = sessionStartTimes.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
 
     // Find node states for peers that disappeared from CConnman
@@ -1287,6 +1414,7 @@ void CSigSharesManager::RemoveSigSharesForSession(const uint256& signHash)
     sigSharesToAnnounce.EraseAllForSignHash(signHash);
     sigShares.EraseAllForSignHash(signHash);
     timeSeenForSessions.erase(signHash);
+    sessionStartTimes.erase(signHash);
 }
 
 void CSigSharesManager::RemoveBannedNodeStates()
@@ -1385,8 +1513,13 @@ bool CSigSharesManager::SignPendingSigShares()
         v = std::move(pendingSigns);
     }
 
-    for (auto& t : v) {
-        Sign(std::get<0>(t), std::get<1>(t), std::get<2>(t));
+    // sign ChainLocks before InstantSend and everything else
+    for (size_t lane = 0; lane < SIGSHARE_LANE_COUNT; lane++) {
+        for (auto& t : v) {
+            if (GetSigShareLane(std::get<0>(t)->params.type, std::get<1>(t)) == lane) {
+                Sign(std::get<0>(t), std::get<1>(t), std::get<2>(t));
+            }
+        }
     }
 
     return !v.empty();
@@ -1428,6 +1561,12 @@ void CSigSharesManager::Sign(const CQuorumCPtr& quorum, const uint256& id, const
     }
 
     sigShare.UpdateKey();
+    sigShare.receiveTime = GetTimeMillis();
+
+    {
+        LOCK(cs);
+        sessionStartTimes.emplace(signHash, sigShare.receiveTime);
+    }
 
     LogPrint("llmq-sigs", "CSigSharesManager::%s -- signed sigShare. signHash=%s, id=%s, msgHash=%s, llmqType=%d, quorum=%s, time=%s\n", __func__,
               signHash.ToString(), sigShare.id.ToString(), sigShare.msgHash.ToString(), quorum->params.type, quorum->qc.quorumHash.ToString(), t.count());
@@ -1462,7 +1601,37 @@ void CSigSharesManager::ForceReAnnouncement(const CQuorumCPtr& quorum, Consensus
 void CSigSharesManager::HandleNewRecoveredSig(const llmq::CRecoveredSig& recoveredSig)
 {
     LOCK(cs);
-    RemoveSigSharesForSession(CLLMQUtils::BuildSignHash(recoveredSig));
+    auto signHash = CLLMQUtils::BuildSignHash(recoveredSig);
+    auto it = sessionStartTimes.find(signHash);
+    if (it != sessionStartTimes.end()) {
+        recoveryLatency[GetSigShareLane((Consensus::LLMQType)recoveredSig.llmqType, recoveredSig.id)].Add(GetTimeMillis() - it->second);
+    }
+    RemoveSigSharesForSession(signHash);
+}
+
+void CSigSharesManager::GetLaneStats(UniValue& ret)
+{
+    LOCK(cs);
+
+    size_t pending[SIGSHARE_LANE_COUNT]{};
+    for (auto& p : nodeStates) {
+        for (size_t lane = 0; lane < SIGSHARE_LANE_COUNT; lane++) {
+            pending[lane] += p.second.pendingIncomingSigShares[lane].Size();
+        }
+    }
+
+    ret.setObject();
+    for (size_t lane = 0; lane < SIGSHARE_LANE_COUNT; lane++) {
+        UniValue laneObj(UniValue::VOBJ);
+        UniValue verifyObj;
+        UniValue recoveryObj;
+        verifyLatency[lane].ToJson(verifyObj);
+        recoveryLatency[lane].ToJson(recoveryObj);
+        laneObj.push_back(Pair("pendingSigShares", (int64_t)pending[lane]));
+        laneObj.push_back(Pair("verifyLatency", verifyObj));
+        laneObj.push_back(Pair("recoveryLatency", recoveryObj));
+        ret.push_back(Pair(sigShareLaneNames[lane], laneObj));
+    }
 }
 
 }
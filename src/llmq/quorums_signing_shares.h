@@ -22,14 +22,28 @@
 #include <unordered_map>
 #include <unordered_set>
 
+class CBLSWorker;
 class CEvoDB;
 class CScheduler;
+class UniValue;
 
 namespace llmq
 {
 // <signHash, quorumMember>
 typedef std::pair<uint256, uint16_t> SigShareKey;
 
+// Incoming sig shares are queued, verified and processed per lane. Lower lanes are always served first, so that a burst
+// of InstantSend signing sessions can not delay ChainLock shares. The same LLMQ type usually signs both, so the lane is
+// derived from the kind of signing request, which ChainLocks recognizes by its request id.
+enum SigShareLane {
+    SIGSHARE_LANE_CHAINLOCKS = 0,
+    SIGSHARE_LANE_INSTANTSEND,
+    SIGSHARE_LANE_OTHER,
+    SIGSHARE_LANE_COUNT,
+};
+
+SigShareLane GetSigShareLane(Consensus::LLMQType llmqType, const uint256& id);
+
 // this one does not get transmitted over the wire as it is batched inside CBatchedSigShares
 class CSigShare
 {
@@ -43,6 +57,9 @@ public:
 
     SigShareKey key;
 
+    // local time (in milliseconds) at which we received or created the share, only used for latency statistics
+    int64_t receiveTime{0};
+
 public:
     void UpdateKey();
     const SigShareKey& GetKey() const
@@ -314,7 +331,7 @@ public:
     std::unordered_map<uint32_t, Session*> sessionByRecvId;
     uint32_t nextSendSessionId{1};
 
-    SigShareMap<CSigShare> pendingIncomingSigShares;
+    SigShareMap<CSigShare> pendingIncomingSigShares[SIGSHARE_LANE_COUNT];
     SigShareMap<int64_t> requestedSigShares;
 
     bool banned{false};
@@ -328,6 +345,23 @@ public:
     void RemoveSession(const uint256& signHash);
 };
 
+// Histogram of latencies in milliseconds with roughly logarithmic buckets
+class CSigShareLatencyHistogram
+{
+public:
+    static const size_t BUCKET_COUNT = 12;
+
+private:
+    uint64_t buckets[BUCKET_COUNT]{};
+    uint64_t count{0};
+    int64_t total{0};
+    int64_t max{0};
+
+public:
+    void Add(int64_t latency);
+    void ToJson(UniValue& obj) const;
+};
+
 class CSigSharesManager : public CRecoveredSigsListener
 {
     static const int64_t SESSION_NEW_SHARES_TIMEOUT = 60;
@@ -340,9 +374,16 @@ class CSigSharesManager : public CRecoveredSigsListener
     // 400 is the maximum quorum size, so this is also the maximum number of sigs we need to support
     const size_t MAX_MSGS_TOTAL_BATCHED_SIGS = 400;
 
+    // number of sig shares verified together in one job on the BLS worker pool
+    static const size_t VERIFY_BATCH_SIZE = 16;
+
+    typedef std::unordered_map<NodeId, std::vector<CSigShare>> SigSharesByNode;
+
 private:
     CCriticalSection cs;
 
+    CBLSWorker& blsWorker;
+
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
@@ -350,6 +391,12 @@ private:
 
     // stores time of last receivedSigShare. Used to detect timeouts
     std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeSeenForSessions;
+    // stores time (in milliseconds) of the first share we received or created for a session
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> sessionStartTimes;
+
+    // share receipt -> share verified, and first share of a session -> recovered sig
+    CSigShareLatencyHistogram verifyLatency[SIGSHARE_LANE_COUNT];
+    CSigShareLatencyHistogram recoveryLatency[SIGSHARE_LANE_COUNT];
 
     std::unordered_map<NodeId, CSigSharesNodeState> nodeStates;
     SigShareMap<std::pair<NodeId, int64_t>> sigSharesRequested;
@@ -364,7 +411,7 @@ private:
     std::atomic<uint32_t> recoveredSigsCounter{0};
 
 public:
-    CSigSharesManager();
+    CSigSharesManager(CBLSWorker& _blsWorker);
     ~CSigSharesManager();
 
     void StartWorkerThread();
@@ -382,6 +429,8 @@ public:
 
     void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig);
 
+    void GetLaneStats(UniValue& ret);
+
 private:
     // all of these return false when the currently processed message should be aborted (as each message actually contains multiple messages)
     bool ProcessMessageSigSesAnn(CNode* pfrom, const CSigSesAnn& ann, CConnman& connman);
@@ -393,7 +442,7 @@ private:
     bool PreVerifyBatchedSigShares(NodeId nodeId, const CSigSharesNodeState::SessionInfo& session, const CBatchedSigShares& batchedSigShares, bool& retBan);
 
     void CollectPendingSigSharesToVerify(size_t maxUniqueSessions,
-            std::unordered_map<NodeId, std::vector<CSigShare>>& retSigShares,
+            std::vector<SigSharesByNode>& retSigSharesByLane,
             std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher>& retQuorums);
     bool ProcessPendingSigShares(CConnman& connman);
 
@@ -7,6 +7,8 @@
 
 #include "chainparams.h"
 #include "random.h"
+#include "saltedhasher.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 namespace llmq
@@ -14,10 +16,32 @@ namespace llmq
 
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
+    // The members only depend on the quorum block, so they are calculated once per quorum and then served from the
+    // cache for signing, sig share routing and connection handling
+    static CCriticalSection cs_members;
+    static std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapQuorumMembers;
+
+    std::vector<CDeterministicMNCPtr> quorumMembers;
+    {
+        LOCK(cs_members);
+        if (mapQuorumMembers.empty()) {
+            for (auto& p : Params().GetConsensus().llmqs) {
+                mapQuorumMembers.emplace(p.first, unordered_lru_cache<uint256, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>(p.second.signingActiveQuorumCount + 1));
+            }
+        }
+        if (mapQuorumMembers.at(llmqType).get(pindexQuorum->GetBlockHash(), quorumMembers)) {
+            return quorumMembers;
+        }
+    }
+
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
     auto allMns = deterministicMNManager->GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair((uint8_t) llmqType, pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+    quorumMembers = allMns.CalculateQuorum(params.size, modifier);
+
+    LOCK(cs_members);
+    mapQuorumMembers.at(llmqType).insert(pindexQuorum->GetBlockHash(), quorumMembers);
+    return quorumMembers;
 }
 
 uint256 CLLMQUtils::BuildCommitmentHash(uint8_t llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash)
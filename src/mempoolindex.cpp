@@ -0,0 +1,169 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mempoolindex.h"
+
+#include "hash.h"
+#include "random.h"
+
+#include <limits>
+
+SaltedMempoolIndexHasher::SaltedMempoolIndexHasher() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{
+}
+
+size_t SaltedMempoolIndexHasher::operator()(const uint256& txid) const
+{
+    return SipHashUint256(k0, k1, txid);
+}
+
+size_t SaltedMempoolIndexHasher::operator()(const std::pair<int, uint160>& address) const
+{
+    return CSipHasher(k0, k1).Write((uint64_t)address.first).Write(address.second.begin(), address.second.size()).Finalize();
+}
+
+size_t SaltedMempoolIndexHasher::operator()(const CSpentIndexKey& key) const
+{
+    return SipHashUint256Extra(k0, k1, key.txid, key.outputIndex);
+}
+
+void CMempoolAddressIndex::Insert(const uint256& txhash, const std::vector<Entry>& entries)
+{
+    std::vector<CMempoolAddressDeltaKey> inserted;
+    inserted.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        const CMempoolAddressDeltaKey& key = entry.first;
+        AddressShard& shard = GetShard(std::make_pair(key.type, key.addressBytes));
+        {
+            LOCK(shard.cs);
+            shard.mapDeltas[std::make_pair(key.type, key.addressBytes)].emplace(key, entry.second);
+        }
+        inserted.emplace_back(key);
+    }
+
+    InsertedShard& shard = GetShard(txhash);
+    LOCK(shard.cs);
+    shard.mapInserted.emplace(txhash, std::move(inserted));
+}
+
+void CMempoolAddressIndex::Remove(const uint256& txhash)
+{
+    std::vector<CMempoolAddressDeltaKey> keys;
+    {
+        InsertedShard& shard = GetShard(txhash);
+        LOCK(shard.cs);
+        auto it = shard.mapInserted.find(txhash);
+        if (it == shard.mapInserted.end()) {
+            return;
+        }
+        keys = std::move(it->second);
+        shard.mapInserted.erase(it);
+    }
+
+    for (const auto& key : keys) {
+        AddressKey addressKey = std::make_pair(key.type, key.addressBytes);
+        AddressShard& shard = GetShard(addressKey);
+        LOCK(shard.cs);
+        auto it = shard.mapDeltas.find(addressKey);
+        if (it == shard.mapDeltas.end()) {
+            continue;
+        }
+        it->second.erase(key);
+        if (it->second.empty()) {
+            shard.mapDeltas.erase(it);
+        }
+    }
+}
+
+void CMempoolAddressIndex::Get(const std::vector<std::pair<uint160, int> >& addresses, std::vector<Entry>& results) const
+{
+    for (const auto& address : addresses) {
+        AddressKey addressKey = std::make_pair(address.second, address.first);
+        const AddressShard& shard = GetShard(addressKey);
+        LOCK(shard.cs);
+        auto it = shard.mapDeltas.find(addressKey);
+        if (it != shard.mapDeltas.end()) {
+            results.insert(results.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
+
+void CMempoolAddressIndex::Clear()
+{
+    for (auto& shard : addressShards) {
+        LOCK(shard.cs);
+        shard.mapDeltas.clear();
+    }
+    for (auto& shard : insertedShards) {
+        LOCK(shard.cs);
+        shard.mapInserted.clear();
+    }
+}
+
+void CMempoolSpentIndex::Insert(const uint256& txhash, const std::vector<Entry>& entries)
+{
+    std::vector<CSpentIndexKey> inserted;
+    inserted.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        SpentShard& shard = GetShard(entry.first);
+        {
+            LOCK(shard.cs);
+            shard.mapSpent.emplace(entry.first, entry.second);
+        }
+        inserted.emplace_back(entry.first);
+    }
+
+    InsertedShard& shard = GetShard(txhash);
+    LOCK(shard.cs);
+    shard.mapInserted.emplace(txhash, std::move(inserted));
+}
+
+void CMempoolSpentIndex::Remove(const uint256& txhash)
+{
+    std::vector<CSpentIndexKey> keys;
+    {
+        InsertedShard& shard = GetShard(txhash);
+        LOCK(shard.cs);
+        auto it = shard.mapInserted.find(txhash);
+        if (it == shard.mapInserted.end()) {
+            return;
+        }
+        keys = std::move(it->second);
+        shard.mapInserted.erase(it);
+    }
+
+    for (const auto& key : keys) {
+        SpentShard& shard = GetShard(key);
+        LOCK(shard.cs);
+        shard.mapSpent.erase(key);
+    }
+}
+
+bool CMempoolSpentIndex::Get(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    const SpentShard& shard = GetShard(key);
+    LOCK(shard.cs);
+    auto it = shard.mapSpent.find(key);
+    if (it == shard.mapSpent.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+void CMempoolSpentIndex::Clear()
+{
+    for (auto& shard : spentShards) {
+        LOCK(shard.cs);
+        shard.mapSpent.clear();
+    }
+    for (auto& shard : insertedShards) {
+        LOCK(shard.cs);
+        shard.mapInserted.clear();
+    }
+}
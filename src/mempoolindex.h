@@ -0,0 +1,127 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_MEMPOOLINDEX_H
+#define COIN_MEMPOOLINDEX_H
+
+#include "addressindex.h"
+#include "spentindex.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * The mempool parts of -addressindex and -spentindex. They have their own locks, split into
+ * MEMPOOL_INDEX_SHARDS stripes, so that explorer queries (getaddressmempool, getspentinfo) neither wait for
+ * nor block transaction acceptance, which holds mempool.cs. Entries are spread over the stripes by a salted hash
+ * of the address (or the spent outpoint), and by the txid for the bookkeeping needed to remove a tx again.
+ *
+ * A tx is added and removed stripe by stripe, so a concurrent reader may see only some of its entries. That's fine
+ * for these indexes, they never were a consistent snapshot of a moving mempool anyway.
+ */
+static const size_t MEMPOOL_INDEX_SHARDS = 16;
+
+/** Picks the stripe from the top bits of a hash, the hash maps inside a stripe use the low ones */
+inline size_t MempoolIndexShard(size_t nHash)
+{
+    return (nHash >> (sizeof(size_t) * 8 - 8)) % MEMPOOL_INDEX_SHARDS;
+}
+
+/** Salted hashes for the keys of the mempool indexes, so that the buckets can't be targeted */
+class SaltedMempoolIndexHasher
+{
+private:
+    const uint64_t k0, k1;
+
+public:
+    SaltedMempoolIndexHasher();
+
+    size_t operator()(const uint256& txid) const;
+    size_t operator()(const std::pair<int, uint160>& address) const;
+    size_t operator()(const CSpentIndexKey& key) const;
+};
+
+class CMempoolAddressIndex
+{
+public:
+    typedef std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> Entry;
+
+private:
+    typedef std::pair<int, uint160> AddressKey;
+    // the deltas of a single address, in the order of the old index
+    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> DeltaMap;
+
+    struct AddressShard
+    {
+        mutable CCriticalSection cs;
+        std::unordered_map<AddressKey, DeltaMap, SaltedMempoolIndexHasher> mapDeltas;
+    };
+    struct InsertedShard
+    {
+        CCriticalSection cs;
+        std::unordered_map<uint256, std::vector<CMempoolAddressDeltaKey>, SaltedMempoolIndexHasher> mapInserted;
+    };
+
+    SaltedMempoolIndexHasher hasher;
+    std::array<AddressShard, MEMPOOL_INDEX_SHARDS> addressShards;
+    std::array<InsertedShard, MEMPOOL_INDEX_SHARDS> insertedShards;
+
+    AddressShard& GetShard(const AddressKey& key) { return addressShards[MempoolIndexShard(hasher(key))]; }
+    const AddressShard& GetShard(const AddressKey& key) const { return addressShards[MempoolIndexShard(hasher(key))]; }
+    InsertedShard& GetShard(const uint256& txhash) { return insertedShards[MempoolIndexShard(hasher(txhash))]; }
+
+public:
+    void Insert(const uint256& txhash, const std::vector<Entry>& entries);
+    void Remove(const uint256& txhash);
+    /** Appends the deltas of all given (addressHash, type) pairs to results */
+    void Get(const std::vector<std::pair<uint160, int> >& addresses, std::vector<Entry>& results) const;
+    void Clear();
+};
+
+class CMempoolSpentIndex
+{
+public:
+    typedef std::pair<CSpentIndexKey, CSpentIndexValue> Entry;
+
+private:
+    struct SpentKeyEqual
+    {
+        bool operator()(const CSpentIndexKey& a, const CSpentIndexKey& b) const
+        {
+            return a.txid == b.txid && a.outputIndex == b.outputIndex;
+        }
+    };
+
+    struct SpentShard
+    {
+        mutable CCriticalSection cs;
+        std::unordered_map<CSpentIndexKey, CSpentIndexValue, SaltedMempoolIndexHasher, SpentKeyEqual> mapSpent;
+    };
+    struct InsertedShard
+    {
+        CCriticalSection cs;
+        std::unordered_map<uint256, std::vector<CSpentIndexKey>, SaltedMempoolIndexHasher> mapInserted;
+    };
+
+    SaltedMempoolIndexHasher hasher;
+    std::array<SpentShard, MEMPOOL_INDEX_SHARDS> spentShards;
+    std::array<InsertedShard, MEMPOOL_INDEX_SHARDS> insertedShards;
+
+    SpentShard& GetShard(const CSpentIndexKey& key) { return spentShards[MempoolIndexShard(hasher(key))]; }
+    const SpentShard& GetShard(const CSpentIndexKey& key) const { return spentShards[MempoolIndexShard(hasher(key))]; }
+    InsertedShard& GetShard(const uint256& txhash) { return insertedShards[MempoolIndexShard(hasher(txhash))]; }
+
+public:
+    void Insert(const uint256& txhash, const std::vector<Entry>& entries);
+    void Remove(const uint256& txhash);
+    bool Get(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+    void Clear();
+};
+
+#endif // COIN_MEMPOOLINDEX_H
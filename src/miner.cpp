@@ -562,6 +562,105 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
 
+void CreateWorkFromTemplate(const CBlock& blockTemplate, const std::vector<uint256>& vCoinbaseMerkleBranch, int nHeight,
+                            const CScript& scriptPubKey, bool fRandomX, const uint256& uRandomXKey,
+                            const std::vector<unsigned char>& vRandomXHeader, unsigned int nExtraNonce, CBlock& blockRet)
+{
+    // copies the tx references only
+    blockRet = blockTemplate;
+
+    CMutableTransaction txCoinbase(*blockTemplate.vtx[0]);
+    txCoinbase.vout[0].scriptPubKey = scriptPubKey;
+    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
+    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+    blockRet.vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+
+    if (fRandomX)
+    {
+        blockRet.RandomXKey  = uRandomXKey;
+        blockRet.RandomXData = "<rxheader>" + HexStr(vRandomXHeader.begin(), vRandomXHeader.end()) + "</rxheader>";
+    }
+
+    blockRet.hashMerkleRoot = ComputeMerkleRootFromBranch(blockRet.vtx[0]->GetHash(), vCoinbaseMerkleBranch, 0);
+}
+
+CBlockTemplateCache blockTemplateCache;
+
+bool CBlockTemplateCache::Update(const CScript& scriptPayee, const uint256& uRandomXKey,
+                                 const std::vector<unsigned char>& vRandomXHeader, int64_t nMaxAge)
+{
+    AssertLockHeld(cs);
+
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    if (!pindexTip)
+        return false;
+
+    if (!pblocktemplate || pindexPrev != pindexTip ||
+        (mempool.GetTransactionsUpdated() != nTransactionsUpdated && GetTime() - nTimeCreated > nMaxAge))
+    {
+        int64_t nTimeStart = GetTimeMicros();
+        unsigned int nTransactionsUpdatedNew = mempool.GetTransactionsUpdated();
+        std::unique_ptr<CBlockTemplate> pblocktemplateNew(BlockAssembler(Params()).CreateNewBlock(scriptPayee, "", uRandomXKey, vRandomXHeader));
+        if (!pblocktemplateNew)
+        {
+            pblocktemplate.reset();
+            return false;
+        }
+
+        pblocktemplate = std::move(pblocktemplateNew);
+        vCoinbaseMerkleBranch = BlockMerkleBranch(pblocktemplate->block, 0);
+        nTransactionsUpdated = nTransactionsUpdatedNew;
+        nTimeCreated = GetTime();
+        {
+            LOCK(cs_main);
+            pindexPrev = mapBlockIndex.at(pblocktemplate->block.hashPrevBlock);
+        }
+        LogPrint("miner", "CBlockTemplateCache::%s -- new template at height %d with %u txs in %.2fms\n", __func__,
+                 pindexPrev->nHeight + 1, pblocktemplate->block.vtx.size(), 0.001 * (GetTimeMicros() - nTimeStart));
+    }
+    return true;
+}
+
+bool CBlockTemplateCache::GetWork(const CScript& scriptPubKey, const std::string& sPoolAddress, const uint256& uRandomXKey,
+                                  const std::vector<unsigned char>& vRandomXHeader, unsigned int nExtraNonce, CBlock& blockRet)
+{
+    const CChainParams& chainparams = Params();
+
+    CScript scriptPayee = scriptPubKey;
+    if (!sPoolAddress.empty())
+    {
+        CBitcoinAddress cbaPoolAddress(sPoolAddress);
+        scriptPayee = GetScriptForDestination(cbaPoolAddress.Get());
+    }
+
+    LOCK(cs);
+    if (!Update(scriptPayee, uRandomXKey, vRandomXHeader, DEFAULT_TEMPLATE_MAX_AGE))
+        return false;
+
+    int nHeight = pindexPrev->nHeight + 1;
+    CreateWorkFromTemplate(pblocktemplate->block, vCoinbaseMerkleBranch, nHeight, scriptPayee,
+                           nHeight >= chainparams.GetConsensus().RANDOMX_HEIGHT, uRandomXKey, vRandomXHeader, nExtraNonce, blockRet);
+    UpdateTime(&blockRet, chainparams.GetConsensus(), pindexPrev);
+    return true;
+}
+
+bool CBlockTemplateCache::GetTemplate(const CScript& scriptPubKey, int64_t nMaxAge, CBlock& blockRet,
+                                      std::vector<uint256>& vCoinbaseMerkleBranchRet, const CBlockIndex*& pindexPrevRet)
+{
+    LOCK(cs);
+    if (!Update(scriptPubKey, uint256(), std::vector<unsigned char>(), nMaxAge))
+        return false;
+
+    blockRet = pblocktemplate->block;
+    vCoinbaseMerkleBranchRet = vCoinbaseMerkleBranch;
+    pindexPrevRet = pindexPrev;
+    return true;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 //                                                                          //
@@ -600,19 +699,20 @@ bool CreateBlockForStratum(std::string sAddress, uint256 uRandomXKey, std::vecto
 	int iThreadID = 0;
 	boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
-	std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript, sAddress, uRandomXKey, vRandomXHeader));
-	if (!pblocktemplate.get())
+	if (!coinbaseScript || coinbaseScript->reserveScript.empty())
+	{
+		sError = "No coinbase script available";
+		return false;
+	}
+	int iStart = rand() % 65536;
+	unsigned int nExtraNonce = GetAdjustedTime() + iStart; // This is the Extra Nonce (not the nonce); this helps put every miner on their own private hash in the pool (since they don't have a distinct receiving address)
+	// The template is shared by all stratum clients, each of them only gets a copy with its own coinbase
+	if (!blockTemplateCache.GetWork(coinbaseScript->reserveScript, sAddress, uRandomXKey, vRandomXHeader, nExtraNonce, blockX))
     {
 		LogPrint("miner", "CreateBlockForStratum::No block to mine %f", iThreadID);
 		sError = "Wallet Locked/ABN Required";
 		return false;
     }
-	CBlock *pblock = &pblocktemplate->block;
-	int iStart = rand() % 65536;
-	unsigned int nExtraNonce = GetAdjustedTime() + iStart; // This is the Extra Nonce (not the nonce); this helps put every miner on their own private hash in the pool (since they don't have a distinct receiving address)
-	CBlockIndex* pindexPrev = chainActive.Tip();
-	IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-	blockX = const_cast<CBlock&>(*pblock);
 	return true;
 }	
 
@@ -681,20 +781,22 @@ recover:
 			uint256 uRXKey = uint256S("0x01");
 			std::vector<unsigned char> vchRXHeader = ParseHex("00");
 	
-			std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript, "", uRXKey, vchRXHeader));
-			if (!pblocktemplate.get())
+			int iStart = rand() % 65536;
+			unsigned int nExtraNonce = GetAdjustedTime() + iStart + iThreadID;
+
+			// All miner threads share one template
+			CBlock block;
+			if (!blockTemplateCache.GetWork(coinbaseScript->reserveScript, "", uRXKey, vchRXHeader, nExtraNonce, block))
             {
 				MilliSleep(15000);
 				LogPrint("miner", "No block to mine %f", iThreadID);
 				goto recover;
             }
+			// The tip moved while the template was created
+			if (block.hashPrevBlock != pindexPrev->GetBlockHash())
+				continue;
 
-			CBlock *pblock = &pblocktemplate->block;
-			
-			int iStart = rand() % 65536;
-			unsigned int nExtraNonce = GetAdjustedTime() + iStart + iThreadID;
-			
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+			CBlock *pblock = &block;
 			nHashesDone++;
 			UpdateHashesPerSec(nHashesDone);
 			if (fDebugSpam)
@@ -24,6 +24,8 @@ class CWallet;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Seconds a cached block template is handed out for while the mempool changes */
+static const int64_t DEFAULT_TEMPLATE_MAX_AGE = 5;
 
 void GenerateCoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
 bool CreateBlockForStratum(std::string sAddress, uint256 uRandomXKey, std::vector<unsigned char> vRandomXHeader, std::string& sError, CBlock& blockX);
@@ -208,6 +210,57 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Create a work unit from a cached block template: copies the block, puts scriptPubKey, the extra nonce and the
+ * RandomX key/header in place and recomputes the merkle root from vCoinbaseMerkleBranch (the merkle branch of the
+ * coinbase), so only the coinbase gets hashed again.
+ */
+void CreateWorkFromTemplate(const CBlock& blockTemplate, const std::vector<uint256>& vCoinbaseMerkleBranch, int nHeight,
+                            const CScript& scriptPubKey, bool fRandomX, const uint256& uRandomXKey,
+                            const std::vector<unsigned char>& vRandomXHeader, unsigned int nExtraNonce, CBlock& blockRet);
+
+/**
+ * Keeps the last block template for the stratum server and the internal miners, so that handing out new work does
+ * not run the package selection, the masternode/superblock payee lookup and TestBlockValidity again every time.
+ * The template is rebuilt when the tip changes and, while the mempool keeps changing, once it's older than
+ * DEFAULT_TEMPLATE_MAX_AGE seconds (the same rule getblocktemplate uses).
+ */
+class CBlockTemplateCache
+{
+private:
+    CCriticalSection cs;
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    std::vector<uint256> vCoinbaseMerkleBranch;
+    const CBlockIndex* pindexPrev{nullptr};
+    unsigned int nTransactionsUpdated{0};
+    int64_t nTimeCreated{0};
+
+    /**
+     * Rebuild the template if the tip changed, or if the mempool changed and the template is older than nMaxAge
+     * seconds. Returns false when no template is available.
+     */
+    bool Update(const CScript& scriptPayee, const uint256& uRandomXKey, const std::vector<unsigned char>& vRandomXHeader,
+                int64_t nMaxAge);
+
+public:
+    /**
+     * Get a work unit paying to scriptPubKey (or to sPoolAddress, if not empty). Returns false when no valid
+     * template could be created. Must not be called with cs_main held.
+     */
+    bool GetWork(const CScript& scriptPubKey, const std::string& sPoolAddress, const uint256& uRandomXKey,
+                 const std::vector<unsigned char>& vRandomXHeader, unsigned int nExtraNonce, CBlock& blockRet);
+
+    /**
+     * Get a copy of the template itself, the merkle branch of its coinbase and the block it builds on, for callers
+     * that hand out work units with CreateWorkFromTemplate themselves. A template older than nMaxAge seconds is
+     * rebuilt once the mempool has changed (GetWork uses DEFAULT_TEMPLATE_MAX_AGE). Must not be called with cs_main held.
+     */
+    bool GetTemplate(const CScript& scriptPubKey, int64_t nMaxAge, CBlock& blockRet,
+                     std::vector<uint256>& vCoinbaseMerkleBranchRet, const CBlockIndex*& pindexPrevRet);
+};
+
+extern CBlockTemplateCache blockTemplateCache;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
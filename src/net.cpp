@@ -37,6 +37,14 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -53,6 +61,9 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// How long the network thread waits for socket events before polling the send queues again
+static const int SELECT_TIMEOUT_MILLISECONDS = 50;
+
 #if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -377,7 +388,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -441,14 +452,18 @@ void CConnman::DumpBanlist()
         banmap.size(), GetTimeMillis() - nStart);
 }
 
-void CNode::CloseSocketDisconnect()
+void CNode::CloseSocketDisconnect(CConnman* connman)
 {
     fDisconnect = true;
-    LOCK(cs_hSocket);
+    LOCK2(connman->cs_mapSocketToNode, cs_hSocket);
     if (hSocket != INVALID_SOCKET)
     {
         if (fDebugSpam)
 			LogPrint("net", "disconnecting peer=%d\n", id);
+        fHasRecvData = false;
+        fCanSendData = false;
+        connman->mapSocketToNode.erase(hSocket);
+        connman->UnregisterEvents(hSocket);
         CloseSocket(hSocket);
     }
 }
@@ -704,6 +719,86 @@ void CNode::copyStats(CNodeStats &stats)
 }
 #undef X
 
+static CNetMessageBufferPool netMessageBufferPool;
+
+bool CNetMessageBufferPool::Acquire(CSerializeData& vchRet, size_t nSize)
+{
+    LOCK(cs);
+    auto itBest = vBuffers.end();
+    for (auto it = vBuffers.begin(); it != vBuffers.end(); ++it) {
+        if (it->capacity() >= nSize && (itBest == vBuffers.end() || it->capacity() < itBest->capacity()))
+            itBest = it;
+    }
+    if (itBest == vBuffers.end())
+        return false;
+    nPooledBytes -= itBest->capacity();
+    vchRet.swap(*itBest);
+    vBuffers.erase(itBest);
+    return true;
+}
+
+void CNetMessageBufferPool::Release(CSerializeData& vch)
+{
+    size_t nCapacity = vch.capacity();
+    if (nCapacity < MIN_POOLED_SIZE)
+        return;
+    LOCK(cs);
+    if (vBuffers.size() >= MAX_POOLED_BUFFERS || nPooledBytes + nCapacity > MAX_POOLED_BYTES)
+        return;
+    vch.clear();
+    vBuffers.emplace_back();
+    vBuffers.back().swap(vch);
+    nPooledBytes += nCapacity;
+}
+
+size_t CNetMessageBufferPool::GetPooledBytes() const
+{
+    LOCK(cs);
+    return nPooledBytes;
+}
+
+bool CNode::OnMessageHeader(CNetMessage& msg, int64_t nTimeMicros)
+{
+    if (nTimeFirstMessageReceived == 0) {
+        if (fSuccessfullyConnected) {
+            // First message after VERSION/VERACK.
+            // We record the time when the header is fully received and not when the full message is received.
+            // otherwise a peer might send us a very large message as first message after VERSION/VERACK and fill
+            // up our memory with multiple parallel connections doing this.
+            nTimeFirstMessageReceived = nTimeMicros;
+            fFirstMessageIsMNAUTH = msg.hdr.GetCommand() == NetMsgType::MNAUTH;
+        } else {
+            // We're still in the VERSION/VERACK handshake process, so any message received in this state is
+            // expected to be very small. This protects against attackers filling up memory by sending oversized
+            // VERSION messages while the incoming connection is still protected against eviction
+            if (msg.hdr.nMessageSize > 1024) {
+                LogPrint("net", "Oversized VERSION/VERACK message from peer=%i, disconnecting\n", GetId());
+                return false;
+            }
+        }
+    }
+
+    if (msg.hdr.nMessageSize > MAX_PROTOCOL_MESSAGE_LENGTH) {
+        LogPrint("net", "Oversized message from peer=%i, disconnecting\n", GetId());
+        return false;
+    }
+
+    return true;
+}
+
+void CNode::OnMessageComplete(CNetMessage& msg, int64_t nTimeMicros)
+{
+    //store received bytes per message command
+    //to prevent a memory DOS, only allow valid commands
+    mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
+    if (i == mapRecvBytesPerMsgCmd.end())
+        i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapRecvBytesPerMsgCmd.end());
+    i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+
+    msg.nTime = nTimeMicros;
+}
+
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete)
 {
     complete = false;
@@ -715,33 +810,17 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
 
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
-            vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.back()->complete())
+            vRecvMsg.push_back(std::make_shared<CNetMessage>(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
 
-        CNetMessage& msg = vRecvMsg.back();
+        CNetMessage& msg = *vRecvMsg.back();
 
         // absorb network data
         int handled;
         if (!msg.in_data) {
             handled = msg.readHeader(pch, nBytes);
-            if (msg.in_data && nTimeFirstMessageReceived == 0) {
-                if (fSuccessfullyConnected) {
-                    // First message after VERSION/VERACK.
-                    // We record the time when the header is fully received and not when the full message is received.
-                    // otherwise a peer might send us a very large message as first message after VERSION/VERACK and fill
-                    // up our memory with multiple parallel connections doing this.
-                    nTimeFirstMessageReceived = nTimeMicros;
-                    fFirstMessageIsMNAUTH = msg.hdr.GetCommand() == NetMsgType::MNAUTH;
-                } else {
-                    // We're still in the VERSION/VERACK handshake process, so any message received in this state is
-                    // expected to be very small. This protects against attackers filling up memory by sending oversized
-                    // VERSION messages while the incoming connection is still protected against eviction
-                    if (msg.hdr.nMessageSize > 1024) {
-                        LogPrint("net", "Oversized VERSION/VERACK message from peer=%i, disconnecting\n", GetId());
-                        return false;
-                    }
-                }
-            }
+            if (msg.in_data && !OnMessageHeader(msg, nTimeMicros))
+                return false;
         } else {
             handled = msg.readData(pch, nBytes);
         }
@@ -749,25 +828,11 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         if (handled < 0)
                 return false;
 
-        if (msg.in_data && msg.hdr.nMessageSize > MAX_PROTOCOL_MESSAGE_LENGTH) {
-            LogPrint("net", "Oversized message from peer=%i, disconnecting\n", GetId());
-            return false;
-        }
-
         pch += handled;
         nBytes -= handled;
 
         if (msg.complete()) {
-
-            //store received bytes per message command
-            //to prevent a memory DOS, only allow valid commands
-            mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
-            if (i == mapRecvBytesPerMsgCmd.end())
-                i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
-            assert(i != mapRecvBytesPerMsgCmd.end());
-            i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
-
-            msg.nTime = nTimeMicros;
+            OnMessageComplete(msg, nTimeMicros);
             complete = true;
         }
     }
@@ -775,6 +840,49 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+unsigned int CNode::GetRecvDataBuffer(char*& pch)
+{
+    if (vRecvMsg.empty() || !vRecvMsg.back()->in_data || vRecvMsg.back()->complete())
+        return 0;
+    return vRecvMsg.back()->GetDataBuffer(pch);
+}
+
+bool CNode::ReceivedMsgData(unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    int64_t nTimeMicros = GetTimeMicros();
+    LOCK(cs_vRecv);
+    nLastRecv = nTimeMicros / 1000000;
+    nRecvBytes += nBytes;
+
+    CNetMessage& msg = *vRecvMsg.back();
+    msg.DataReceived(nBytes);
+    if (msg.complete()) {
+        OnMessageComplete(msg, nTimeMicros);
+        complete = true;
+    }
+    return true;
+}
+
+bool CNode::QueueCompletedMessages(size_t nReceiveFloodSize)
+{
+    size_t nSizeAdded = 0;
+    auto it(vRecvMsg.begin());
+    for (; it != vRecvMsg.end(); ++it) {
+        if (!(*it)->complete())
+            break;
+        nSizeAdded += (*it)->vRecv.size() + CMessageHeader::HEADER_SIZE;
+    }
+    if (it == vRecvMsg.begin())
+        return false;
+
+    LOCK(cs_vProcessMsg);
+    vProcessMsg.splice(vProcessMsg.end(), vRecvMsg, vRecvMsg.begin(), it);
+    nProcessQueueSize += nSizeAdded;
+    fPauseRecv = nProcessQueueSize > nReceiveFloodSize;
+    return true;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -835,19 +943,46 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
 {
-    unsigned int nRemaining = hdr.nMessageSize - nDataPos;
-    unsigned int nCopy = std::min(nRemaining, nBytes);
+    char* pchData;
+    unsigned int nCopy = std::min(GetDataBuffer(pchData), nBytes);
+
+    memcpy(pchData, pch, nCopy);
+    DataReceived(nCopy);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+    return nCopy;
+}
+
+unsigned int CNetMessage::GetDataBuffer(char*& pch)
+{
+    if (vRecv.size() == nDataPos) {
+        if (nDataPos == 0 && hdr.nMessageSize >= CNetMessageBufferPool::MIN_POOLED_SIZE) {
+            CSerializeData vch;
+            if (netMessageBufferPool.Acquire(vch, hdr.nMessageSize))
+                vRecv.swap_data(vch);
+        }
+        // Allocate at least 256 KiB ahead and grow geometrically after that, so that large messages are not
+        // reallocated and copied over and over. Never allocate more than the total message size.
+        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + std::max(nDataPos, 256U * 1024)));
     }
 
-    hasher.Write((const unsigned char*)pch, nCopy);
-    memcpy(&vRecv[nDataPos], pch, nCopy);
-    nDataPos += nCopy;
+    pch = &vRecv[nDataPos];
+    return vRecv.size() - nDataPos;
+}
 
-    return nCopy;
+void CNetMessage::DataReceived(unsigned int nBytes)
+{
+    assert(nDataPos + nBytes <= vRecv.size());
+    hasher.Write((const unsigned char*)&vRecv[nDataPos], nBytes);
+    nDataPos += nBytes;
+}
+
+CNetMessage::~CNetMessage()
+{
+    if (vRecv.capacity() >= CNetMessageBufferPool::MIN_POOLED_SIZE) {
+        CSerializeData vch;
+        vRecv.swap_data(vch);
+        netMessageBufferPool.Release(vch);
+    }
 }
 
 const uint256& CNetMessage::GetMessageHash() const
@@ -894,13 +1029,19 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 it++;
             } else {
                 // could not send full message; stop sending more
+                // the socket buffer is full, wait for it to become writable again
+                pnode->fCanSendData = false;
                 break;
             }
         } else {
             if (nBytes < 0) {
                 // error
                 int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+                if (nErr == WSAEWOULDBLOCK)
+                {
+                    pnode->fCanSendData = false;
+                }
+                else if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
                 {
                     LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
                     pnode->fDisconnect = true;
@@ -1127,7 +1268,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         if (fDebugSpam)
 			LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
@@ -1183,339 +1324,537 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     GetNodeSignals().InitializeNode(pnode, *this);
 	if (fDebugSpam)
 		LogPrint("net", "connection from %s accepted\n", addr.ToString());
+    AddNode(pnode);
+}
+
+void CConnman::AddNode(CNode* pnode)
+{
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+
+    LOCK2(cs_mapSocketToNode, pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+    mapSocketToNode[pnode->hSocket] = pnode;
+    if (!RegisterEvents(pnode->hSocket, true)) {
+        // we would never hear from this socket again
+        pnode->fDisconnect = true;
+    }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::DisconnectNodes()
 {
-    unsigned int nPrevNodeCount = 0;
-    while (!interruptNet)
+    LOCK(cs_vNodes);
+    // Disconnect unused nodes
+    std::vector<CNode*> vNodesCopy = vNodes;
+    BOOST_FOREACH(CNode* pnode, vNodesCopy)
     {
-        //
-        // Disconnect nodes
-        //
+        if (pnode->fDisconnect)
         {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            std::vector<CNode*> vNodesCopy = vNodes;
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
-            {
-                if (pnode->fDisconnect)
-                {
-                    if (fDebugSpam)
-						LogPrintf("ThreadSocketHandler -- removing node: peer=%d addr=%s nRefCount=%d fInbound=%d fMasternode=%d\n",
-                              pnode->id, pnode->addr.ToString(), pnode->GetRefCount(), pnode->fInbound, pnode->fMasternode);
-
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
-
-                    // release outbound grant (if any)
-                    pnode->grantOutbound.Release();
-                    pnode->grantMasternodeOutbound.Release();
+            if (fDebugSpam)
+                LogPrintf("ThreadSocketHandler -- removing node: peer=%d addr=%s nRefCount=%d fInbound=%d fMasternode=%d\n",
+                      pnode->id, pnode->addr.ToString(), pnode->GetRefCount(), pnode->fInbound, pnode->fMasternode);
 
-                    // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+            // remove from vNodes
+            vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
-                    // hold in disconnected pool until all refs are released
+            // nothing left to receive or send on this socket
+            mapReceivableNodes.erase(pnode->GetId());
+            {
+                LOCK(cs_mapNodesWithDataToSend);
+                if (mapNodesWithDataToSend.erase(pnode->GetId()))
                     pnode->Release();
-                    vNodesDisconnected.push_back(pnode);
-                }
             }
+
+            // release outbound grant (if any)
+            pnode->grantOutbound.Release();
+            pnode->grantMasternodeOutbound.Release();
+
+            // close socket and cleanup
+            pnode->CloseSocketDisconnect(this);
+
+            // hold in disconnected pool until all refs are released
+            pnode->Release();
+            vNodesDisconnected.push_back(pnode);
         }
-        {
-            // Delete disconnected nodes
-            std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
+    }
+
+    // Delete disconnected nodes
+    std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+    BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
+    {
+        // wait until threads are done using it
+        if (pnode->GetRefCount() <= 0) {
+            bool fDelete = false;
             {
-                // wait until threads are done using it
-                if (pnode->GetRefCount() <= 0) {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pnode->cs_inventory, lockInv);
-                        if (lockInv) {
-                            TRY_LOCK(pnode->cs_vSend, lockSend);
-                            if (lockSend) {
-                                fDelete = true;
-                            }
-                        }
-                    }
-                    if (fDelete) {
-                        vNodesDisconnected.remove(pnode);
-                        DeleteNode(pnode);
+                TRY_LOCK(pnode->cs_inventory, lockInv);
+                if (lockInv) {
+                    TRY_LOCK(pnode->cs_vSend, lockSend);
+                    if (lockSend) {
+                        fDelete = true;
                     }
                 }
             }
+            if (fDelete) {
+                vNodesDisconnected.remove(pnode);
+                DeleteNode(pnode);
+            }
         }
-        size_t vNodesSize;
+    }
+}
+
+void CConnman::NotifyNumConnectionsChanged()
+{
+    size_t vNodesSize;
+    {
+        LOCK(cs_vNodes);
+        vNodesSize = vNodes.size();
+    }
+    if(vNodesSize != nPrevNodeCount) {
+        nPrevNodeCount = vNodesSize;
+        if(clientInterface)
+            clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+    }
+}
+
+void CConnman::InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
         {
-            LOCK(cs_vNodes);
-            vNodesSize = vNodes.size();
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
         }
-        if(vNodesSize != nPrevNodeCount) {
-            nPrevNodeCount = vNodesSize;
-            if(clientInterface)
-                clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
         }
+        else if (!pnode->fSuccessfullyConnected)
+        {
+            LogPrintf("version handshake timeout from %d\n", pnode->id);
+            pnode->fDisconnect = true;
+        }
+    }
+}
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll)
+{
+    switch (socketEventsMode) {
+#ifdef HAVE_EPOLL
+    case SOCKETEVENTS_EPOLL:
+        SocketEventsEpoll(recv_set, send_set, error_set, fOnlyPoll);
+        break;
+#endif
+    case SOCKETEVENTS_SELECT:
+        SocketEventsSelect(recv_set, send_set, error_set, fOnlyPoll);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+#ifdef HAVE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll)
+{
+    // Peer sockets are registered edge-triggered when they are added, so this only returns sockets whose state changed.
+    // Sockets with buffered data left over from earlier rounds are tracked through mapReceivableNodes and
+    // mapNodesWithDataToSend instead of being re-registered on each iteration.
+    const size_t maxEvents = 64;
+    epoll_event events[maxEvents];
+
+    wakeupSelectNeeded = true;
+    int nEvents = epoll_wait(epollfd, events, maxEvents, fOnlyPoll ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const epoll_event& e = events[i];
+        if (e.events & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(e.data.fd);
+            continue;
+        }
+        if (e.events & (EPOLLIN | EPOLLRDHUP)) {
+            recv_set.insert(e.data.fd);
+        }
+        if (e.events & EPOLLOUT) {
+            send_set.insert(e.data.fd);
+        }
+    }
+}
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
 
 #ifndef WIN32
-        // We add a pipe to the read set so that the select() call can be woken up from the outside
-        // This is done when data is available for sending and at the same time optimistic sending was disabled
-        // when pushing the data.
-        // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
-        // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
-        // run on Linux and friends.
-        FD_SET(wakeupPipe[0], &fdsetRecv);
-        hSocketMax = std::max(hSocketMax, (SOCKET)wakeupPipe[0]);
-        have_fds = true;
+    // We add a pipe to the read set so that the select() call can be woken up from the outside
+    // This is done when data is available for sending and at the same time optimistic sending was disabled
+    // when pushing the data.
+    // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
+    // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
+    // run on Linux and friends.
+    if (wakeupPipe[0] != -1)
+        recv_select_set.insert(wakeupPipe[0]);
 #endif
 
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        recv_select_set.insert(hListenSocket.socket);
+    }
 
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
             {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
 
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+            error_select_set.insert(pnode->hSocket);
+            if (select_send) {
+                send_select_set.insert(pnode->hSocket);
+                continue;
+            }
+            if (select_recv) {
+                recv_select_set.insert(pnode->hSocket);
             }
         }
+    }
 
-        wakeupSelectNeeded = true;
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        wakeupSelectNeeded = false;
-        if (interruptNet)
-            return;
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = fOnlyPoll ? 0 : SELECT_TIMEOUT_MILLISECONDS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+
+    for (SOCKET hSocket : recv_select_set) {
+        FD_SET(hSocket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+    for (SOCKET hSocket : send_select_set) {
+        FD_SET(hSocket, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+    for (SOCKET hSocket : error_select_set) {
+        FD_SET(hSocket, &fdsetError);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+    bool have_fds = !recv_select_set.empty() || !send_select_set.empty() || !error_select_set.empty();
+
+    wakeupSelectNeeded = true;
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
 
-        if (nSelect == SOCKET_ERROR)
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (SOCKET hSocket : recv_select_set)
+                FD_SET(hSocket, &fdsetRecv);
         }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS)))
+            return;
+    }
 
-#ifndef WIN32
-        // drain the wakeup pipe
-        if (FD_ISSET(wakeupPipe[0], &fdsetRecv)) 
-		{
-			if (fDebugSpam)
-				LogPrint("net", "woke up select()\n");
-            char buf[128];
-            while (true) {
-                int r = read(wakeupPipe[0], buf, sizeof(buf));
-                if (r <= 0) {
+    for (SOCKET hSocket : recv_select_set) {
+        if (FD_ISSET(hSocket, &fdsetRecv))
+            recv_set.insert(hSocket);
+    }
+    for (SOCKET hSocket : send_select_set) {
+        if (FD_ISSET(hSocket, &fdsetSend))
+            send_set.insert(hSocket);
+    }
+    for (SOCKET hSocket : error_select_set) {
+        if (FD_ISSET(hSocket, &fdsetError))
+            error_set.insert(hSocket);
+    }
+}
+
+void CConnman::SocketHandler()
+{
+    // Don't block waiting for events if a receivable socket still has unread data from an earlier round or a writable
+    // socket has data queued, edge-triggered backends won't report these sockets again.
+    bool fOnlyPoll = false;
+    {
+        LOCK(cs_mapNodesWithDataToSend);
+        for (const auto& p : mapReceivableNodes) {
+            if (!p.second->fPauseRecv && !mapNodesWithDataToSend.count(p.first)) {
+                fOnlyPoll = true;
+                break;
+            }
+        }
+        if (!fOnlyPoll) {
+            for (const auto& p : mapNodesWithDataToSend) {
+                if (p.second->fCanSendData) {
+                    fOnlyPoll = true;
                     break;
                 }
             }
         }
+    }
+
+    std::set<SOCKET> recv_set, send_set, error_set;
+    SocketEvents(recv_set, send_set, error_set, fOnlyPoll);
+    if (interruptNet)
+        return;
+
+#ifndef WIN32
+    if (wakeupPipe[0] != -1 && recv_set.count(wakeupPipe[0]))
+        DrainWakeup();
 #endif
 
-        //
-        // Accept new connections
-        //
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+    //
+    // Accept new connections
+    //
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+    {
+        if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket))
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
-            }
+            AcceptConnection(hListenSocket);
         }
+    }
 
-        //
-        // Service each socket
-        //
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
-        {
-            if (interruptNet)
-                return;
+    std::vector<CNode*> vErrorNodes;
+    std::vector<CNode*> vReceivableNodes;
+    std::vector<CNode*> vSendableNodes;
+    {
+        LOCK(cs_mapSocketToNode);
+        for (SOCKET hSocket : error_set) {
+            auto it = mapSocketToNode.find(hSocket);
+            if (it == mapSocketToNode.end())
+                continue;
+            it->second->AddRef();
+            vErrorNodes.push_back(it->second);
+        }
+        for (SOCKET hSocket : recv_set) {
+            if (error_set.count(hSocket))
+                continue;
+            auto it = mapSocketToNode.find(hSocket);
+            if (it == mapSocketToNode.end())
+                continue;
+            it->second->fHasRecvData = true;
+            mapReceivableNodes.emplace(it->second->GetId(), it->second);
+        }
+        for (SOCKET hSocket : send_set) {
+            auto it = mapSocketToNode.find(hSocket);
+            if (it == mapSocketToNode.end())
+                continue;
+            it->second->fCanSendData = true;
+        }
+    }
 
-            //
-            // Receive
-            //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+    {
+        LOCK(cs_mapNodesWithDataToSend);
+
+        // Collect nodes to receive from, forgetting the ones which reported EWOULDBLOCK in the last round.
+        // Nodes with queued data are skipped to first drain their write buffer, see SocketEventsSelect.
+        for (auto it = mapReceivableNodes.begin(); it != mapReceivableNodes.end(); ) {
+            CNode* pnode = it->second;
+            if (!pnode->fHasRecvData) {
+                it = mapReceivableNodes.erase(it);
+                continue;
             }
-            if (recvSet || errorSet)
-            {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = 0;
-                        {
-                            LOCK(pnode->cs_hSocket);
-                            if (pnode->hSocket == INVALID_SOCKET)
-                                continue;
-                            nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        }
-                        if (nBytes > 0)
-                        {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-							{
-                                if (fDebugSpam)
-									LogPrint("net", "socket closed\n");
-							}
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-								{
-                                    if (fDebugSpam)
-										LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-								}
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+            if (!pnode->fPauseRecv && !pnode->fDisconnect && !mapNodesWithDataToSend.count(it->first)) {
+                pnode->AddRef();
+                vReceivableNodes.push_back(pnode);
             }
+            ++it;
+        }
 
-            //
-            // Send
-            //
-            if (sendSet)
+        // Collect nodes to send to, forgetting the ones which have no more data queued
+        for (auto it = mapNodesWithDataToSend.begin(); it != mapNodesWithDataToSend.end(); ) {
+            CNode* pnode = it->second;
+            bool fHasData;
             {
                 LOCK(pnode->cs_vSend);
-                size_t nBytes = SocketSendData(pnode);
-                if (nBytes) {
-                    RecordBytesSent(nBytes);
-                }
+                fHasData = !pnode->vSendMsg.empty();
+            }
+            if (!fHasData || pnode->fDisconnect) {
+                pnode->Release();
+                it = mapNodesWithDataToSend.erase(it);
+                continue;
+            }
+            if (pnode->fCanSendData) {
+                pnode->AddRef();
+                vSendableNodes.push_back(pnode);
             }
+            ++it;
+        }
+    }
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
+    for (CNode* pnode : vErrorNodes)
+    {
+        if (interruptNet)
+            break;
+        // let recv() return the error and handle it there
+        SocketRecvData(pnode);
+    }
+
+    for (CNode* pnode : vReceivableNodes)
+    {
+        if (interruptNet)
+            break;
+        SocketRecvData(pnode);
+    }
+
+    for (CNode* pnode : vSendableNodes)
+    {
+        if (interruptNet)
+            break;
+        size_t nBytes;
+        {
+            LOCK(pnode->cs_vSend);
+            nBytes = SocketSendData(pnode);
+        }
+        if (nBytes) {
+            RecordBytesSent(nBytes);
+        }
+    }
+
+    ReleaseNodeVector(vErrorNodes);
+    ReleaseNodeVector(vReceivableNodes);
+    ReleaseNodeVector(vSendableNodes);
+}
+
+void CConnman::SocketRecvData(CNode* pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    // When in the middle of a message payload, read straight into the message buffer instead of copying it over
+    char* pchRecv = nullptr;
+    unsigned int nRecvSize = pnode->GetRecvDataBuffer(pchRecv);
+    bool fDirect = nRecvSize != 0;
+    if (!fDirect) {
+        pchRecv = pchBuf;
+        nRecvSize = sizeof(pchBuf);
+    }
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return;
+        nBytes = recv(pnode->hSocket, pchRecv, nRecvSize, MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        // a short read means the socket buffer has been drained, otherwise there may be more to read
+        if (nBytes < (int)nRecvSize)
+            pnode->fHasRecvData = false;
+
+        bool notify = false;
+        bool fOk = fDirect ? pnode->ReceivedMsgData(nBytes, notify) : pnode->ReceiveMsgBytes(pchBuf, nBytes, notify);
+        if (!fOk)
+            pnode->CloseSocketDisconnect(this);
+        RecordBytesRecv(nBytes);
+        if (notify && pnode->QueueCompletedMessages(nReceiveFloodSize)) {
+            WakeMessageHandler();
+        }
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+        {
+            if (fDebugSpam)
+                LogPrint("net", "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect(this);
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr == WSAEWOULDBLOCK)
+        {
+            pnode->fHasRecvData = false;
+        }
+        else if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
             {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
-                }
+                if (fDebugSpam)
+                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
             }
+            pnode->CloseSocketDisconnect(this);
+        }
+    }
+}
+
+void CConnman::ThreadSocketHandler()
+{
+    while (!interruptNet)
+    {
+        DisconnectNodes();
+        NotifyNumConnectionsChanged();
+        SocketHandler();
+
+        // Timeouts have second granularity, no need to walk all nodes on every wakeup
+        int64_t nNow = GetTimeMillis();
+        if (nNow - nLastInactivityCheck >= 1000) {
+            ForEachNode(AllNodes, [this](CNode* pnode) {
+                InactivityCheck(pnode);
+            });
+            nLastInactivityCheck = nNow;
         }
-        ReleaseNodeVector(vNodesCopy);
     }
 }
 
@@ -1538,6 +1877,17 @@ void CConnman::WakeSelect()
 	if (fDebugSpam)
 		LogPrint("net", "waking up select()\n");
 
+#ifdef HAVE_EVENTFD
+    if (fWakeupEventFd) {
+        uint64_t nValue = 1;
+        if (write(wakeupPipe[1], &nValue, sizeof(nValue)) != sizeof(nValue)) {
+            LogPrint("net", "write to wakeup eventfd failed\n");
+        }
+        wakeupSelectNeeded = false;
+        return;
+    }
+#endif
+
     char buf[1];
     if (write(wakeupPipe[1], buf, 1) != 1) {
         LogPrint("net", "write to wakeupPipe failed\n");
@@ -1547,6 +1897,145 @@ void CConnman::WakeSelect()
     wakeupSelectNeeded = false;
 }
 
+bool CConnman::InitWakeup()
+{
+#ifndef WIN32
+#ifdef HAVE_EVENTFD
+    int fd = eventfd(0, EFD_NONBLOCK);
+    if (fd != -1) {
+        wakeupPipe[0] = wakeupPipe[1] = fd;
+        fWakeupEventFd = true;
+        return true;
+    }
+    LogPrint("net", "eventfd() for wakeup failed, falling back to a pipe\n");
+#endif
+    if (pipe(wakeupPipe) != 0) {
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+        LogPrint("net", "pipe() for wakeupPipe failed\n");
+        return false;
+    } else {
+        int fFlags = fcntl(wakeupPipe[0], F_GETFL, 0);
+        if (fcntl(wakeupPipe[0], F_SETFL, fFlags | O_NONBLOCK) == -1) {
+            LogPrint("net", "fcntl for O_NONBLOCK on wakeupPipe failed\n");
+        }
+        fFlags = fcntl(wakeupPipe[1], F_GETFL, 0);
+        if (fcntl(wakeupPipe[1], F_SETFL, fFlags | O_NONBLOCK) == -1) {
+            LogPrint("net", "fcntl for O_NONBLOCK on wakeupPipe failed\n");
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CConnman::DrainWakeup()
+{
+#ifndef WIN32
+	if (fDebugSpam)
+		LogPrint("net", "woke up select()\n");
+
+#ifdef HAVE_EVENTFD
+    if (fWakeupEventFd) {
+        // reading an eventfd resets its counter, no matter how often it was written to
+        uint64_t nValue;
+        if (read(wakeupPipe[0], &nValue, sizeof(nValue)) != sizeof(nValue)) {
+            LogPrint("net", "read from wakeup eventfd failed\n");
+        }
+        return;
+    }
+#endif
+
+    char buf[128];
+    while (true) {
+        int r = read(wakeupPipe[0], buf, sizeof(buf));
+        if (r <= 0) {
+            break;
+        }
+    }
+#endif
+}
+
+void CConnman::CloseWakeup()
+{
+#ifndef WIN32
+    if (fWakeupEventFd) {
+        if (wakeupPipe[0] != -1) close(wakeupPipe[0]);
+    } else {
+        if (wakeupPipe[0] != -1) close(wakeupPipe[0]);
+        if (wakeupPipe[1] != -1) close(wakeupPipe[1]);
+    }
+    wakeupPipe[0] = wakeupPipe[1] = -1;
+    fWakeupEventFd = false;
+#endif
+}
+
+bool CConnman::RegisterEvents(SOCKET hSocket, bool fEdgeTriggered)
+{
+#ifdef HAVE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return true;
+
+    epoll_event e;
+    memset(&e, 0, sizeof(e));
+    // listen sockets and the wakeup fd stay level-triggered, it's simpler to handle them on every round
+    e.events = fEdgeTriggered ? (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET) : EPOLLIN;
+    e.data.fd = hSocket;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &e) != 0) {
+        LogPrintf("epoll_ctl(EPOLL_CTL_ADD) failed for socket %d: %s\n", hSocket, NetworkErrorString(WSAGetLastError()));
+        return false;
+    }
+#endif
+    return true;
+}
+
+void CConnman::UnregisterEvents(SOCKET hSocket)
+{
+#ifdef HAVE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+
+    // Closing the socket would do this implicitly, but only if no other process (e.g. -blocknotify) inherited it
+    if (epoll_ctl(epollfd, EPOLL_CTL_DEL, hSocket, nullptr) != 0) {
+        LogPrint("net", "epoll_ctl(EPOLL_CTL_DEL) failed for socket %d: %s\n", hSocket, NetworkErrorString(WSAGetLastError()));
+    }
+#endif
+}
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet)
+{
+    if (strMode == "select") {
+        modeRet = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef HAVE_EPOLL
+    if (strMode == "epoll") {
+        modeRet = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT: return "select";
+    case SOCKETEVENTS_EPOLL: return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string strModes = "select";
+#ifdef HAVE_EPOLL
+    strModes += ", epoll";
+#endif
+    return strModes;
+}
+
 
 
 
@@ -2209,10 +2698,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fMasternode = true;
 
     GetNodeSignals().InitializeNode(pnode, *this);
-    {
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
-    }
+    AddNode(pnode);
 
     return true;
 }
@@ -2425,7 +2911,7 @@ void CConnman::SetNetworkActive(bool active)
         LOCK(cs_vNodes);
         // Close sockets to all nodes
         BOOST_FOREACH(CNode* pnode, vNodes) {
-            pnode->CloseSocketDisconnect();
+            pnode->CloseSocketDisconnect(this);
         }
     } else {
         fNetworkActive = true;
@@ -2480,6 +2966,8 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    socketEventsMode = connOptions.socketEventsMode;
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2547,21 +3035,27 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         fMsgProcWake = false;
     }
 
-#ifndef WIN32
-    if (pipe(wakeupPipe) != 0) {
-        wakeupPipe[0] = wakeupPipe[1] = -1;
-        LogPrint("net", "pipe() for wakeupPipe failed\n");
-    } else {
-        int fFlags = fcntl(wakeupPipe[0], F_GETFL, 0);
-        if (fcntl(wakeupPipe[0], F_SETFL, fFlags | O_NONBLOCK) == -1) {
-            LogPrint("net", "fcntl for O_NONBLOCK on wakeupPipe failed\n");
-        }
-        fFlags = fcntl(wakeupPipe[1], F_GETFL, 0);
-        if (fcntl(wakeupPipe[1], F_SETFL, fFlags | O_NONBLOCK) == -1) {
-            LogPrint("net", "fcntl for O_NONBLOCK on wakeupPipe failed\n");
+#ifdef HAVE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+            socketEventsMode = SOCKETEVENTS_SELECT;
         }
     }
 #endif
+    LogPrintf("Using %s for socket events\n", GetSocketEventsModeName(socketEventsMode));
+
+    InitWakeup();
+
+#ifdef HAVE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        if (wakeupPipe[0] != -1)
+            RegisterEvents(wakeupPipe[0], false);
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            RegisterEvents(hListenSocket.socket, false);
+    }
+#endif
 
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
@@ -2667,12 +3161,21 @@ void CConnman::Stop()
 
     // Close sockets
     BOOST_FOREACH(CNode* pnode, vNodes)
-        pnode->CloseSocketDisconnect();
+        pnode->CloseSocketDisconnect(this);
     BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket)
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
 
+    // drop the socket handler's bookkeeping, including the references held for queued data
+    mapReceivableNodes.clear();
+    {
+        LOCK(cs_mapNodesWithDataToSend);
+        for (auto& p : mapNodesWithDataToSend)
+            p.second->Release();
+        mapNodesWithDataToSend.clear();
+    }
+
     // clean up some globals (to help leak detection)
     BOOST_FOREACH(CNode *pnode, vNodes) {
         DeleteNode(pnode);
@@ -2690,10 +3193,13 @@ void CConnman::Stop()
     delete semMasternodeOutbound;
     semMasternodeOutbound = NULL;
 
-#ifndef WIN32
-    if (wakeupPipe[0] != -1) close(wakeupPipe[0]);
-    if (wakeupPipe[1] != -1) close(wakeupPipe[1]);
-    wakeupPipe[0] = wakeupPipe[1] = -1;
+    CloseWakeup();
+
+#ifdef HAVE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
 #endif
 }
 
@@ -3171,6 +3677,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
+    fCanSendData = false;
     nProcessQueueSize = 0;
 
     BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes())
@@ -3274,6 +3782,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
     size_t nBytesSent = 0;
+    bool fWake = false;
+    bool fQueued = false;
     {
         LOCK(pnode->cs_vSend);
         bool hasPendingData = !pnode->vSendMsg.empty();
@@ -3293,9 +3803,18 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
         // wake up select() call in case there was no pending data before (so it was not selecting this socket for sending)
-        else if (!hasPendingData && wakeupSelectNeeded)
-            WakeSelect();
-    }
+        else if (!hasPendingData)
+            fWake = true;
+        fQueued = !pnode->vSendMsg.empty();
+    }
+    if (fQueued) {
+        // let the socket handler know, it only looks at nodes with queued data (the reference is released there)
+        LOCK(cs_mapNodesWithDataToSend);
+        if (mapNodesWithDataToSend.emplace(pnode->GetId(), pnode).second)
+            pnode->AddRef();
+    }
+    if (fWake && wakeupSelectNeeded)
+        WakeSelect();
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
 }
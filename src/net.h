@@ -29,6 +29,8 @@
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifndef WIN32
@@ -110,6 +112,22 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Mechanisms the network thread can use to wait for events on peer and listen sockets */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+#ifdef HAVE_EPOLL
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+/** Parse a -socketevents value, returns false if the mode is unknown or unsupported on this platform */
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** Comma separated list of the modes supported on this platform */
+std::string GetSupportedSocketEventsModes();
+
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
@@ -145,6 +163,7 @@ struct CSerializedNetMsg
 
 class CConnman
 {
+friend class CNode;
 public:
 
     enum NumConnections {
@@ -168,6 +187,7 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -425,6 +445,8 @@ public:
     void WakeMessageHandler();
     void WakeSelect();
 
+    SocketEventsMode GetSocketEventsMode() const { return socketEventsMode; }
+
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -438,6 +460,17 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    void AddNode(CNode* pnode);
+    void DisconnectNodes();
+    void NotifyNumConnectionsChanged();
+    void InactivityCheck(CNode* pnode);
+    void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll);
+    void SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll);
+#ifdef HAVE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, bool fOnlyPoll);
+#endif
+    void SocketHandler();
+    void SocketRecvData(CNode* pnode);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
@@ -458,6 +491,12 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+
+    bool InitWakeup();
+    void DrainWakeup();
+    void CloseWakeup();
+    bool RegisterEvents(SOCKET hSocket, bool fEdgeTriggered);
+    void UnregisterEvents(SOCKET hSocket);
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -546,8 +585,30 @@ private:
     /** a pipe which is added to select() calls to wakeup before the timeout */
     int wakeupPipe[2]{-1,-1};
 #endif
+    /** true if both ends of wakeupPipe are the same eventfd instead of a pipe */
+    bool fWakeupEventFd{false};
     std::atomic<bool> wakeupSelectNeeded{false};
 
+    SocketEventsMode socketEventsMode{SOCKETEVENTS_SELECT};
+#ifdef HAVE_EPOLL
+    /** epoll instance, peer sockets are registered (edge-triggered) once for their whole lifetime */
+    int epollfd{-1};
+#endif
+
+    /** maps registered peer sockets back to their nodes, entries are removed when the socket is closed */
+    CCriticalSection cs_mapSocketToNode;
+    std::unordered_map<SOCKET, CNode*> mapSocketToNode;
+
+    /** nodes whose socket reported readable and which did not yet hit EWOULDBLOCK, only touched by the socket handler */
+    std::unordered_map<NodeId, CNode*> mapReceivableNodes;
+
+    /** nodes with a non-empty send queue, each entry holds a reference to the node */
+    CCriticalSection cs_mapNodesWithDataToSend;
+    std::unordered_map<NodeId, CNode*> mapNodesWithDataToSend;
+
+    int64_t nLastInactivityCheck{0};
+    unsigned int nPrevNodeCount{0};
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -667,6 +728,33 @@ public:
 
 
 
+/**
+ * Recycles the payload buffers of processed messages, so that large messages like blocks, sig share batches and
+ * governance syncs don't pay for a fresh allocation (and the zero-after-free on release) every time they are received.
+ */
+class CNetMessageBufferPool
+{
+public:
+    // Smaller payloads are cheap to allocate and are not pooled
+    static const size_t MIN_POOLED_SIZE = 16 * 1024;
+    static const size_t MAX_POOLED_BUFFERS = 32;
+    static const size_t MAX_POOLED_BYTES = 32 * 1024 * 1024;
+
+    CNetMessageBufferPool() : nPooledBytes(0) {}
+
+    //! Hands out the smallest pooled buffer able to hold nSize bytes, returns false if there is none
+    bool Acquire(CSerializeData& vchRet, size_t nSize);
+    //! Takes over the storage of vch if there is room in the pool, vch is left empty
+    void Release(CSerializeData& vch);
+
+    size_t GetPooledBytes() const;
+
+private:
+    mutable CCriticalSection cs;
+    std::vector<CSerializeData> vBuffers;
+    size_t nPooledBytes;
+};
+
 class CNetMessage {
 private:
     mutable CHash256 hasher;
@@ -690,6 +778,7 @@ public:
         nDataPos = 0;
         nTime = 0;
     }
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -708,8 +797,15 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    // Returns the part of the payload buffer which still has to be filled, so it can be written to in place
+    unsigned int GetDataBuffer(char*& pch);
+    // Marks nBytes written into the buffer returned by GetDataBuffer as received
+    void DataReceived(unsigned int nBytes);
 };
 
+typedef std::shared_ptr<CNetMessage> CNetMessageRef;
+
 
 /** Information about a peer */
 class CNode
@@ -729,7 +825,7 @@ public:
     CCriticalSection cs_vRecv;
 
     CCriticalSection cs_vProcessMsg;
-    std::list<CNetMessage> vProcessMsg;
+    std::list<CNetMessageRef> vProcessMsg;
     size_t nProcessQueueSize;
 
     CCriticalSection cs_sendProcessing;
@@ -781,6 +877,11 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+
+    // Set by the socket handler when the socket signalled readability/writability and cleared once a
+    // recv/send would block. Required for edge-triggered events, where readiness is only reported once.
+    std::atomic_bool fHasRecvData;
+    std::atomic_bool fCanSendData;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -865,7 +966,10 @@ private:
     const ServiceFlags nLocalServices;
     const int nMyStartingHeight;
     int nSendVersion;
-    std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+    std::list<CNetMessageRef> vRecvMsg;  // Used only by SocketHandler thread
+
+    bool OnMessageHeader(CNetMessage& msg, int64_t nTimeMicros);
+    void OnMessageComplete(CNetMessage& msg, int64_t nTimeMicros);
 
     mutable CCriticalSection cs_addrName;
     std::string addrName;
@@ -893,6 +997,13 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    // Returns the unfilled payload buffer of the message currently being received, so that the socket can be read
+    // into it directly, or 0 if no message payload is pending. Used only by the SocketHandler thread.
+    unsigned int GetRecvDataBuffer(char*& pch);
+    // Same as ReceiveMsgBytes, for nBytes which were written into the buffer returned by GetRecvDataBuffer
+    bool ReceivedMsgData(unsigned int nBytes, bool& complete);
+    // Moves completed messages to the processing queue, returns true if there were any
+    bool QueueCompletedMessages(size_t nReceiveFloodSize);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -993,7 +1104,7 @@ public:
     void AskFor(const CInv& inv, int64_t doubleRequestDelay = 2 * 60 * 1000000);
     void RemoveAskFor(const uint256& hash);
 
-    void CloseSocketDisconnect();
+    void CloseSocketDisconnect(CConnman* connman);
 
     void copyStats(CNodeStats &stats);
 
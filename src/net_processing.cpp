@@ -1141,8 +1141,15 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
     if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
     {
         std::shared_ptr<const CBlock> pblock;
+        CSerializedNetMsg rawBlockMsg;
         if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
             pblock = a_recent_block;
+        } else if (inv.type == MSG_BLOCK) {
+            // Fast-path: the network format of a block is identical to its format on disk,
+            // so serve the stored bytes directly instead of parsing and reserializing every tx
+            rawBlockMsg.command = NetMsgType::BLOCK;
+            if (!ReadRawBlockFromDisk(rawBlockMsg.data, (*mi).second, Params().MessageStart()))
+                assert(!"cannot load block from disk");
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1151,7 +1158,12 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
             pblock = pblockRead;
         }
         if (inv.type == MSG_BLOCK)
-            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+        {
+            if (pblock)
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            else
+                connman.PushMessage(pfrom, std::move(rawBlockMsg));
+        }
         else if (inv.type == MSG_FILTERED_BLOCK)
         {
             bool sendMerkleBlock = false;
@@ -2703,6 +2715,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
+        // Hash the whole batch up front, outside cs_main.
+        const std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+
         const CBlockIndex *pindexLast = NULL;
         {
         LOCK(cs_main);
@@ -2720,14 +2735,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             nodestate->nUnconnectingHeaders++;
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256()));
             LogPrint("net", "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    hashes[0].ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->id, nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), hashes.back());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 17);
@@ -2735,13 +2750,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+        for (unsigned int n = 1; n < nCount; n++) {
+            if (headers[n].hashPrevBlock != hashes[n - 1]) {
                 Misbehaving(pfrom->GetId(), 21);
                 return error("non-continuous headers sequence");
             }
-            hashLastBlock = header.GetHash();
         }
         }
 
@@ -3200,18 +3213,19 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         if (pfrom->fPauseSend)
             return false;
 
-        std::list<CNetMessage> msgs;
+        CNetMessageRef pmsg;
         {
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
                 return false;
             // Just take one message
-            msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
-            pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            pmsg = std::move(pfrom->vProcessMsg.front());
+            pfrom->vProcessMsg.pop_front();
+            pfrom->nProcessQueueSize -= pmsg->vRecv.size() + CMessageHeader::HEADER_SIZE;
             pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
             fMoreWork = !pfrom->vProcessMsg.empty();
         }
-        CNetMessage& msg(msgs.front());
+        CNetMessage& msg(*pmsg);
 
         msg.SetVersion(pfrom->GetRecvVersion());
         // Scan for message start
@@ -10,6 +10,7 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/x11.h"
 #include "randomx_bbp.h"
 #include <pthread.h>
 
@@ -73,6 +74,21 @@ uint256 CBlockHeader::GetHashBible() const
 
 
 
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    // the same 80 bytes GetHash() serializes, back to back
+    std::vector<unsigned char> vch(80 * headers.size());
+    CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
+    for (const CBlockHeader& header : headers) {
+        ss << header.nVersion << header.hashPrevBlock << header.hashMerkleRoot << header.nTime << header.nBits << header.nNonce;
+    }
+    std::vector<uint256> hashes(headers.size());
+    if (!headers.empty()) {
+        X11Batch(hashes[0].begin(), vch.data(), 80, headers.size());
+    }
+    return hashes;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -134,6 +134,11 @@ public:
 };
 
 
+/** Compute the hashes of many block headers at once, in order. Equivalent to calling GetHash() on each header,
+ *  but the X11 stages run over the whole batch (see X11Batch), which is much faster for a full headers message.
+ */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
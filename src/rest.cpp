@@ -11,6 +11,8 @@
 #include "primitives/transaction.h"
 #include "validation.h"
 #include "httpserver.h"
+#include "rpc/cache.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -61,9 +63,9 @@ struct CCoin {
 };
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern JSONStreamFn blockToJSONStream(const std::shared_ptr<const CBlock>& block, const CBlockIndex* blockindex, bool txDetails);
 extern UniValue mempoolInfoToJSON();
-extern UniValue mempoolToJSON(bool fVerbose = false);
+extern JSONStreamFn mempoolToJSONStream();
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
@@ -216,7 +218,6 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
     CBlockIndex* pblockindex = NULL;
     {
         LOCK(cs_main);
@@ -226,34 +227,40 @@ static bool rest_block(HTTPRequest* req,
         pblockindex = mapBlockIndex[hash];
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
-
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        // The on-disk format is the network format, no need to deserialize the block
+        std::vector<unsigned char> blockData;
+        if (!ReadRawBlockFromDisk(blockData, pblockindex, Params().MessageStart()))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string binaryBlock(blockData.begin(), blockData.end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::vector<unsigned char> blockData;
+        if (!ReadRawBlockFromDisk(blockData, pblockindex, Params().MessageStart()))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string strHex = HexStr(blockData.begin(), blockData.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+        JSONStreamFn fnBlock;
+        {
+            LOCK(cs_main);
+            if (!ReadBlockFromDisk(*block, pblockindex, Params().GetConsensus()))
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+            fnBlock = blockToJSONStream(block, pblockindex, showTxDetails);
+        }
+        StreamJSONReply(req, fnBlock);
         return true;
     }
 
@@ -290,7 +297,7 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
     case RF_JSON: {
         JSONRPCRequest jsonRequest;
         jsonRequest.params = UniValue(UniValue::VARR);
-        UniValue chainInfoObject = getblockchaininfo(jsonRequest);
+        UniValue chainInfoObject = CachedRPCCall("getblockchaininfo", jsonRequest.params, [&] { return getblockchaininfo(jsonRequest); });
         std::string strJSON = chainInfoObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
@@ -413,6 +420,18 @@ static bool rest_getaddressutxos(HTTPRequest* req, const std::string& strURIPart
 	}
     addresses.push_back(std::make_pair(hashBytes, type));
 
+    UniValue cacheParams(UniValue::VARR);
+    cacheParams.push_back(sAddress);
+    std::string strCacheKey;
+    UniValue result(UniValue::VARR);
+    if (prpcResponseCache && prpcResponseCache->Lookup("rest/getaddressutxos", cacheParams, strCacheKey, result))
+    {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteHeader("Access-Control-Allow-Origin", "*");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) 
@@ -424,7 +443,6 @@ static bool rest_getaddressutxos(HTTPRequest* req, const std::string& strURIPart
     }
 
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), height_sort);
-    UniValue result(UniValue::VARR);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) 
 	{
         UniValue output(UniValue::VOBJ);
@@ -443,6 +461,8 @@ static bool rest_getaddressutxos(HTTPRequest* req, const std::string& strURIPart
 		output.push_back(Pair("height", it->second.blockHeight));
 		result.push_back(output);
     }
+    if (!strCacheKey.empty())
+        prpcResponseCache->Insert("rest/getaddressutxos", cacheParams, strCacheKey, result);
 
 	req->WriteHeader("Content-Type", "application/json");
 	req->WriteHeader("Access-Control-Allow-Origin", "*");
@@ -511,11 +531,7 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        std::string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        StreamJSONReply(req, mempoolToJSONStream());
         return true;
     }
     default: {
@@ -6,6 +6,7 @@
 
 #include "amount.h"
 #include "alert.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -44,6 +45,7 @@
 
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 
@@ -131,69 +133,58 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+/** The fields of a block's JSON before (head) and after (tail) its transactions. Requires cs_main. */
+static void blockFieldsToJSON(const CBlock& block, const CBlockIndex* blockindex, UniValue& head, UniValue& tail)
 {
-    UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
+    head.setObject();
+    tail.setObject();
+    head.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.push_back(Pair("confirmations", confirmations));
-    result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
-    result.push_back(Pair("height", blockindex->nHeight));
-    result.push_back(Pair("version", block.nVersion));
-    result.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
-    result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    UniValue txs(UniValue::VARR);
-    for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(*tx, uint256(), objTx);
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
-    result.push_back(Pair("tx", txs));
+    head.push_back(Pair("confirmations", confirmations));
+    head.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
+    head.push_back(Pair("height", blockindex->nHeight));
+    head.push_back(Pair("version", block.nVersion));
+    head.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
+    head.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
     if (!block.vtx[0]->vExtraPayload.empty()) {
         CCbTx cbTx;
         if (GetTxPayload(block.vtx[0]->vExtraPayload, cbTx)) {
             UniValue cbTxObj;
             cbTx.ToJson(cbTxObj);
-            result.push_back(Pair("cbTx", cbTxObj));
+            tail.push_back(Pair("cbTx", cbTxObj));
         }
     }
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-	result.push_back(Pair("hrtime", TimestampToHRDate(block.GetBlockTime())));
-    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
-	result.push_back(Pair("subsidy", block.vtx[0]->vout[0].nValue/COIN));
+    tail.push_back(Pair("time", block.GetBlockTime()));
+    tail.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
+	tail.push_back(Pair("hrtime", TimestampToHRDate(block.GetBlockTime())));
+    tail.push_back(Pair("nonce", (uint64_t)block.nNonce));
+    tail.push_back(Pair("bits", strprintf("%08x", block.nBits)));
+    tail.push_back(Pair("difficulty", GetDifficulty(blockindex)));
+    tail.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
+	tail.push_back(Pair("subsidy", block.vtx[0]->vout[0].nValue/COIN));
 	std::string sCPK;
 	CheckABNSignature(block, sCPK);
 	if (!sCPK.empty())
-		result.push_back(Pair("cpk", sCPK));
+		tail.push_back(Pair("cpk", sCPK));
 
-	result.push_back(Pair("blockversion", GetBlockVersion(block.vtx[0]->vout[0].sTxOutMessage)));
+	tail.push_back(Pair("blockversion", GetBlockVersion(block.vtx[0]->vout[0].sTxOutMessage)));
 	if (block.vtx.size() > 1)
-		result.push_back(Pair("sanctuary_reward", block.vtx[0]->vout[1].nValue/COIN));
+		tail.push_back(Pair("sanctuary_reward", block.vtx[0]->vout[1].nValue/COIN));
 	// Estatero
 	bool bShowPrayers = true;
     if (blockindex->pprev)
 	{
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+        tail.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
 		const Consensus::Params& consensusParams = Params().GetConsensus();
 		std::string sVerses = GetBibleHashVerses(block.GetHash(), block.GetBlockTime(), blockindex->pprev->nTime, blockindex->pprev->nHeight, blockindex->pprev);
 		if (bShowPrayers) 
-			result.push_back(Pair("verses", sVerses));
-		result.push_back(Pair("chaindata", block.vtx[0]->vout[0].sTxOutMessage));
+			tail.push_back(Pair("verses", sVerses));
+		tail.push_back(Pair("chaindata", block.vtx[0]->vout[0].sTxOutMessage));
 		bool fChainLock = llmq::chainLocksHandler->HasChainLock(blockindex->nHeight, blockindex->GetBlockHash());
-		result.push_back(Pair("chainlock", fChainLock));
+		tail.push_back(Pair("chainlock", fChainLock));
 		UniValue objIPFS(UniValue::VOBJ);
 		// BIPFS - R Andrews	
 		BOOST_FOREACH(PAIRTYPE(std::string, IPFSTransaction) item, mapSidechainTransactions)
@@ -207,11 +198,11 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 				objIPFS.push_back(Pair(item.second.TXID, sDesc));
 			}
 		}
-		result.push_back(Pair("bipfs", objIPFS));
+		tail.push_back(Pair("bipfs", objIPFS));
     }
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+        tail.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
 	// Genesis Block only:
 	if (blockindex && blockindex->nHeight==0)
 	{
@@ -221,12 +212,61 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 		GetBookStartEnd("gen", iStart, iEnd);
 		std::string sVerse = GetVerse("gen", 1, 1, iStart - 1, iEnd);
 		boost::trim(sVerse);
-		result.push_back(Pair("verses", sVerse));
+		tail.push_back(Pair("verses", sVerse));
 	}
+}
+
+static UniValue blockTxToJSON(const CTransaction& tx, bool txDetails)
+{
+    if (!txDetails)
+        return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToJSON(tx, uint256(), objTx);
+    return objTx;
+}
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValue result, tail;
+    blockFieldsToJSON(block, blockindex, result, tail);
+    UniValue txs(UniValue::VARR);
+    for(const auto& tx : block.vtx)
+        txs.push_back(blockTxToJSON(*tx, txDetails));
+    result.push_back(Pair("tx", txs));
+    result.pushKVs(tail);
     return result;
 }
 
+/**
+ * Streaming blockToJSON. The block fields are collected right away, with cs_main held, while the transactions are
+ * converted one at a time as they are written, only taking cs_main for each of them.
+ */
+JSONStreamFn blockToJSONStream(const std::shared_ptr<const CBlock>& block, const CBlockIndex* blockindex, bool txDetails)
+{
+    AssertLockHeld(cs_main);
+    UniValue head, tail;
+    blockFieldsToJSON(*block, blockindex, head, tail);
+    return [block, head, tail, txDetails](CJSONStreamWriter& writer) {
+        writer.BeginObject();
+        writer.Fields(head);
+        writer.Key("tx");
+        writer.BeginArray();
+        for (const auto& tx : block->vtx) {
+            if (writer.IsAborted())
+                return;
+            UniValue objTx;
+            {
+                LOCK(cs_main);
+                objTx = blockTxToJSON(*tx, txDetails);
+            }
+            writer.Value(objTx);
+        }
+        writer.EndArray();
+        writer.Fields(tail);
+        writer.EndObject();
+    };
+}
+
 UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -494,6 +534,37 @@ UniValue mempoolToJSON(bool fVerbose = false)
     }
 }
 
+/**
+ * Streaming mempoolToJSON(true). The entries are converted in batches, taking mempool.cs for each batch; entries
+ * which left the mempool in the meantime are skipped.
+ */
+JSONStreamFn mempoolToJSONStream()
+{
+    static const size_t nBatchSize = 100;
+    std::shared_ptr<std::vector<uint256> > vtxid = std::make_shared<std::vector<uint256> >();
+    mempool.queryHashes(*vtxid);
+    return [vtxid](CJSONStreamWriter& writer) {
+        writer.BeginObject();
+        size_t i = 0;
+        while (i < vtxid->size() && !writer.IsAborted()) {
+            UniValue batch(UniValue::VOBJ);
+            {
+                LOCK(mempool.cs);
+                for (size_t nEnd = std::min(vtxid->size(), i + nBatchSize); i < nEnd; i++) {
+                    CTxMemPool::txiter it = mempool.mapTx.find((*vtxid)[i]);
+                    if (it == mempool.mapTx.end())
+                        continue;
+                    UniValue info(UniValue::VOBJ);
+                    entryToJSON(info, *it);
+                    batch.push_back(Pair((*vtxid)[i].ToString(), info));
+                }
+            }
+            writer.Fields(batch);
+        }
+        writer.EndObject();
+    };
+}
+
 UniValue getrawmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -526,6 +597,15 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     return mempoolToJSON(fVerbose);
 }
 
+static JSONStreamFn getrawmempool_stream(const JSONRPCRequest& request)
+{
+    // let getrawmempool report the usage, the list of txids is small enough to build at once
+    if (request.params.size() > 1 || request.params.size() == 0 || !request.params[0].get_bool())
+        return nullptr;
+
+    return mempoolToJSONStream();
+}
+
 UniValue getmempoolancestors(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
@@ -894,6 +974,96 @@ UniValue getblockheaders(const JSONRPCRequest& request)
     return arrHeaders;
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+            "Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=\"basic\") The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\"   (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    uint256 hash(ParseHashV(request.params[0], "blockhash"));
+
+    std::string strFilterType = "basic";
+    if (request.params.size() > 1)
+        strFilterType = request.params[1].get_str();
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(strFilterType, filterType))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+
+    if (!blockFilterIndex || blockFilterIndex->GetFilterType() != filterType)
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + strFilterType);
+
+    const CBlockIndex* pblockindex;
+    {
+        LOCK(cs_main);
+        auto it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = it->second;
+    }
+
+    BlockFilter filter;
+    uint256 filterHeader;
+    if (!blockFilterIndex->LookupFilter(pblockindex, filter) ||
+        !blockFilterIndex->LookupFilterHeader(pblockindex, filterHeader)) {
+        std::string strError = blockFilterIndex->IsSynced() ? "Filter not found." :
+                               "Filter not found. Block filters are still in the process of being indexed.";
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filter", HexStr(filter.GetEncodedFilter())));
+    ret.push_back(Pair("header", filterHeader.GetHex()));
+    return ret;
+}
+
+/** The block (by hash or height) and verbosity of a getblock request. Requires cs_main. */
+static CBlockIndex* ParseGetBlockRequest(const JSONRPCRequest& request, int& verbosity)
+{
+    std::string strHash = request.params[0].get_str();
+    uint256 hash(uint256S(strHash));
+
+    verbosity = 1;
+    if (request.params.size() > 1) {
+        if(request.params[1].isNum())
+            verbosity = request.params[1].get_int();
+        else
+            verbosity = request.params[1].get_bool() ? 1 : 0;
+    }
+	int NUMBER_LENGTH_NON_HASH = 10;
+	if (strHash.length() < NUMBER_LENGTH_NON_HASH && !strHash.empty())
+	{
+		CBlockIndex* bindex = FindBlockByHeight(cdbl(strHash, 0));
+		if (bindex==NULL)
+		    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found by height");
+		hash = bindex->GetBlockHash();
+	}
+   
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+    return pblockindex;
+}
+
 UniValue getblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -944,34 +1114,9 @@ UniValue getblock(const JSONRPCRequest& request)
 
     LOCK(cs_main);
 
-    std::string strHash = request.params[0].get_str();
-    uint256 hash(uint256S(strHash));
-
-    int verbosity = 1;
-    if (request.params.size() > 1) {
-        if(request.params[1].isNum())
-            verbosity = request.params[1].get_int();
-        else
-            verbosity = request.params[1].get_bool() ? 1 : 0;
-    }
-	int NUMBER_LENGTH_NON_HASH = 10;
-	if (strHash.length() < NUMBER_LENGTH_NON_HASH && !strHash.empty())
-	{
-		CBlockIndex* bindex = FindBlockByHeight(cdbl(strHash, 0));
-		if (bindex==NULL)
-		    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found by height");
-		hash = bindex->GetBlockHash();
-	}
-   
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
+    int verbosity;
+    CBlockIndex* pblockindex = ParseGetBlockRequest(request, verbosity);
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
-
     if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
@@ -986,6 +1131,25 @@ UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
+static JSONStreamFn getblock_stream(const JSONRPCRequest& request)
+{
+    // let getblock report the usage
+    if (request.params.size() < 1 || request.params.size() > 2)
+        return nullptr;
+
+    LOCK(cs_main);
+
+    int verbosity;
+    CBlockIndex* pblockindex = ParseGetBlockRequest(request, verbosity);
+    if (verbosity <= 0)
+        return nullptr;
+    std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+    if(!ReadBlockFromDisk(*block, pblockindex, Params().GetConsensus()))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    return blockToJSONStream(block, pblockindex, verbosity >= 2);
+}
+
 struct CCoinsStats
 {
     int nHeight;
@@ -3820,6 +3984,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockhashes",         &getblockhashes,         true,  {"high","low"} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash","filtertype"} },
     { "blockchain",         "getblockheaders",        &getblockheaders,        true,  {"blockhash","count","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {"count","branchlen"} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
@@ -3848,5 +4013,7 @@ void RegisterBlockchainRPCCommands(CRPCTable &t)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+    t.appendStreamingCommand("getblock", &getblock_stream);
+    t.appendStreamingCommand("getrawmempool", &getrawmempool_stream);
 }
 
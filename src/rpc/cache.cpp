@@ -0,0 +1,233 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/cache.h"
+
+#include "chain.h"
+#include "txmempool.h"
+#include "validation.h"
+#include "util.h"
+#include "utiltime.h"
+
+enum
+{
+    RPC_CACHE_MEMPOOL     = (1 << 0),
+    RPC_CACHE_GOVERNANCE  = (1 << 1),
+    RPC_CACHE_MASTERNODES = (1 << 2),
+};
+
+struct CRPCCachePolicy
+{
+    const char* strMethod;
+    //! first parameter the call must have to be cacheable, empty for any
+    const char* strSubCommand;
+    int64_t nTTL;
+    unsigned int nFlags;
+};
+
+static const CRPCCachePolicy rpcCachePolicies[] =
+{ //  method                  subcommand  ttl   also invalidated by
+  //  ----------------------  ----------  ----  ----------------------
+    { "getblockchaininfo",    "",           10,  0 },
+    { "getdifficulty",        "",           60,  0 },
+    { "getmininginfo",        "",           10,  RPC_CACHE_MEMPOOL },
+    { "getmempoolinfo",       "",            5,  RPC_CACHE_MEMPOOL },
+    { "getgovernanceinfo",    "",           60,  RPC_CACHE_GOVERNANCE },
+    { "getsuperblockbudget",  "",          600,  0 },
+    { "gobject",              "count",      30,  RPC_CACHE_GOVERNANCE },
+    { "gobject",              "list",       30,  RPC_CACHE_GOVERNANCE },
+    { "masternode",           "count",      30,  RPC_CACHE_MASTERNODES },
+    { "masternode",           "list",       30,  RPC_CACHE_MASTERNODES },
+    { "masternode",           "winners",    30,  RPC_CACHE_MASTERNODES },
+    { "masternodelist",       "",           30,  RPC_CACHE_MASTERNODES },
+    { "leaderboard",          "",           60,  0 },
+    { "rest/getaddressutxos", "",           30,  0 },
+};
+
+/** Rough per-entry overhead of the list and map nodes and the UniValue tree on top of its serialized size */
+static const size_t CACHE_ENTRY_OVERHEAD = 256;
+
+static const CRPCCachePolicy* GetCachePolicy(const std::string& strMethod, const UniValue& params)
+{
+    for (const CRPCCachePolicy& policy : rpcCachePolicies) {
+        if (strMethod != policy.strMethod)
+            continue;
+        if (!*policy.strSubCommand)
+            return &policy;
+        if (params.isArray() && params.size() > 0 && params[0].isStr() && params[0].get_str() == policy.strSubCommand)
+            return &policy;
+    }
+    return nullptr;
+}
+
+CRPCResponseCache* prpcResponseCache = nullptr;
+
+CRPCResponseCache::CRPCResponseCache(size_t nMaxBytesIn) :
+    nMaxBytes(nMaxBytesIn), nBytes(0), nHits(0), nMisses(0), nEvicted(0)
+{
+}
+
+std::string CRPCResponseCache::MakeKey(const CRPCCachePolicy* policy, const std::string& strMethod, const UniValue& params, unsigned int nMempoolUpdates) const
+{
+    AssertLockHeld(cs);
+    std::string strKey = strMethod + "\n" + params.write() + "\n" + hashTip.ToString();
+    if (policy->nFlags & RPC_CACHE_MEMPOOL)
+        strKey += strprintf("\n%u", nMempoolUpdates);
+    return strKey;
+}
+
+void CRPCResponseCache::Erase(EntryList::iterator it)
+{
+    AssertLockHeld(cs);
+    nBytes -= it->nBytes;
+    mapEntries.erase(it->strKey);
+    listEntries.erase(it);
+}
+
+void CRPCResponseCache::EraseDependent(unsigned int nFlags)
+{
+    LOCK(cs);
+    for (EntryList::iterator it = listEntries.begin(); it != listEntries.end(); ) {
+        if (it->policy->nFlags & nFlags)
+            Erase(it++);
+        else
+            ++it;
+    }
+}
+
+bool CRPCResponseCache::Lookup(const std::string& strMethod, const UniValue& params, std::string& strKeyRet, UniValue& resultRet)
+{
+    strKeyRet.clear();
+    const CRPCCachePolicy* policy = GetCachePolicy(strMethod, params);
+    if (!policy)
+        return false;
+
+    // read outside of cs, SyncTransaction may be signaled with the mempool locked
+    unsigned int nMempoolUpdates = (policy->nFlags & RPC_CACHE_MEMPOOL) ? mempool.GetTransactionsUpdated() : 0;
+
+    LOCK(cs);
+    std::string strKey = MakeKey(policy, strMethod, params, nMempoolUpdates);
+    std::map<std::string, EntryList::iterator>::iterator mi = mapEntries.find(strKey);
+    if (mi != mapEntries.end()) {
+        EntryList::iterator it = mi->second;
+        if (it->nExpires > GetTime()) {
+            listEntries.splice(listEntries.begin(), listEntries, it);
+            resultRet = it->result;
+            nHits++;
+            return true;
+        }
+        Erase(it);
+    }
+    nMisses++;
+    strKeyRet = strKey;
+    return false;
+}
+
+void CRPCResponseCache::Insert(const std::string& strMethod, const UniValue& params, const std::string& strKey, const UniValue& result)
+{
+    const CRPCCachePolicy* policy = GetCachePolicy(strMethod, params);
+    if (!policy)
+        return;
+
+    unsigned int nMempoolUpdates = (policy->nFlags & RPC_CACHE_MEMPOOL) ? mempool.GetTransactionsUpdated() : 0;
+    size_t nEntryBytes = 2 * strKey.size() + result.write().size() + CACHE_ENTRY_OVERHEAD;
+
+    LOCK(cs);
+    // the tip or mempool changed while the call was executed
+    if (strKey != MakeKey(policy, strMethod, params, nMempoolUpdates))
+        return;
+    if (nEntryBytes > nMaxBytes || mapEntries.count(strKey))
+        return;
+
+    while (nBytes + nEntryBytes > nMaxBytes && !listEntries.empty()) {
+        Erase(std::prev(listEntries.end()));
+        nEvicted++;
+    }
+    listEntries.push_front(CacheEntry{strKey, policy, result, GetTime() + policy->nTTL, nEntryBytes});
+    mapEntries.emplace(strKey, listEntries.begin());
+    nBytes += nEntryBytes;
+}
+
+void CRPCResponseCache::Clear()
+{
+    LOCK(cs);
+    listEntries.clear();
+    mapEntries.clear();
+    nBytes = 0;
+}
+
+CRPCResponseCacheStats CRPCResponseCache::GetStats() const
+{
+    LOCK(cs);
+    CRPCResponseCacheStats stats;
+    stats.nEntries = mapEntries.size();
+    stats.nBytes = nBytes;
+    stats.nMaxBytes = nMaxBytes;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvicted = nEvicted;
+    return stats;
+}
+
+void CRPCResponseCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    LOCK(cs);
+    hashTip = pindexNew->GetBlockHash();
+    listEntries.clear();
+    mapEntries.clear();
+    nBytes = 0;
+}
+
+void CRPCResponseCache::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    // transactions in connected blocks are covered by UpdatedBlockTip
+    if (posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK)
+        EraseDependent(RPC_CACHE_MEMPOOL);
+}
+
+void CRPCResponseCache::NotifyGovernanceVote(const CGovernanceVote& vote)
+{
+    EraseDependent(RPC_CACHE_GOVERNANCE);
+}
+
+void CRPCResponseCache::NotifyGovernanceObject(const CGovernanceObject& object)
+{
+    EraseDependent(RPC_CACHE_GOVERNANCE);
+}
+
+void CRPCResponseCache::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+{
+    EraseDependent(RPC_CACHE_MASTERNODES);
+}
+
+void InitRPCResponseCache()
+{
+    int64_t nCacheSize = GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE);
+    if (nCacheSize <= 0)
+        return;
+    LogPrintf("Using %d MiB for the RPC response cache\n", nCacheSize);
+    prpcResponseCache = new CRPCResponseCache(nCacheSize << 20);
+    RegisterValidationInterface(prpcResponseCache);
+}
+
+void StopRPCResponseCache()
+{
+    if (prpcResponseCache) {
+        UnregisterValidationInterface(prpcResponseCache);
+        delete prpcResponseCache;
+        prpcResponseCache = nullptr;
+    }
+}
+
+UniValue CachedRPCCall(const std::string& strMethod, const UniValue& params, const std::function<UniValue()>& fn)
+{
+    std::string strKey;
+    UniValue result;
+    if (prpcResponseCache && prpcResponseCache->Lookup(strMethod, params, strKey, result))
+        return result;
+    result = fn();
+    if (!strKey.empty())
+        prpcResponseCache->Insert(strMethod, params, strKey, result);
+    return result;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_CACHE_H
+#define BITCOIN_RPC_CACHE_H
+
+#include "sync.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include <functional>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#include <univalue.h>
+
+/** Size of the RPC response cache in megabytes, 0 disables it */
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 0;
+
+struct CRPCCachePolicy;
+
+struct CRPCResponseCacheStats
+{
+    size_t nEntries;
+    size_t nBytes;
+    size_t nMaxBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvicted;
+};
+
+/**
+ * Cache for the results of idempotent, read-only RPC calls and REST requests.
+ *
+ * Only the calls listed in the policy table are cached, each with its own time to live. Entries are keyed by
+ * (method, params, tip hash) and, for calls that look at the mempool, the mempool update counter. A tip change
+ * drops all entries; mempool, governance and masternode list notifications drop the entries which depend on them.
+ * The least recently used entries are evicted once the cache holds more than its maximum size.
+ */
+class CRPCResponseCache : public CValidationInterface
+{
+private:
+    struct CacheEntry
+    {
+        std::string strKey;
+        const CRPCCachePolicy* policy;
+        UniValue result;
+        int64_t nExpires;
+        size_t nBytes;
+    };
+    typedef std::list<CacheEntry> EntryList;
+
+    mutable CCriticalSection cs;
+    const size_t nMaxBytes;
+    uint256 hashTip;
+    //! most recently used entries first
+    EntryList listEntries;
+    std::map<std::string, EntryList::iterator> mapEntries;
+    size_t nBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvicted;
+
+    std::string MakeKey(const CRPCCachePolicy* policy, const std::string& strMethod, const UniValue& params, unsigned int nMempoolUpdates) const;
+    void Erase(EntryList::iterator it);
+    void EraseDependent(unsigned int nFlags);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock) override;
+    void NotifyGovernanceVote(const CGovernanceVote& vote) override;
+    void NotifyGovernanceObject(const CGovernanceObject& object) override;
+    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) override;
+
+public:
+    explicit CRPCResponseCache(size_t nMaxBytesIn);
+
+    /**
+     * Look up the result of a call. Returns true on a hit. On a miss strKeyRet is set to the key to Insert() the
+     * result under, or left empty if the call isn't cacheable.
+     */
+    bool Lookup(const std::string& strMethod, const UniValue& params, std::string& strKeyRet, UniValue& resultRet);
+    /** Store the result of a call which missed. It's dropped if the state it depends on changed in the meantime. */
+    void Insert(const std::string& strMethod, const UniValue& params, const std::string& strKey, const UniValue& result);
+    void Clear();
+    CRPCResponseCacheStats GetStats() const;
+};
+
+extern CRPCResponseCache* prpcResponseCache;
+
+/** Create the response cache (-rpccachesize) and subscribe it to validation notifications */
+void InitRPCResponseCache();
+/** Unsubscribe and delete the response cache */
+void StopRPCResponseCache();
+/** Return the cached result of a call or run it, caching the result when the call is cacheable */
+UniValue CachedRPCCall(const std::string& strMethod, const UniValue& params, const std::function<UniValue()>& fn);
+
+#endif // BITCOIN_RPC_CACHE_H
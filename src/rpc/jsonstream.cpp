@@ -0,0 +1,151 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include "httpserver.h"
+#include "netaddress.h"
+#include "rpc/protocol.h"
+#include "util.h"
+
+#include <assert.h>
+
+CJSONStreamWriter::CJSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn), fAfterKey(false), fFlushed(false), fAborted(false)
+{
+    strBuffer.reserve(nChunkSize + nChunkSize / 4);
+}
+
+void CJSONStreamWriter::Separator()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vFirst.empty()) {
+        if (!vFirst.back())
+            strBuffer += ',';
+        vFirst.back() = false;
+    }
+}
+
+void CJSONStreamWriter::MaybeFlush()
+{
+    if (strBuffer.size() >= nChunkSize)
+        Flush();
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    Separator();
+    strBuffer += '{';
+    vFirst.push_back(true);
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    strBuffer += '}';
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    Separator();
+    strBuffer += '[';
+    vFirst.push_back(true);
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    strBuffer += ']';
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::Key(const std::string& strKey)
+{
+    assert(!fAfterKey);
+    Separator();
+    strBuffer += UniValue(strKey).write();
+    strBuffer += ':';
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue& value)
+{
+    Separator();
+    strBuffer += value.write();
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::KeyValue(const std::string& strKey, const UniValue& value)
+{
+    Key(strKey);
+    Value(value);
+}
+
+void CJSONStreamWriter::Fields(const UniValue& obj)
+{
+    const std::vector<std::string>& vKeys = obj.getKeys();
+    const std::vector<UniValue>& vValues = obj.getValues();
+    for (size_t i = 0; i < vKeys.size(); i++) {
+        KeyValue(vKeys[i], vValues[i]);
+    }
+}
+
+bool CJSONStreamWriter::Flush()
+{
+    if (!fAborted && !strBuffer.empty()) {
+        fFlushed = true;
+        if (!sink(strBuffer))
+            fAborted = true;
+    }
+    strBuffer.clear();
+    return !fAborted;
+}
+
+std::string CJSONStreamWriter::TakeBuffer()
+{
+    std::string strRet;
+    strRet.swap(strBuffer);
+    return strRet;
+}
+
+void StreamJSONReply(HTTPRequest* req, const JSONStreamFn& fnWrite)
+{
+    bool fStarted = false;
+    CJSONStreamWriter writer([req, &fStarted](const std::string& strChunk) {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->StartReply(HTTP_OK);
+            fStarted = true;
+        }
+        return req->WriteReplyChunk(strChunk);
+    });
+
+    try {
+        fnWrite(writer);
+    } catch (...) {
+        if (!fStarted)
+            throw;
+        // the status line went out with the first chunk, drop the connection so the
+        // client can't mistake the partial body for a complete reply
+        LogPrintf("%s: Error while streaming the reply to %s, aborting it\n", __func__, req->GetPeer().ToString());
+        req->AbortReply();
+        return;
+    }
+
+    std::string strRest = writer.TakeBuffer() + "\n";
+    if (!fStarted) {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strRest);
+        return;
+    }
+    if (!writer.IsAborted())
+        req->WriteReplyChunk(strRest);
+    req->EndReply();
+}
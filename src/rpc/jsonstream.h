@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+class HTTPRequest;
+
+/** Output is handed to the sink in chunks of about this many bytes */
+static const size_t JSON_STREAM_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Incremental JSON serializer for large responses.
+ *
+ * The structure is written with Begin/End calls while the leaves are written as (small) UniValue trees, so only
+ * one element and one chunk of output need to be in memory at a time. Output is handed to the sink whenever a chunk
+ * fills up. Once the sink fails, e.g. because the client went away, the writer discards all further output; producers
+ * should check IsAborted() in their loops.
+ */
+class CJSONStreamWriter
+{
+public:
+    /** Receives the serialized output, returns false to abort */
+    typedef std::function<bool(const std::string&)> Sink;
+
+    explicit CJSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn = JSON_STREAM_CHUNK_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next object member */
+    void Key(const std::string& strKey);
+    /** Write a value, an object member after Key() or an array element */
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& strKey, const UniValue& value);
+    /** Write all members of obj into the current object */
+    void Fields(const UniValue& obj);
+
+    /** Hand the buffered output to the sink */
+    bool Flush();
+    /** Return the output which wasn't handed to the sink yet */
+    std::string TakeBuffer();
+
+    /** Whether any output went to the sink */
+    bool HasFlushed() const { return fFlushed; }
+    bool IsAborted() const { return fAborted; }
+
+private:
+    Sink sink;
+    size_t nChunkSize;
+    std::string strBuffer;
+    //! per open object or array, whether no element was written yet
+    std::vector<bool> vFirst;
+    bool fAfterKey;
+    bool fFlushed;
+    bool fAborted;
+
+    void Separator();
+    void MaybeFlush();
+};
+
+/** Produces a JSON value into a stream writer */
+typedef std::function<void(CJSONStreamWriter&)> JSONStreamFn;
+
+/**
+ * Send the JSON written by fnWrite as the HTTP_OK reply to req. A reply which fits into one chunk is sent as a
+ * whole, a larger one with chunked transfer encoding while it's produced. Exceptions thrown by fnWrite before the
+ * first chunk went out are passed on so the caller can send an error reply instead; later ones abort the connection.
+ */
+void StreamJSONReply(HTTPRequest* req, const JSONStreamFn& fnWrite);
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
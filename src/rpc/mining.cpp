@@ -21,6 +21,7 @@
 #include "pow.h"
 #include "rpc/server.h"
 #include "spork.h"
+#include "stratum.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -257,6 +258,41 @@ UniValue getmininginfo(const JSONRPCRequest& request)
 }
 
 
+UniValue getstratuminfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getstratuminfo\n"
+            "\nReturns the state of the stratum server (-stratumport)."
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,   (boolean) Whether the stratum server is listening\n"
+            "  \"clients\": n,            (numeric) The number of connected clients\n"
+            "  \"job\": \"xxxx\",           (string) The id of the current job\n"
+            "  \"height\": n,             (numeric) The height the current job builds\n"
+            "  \"jobs\": n,               (numeric) The number of jobs pushed\n"
+            "  \"accepted\": n,           (numeric) The number of accepted shares\n"
+            "  \"rejected\": n,           (numeric) The number of rejected shares\n"
+            "  \"blocks\": n              (numeric) The number of blocks found by stratum clients\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getstratuminfo", "")
+            + HelpExampleRpc("getstratuminfo", "")
+        );
+
+    CStratumStats stats = GetStratumStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("running", stats.fRunning));
+    obj.push_back(Pair("clients", (uint64_t)stats.nSessions));
+    obj.push_back(Pair("job", stats.strJobId));
+    obj.push_back(Pair("height", stats.nJobHeight));
+    obj.push_back(Pair("jobs", stats.nJobs));
+    obj.push_back(Pair("accepted", stats.nSharesAccepted));
+    obj.push_back(Pair("rejected", stats.nSharesRejected));
+    obj.push_back(Pair("blocks", stats.nBlocksFound));
+    return obj;
+}
+
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const JSONRPCRequest& request)
 {
@@ -1004,6 +1040,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       true,  {"nblocks","height"} },
     { "mining",             "getmininginfo",          &getmininginfo,          true,  {"details"} },
+    { "mining",             "getstratuminfo",         &getstratuminfo,         true,  {} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,  {"txid","priority_delta","fee_delta"} },
    	{ "mining",             "getblockforstratum",     &getblockforstratum,     true,  {"hexdata"} },
 	{ "mining",             "getblocktemplate",       &getblocktemplate,       true,  {"template_request"} },
@@ -7,9 +7,11 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "httpserver.h"
 #include "init.h"
 #include "net.h"
 #include "netbase.h"
+#include "rpc/cache.h"
 #include "rpc/server.h"
 #include "timedata.h"
 #include "txmempool.h"
@@ -837,39 +839,9 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
     return result;
 }
 
-UniValue getaddressdeltas(const JSONRPCRequest& request)
+/** The address index entries requested by getaddressdeltas */
+static void GetAddressDeltas(const JSONRPCRequest& request, std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex)
 {
-    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
-        throw std::runtime_error(
-            "getaddressdeltas\n"
-            "\nReturns all changes for an address (requires addressindex to be enabled).\n"
-            "\nArguments:\n"
-            "{\n"
-            "  \"addresses\"\n"
-            "    [\n"
-            "      \"address\"  (string) The base58check encoded address\n"
-            "      ,...\n"
-            "    ]\n"
-            "  \"start\" (number) The start block height\n"
-            "  \"end\" (number) The end block height\n"
-            "}\n"
-            "\nResult:\n"
-            "[\n"
-            "  {\n"
-            "    \"satoshis\"  (number) The difference of duffs\n"
-            "    \"txid\"  (string) The related txid\n"
-            "    \"index\"  (number) The related input or output index\n"
-            "    \"blockindex\"  (number) The related block index\n"
-            "    \"height\"  (number) The block height\n"
-            "    \"address\"  (string) The base58check encoded address\n"
-            "  }\n"
-            "]\n"
-            "\nExamples:\n"
-            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
-            + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
-        );
-
-
     UniValue startValue = find_value(request.params[0].get_obj(), "start");
     UniValue endValue = find_value(request.params[0].get_obj(), "end");
 
@@ -890,8 +862,6 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
             if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
@@ -904,27 +874,93 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         }
     }
 
-    UniValue result(UniValue::VARR);
-
+    // check before any output is streamed
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
         if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
+    }
+}
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        result.push_back(delta);
+static UniValue AddressDeltaToJSON(const std::pair<CAddressIndexKey, CAmount>& entry)
+{
+    std::string address;
+    getAddressFromIndex(entry.first.type, entry.first.hashBytes, address);
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("satoshis", entry.second));
+    delta.push_back(Pair("txid", entry.first.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)entry.first.index));
+    delta.push_back(Pair("blockindex", (int)entry.first.txindex));
+    delta.push_back(Pair("height", entry.first.blockHeight));
+    delta.push_back(Pair("address", address));
+    return delta;
+}
+
+UniValue getaddressdeltas(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
+        throw std::runtime_error(
+            "getaddressdeltas\n"
+            "\nReturns all changes for an address (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"satoshis\"  (number) The difference of duffs\n"
+            "    \"txid\"  (string) The related txid\n"
+            "    \"index\"  (number) The related input or output index\n"
+            "    \"blockindex\"  (number) The related block index\n"
+            "    \"height\"  (number) The block height\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
+        );
+
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    GetAddressDeltas(request, addressIndex);
+
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        result.push_back(AddressDeltaToJSON(*it));
     }
 
     return result;
 }
 
+static JSONStreamFn getaddressdeltas_stream(const JSONRPCRequest& request)
+{
+    // let getaddressdeltas report the usage
+    if (request.params.size() != 1 || !request.params[0].isObject())
+        return nullptr;
+
+    std::shared_ptr<std::vector<std::pair<CAddressIndexKey, CAmount> > > addressIndex = std::make_shared<std::vector<std::pair<CAddressIndexKey, CAmount> > >();
+    GetAddressDeltas(request, *addressIndex);
+    return [addressIndex](CJSONStreamWriter& writer) {
+        writer.BeginArray();
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex->begin(); it!=addressIndex->end(); it++) {
+            if (writer.IsAborted())
+                return;
+            writer.Value(AddressDeltaToJSON(*it));
+        }
+        writer.EndArray();
+    };
+}
+
 UniValue getaddressbalance(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1124,6 +1160,21 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCResponseCacheInfo()
+{
+    CRPCResponseCacheStats stats = {};
+    if (prpcResponseCache)
+        stats = prpcResponseCache->GetStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("entries", (uint64_t)stats.nEntries));
+    obj.push_back(Pair("bytes", (uint64_t)stats.nBytes));
+    obj.push_back(Pair("max_bytes", (uint64_t)stats.nMaxBytes));
+    obj.push_back(Pair("hits", stats.nHits));
+    obj.push_back(Pair("misses", stats.nMisses));
+    obj.push_back(Pair("evicted", stats.nEvicted));
+    return obj;
+}
+
 UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -1142,6 +1193,14 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"rpccache\": {             (json object) Information about the RPC response cache (-rpccachesize)\n"
+            "    \"entries\": xxxxx,       (numeric) Number of cached responses\n"
+            "    \"bytes\": xxxxx,         (numeric) Estimated number of bytes used\n"
+            "    \"max_bytes\": xxxxx,     (numeric) Maximum number of bytes, 0 if the cache is disabled\n"
+            "    \"hits\": xxxxx,          (numeric) Number of calls answered from the cache\n"
+            "    \"misses\": xxxxx,        (numeric) Number of cacheable calls which had to be executed\n"
+            "    \"evicted\": xxxxx,       (numeric) Number of responses evicted to stay within max_bytes\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -1150,6 +1209,51 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+    obj.push_back(Pair("rpccache", RPCResponseCacheInfo()));
+    return obj;
+}
+
+UniValue getrpcqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getrpcqueueinfo\n"
+            "Returns an object with the state of the work queue of every RPC execution class.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"class\": {              (json object) One of fast, normal, heavy and external\n"
+            "    \"threads\": n,         (numeric) Number of worker threads\n"
+            "    \"maxdepth\": n,        (numeric) Maximum number of queued calls (-rpc<class>workqueue)\n"
+            "    \"depth\": n,           (numeric) Number of queued calls\n"
+            "    \"active\": n,          (numeric) Number of calls being executed\n"
+            "    \"executed\": n,        (numeric) Number of calls executed\n"
+            "    \"rejected\": n,        (numeric) Number of calls rejected because the queue was full\n"
+            "    \"avgwait_ms\": x.xxx,  (numeric) Average time a call was queued, in milliseconds\n"
+            "    \"avgexec_ms\": x.xxx,  (numeric) Average execution time, in milliseconds\n"
+            "    \"maxexec_ms\": x.xxx,  (numeric) Longest execution time, in milliseconds\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcqueueinfo", "")
+            + HelpExampleRpc("getrpcqueueinfo", "")
+        );
+
+    std::vector<HTTPWorkQueueStats> vStats = GetHTTPWorkQueueStats();
+    UniValue obj(UniValue::VOBJ);
+    for (size_t i = 0; i < vStats.size(); i++) {
+        const HTTPWorkQueueStats& stats = vStats[i];
+        UniValue queue(UniValue::VOBJ);
+        queue.push_back(Pair("threads", stats.threads));
+        queue.push_back(Pair("maxdepth", (uint64_t)stats.maxDepth));
+        queue.push_back(Pair("depth", (uint64_t)stats.depth));
+        queue.push_back(Pair("active", stats.active));
+        queue.push_back(Pair("executed", stats.executed));
+        queue.push_back(Pair("rejected", stats.rejected));
+        queue.push_back(Pair("avgwait_ms", stats.executed ? 0.001 * stats.waitTimeMicros / stats.executed : 0.0));
+        queue.push_back(Pair("avgexec_ms", stats.executed ? 0.001 * stats.runTimeMicros / stats.executed : 0.0));
+        queue.push_back(Pair("maxexec_ms", 0.001 * stats.maxRunTimeMicros));
+        obj.push_back(Pair(HTTPWorkClassName((HTTPWorkClass)i), queue));
+    }
     return obj;
 }
 
@@ -1172,6 +1276,7 @@ static const CRPCCommand commands[] =
     { "control",            "debug",                  &debug,                  true,  {} },
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getrpcqueueinfo",        &getrpcqueueinfo,        true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -1199,4 +1304,5 @@ void RegisterMiscRPCCommands(CRPCTable &t)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+    t.appendStreamingCommand("getaddressdeltas", &getaddressdeltas_stream);
 }
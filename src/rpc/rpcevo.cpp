@@ -1992,6 +1992,72 @@ UniValue _bls(const JSONRPCRequest& request)
     }
 }
 
+UniValue getmnlistcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            "getmnlistcacheinfo\n"
+            "\nReturns statistics about the deterministic masternode list cache.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": n,             (numeric) Number of lists in the LRU cache\n"
+            "  \"bytes\": n,               (numeric) Estimated memory usage of the LRU cache\n"
+            "  \"maxbytes\": n,            (numeric) Memory limit of the LRU cache (-dmnlistcachesize)\n"
+            "  \"evicted\": n,             (numeric) Number of lists evicted from the LRU cache\n"
+            "  \"snapshots\": n,           (numeric) Number of in-memory snapshots\n"
+            "  \"snapshotinterval\": n,    (numeric) Height interval of the in-memory snapshots (-dmnsnapshotinterval)\n"
+            "  \"lookups\": n,             (numeric) Number of list lookups\n"
+            "  \"histogram\": {            (json object) Number of lookups by the number of diffs which had to be applied\n"
+            "    \"0\": n,                 (numeric) Lookups answered from the LRU cache\n"
+            "    \"1\": n,\n"
+            "    \"2-3\": n,\n"
+            "    ...\n"
+            "  },\n"
+            "  \"memsnapshothits\": n,     (numeric) Lookups which started from an in-memory snapshot\n"
+            "  \"dbsnapshothits\": n,      (numeric) Lookups which started from a snapshot on disk\n"
+            "  \"rangediffsused\": n,      (numeric) Compacted range diffs applied during lookups\n"
+            "  \"rangediffswritten\": n    (numeric) Range diffs written by the background compaction\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmnlistcacheinfo", "")
+            + HelpExampleRpc("getmnlistcacheinfo", "")
+        );
+    }
+
+    CDeterministicMNManager::CacheStats stats;
+    size_t nEntries, nBytes, nMaxBytes, nSnapshots;
+    int nSnapshotInterval;
+    deterministicMNManager->GetCacheStats(stats, nEntries, nBytes, nMaxBytes, nSnapshots, nSnapshotInterval);
+
+    UniValue histogram(UniValue::VOBJ);
+    for (size_t i = 0; i < CDeterministicMNManager::HIT_BUCKETS; i++) {
+        std::string strBucket;
+        if (i <= 1) {
+            strBucket = itostr(i);
+        } else if (i == CDeterministicMNManager::HIT_BUCKETS - 1) {
+            strBucket = strprintf("%d+", 1 << (i - 1));
+        } else {
+            strBucket = strprintf("%d-%d", 1 << (i - 1), (1 << i) - 1);
+        }
+        histogram.push_back(Pair(strBucket, stats.nDiffsApplied[i]));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("entries", (uint64_t)nEntries));
+    ret.push_back(Pair("bytes", (uint64_t)nBytes));
+    ret.push_back(Pair("maxbytes", (uint64_t)nMaxBytes));
+    ret.push_back(Pair("evicted", stats.nEvicted));
+    ret.push_back(Pair("snapshots", (uint64_t)nSnapshots));
+    ret.push_back(Pair("snapshotinterval", nSnapshotInterval));
+    ret.push_back(Pair("lookups", stats.nLookups));
+    ret.push_back(Pair("histogram", histogram));
+    ret.push_back(Pair("memsnapshothits", stats.nMemSnapshotHits));
+    ret.push_back(Pair("dbsnapshothits", stats.nDbSnapshotHits));
+    ret.push_back(Pair("rangediffsused", stats.nRangeDiffsUsed));
+    ret.push_back(Pair("rangediffswritten", stats.nRangeDiffsWritten));
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -2007,6 +2073,7 @@ static const CRPCCommand commands[] =
 	{ "evo",                "getpobhhash",                  &getpobhhash,                   false, {}  },
     { "evo",                "bls",                          &_bls,                          false, {}  },
     { "evo",                "protx",                        &protx,                         false, {}  },
+    { "evo",                "getmnlistcacheinfo",           &getmnlistcacheinfo,            true,  {}  },
 	{ "evo",                "createnonfinancialtransaction",&createnonfinancialtransaction, false, {}  },
 	{ "evo",                "nonfinancialtxtojson",         &nonfinancialtxtojson,          false, {}  },
 	{ "evo",                "faucetcode",                   &faucetcode,                    false, {}  },
@@ -11,6 +11,7 @@
 #include "llmq/quorums_debug.h"
 #include "llmq/quorums_dkgsession.h"
 #include "llmq/quorums_signing.h"
+#include "llmq/quorums_signing_shares.h"
 
 void quorum_list_help()
 {
@@ -189,6 +190,27 @@ UniValue quorum_dkgstatus(const JSONRPCRequest& request)
     return ret;
 }
 
+void quorum_sigsharestats_help()
+{
+    throw std::runtime_error(
+            "quorum sigsharestats\n"
+            "Return statistics about signature shares, per lane (chainlocks, instantsend, other).\n"
+            "Shows the number of pending incoming shares, the latency from receiving a share to its verification\n"
+            "and the latency from the first share of a signing session to the recovered signature.\n"
+    );
+}
+
+UniValue quorum_sigsharestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        quorum_sigsharestats_help();
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    llmq::quorumSigSharesManager->GetLaneStats(ret);
+    return ret;
+}
+
 void quorum_memberof_help()
 {
     throw std::runtime_error(
@@ -386,6 +408,7 @@ UniValue quorum_dkgsimerror(const JSONRPCRequest& request)
             "  info              - Return information about a quorum\n"
             "  dkgsimerror       - Simulates DKG errors and malicious behavior.\n"
             "  dkgstatus         - Return the status of the current DKG process\n"
+            "  sigsharestats     - Return latency statistics of signature shares\n"
             "  memberof          - Checks which quorums the given masternode is a member of\n"
             "  sign              - Threshold-sign a message\n"
             "  hasrecsig         - Test if a valid recovered signature is present\n"
@@ -411,6 +434,8 @@ UniValue quorum(const JSONRPCRequest& request)
         return quorum_info(request);
     } else if (command == "dkgstatus") {
         return quorum_dkgstatus(request);
+    } else if (command == "sigsharestats") {
+        return quorum_sigsharestats(request);
     } else if (command == "memberof") {
         return quorum_memberof(request);
     } else if (command == "sign" || command == "hasrecsig" || command == "getrecsig" || command == "isconflicting") {
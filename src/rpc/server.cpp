@@ -9,6 +9,7 @@
 #include "base58.h"
 #include "init.h"
 #include "random.h"
+#include "rpc/cache.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -361,6 +362,15 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+bool CRPCTable::appendStreamingCommand(const std::string& name, rpcstreamfn_type fn)
+{
+    if (IsRPCRunning() || !mapCommands.count(name) || mapStreamingCommands.count(name))
+        return false;
+
+    mapStreamingCommands[name] = fn;
+    return true;
+}
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
@@ -523,6 +533,12 @@ static inline JSONRPCRequest transformNamedArguments(const JSONRPCRequest& in, c
     return out;
 }
 
+/** Run a command, through the response cache for read-only calls */
+static UniValue ExecuteCommand(const CRPCCommand& cmd, const JSONRPCRequest& request)
+{
+    return CachedRPCCall(request.strMethod, request.params, [&] { return cmd.actor(request); });
+}
+
 UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 {
     // Return immediately if in warmup
@@ -543,9 +559,40 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
     {
         // Execute, convert arguments to array if necessary
         if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
+            return ExecuteCommand(*pcmd, transformNamedArguments(request, pcmd->argNames));
+        } else {
+            return ExecuteCommand(*pcmd, request);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
+
+JSONStreamFn CRPCTable::prepareStreaming(const JSONRPCRequest &request) const
+{
+    std::map<std::string, rpcstreamfn_type>::const_iterator it = mapStreamingCommands.find(request.strMethod);
+    if (it == mapStreamingCommands.end())
+        return nullptr;
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    const CRPCCommand *pcmd = tableRPC[request.strMethod];
+    g_rpcSignals.PreCommand(*pcmd);
+
+    try
+    {
+        // Prepare, convert arguments to array if necessary
+        if (request.params.isObject()) {
+            return it->second(transformNamedArguments(request, pcmd->argNames));
         } else {
-            return pcmd->actor(request);
+            return it->second(request);
         }
     }
     catch (const std::exception& e)
@@ -7,6 +7,7 @@
 #define BITCOIN_RPCSERVER_H
 
 #include "amount.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "uint256.h"
 
@@ -131,6 +132,9 @@ void RPCUnsetTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const JSONRPCRequest& jsonRequest);
+/** Streaming variant of an actor: checks the request and returns the function writing the result, or nullptr to
+ * have the call executed by the regular actor instead */
+typedef JSONStreamFn(*rpcstreamfn_type)(const JSONRPCRequest& jsonRequest);
 
 class CRPCCommand
 {
@@ -149,6 +153,7 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::map<std::string, rpcstreamfn_type> mapStreamingCommands;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -162,6 +167,14 @@ public:
      */
     UniValue execute(const JSONRPCRequest &request) const;
 
+    /**
+     * Prepare a method whose result can be streamed.
+     * @param request The JSONRPCRequest to execute
+     * @returns Function writing the result, or nullptr if the call has to go through execute().
+     * @throws an exception (UniValue) when an error happens, like execute().
+     */
+    JSONStreamFn prepareStreaming(const JSONRPCRequest &request) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -174,6 +187,12 @@ public:
      * Commands cannot be overwritten (returns false).
      */
     bool appendCommand(const std::string& name, const CRPCCommand* pcmd);
+
+    /**
+     * Appends a streaming implementation of an existing command, used by the HTTP
+     * server to send large results without building them in memory first.
+     */
+    bool appendStreamingCommand(const std::string& name, rpcstreamfn_type fn);
 };
 
 extern CRPCTable tableRPC;
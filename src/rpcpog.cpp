@@ -2579,8 +2579,9 @@ CWalletTx CreateAntiBotNetTx(CBlockIndex* pindexLast, double nMinCoinAge, CReser
 		bool fCreated = false;		
 		std::string sDebugInfo;
 		std::string sMiningInfo;
-		CAmount nUsed = 0;
-		double nTargetABNWeight = pwalletMain->GetAntiBotNetWalletWeight(nMinCoinAge, nUsed);
+		// Same query as the dry run above
+		CAmount nUsed = nReqCoins;
+		double nTargetABNWeight = nABNWeight;
 		int nChangePosRet = -1;
 		bool fSubtractFeeFromAmount = true;
 		CAmount nAllocated = nUsed - (0 * COIN);
@@ -3569,10 +3570,8 @@ std::vector<DashStake> GetDashStakes(bool fIncludeMemoryPool)
 
 	if (fIncludeMemoryPool)
 	{
-		BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+		for (const CTransactionRef& tx1 : mempool.getDACBurns())
 		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
 			DashStake w = GetDashStake(tx1);
 			if (w.found && w.nESTAmount > 0 && w.DWU > 0)
 				wStakes.push_back(w);
@@ -3626,14 +3625,11 @@ std::vector<WhaleStake> GetDWS(bool fIncludeMemoryPool)
 
 	if (fIncludeMemoryPool)
 	{
-		BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+		for (const CTransactionRef& tx1 : mempool.getDACBurns())
 		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
 			WhaleStake w = GetWhaleStake(tx1);
 			if (w.found && w.RewardAmount > 0 && w.Amount > 0 && w.ActualDWU > 0)
 				wStakes.push_back(w);
-
 		}
 	}
 	return wStakes;
@@ -4283,17 +4279,14 @@ double GetVinAge(int64_t nVINTime, int64_t nSpendTime, CAmount nAmount)
 double GetWhaleStakesInMemoryPool(std::string sCPK)
 {
 	double nTotal = 0;
-	BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+	// Only the burns of this CPK, or all of them
+	std::vector<CTransactionRef> vBurns = sCPK.empty() ? mempool.getDACBurns() : mempool.getDACBurnsByCPK(sCPK);
+	for (const CTransactionRef& tx1 : vBurns)
     {
-        const CTransaction& tx = e.GetTx();
-		CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
 		WhaleStake w = GetWhaleStake(tx1);
 		if (w.found)
 		{
-			if (sCPK == w.CPK || sCPK.empty())
-			{
-				nTotal += w.TotalOwed;
-			}
+			nTotal += w.TotalOwed;
 		}
 	}
 	return nTotal;
@@ -4305,22 +4298,17 @@ CoinVin GetCoinVIN(COutPoint o, int64_t nTxTime)
 	b.OutPoint = o;
 	b.HashBlock = uint256();
 	// Special case if the transaction is not in a block:
-    BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
-    {
-        const uint256& hash = e.GetTx().GetHash();
-		if (hash == o.hash)
-		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
-			b.TxRef = tx1;
-			b.BlockTime = GetAdjustedTime(); //Memory Pool
-			b.Amount = b.TxRef->vout[b.OutPoint.n].nValue;
-			b.Destination = PubKeyToAddress(b.TxRef->vout[b.OutPoint.n].scriptPubKey);
-			b.CoinAge = GetVinAge(b.BlockTime, nTxTime, b.Amount);
-			b.Found = true;
-			return b;
-		}
-    }
+	CTransactionRef txMempool = mempool.get(o.hash);
+	if (txMempool)
+	{
+		b.TxRef = txMempool;
+		b.BlockTime = GetAdjustedTime(); //Memory Pool
+		b.Amount = b.TxRef->vout[b.OutPoint.n].nValue;
+		b.Destination = PubKeyToAddress(b.TxRef->vout[b.OutPoint.n].scriptPubKey);
+		b.CoinAge = GetVinAge(b.BlockTime, nTxTime, b.Amount);
+		b.Found = true;
+		return b;
+	}
 
 	if (GetTransaction(b.OutPoint.hash, b.TxRef, Params().GetConsensus(), b.HashBlock, true))
 	{
@@ -0,0 +1,793 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "base58.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "miner.h"
+#include "netbase.h"
+#include "primitives/block.h"
+#include "rpcpog.h"
+#include "script/standard.h"
+#include "sync.h"
+#include "timedata.h"
+#include "txmempool.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+/** Maximum length of a request line */
+static const size_t MAX_STRATUM_LINE = 16 * 1024;
+/** Maximum size of a submitted RandomX header */
+static const size_t MAX_STRATUM_RANDOMX_HEADER = 256;
+/** Maximum number of connected clients */
+static const size_t MAX_STRATUM_SESSIONS = 1024;
+/** Maximum number of shares waiting for validation */
+static const size_t MAX_STRATUM_SHARE_QUEUE = 1024;
+/** Number of jobs (of the current tip) shares are accepted for */
+static const size_t MAX_STRATUM_JOBS = 8;
+/** Seconds after which a changed mempool gets a new job, even below -stratummempoolthreshold */
+static const int64_t STRATUM_JOB_MAX_AGE = 60;
+/** Every session gets its own range of this many extra nonces */
+static const unsigned int STRATUM_EXTRANONCE_SIZE = 1 << 16;
+/** CheckBlockHeader rejects blocks more than 15 minutes in the future */
+static const int64_t MAX_STRATUM_FUTURE_TIME = 15 * 60;
+/** Number of RandomX VMs for share validation, each bound to the seed of the sessions using it */
+static const size_t MAX_STRATUM_RANDOMX_SEEDS = 4;
+/** Seconds before a VM no session uses any more may be rebuilt for another seed */
+static const int64_t STRATUM_RANDOMX_SEED_REUSE_TIME = 60;
+/** First RandomX VM used for share validation, separate from the ones of block validation and the internal miner */
+static const int STRATUM_RANDOMX_THREAD = 70;
+
+/** Stratum error codes */
+enum StratumErrorCode
+{
+    STRATUM_ERR_OTHER = 20,
+    STRATUM_ERR_JOB_NOT_FOUND = 21,
+    STRATUM_ERR_DUPLICATE_SHARE = 22,
+    STRATUM_ERR_LOW_DIFFICULTY = 23,
+    STRATUM_ERR_UNAUTHORIZED = 24,
+    STRATUM_ERR_NOT_SUBSCRIBED = 25,
+};
+
+namespace {
+
+/** A job as handed out to the clients, along with what's needed to turn a share into a block. */
+struct StratumJob
+{
+    std::string strId;
+    CBlock block;
+    std::vector<uint256> vCoinbaseMerkleBranch;
+    uint256 hashPrevBlock;
+    int nPrevHeight;
+    int64_t nPrevBlockTime;
+    int64_t nMinTime;
+    arith_uint256 bnBlockTarget;
+    arith_uint256 bnShareTarget;
+};
+typedef std::shared_ptr<StratumJob> StratumJobRef;
+
+class StratumSession
+{
+public:
+    const uint64_t nId;
+    struct bufferevent* const bev;
+    const std::string strPeer;
+    const unsigned int nExtraNonceStart;
+
+    // guarded by cs_stratum
+    bool fSubscribed{false};
+    uint256 uRandomXSeed;
+    int nSeedSlot{-1};
+    CScript scriptPayee;
+
+    StratumSession(uint64_t nIdIn, struct bufferevent* bevIn, const std::string& strPeerIn, unsigned int nExtraNonceStartIn) :
+        nId(nIdIn), bev(bevIn), strPeer(strPeerIn), nExtraNonceStart(nExtraNonceStartIn) {}
+    /** Runs once the last queued share of the session is processed, only then its extra nonces and seed are released */
+    ~StratumSession();
+
+    void Send(const UniValue& message)
+    {
+        std::string strLine = message.write() + "\n";
+        bufferevent_write(bev, strLine.data(), strLine.size());
+    }
+};
+typedef std::shared_ptr<StratumSession> StratumSessionRef;
+
+struct StratumShare
+{
+    StratumSessionRef session;
+    UniValue id;
+    UniValue params;
+};
+
+/** A RandomX VM for share validation, see STRATUM_RANDOMX_THREAD */
+struct StratumSeedSlot
+{
+    bool fUsed{false};
+    uint256 uSeed;
+    size_t nSessions{0};
+    int64_t nReleaseTime{0};
+};
+
+class CStratumNotificationInterface : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+};
+
+} // namespace
+
+//! libevent event loop
+static struct event_base* eventBase = nullptr;
+static std::vector<struct evconnlistener*> vListeners;
+static std::thread threadStratum;
+static std::thread threadStratumWork;
+static CStratumNotificationInterface* pStratumNotificationInterface = nullptr;
+
+static int nShareFactor = DEFAULT_STRATUM_SHARE_FACTOR;
+static unsigned int nMempoolThreshold = DEFAULT_STRATUM_MEMPOOL_THRESHOLD;
+static CScript scriptDefaultPayee;
+
+static CCriticalSection cs_stratum;
+static std::map<uint64_t, StratumSessionRef> mapSessions;
+static uint64_t nLastSessionId = 0;
+//! Extra nonce ranges (in units of STRATUM_EXTRANONCE_SIZE) handed out so far, and the ones of destroyed sessions
+static unsigned int nExtraNonceRanges = 0;
+static std::set<unsigned int> setFreeExtraNonceRanges;
+static StratumSeedSlot seedSlots[MAX_STRATUM_RANDOMX_SEEDS];
+static std::deque<StratumJobRef> vJobs;
+static StratumJobRef currentJob;
+//! Shares submitted on the current tip. The proof of work only depends on the seed, the RandomX header and the
+//! previous block, so a share must not count again for another job of the same tip.
+static std::set<uint256> setTipShares;
+static uint64_t nJobs = 0;
+static uint64_t nSharesAccepted = 0;
+static uint64_t nSharesRejected = 0;
+static uint64_t nBlocksFound = 0;
+
+//! Work for the share validation thread, guarded by cs_work
+static std::mutex cs_work;
+static std::condition_variable condWork;
+static std::deque<StratumShare> queueShares;
+static bool fNewTip = false;
+static bool fInterrupted = false;
+
+/** Bind a session to the VM of its seed, returns -1 if all VMs are in use for other seeds */
+static int AcquireSeedSlot(const uint256& uSeed)
+{
+    AssertLockHeld(cs_stratum);
+    for (size_t i = 0; i < MAX_STRATUM_RANDOMX_SEEDS; i++) {
+        if (seedSlots[i].fUsed && seedSlots[i].uSeed == uSeed) {
+            seedSlots[i].nSessions++;
+            return i;
+        }
+    }
+    // rebuilding a VM stalls share validation, so idle VMs are only rebuilt after a while
+    int nSlot = -1;
+    int64_t nNow = GetTime();
+    for (size_t i = 0; i < MAX_STRATUM_RANDOMX_SEEDS; i++) {
+        const StratumSeedSlot& slot = seedSlots[i];
+        if (slot.nSessions != 0 || (slot.fUsed && slot.nReleaseTime + STRATUM_RANDOMX_SEED_REUSE_TIME > nNow))
+            continue;
+        if (nSlot == -1 || (seedSlots[nSlot].fUsed && (!slot.fUsed || slot.nReleaseTime < seedSlots[nSlot].nReleaseTime)))
+            nSlot = i;
+    }
+    if (nSlot != -1) {
+        seedSlots[nSlot].fUsed = true;
+        seedSlots[nSlot].uSeed = uSeed;
+        seedSlots[nSlot].nSessions = 1;
+    }
+    return nSlot;
+}
+
+static void ReleaseSeedSlot(int nSlot)
+{
+    AssertLockHeld(cs_stratum);
+    if (nSlot < 0)
+        return;
+    if (--seedSlots[nSlot].nSessions == 0)
+        seedSlots[nSlot].nReleaseTime = GetTime();
+}
+
+StratumSession::~StratumSession()
+{
+    bufferevent_free(bev);
+    LOCK(cs_stratum);
+    ReleaseSeedSlot(nSeedSlot);
+    setFreeExtraNonceRanges.insert(nExtraNonceStart / STRATUM_EXTRANONCE_SIZE);
+}
+
+static UniValue StratumResponse(const UniValue& id, const UniValue& result)
+{
+    UniValue response(UniValue::VOBJ);
+    response.push_back(Pair("id", id));
+    response.push_back(Pair("result", result));
+    response.push_back(Pair("error", NullUniValue));
+    return response;
+}
+
+static UniValue StratumError(const UniValue& id, int nCode, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(nCode);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+    UniValue response(UniValue::VOBJ);
+    response.push_back(Pair("id", id));
+    response.push_back(Pair("result", NullUniValue));
+    response.push_back(Pair("error", error));
+    return response;
+}
+
+/** mining.notify for a job, cs_stratum must be held since the seed belongs to the session */
+static UniValue JobNotification(const StratumJob& job, const StratumSession& session, bool fClean)
+{
+    AssertLockHeld(cs_stratum);
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strId);
+    params.push_back(job.hashPrevBlock.GetHex());
+    params.push_back(HexStr(session.uRandomXSeed.begin(), session.uRandomXSeed.end()));
+    params.push_back(job.bnShareTarget.GetHex());
+    params.push_back(job.nPrevHeight + 1);
+    params.push_back(strprintf("%08x", job.block.nBits));
+    params.push_back((int64_t)job.block.nTime);
+    params.push_back(fClean);
+    UniValue notification(UniValue::VOBJ);
+    notification.push_back(Pair("id", NullUniValue));
+    notification.push_back(Pair("method", "mining.notify"));
+    notification.push_back(Pair("params", params));
+    return notification;
+}
+
+/** Build a job from the cached block template and push it to all subscribed clients */
+static void UpdateJob(bool fClean, int64_t nMaxAge)
+{
+    const CChainParams& chainparams = Params();
+    StratumJobRef job = std::make_shared<StratumJob>();
+    const CBlockIndex* pindexPrev;
+    // the coinbase output is replaced by the payee of the share's session
+    if (!blockTemplateCache.GetTemplate(CScript() << OP_TRUE, nMaxAge, job->block, job->vCoinbaseMerkleBranch, pindexPrev)) {
+        LogPrint("stratum", "%s: no block template available\n", __func__);
+        return;
+    }
+    UpdateTime(&job->block, chainparams.GetConsensus(), pindexPrev);
+
+    job->hashPrevBlock = pindexPrev->GetBlockHash();
+    job->nPrevHeight = pindexPrev->nHeight;
+    job->nPrevBlockTime = pindexPrev->GetBlockTime();
+    job->nMinTime = pindexPrev->GetMedianTimePast() + 1;
+    job->bnBlockTarget.SetCompact(job->block.nBits);
+    arith_uint256 bnPowLimit = UintToArith256(chainparams.GetConsensus().powLimit);
+    if (job->bnBlockTarget > bnPowLimit / nShareFactor)
+        job->bnShareTarget = bnPowLimit;
+    else
+        job->bnShareTarget = job->bnBlockTarget * nShareFactor;
+
+    std::vector<std::pair<StratumSessionRef, UniValue> > vNotifications;
+    {
+        LOCK(cs_stratum);
+        if (!fClean && currentJob && currentJob->hashPrevBlock == job->hashPrevBlock &&
+            currentJob->block.hashMerkleRoot == job->block.hashMerkleRoot) {
+            // the template did not change
+            return;
+        }
+        job->strId = strprintf("%x", ++nJobs);
+        if (fClean || (currentJob && currentJob->hashPrevBlock != job->hashPrevBlock)) {
+            fClean = true;
+            vJobs.clear();
+            setTipShares.clear();
+        }
+        if (vJobs.size() >= MAX_STRATUM_JOBS)
+            vJobs.pop_front();
+        vJobs.push_back(job);
+        currentJob = job;
+
+        for (const auto& pair : mapSessions) {
+            if (pair.second->fSubscribed)
+                vNotifications.emplace_back(pair.second, JobNotification(*job, *pair.second, fClean));
+        }
+    }
+
+    LogPrint("stratum", "%s: job %s at height %d with %u txs for %u clients%s\n", __func__, job->strId, job->nPrevHeight + 1,
+             job->block.vtx.size(), vNotifications.size(), fClean ? " (clean)" : "");
+    // not under cs_stratum, the event loop calls into cs_stratum with the bufferevent locked
+    for (auto& notification : vNotifications) {
+        notification.first->Send(notification.second);
+    }
+}
+
+/** Validate a share with the RandomX verifier, and submit the block if it meets the block target */
+static void ProcessShare(const StratumShare& share)
+{
+    const CChainParams& chainparams = Params();
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+    const UniValue& params = share.params;
+
+    std::string strRejectReason;
+    int nCode = STRATUM_ERR_OTHER;
+    bool fBlock = false;
+
+    StratumJobRef job;
+    uint256 uRandomXSeed;
+    int nRandomXThread = STRATUM_RANDOMX_THREAD;
+    CScript scriptPayee;
+    std::vector<unsigned char> vRandomXHeader;
+    int64_t nExtraNonce = 0;
+    int64_t nTime = 0;
+
+    if (!params.isArray() || params.size() < 4 || !params[0].isStr() || !params[1].isNum() || !params[2].isStr() || !params[3].isNum()) {
+        strRejectReason = "invalid-parameters";
+    } else if (!IsHex(params[2].get_str()) || params[2].get_str().size() > 2 * MAX_STRATUM_RANDOMX_HEADER) {
+        strRejectReason = "invalid-randomx-header";
+    } else {
+        vRandomXHeader = ParseHex(params[2].get_str());
+        nExtraNonce = params[1].get_int64();
+        nTime = params[3].get_int64();
+
+        LOCK(cs_stratum);
+        auto it = std::find_if(vJobs.begin(), vJobs.end(), [&params](const StratumJobRef& j) { return j->strId == params[0].get_str(); });
+        if (it == vJobs.end()) {
+            nCode = STRATUM_ERR_JOB_NOT_FOUND;
+            strRejectReason = "job-not-found";
+        } else if (share.session->scriptPayee.empty()) {
+            nCode = STRATUM_ERR_UNAUTHORIZED;
+            strRejectReason = "unauthorized";
+        } else {
+            job = *it;
+            uRandomXSeed = share.session->uRandomXSeed;
+            nRandomXThread = STRATUM_RANDOMX_THREAD + share.session->nSeedSlot;
+            scriptPayee = share.session->scriptPayee;
+        }
+    }
+
+    if (strRejectReason.empty()) {
+        if (nExtraNonce < share.session->nExtraNonceStart || nExtraNonce >= (int64_t)share.session->nExtraNonceStart + STRATUM_EXTRANONCE_SIZE) {
+            strRejectReason = "extranonce-out-of-range";
+        } else if (nTime < job->nMinTime || nTime > GetAdjustedTime() + MAX_STRATUM_FUTURE_TIME) {
+            strRejectReason = "ntime-out-of-range";
+        } else if (job->nPrevHeight < consensusParams.RANDOMX_HEIGHT) {
+            strRejectReason = "randomx-inactive";
+        } else {
+            LOCK(cs_stratum);
+            if (job->hashPrevBlock != currentJob->hashPrevBlock) {
+                // a clean job was pushed since the job was looked up
+                nCode = STRATUM_ERR_JOB_NOT_FOUND;
+                strRejectReason = "job-not-found";
+            } else if (!setTipShares.insert((CHashWriter(SER_GETHASH, 0) << uRandomXSeed << vRandomXHeader).GetHash()).second) {
+                nCode = STRATUM_ERR_DUPLICATE_SHARE;
+                strRejectReason = "duplicate-share";
+            }
+        }
+    }
+
+    if (strRejectReason.empty()) {
+        // the same proof of work CheckProofOfWork checks for the block, against the share target
+        std::string strRandomXData = "<rxheader>" + HexStr(vRandomXHeader.begin(), vRandomXHeader.end()) + "</rxheader>";
+        uint256 rxhash = job->nPrevHeight <= consensusParams.POOM_PHASEOUT_HEIGHT
+            ? GetRandomXHash(strRandomXData, uRandomXSeed, job->hashPrevBlock, nRandomXThread)
+            : GetRandomXHash2(strRandomXData, uRandomXSeed, job->hashPrevBlock, nRandomXThread);
+        arith_uint256 bnHash = UintToArith256(ComputeRandomXTarget(rxhash, job->nPrevBlockTime, nTime));
+        if (bnHash > job->bnShareTarget) {
+            nCode = STRATUM_ERR_LOW_DIFFICULTY;
+            strRejectReason = "low-difficulty-share";
+        } else if (bnHash <= job->bnBlockTarget) {
+            CBlock block;
+            CreateWorkFromTemplate(job->block, job->vCoinbaseMerkleBranch, job->nPrevHeight + 1, scriptPayee, true,
+                                   uRandomXSeed, vRandomXHeader, (unsigned int)nExtraNonce, block);
+            block.nTime = nTime;
+            std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
+            fBlock = ProcessNewBlock(chainparams, shared_pblock, true, nullptr);
+            LogPrintf("stratum: block %s at height %d from %s %s\n", block.GetHash().ToString(), job->nPrevHeight + 1,
+                      share.session->strPeer, fBlock ? "accepted" : "rejected");
+        }
+    }
+
+    {
+        LOCK(cs_stratum);
+        if (strRejectReason.empty())
+            nSharesAccepted++;
+        else
+            nSharesRejected++;
+        if (fBlock)
+            nBlocksFound++;
+    }
+    if (!strRejectReason.empty()) {
+        LogPrint("stratum", "%s: share from %s rejected: %s\n", __func__, share.session->strPeer, strRejectReason);
+        share.session->Send(StratumError(share.id, nCode, strRejectReason));
+        return;
+    }
+    share.session->Send(StratumResponse(share.id, true));
+}
+
+/** Share validation and job updates, off the event loop since RandomX hashing and block creation are slow */
+static void ThreadStratumWork()
+{
+    RenameThread("dac-stratum");
+    unsigned int nJobTransactionsUpdated = mempool.GetTransactionsUpdated();
+    int64_t nJobTime = 0;
+    bool fFirstJob = true;
+
+    while (true) {
+        std::deque<StratumShare> shares;
+        bool fTip;
+        {
+            std::unique_lock<std::mutex> lock(cs_work);
+            condWork.wait_for(lock, std::chrono::seconds(1), [] { return fInterrupted || fNewTip || !queueShares.empty(); });
+            if (fInterrupted)
+                break;
+            fTip = fNewTip || fFirstJob;
+            fNewTip = false;
+            fFirstJob = false;
+            shares.swap(queueShares);
+        }
+
+        unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+        unsigned int nUpdates = nTransactionsUpdated - nJobTransactionsUpdated;
+        if (fTip || nUpdates >= nMempoolThreshold || (nUpdates > 0 && GetTime() - nJobTime >= STRATUM_JOB_MAX_AGE)) {
+            UpdateJob(fTip, fTip ? DEFAULT_TEMPLATE_MAX_AGE : 0);
+            nJobTransactionsUpdated = nTransactionsUpdated;
+            nJobTime = GetTime();
+        }
+
+        for (const StratumShare& share : shares) {
+            ProcessShare(share);
+        }
+    }
+}
+
+void CStratumNotificationInterface::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload)
+        return;
+    std::unique_lock<std::mutex> lock(cs_work);
+    fNewTip = true;
+    condWork.notify_one();
+}
+
+static StratumSessionRef FindSession(uint64_t nId)
+{
+    LOCK(cs_stratum);
+    auto it = mapSessions.find(nId);
+    return it == mapSessions.end() ? nullptr : it->second;
+}
+
+static void CloseSession(uint64_t nId)
+{
+    StratumSessionRef session;
+    {
+        LOCK(cs_stratum);
+        auto it = mapSessions.find(nId);
+        if (it == mapSessions.end())
+            return;
+        session = it->second;
+        mapSessions.erase(it);
+    }
+    LogPrint("stratum", "%s: client %s disconnected\n", __func__, session->strPeer);
+    bufferevent_disable(session->bev, EV_READ | EV_WRITE);
+}
+
+/** Handle one request; returns false if the client should be disconnected */
+static bool HandleRequest(const StratumSessionRef& session, const std::string& strLine)
+{
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject())
+        return false;
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr())
+        return false;
+    const std::string& strMethod = method.get_str();
+
+    if (strMethod == "mining.subscribe") {
+        uint256 uRandomXSeed = uint256S("0x01"); // the seed the internal miner uses
+        if (params.isArray() && params.size() > 1 && params[1].isStr() && !params[1].get_str().empty()) {
+            const std::string& strSeed = params[1].get_str();
+            if (strSeed.size() != 64 || !IsHex(strSeed)) {
+                session->Send(StratumError(id, STRATUM_ERR_OTHER, "invalid-randomx-seed"));
+                return true;
+            }
+            uRandomXSeed = uint256(ParseHex(strSeed));
+        }
+
+        LOCK(cs_stratum);
+        if (!session->fSubscribed || session->uRandomXSeed != uRandomXSeed) {
+            int nSeedSlot = AcquireSeedSlot(uRandomXSeed);
+            if (nSeedSlot == -1) {
+                session->Send(StratumError(id, STRATUM_ERR_OTHER, "too-many-randomx-seeds"));
+                return true;
+            }
+            ReleaseSeedSlot(session->nSeedSlot);
+            session->nSeedSlot = nSeedSlot;
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("session", strprintf("%016x", session->nId)));
+        result.push_back(Pair("extranonce_start", (int64_t)session->nExtraNonceStart));
+        result.push_back(Pair("extranonce_size", (int64_t)STRATUM_EXTRANONCE_SIZE));
+        session->Send(StratumResponse(id, result));
+
+        session->fSubscribed = true;
+        session->uRandomXSeed = uRandomXSeed;
+        if (currentJob)
+            session->Send(JobNotification(*currentJob, *session, true));
+        return true;
+    }
+
+    if (strMethod == "mining.authorize") {
+        // the user name is the payout address, optionally followed by .<worker>
+        std::string strUser = params.isArray() && params.size() > 0 && params[0].isStr() ? params[0].get_str() : "";
+        CBitcoinAddress address(strUser.substr(0, strUser.find('.')));
+        CScript scriptPayee = address.IsValid() ? GetScriptForDestination(address.Get()) : scriptDefaultPayee;
+        if (scriptPayee.empty()) {
+            session->Send(StratumError(id, STRATUM_ERR_UNAUTHORIZED, "invalid-address"));
+            return true;
+        }
+        {
+            LOCK(cs_stratum);
+            session->scriptPayee = scriptPayee;
+        }
+        session->Send(StratumResponse(id, true));
+        return true;
+    }
+
+    if (strMethod == "mining.submit") {
+        {
+            LOCK(cs_stratum);
+            if (!session->fSubscribed) {
+                session->Send(StratumError(id, STRATUM_ERR_NOT_SUBSCRIBED, "not-subscribed"));
+                return true;
+            }
+        }
+        std::unique_lock<std::mutex> lock(cs_work);
+        if (queueShares.size() >= MAX_STRATUM_SHARE_QUEUE) {
+            session->Send(StratumError(id, STRATUM_ERR_OTHER, "busy"));
+            return true;
+        }
+        queueShares.push_back(StratumShare{session, id, params});
+        condWork.notify_one();
+        return true;
+    }
+
+    session->Send(StratumError(id, STRATUM_ERR_OTHER, "unknown-method"));
+    return true;
+}
+
+static void stratum_read_cb(struct bufferevent* bev, void* ctx)
+{
+    uint64_t nId = (uint64_t)(uintptr_t)ctx;
+    StratumSessionRef session = FindSession(nId);
+    if (!session)
+        return;
+
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t nLength;
+    while (char* line = evbuffer_readln(input, &nLength, EVBUFFER_EOL_CRLF)) {
+        std::string strLine(line, nLength);
+        free(line);
+        if (strLine.empty())
+            continue;
+        if (!HandleRequest(session, strLine)) {
+            LogPrint("stratum", "%s: malformed request from %s\n", __func__, session->strPeer);
+            CloseSession(nId);
+            return;
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE) {
+        LogPrint("stratum", "%s: oversized request from %s\n", __func__, session->strPeer);
+        CloseSession(nId);
+    }
+}
+
+static void stratum_event_cb(struct bufferevent* bev, short what, void* ctx)
+{
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        CloseSession((uint64_t)(uintptr_t)ctx);
+}
+
+static void stratum_accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* address, int socklen, void* ctx)
+{
+    CService peer;
+    peer.SetSockAddr(address);
+
+    LOCK(cs_stratum);
+    if (mapSessions.size() >= MAX_STRATUM_SESSIONS) {
+        LogPrint("stratum", "%s: too many clients, rejecting %s\n", __func__, peer.ToString());
+        evutil_closesocket(fd);
+        return;
+    }
+    // ranges of closed sessions are reused, the extra nonce must fit into 32 bits
+    unsigned int nExtraNonceRange;
+    if (!setFreeExtraNonceRanges.empty()) {
+        nExtraNonceRange = *setFreeExtraNonceRanges.begin();
+    } else if (nExtraNonceRanges < std::numeric_limits<unsigned int>::max() / STRATUM_EXTRANONCE_SIZE) {
+        nExtraNonceRange = nExtraNonceRanges;
+    } else {
+        LogPrint("stratum", "%s: no extra nonces left, rejecting %s\n", __func__, peer.ToString());
+        evutil_closesocket(fd);
+        return;
+    }
+    struct bufferevent* bev = bufferevent_socket_new(eventBase, fd, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    if (nExtraNonceRange == nExtraNonceRanges)
+        nExtraNonceRanges++;
+    else
+        setFreeExtraNonceRanges.erase(nExtraNonceRange);
+    uint64_t nId = ++nLastSessionId;
+    mapSessions.emplace(nId, std::make_shared<StratumSession>(nId, bev, peer.ToString(), nExtraNonceRange * STRATUM_EXTRANONCE_SIZE));
+    bufferevent_setcb(bev, stratum_read_cb, nullptr, stratum_event_cb, (void*)(uintptr_t)nId);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint("stratum", "%s: client %s connected\n", __func__, peer.ToString());
+}
+
+bool InitStratumServer()
+{
+    int nPort = GetArg("-stratumport", DEFAULT_STRATUM_PORT);
+    if (nPort <= 0)
+        return true;
+
+    nShareFactor = std::max((int)GetArg("-stratumsharefactor", DEFAULT_STRATUM_SHARE_FACTOR), 1);
+    nMempoolThreshold = std::max((int)GetArg("-stratummempoolthreshold", DEFAULT_STRATUM_MEMPOOL_THRESHOLD), 1);
+    if (IsArgSet("-stratumaddress")) {
+        CBitcoinAddress address(GetArg("-stratumaddress", ""));
+        if (!address.IsValid()) {
+            LogPrintf("Invalid -stratumaddress\n");
+            return false;
+        }
+        scriptDefaultPayee = GetScriptForDestination(address.Get());
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    eventBase = event_base_new();
+    if (!eventBase) {
+        LogPrintf("stratum: Unable to create event_base\n");
+        return false;
+    }
+
+    // Default to loopback, like the RPC server
+    std::vector<std::string> vBind;
+    if (mapMultiArgs.count("-stratumbind")) {
+        vBind = mapMultiArgs.at("-stratumbind");
+    } else {
+        vBind.push_back("::1");
+        vBind.push_back("127.0.0.1");
+    }
+
+    for (const std::string& strBind : vBind) {
+        CService addrBind;
+        struct sockaddr_storage sockaddr;
+        socklen_t len = sizeof(sockaddr);
+        if (!Lookup(strBind.c_str(), addrBind, nPort, false) || !addrBind.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+            LogPrintf("stratum: Invalid -stratumbind address %s\n", strBind);
+            continue;
+        }
+        struct evconnlistener* listener = evconnlistener_new_bind(eventBase, stratum_accept_cb, nullptr,
+            LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE | LEV_OPT_THREADSAFE, -1, (struct sockaddr*)&sockaddr, len);
+        if (!listener) {
+            LogPrintf("stratum: Binding on address %s failed\n", addrBind.ToString());
+            continue;
+        }
+        LogPrintf("stratum: Listening on %s\n", addrBind.ToString());
+        vListeners.push_back(listener);
+    }
+    if (vListeners.empty()) {
+        event_base_free(eventBase);
+        eventBase = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool StartStratumServer()
+{
+    if (!eventBase)
+        return true;
+
+    pStratumNotificationInterface = new CStratumNotificationInterface();
+    RegisterValidationInterface(pStratumNotificationInterface);
+
+    threadStratum = std::thread([] {
+        RenameThread("dac-stratumev");
+        event_base_dispatch(eventBase);
+    });
+    threadStratumWork = std::thread(ThreadStratumWork);
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (!eventBase)
+        return;
+    LogPrint("stratum", "Interrupting stratum server\n");
+    for (struct evconnlistener* listener : vListeners) {
+        evconnlistener_disable(listener);
+    }
+    std::unique_lock<std::mutex> lock(cs_work);
+    fInterrupted = true;
+    condWork.notify_all();
+}
+
+void StopStratumServer()
+{
+    if (!eventBase)
+        return;
+    LogPrint("stratum", "Stopping stratum server\n");
+    InterruptStratumServer();
+    if (threadStratumWork.joinable())
+        threadStratumWork.join();
+    if (pStratumNotificationInterface) {
+        UnregisterValidationInterface(pStratumNotificationInterface);
+        delete pStratumNotificationInterface;
+        pStratumNotificationInterface = nullptr;
+    }
+
+    event_base_loopbreak(eventBase);
+    if (threadStratum.joinable())
+        threadStratum.join();
+
+    {
+        LOCK(cs_stratum);
+        mapSessions.clear();
+        vJobs.clear();
+        setTipShares.clear();
+        currentJob.reset();
+    }
+    {
+        std::unique_lock<std::mutex> lock(cs_work);
+        queueShares.clear();
+    }
+    for (struct evconnlistener* listener : vListeners) {
+        evconnlistener_free(listener);
+    }
+    vListeners.clear();
+    event_base_free(eventBase);
+    eventBase = nullptr;
+}
+
+CStratumStats GetStratumStats()
+{
+    CStratumStats stats;
+    LOCK(cs_stratum);
+    stats.fRunning = eventBase != nullptr;
+    stats.nSessions = mapSessions.size();
+    stats.strJobId = currentJob ? currentJob->strId : "";
+    stats.nJobHeight = currentJob ? currentJob->nPrevHeight + 1 : 0;
+    stats.nJobs = nJobs;
+    stats.nSharesAccepted = nSharesAccepted;
+    stats.nSharesRejected = nSharesRejected;
+    stats.nBlocksFound = nBlocksFound;
+    return stats;
+}
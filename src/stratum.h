@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include <stdint.h>
+#include <string>
+
+/** Port of the stratum server, 0 disables it */
+static const int DEFAULT_STRATUM_PORT = 0;
+/** Shares are accepted up to this many times the block target */
+static const int DEFAULT_STRATUM_SHARE_FACTOR = 256;
+/** Number of mempool updates after which a new (non-clean) job is pushed */
+static const int DEFAULT_STRATUM_MEMPOOL_THRESHOLD = 50;
+
+/**
+ * Line-delimited JSON-RPC stratum endpoint for RandomX pool mining (-stratumport).
+ *
+ * Client requests:
+ *   mining.subscribe [user agent, randomx seed hex]   -> {"session", "extranonce_start", "extranonce_size"}
+ *   mining.authorize [payout address, password]       -> true
+ *   mining.submit    [job id, extranonce, randomx header hex, ntime] -> true
+ *
+ * Server notifications:
+ *   mining.notify    [job id, prevhash, randomx seed, share target, height, nbits, ntime, clean]
+ *
+ * Jobs only carry the data a RandomX miner needs; the block itself is kept in the node and is only assembled (from
+ * the cached block template, see CBlockTemplateCache) when a share meets the block target. A clean job is pushed
+ * whenever the tip changes, a non-clean one once the mempool changed -stratummempoolthreshold times.
+ *
+ * Every connected client gets its own extra nonce range, ranges are reused once a client is gone. Shares are validated
+ * with one RandomX VM per seed, for at most 4 different seeds at a time; a subscription with yet another seed is
+ * rejected. A share (seed and RandomX header) only counts once per tip, whichever job it is submitted for.
+ */
+struct CStratumStats
+{
+    bool fRunning;
+    size_t nSessions;
+    std::string strJobId;
+    int nJobHeight;
+    uint64_t nJobs;
+    uint64_t nSharesAccepted;
+    uint64_t nSharesRejected;
+    uint64_t nBlocksFound;
+};
+
+/** Initialize the stratum server and bind its endpoints. Returns true when it's disabled. */
+bool InitStratumServer();
+/** Start the stratum event loop and share validation threads */
+bool StartStratumServer();
+/** Stop accepting connections and new shares */
+void InterruptStratumServer();
+/** Stop the stratum server and disconnect all clients */
+void StopStratumServer();
+/** Counters for getstratuminfo */
+CStratumStats GetStratumStats();
+
+#endif // BITCOIN_STRATUM_H
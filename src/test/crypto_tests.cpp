@@ -9,6 +9,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "utilstrencodings.h"
 #include "test/test_coin.h"
 #include "test/test_random.h"
@@ -255,6 +256,47 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256batch64_test) {
+    // the batch must match hashing each 64 byte blob on its own
+    std::vector<unsigned char> in(64 * 9), out(32 * 9);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = insecure_rand() & 0xff;
+    }
+    SHA256Batch64(out.data(), in.data(), 9);
+    for (size_t i = 0; i < 9; i++) {
+        unsigned char hash[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(&in[i * 64], 64).Finalize(hash);
+        BOOST_CHECK(memcmp(hash, &out[i * 32], CSHA256::OUTPUT_SIZE) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64_test) {
+    // every backend, restricted one at a time, must agree with hashing each 64 byte blob twice
+    const sha256_implementation::UseImplementation impls[] = {
+        sha256_implementation::STANDARD, sha256_implementation::USE_SSE41, sha256_implementation::USE_AVX2,
+        sha256_implementation::USE_SHANI, sha256_implementation::USE_ALL};
+    for (sha256_implementation::UseImplementation impl : impls) {
+        SHA256AutoDetect(impl);
+        TestSHA256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        TestSHA256(std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        for (int blocks = 0; blocks <= 33; blocks++) {
+            std::vector<unsigned char> in(64 * blocks), out(32 * blocks), ref(32 * blocks);
+            for (size_t i = 0; i < in.size(); i++) {
+                in[i] = insecure_rand() & 0xff;
+            }
+            for (int i = 0; i < blocks; i++) {
+                CHash256().Write(&in[i * 64], 64).Finalize(&ref[i * 32]);
+            }
+            SHA256D64(out.data(), in.data(), blocks);
+            BOOST_CHECK(out == ref);
+            // in place, as ComputeMerkleRoot uses it
+            SHA256D64(in.data(), in.data(), blocks);
+            BOOST_CHECK(std::vector<unsigned char>(in.begin(), in.begin() + 32 * blocks) == ref);
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
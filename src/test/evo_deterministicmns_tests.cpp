@@ -399,6 +399,53 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
     }
     BOOST_ASSERT(foundRevived);
 
+    // move an operator key from one MN to another within the same diff range: revoking the second MN frees its key,
+    // the next block assigns it to the first MN (which has the lower internal id, so its update comes first)
+    while ((chainActive.Height() + 1) % 16 != 4 || (chainActive.Height() + 1) % 205 < 2) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+        nHeight++;
+    }
+    tx = CreateProUpRevTx(utxos, dmnHashes[2], operatorKeys[dmnHashes[2]], coinbaseKey);
+    CreateAndProcessBlock({tx}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    nHeight++;
+
+    dmn = deterministicMNManager->GetListAtChainTip().GetMN(dmnHashes[1]);
+    tx = CreateProUpRegTx(utxos, dmnHashes[1], ownerKeys[dmnHashes[1]], operatorKeys[dmnHashes[2]].GetPublicKey(), ownerKeys[dmnHashes[1]].GetPubKey().GetID(), dmn->pdmnState->scriptPayout, coinbaseKey);
+    CreateAndProcessBlock({tx}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    BOOST_ASSERT(chainActive.Height() == nHeight + 1);
+    nHeight++;
+
+    dmn = deterministicMNManager->GetListAtChainTip().GetMN(dmnHashes[1]);
+    BOOST_ASSERT(dmn != nullptr && dmn->pdmnState->pubKeyOperator.Get() == operatorKeys[dmnHashes[2]].GetPublicKey());
+
+    // bury the range deep enough for compaction
+    for (size_t i = 0; i < 30; i++) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+        nHeight++;
+    }
+
+    // compact the per-block diffs and check that a manager with empty caches, which has to replay the lists from
+    // disk through the range diffs, arrives at the same lists. A single run only compacts a bounded number of ranges.
+    for (int h = Params().GetConsensus().DIP0003Height; h <= chainActive.Height(); h += 16) {
+        deterministicMNManager->DoMaintenance();
+    }
+    CDeterministicMNManager::CacheStats stats;
+    size_t nEntries, nBytes, nMaxBytes, nSnapshots;
+    int nSnapshotInterval;
+    deterministicMNManager->GetCacheStats(stats, nEntries, nBytes, nMaxBytes, nSnapshots, nSnapshotInterval);
+    BOOST_CHECK(stats.nRangeDiffsWritten > 0);
+
+    CDeterministicMNManager uncachedManager(*evoDb);
+    for (int h = Params().GetConsensus().DIP0003Height; h <= chainActive.Height(); h++) {
+        BOOST_CHECK(::SerializeHash(uncachedManager.GetListForBlock(chainActive[h])) == ::SerializeHash(deterministicMNManager->GetListForBlock(chainActive[h])));
+    }
+    uncachedManager.GetCacheStats(stats, nEntries, nBytes, nMaxBytes, nSnapshots, nSnapshotInterval);
+    BOOST_CHECK(stats.nRangeDiffsUsed > 0);
+
     const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
 }
 BOOST_AUTO_TEST_SUITE_END()
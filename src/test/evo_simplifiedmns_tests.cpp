@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "test/test_coin.h"
+#include "test/test_random.h"
 
 #include "bls/bls.h"
 #include "evo/simplifiedmns.h"
@@ -70,4 +71,52 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree)
+{
+    std::vector<CSimplifiedMNListEntry> entries;
+    CSimplifiedMNListMerkleTree tree;
+
+    auto checkRoot = [&]() {
+        bool mutated1, mutated2;
+        uint256 root1 = CSimplifiedMNList(entries).CalcMerkleRoot(&mutated1);
+        uint256 root2 = tree.CalcMerkleRoot(&mutated2);
+        BOOST_CHECK(root1 == root2);
+        BOOST_CHECK(mutated1 == mutated2);
+        BOOST_CHECK(tree.size() == entries.size());
+    };
+
+    checkRoot();
+
+    for (int round = 0; round < 100; round++) {
+        int nChanges = insecure_rand() % 5;
+        for (int i = 0; i < nChanges; i++) {
+            int op = insecure_rand() % 3;
+            if (op == 0 || entries.empty()) {
+                CSimplifiedMNListEntry smle;
+                smle.proRegTxHash = GetRandHash();
+                smle.confirmedHash = GetRandHash();
+                smle.isValid = true;
+                entries.emplace_back(smle);
+                tree.AddOrUpdate(smle);
+            } else if (op == 1) {
+                auto& smle = entries[insecure_rand() % entries.size()];
+                smle.confirmedHash = GetRandHash();
+                smle.isValid = (insecure_rand() % 2) == 0;
+                tree.AddOrUpdate(smle);
+            } else {
+                size_t nPos = insecure_rand() % entries.size();
+                tree.Remove(entries[nPos].proRegTxHash);
+                entries.erase(entries.begin() + nPos);
+            }
+        }
+        checkRoot();
+    }
+
+    while (!entries.empty()) {
+        tree.Remove(entries.back().proRegTxHash);
+        entries.pop_back();
+        checkRoot();
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-db.h"
+#include "governance-object.h"
+#include "random.h"
+
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_db_tests, BasicTestingSetup)
+
+static CGovernanceVote MakeVote(const COutPoint& outpoint, const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, eSignal, eOutcome, "");
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(governance_db_votes)
+{
+    CGovernanceDB db(1 << 20, true, true);
+
+    uint256 nParent1 = GetRandHash(), nParent2 = GetRandHash();
+    COutPoint mn1(GetRandHash(), 0), mn2(GetRandHash(), 1);
+
+    CGovernanceVote vote1 = MakeVote(mn1, nParent1, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote vote2 = MakeVote(mn1, nParent1, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO, 1000);
+    CGovernanceVote vote3 = MakeVote(mn2, nParent1, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1000);
+    CGovernanceVote vote4 = MakeVote(mn1, nParent2, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    db.WriteVote(vote1);
+    db.WriteVote(vote2);
+    db.WriteVote(vote3);
+    db.WriteVote(vote4);
+
+    BOOST_CHECK_EQUAL(db.ReadVotes(nParent1).size(), 3);
+    BOOST_CHECK_EQUAL(db.ReadVotes(nParent2).size(), 1);
+    BOOST_CHECK_EQUAL(db.ReadVotes(GetRandHash()).size(), 0);
+
+    CGovernanceVote voteRead;
+    BOOST_CHECK(db.HasVote(vote3.GetHash()));
+    BOOST_CHECK(db.ReadVote(vote3.GetHash(), voteRead));
+    BOOST_CHECK(voteRead.GetHash() == vote3.GetHash());
+
+    // a newer vote of the same masternode for the same object and signal replaces the old one
+    CGovernanceVote vote1b = MakeVote(mn1, nParent1, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000);
+    db.WriteVote(vote1b);
+    BOOST_CHECK_EQUAL(db.ReadVotes(nParent1).size(), 3);
+    BOOST_CHECK(!db.HasVote(vote1.GetHash()));
+    BOOST_CHECK(!db.ReadVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(db.HasVote(vote1b.GetHash()));
+
+    db.EraseVote(vote3.GetHash());
+    BOOST_CHECK(!db.HasVote(vote3.GetHash()));
+    BOOST_CHECK_EQUAL(db.ReadVotes(nParent1).size(), 2);
+
+    // all votes of a masternode for one object
+    db.EraseVotes(nParent1, mn1);
+    BOOST_CHECK_EQUAL(db.ReadVotes(nParent1).size(), 0);
+    BOOST_CHECK(!db.HasVote(vote1b.GetHash()));
+    BOOST_CHECK(!db.HasVote(vote2.GetHash()));
+    BOOST_CHECK(db.HasVote(vote4.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(governance_db_objects)
+{
+    CGovernanceDB db(1 << 20, true, true);
+
+    CGovernanceObject govobj1(uint256(), 1, 1000, GetRandHash(), "");
+    CGovernanceObject govobj2(uint256(), 1, 2000, GetRandHash(), "");
+    BOOST_CHECK(db.WriteObject(govobj1));
+    BOOST_CHECK(db.WriteObject(govobj2));
+
+    COutPoint mn(GetRandHash(), 0);
+    CGovernanceVote vote = MakeVote(mn, govobj1.GetHash(), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    db.WriteVote(vote);
+
+    std::map<uint256, CGovernanceObject> mapObjects;
+    db.ReadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.size(), 2);
+    BOOST_CHECK(mapObjects.count(govobj1.GetHash()));
+    BOOST_CHECK_EQUAL(mapObjects.at(govobj2.GetHash()).GetCreationTime(), 2000);
+
+    // the deletion time is only set once and survives a rewrite of the object
+    CGovernanceObject& govobj2Read = mapObjects.at(govobj2.GetHash());
+    govobj2Read.PrepareDeletion(3000);
+    govobj2Read.PrepareDeletion(4000);
+    BOOST_CHECK(govobj2Read.IsSetCachedDelete());
+    BOOST_CHECK(db.WriteObject(govobj2Read));
+    mapObjects.clear();
+    db.ReadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.at(govobj2.GetHash()).GetDeletionTime(), 3000);
+
+    // erasing an object takes its votes along
+    db.EraseObject(govobj1.GetHash());
+    mapObjects.clear();
+    db.ReadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.size(), 1);
+    BOOST_CHECK(!db.HasVote(vote.GetHash()));
+    BOOST_CHECK_EQUAL(db.ReadVotes(govobj1.GetHash()).size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(governance_vote_file)
+{
+    CGovernanceObjectVoteFile fileVotes;
+
+    uint256 nParent = GetRandHash();
+    std::vector<COutPoint> vecMasternodes;
+    for (int i = 0; i < 10; i++) {
+        vecMasternodes.emplace_back(GetRandHash(), i);
+    }
+
+    std::vector<CGovernanceVote> vecVotes;
+    for (const auto& outpoint : vecMasternodes) {
+        vecVotes.push_back(MakeVote(outpoint, nParent, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000));
+        vecVotes.push_back(MakeVote(outpoint, nParent, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO, 1000));
+    }
+    for (const auto& vote : vecVotes) {
+        fileVotes.AddVote(vote);
+    }
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 20);
+
+    // a vote read back from the columns is the same vote
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(fileVotes.SerializeVoteToStream(vecVotes[5].GetHash(), ss));
+    CGovernanceVote voteRead;
+    ss >> voteRead;
+    BOOST_CHECK(voteRead.GetHash() == vecVotes[5].GetHash());
+    BOOST_CHECK(voteRead.GetMasternodeOutpoint() == vecVotes[5].GetMasternodeOutpoint());
+
+    // a newer vote replaces the older vote of the same masternode and signal only
+    CGovernanceVote voteNew = MakeVote(vecMasternodes[0], nParent, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000);
+    fileVotes.AddVote(voteNew);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 20);
+    BOOST_CHECK(!fileVotes.HasVote(vecVotes[0].GetHash()));
+    BOOST_CHECK(fileVotes.HasVote(vecVotes[1].GetHash()));
+    BOOST_CHECK(fileVotes.HasVote(voteNew.GetHash()));
+
+    fileVotes.RemoveVotesFromMasternode(vecMasternodes[3]);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 18);
+    BOOST_CHECK(!fileVotes.HasVote(vecVotes[6].GetHash()));
+    BOOST_CHECK(!fileVotes.HasVote(vecVotes[7].GetHash()));
+
+    // rows moved around by the removals are still found under their hash
+    std::set<uint256> setHashes;
+    for (const auto& vote : fileVotes.GetVotes()) {
+        BOOST_CHECK(fileVotes.HasVote(vote.GetHash()));
+        setHashes.insert(vote.GetHash());
+    }
+    BOOST_CHECK_EQUAL(setHashes.size(), 18);
+    for (size_t i = 8; i < vecVotes.size(); i++) {
+        BOOST_CHECK(setHashes.count(vecVotes[i].GetHash()));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,8 +3,23 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_cubehash.h"
+#include "crypto/sph_echo.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_simd.h"
+#include "crypto/sph_skein.h"
+#include "crypto/x11.h"
+#include "primitives/block.h"
+#include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_coin.h"
+#include "test/test_random.h"
 
 #include <vector>
 
@@ -149,4 +164,76 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+/** The plain sph chain, as HashX11 computed it before the vectorized stages. */
+static uint256 ReferenceX11(const std::vector<unsigned char>& in)
+{
+    static unsigned char blank[1];
+    unsigned char hash[64];
+
+#define X11_STEP(algo, data, len) \
+    { \
+        sph_##algo##_context ctx; \
+        sph_##algo##_init(&ctx); \
+        sph_##algo(&ctx, data, len); \
+        sph_##algo##_close(&ctx, hash); \
+    }
+    X11_STEP(blake512, in.empty() ? blank : in.data(), in.size());
+    X11_STEP(bmw512, hash, 64);
+    X11_STEP(groestl512, hash, 64);
+    X11_STEP(skein512, hash, 64);
+    X11_STEP(jh512, hash, 64);
+    X11_STEP(keccak512, hash, 64);
+    X11_STEP(luffa512, hash, 64);
+    X11_STEP(cubehash512, hash, 64);
+    X11_STEP(shavite512, hash, 64);
+    X11_STEP(simd512, hash, 64);
+    X11_STEP(echo512, hash, 64);
+#undef X11_STEP
+
+    uint256 ret;
+    memcpy(ret.begin(), hash, 32);
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(x11)
+{
+    // whatever X11AutoDetect picked on this machine must match the reference
+    for (size_t len = 0; len < 300; len += 1 + len / 8) {
+        std::vector<unsigned char> in(len);
+        for (size_t i = 0; i < len; i++) {
+            in[i] = insecure_rand();
+        }
+        BOOST_CHECK(HashX11(in.begin(), in.end()) == ReferenceX11(in));
+    }
+
+    // batches of every size around the 4-way grouping
+    for (size_t count : {0, 1, 3, 4, 5, 9, 17}) {
+        std::vector<unsigned char> in(80 * count);
+        for (size_t i = 0; i < in.size(); i++) {
+            in[i] = insecure_rand();
+        }
+        std::vector<uint256> out(count);
+        X11Batch(count ? out[0].begin() : NULL, in.data(), 80, count);
+        for (size_t n = 0; n < count; n++) {
+            std::vector<unsigned char> msg(in.begin() + 80 * n, in.begin() + 80 * (n + 1));
+            BOOST_CHECK(out[n] == ReferenceX11(msg));
+        }
+    }
+
+    std::vector<CBlockHeader> headers(7);
+    for (size_t n = 0; n < headers.size(); n++) {
+        headers[n].nVersion = insecure_rand();
+        headers[n].hashPrevBlock = GetRandHash();
+        headers[n].hashMerkleRoot = GetRandHash();
+        headers[n].nTime = insecure_rand();
+        headers[n].nBits = insecure_rand();
+        headers[n].nNonce = insecure_rand();
+    }
+    std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+    BOOST_CHECK_EQUAL(hashes.size(), headers.size());
+    for (size_t n = 0; n < headers.size(); n++) {
+        BOOST_CHECK(hashes[n] == headers[n].GetHash());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+static UniValue Sample()
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("hash", "00ff"));
+    obj.push_back(Pair("quote \"key\"", "line\nbreak"));
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 100; i++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("n", i));
+        entry.push_back(Pair("empty", UniValue(UniValue::VARR)));
+        arr.push_back(entry);
+    }
+    obj.push_back(Pair("entries", arr));
+    obj.push_back(Pair("null", NullUniValue));
+    return obj;
+}
+
+/** Write obj through the stream writer, element by element for arrays and objects */
+static void Stream(CJSONStreamWriter& writer, const UniValue& value)
+{
+    if (value.isObject()) {
+        writer.BeginObject();
+        for (size_t i = 0; i < value.size(); i++) {
+            writer.Key(value.getKeys()[i]);
+            Stream(writer, value.getValues()[i]);
+        }
+        writer.EndObject();
+    } else if (value.isArray()) {
+        writer.BeginArray();
+        for (size_t i = 0; i < value.size(); i++) {
+            Stream(writer, value[i]);
+        }
+        writer.EndArray();
+    } else {
+        writer.Value(value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_output)
+{
+    UniValue sample = Sample();
+
+    // everything fits into one chunk, nothing goes to the sink
+    std::string strOut;
+    CJSONStreamWriter writer([&strOut](const std::string& strChunk) { strOut += strChunk; return true; });
+    Stream(writer, sample);
+    BOOST_CHECK(!writer.HasFlushed());
+    BOOST_CHECK_EQUAL(writer.TakeBuffer(), sample.write());
+    BOOST_CHECK(strOut.empty());
+
+    // small chunks
+    size_t nChunks = 0;
+    CJSONStreamWriter chunked([&strOut, &nChunks](const std::string& strChunk) {
+        BOOST_CHECK(strChunk.size() >= 64);
+        strOut += strChunk;
+        nChunks++;
+        return true;
+    }, 64);
+    Stream(chunked, sample);
+    BOOST_CHECK(chunked.HasFlushed());
+    BOOST_CHECK(nChunks > 10);
+    BOOST_CHECK_EQUAL(strOut + chunked.TakeBuffer(), sample.write());
+
+    // leaves written as whole trees, and Fields()
+    strOut.clear();
+    CJSONStreamWriter fields([&strOut](const std::string& strChunk) { strOut += strChunk; return true; }, 64);
+    fields.BeginObject();
+    fields.Fields(sample);
+    fields.EndObject();
+    fields.BeginArray();
+    fields.Value(sample);
+    fields.EndArray();
+    fields.Flush();
+    BOOST_CHECK_EQUAL(strOut, sample.write() + "[" + sample.write() + "]");
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_abort)
+{
+    size_t nCalls = 0;
+    CJSONStreamWriter writer([&nCalls](const std::string& strChunk) { nCalls++; return false; }, 64);
+    Stream(writer, Sample());
+    BOOST_CHECK(writer.IsAborted());
+    BOOST_CHECK(!writer.Flush());
+    // nothing is handed to the sink after it failed
+    BOOST_CHECK_EQUAL(nCalls, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,70 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "llmq/quorums.h"
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(llmq_quorums_tests, TestingSetup)
+
+static BLSVerificationVectorPtr MakeVvec(size_t threshold)
+{
+    auto vvec = std::make_shared<BLSVerificationVector>();
+    for (size_t i = 0; i < threshold; i++) {
+        CBLSSecretKey sk;
+        sk.MakeNewKey();
+        vvec->emplace_back(sk.GetPublicKey());
+    }
+    return vvec;
+}
+
+static llmq::CQuorumPtr MakeQuorum(CBLSWorker& blsWorker, const uint256& quorumHash, const std::vector<CDeterministicMNCPtr>& members, const BLSVerificationVectorPtr& vvec)
+{
+    const auto& params = Params().GetConsensus().llmqs.at(Consensus::LLMQ_50_60);
+
+    llmq::CFinalCommitment qc;
+    qc.llmqType = params.type;
+    qc.quorumHash = quorumHash;
+    qc.validMembers.assign(members.size(), true);
+    qc.quorumVvecHash = ::SerializeHash(*vvec);
+
+    auto quorum = std::make_shared<llmq::CQuorum>(params, blsWorker, *evoDb);
+    quorum->Init(qc, nullptr, uint256(), members);
+    quorum->quorumVvec = vvec;
+    return quorum;
+}
+
+BOOST_AUTO_TEST_CASE(pubkey_shares_per_commitment)
+{
+    CBLSWorker blsWorker;
+
+    std::vector<CDeterministicMNCPtr> members;
+    for (int i = 0; i < 3; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        members.emplace_back(dmn);
+    }
+    const uint256 quorumHash = GetRandHash();
+    const CBLSId id = CBLSId::FromHash(members[1]->proTxHash);
+
+    auto vvec1 = MakeVvec(2);
+    auto vvec2 = MakeVvec(2);
+    CBLSPublicKey pkShare1 = blsWorker.BuildPubKeyShare(vvec1, id);
+    CBLSPublicKey pkShare2 = blsWorker.BuildPubKeyShare(vvec2, id);
+    BOOST_CHECK(pkShare1 != pkShare2);
+
+    // Recovers the share and persists it
+    BOOST_CHECK(MakeQuorum(blsWorker, quorumHash, members, vvec1)->GetPubKeyShare(1) == pkShare1);
+
+    // A different commitment for the same quorumHash, e.g. mined after a reorg, must not get the persisted share
+    BOOST_CHECK(MakeQuorum(blsWorker, quorumHash, members, vvec2)->GetPubKeyShare(1) == pkShare2);
+
+    // Both are still read back for their own commitment
+    BOOST_CHECK(MakeQuorum(blsWorker, quorumHash, members, vvec1)->GetPubKeyShare(1) == pkShare1);
+    BOOST_CHECK(MakeQuorum(blsWorker, quorumHash, members, vvec2)->GetPubKeyShare(1) == pkShare2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
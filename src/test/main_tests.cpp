@@ -2,7 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chainparams.h"
 #include "net.h"
+#include "streams.h"
+#include "validation.h"
 
 #include "test/test_coin.h"
 
@@ -27,4 +30,27 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+BOOST_AUTO_TEST_CASE(read_raw_block_from_disk)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CDiskBlockPos pos(9999, 0);
+    BOOST_CHECK(WriteBlockToDisk(genesis, pos, Params().MessageStart()));
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << genesis;
+
+    std::vector<unsigned char> blockData;
+    BOOST_CHECK(ReadRawBlockFromDisk(blockData, pos, Params().MessageStart()));
+    BOOST_CHECK_EQUAL(blockData.size(), ssBlock.size());
+    BOOST_CHECK(std::equal(blockData.begin(), blockData.end(), (const unsigned char*)ssBlock.data()));
+
+    // wrong network magic must be rejected
+    CMessageHeader::MessageStartChars badMagic = {0x00, 0x01, 0x02, 0x03};
+    BOOST_CHECK(!ReadRawBlockFromDisk(blockData, pos, badMagic));
+
+    // a position that does not point right behind a block header must be rejected
+    CDiskBlockPos badPos(9999, 0);
+    BOOST_CHECK(!ReadRawBlockFromDisk(blockData, badPos, Params().MessageStart()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
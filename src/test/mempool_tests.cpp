@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "txmempool.h"
+#include "base58.h"
+#include "chainparams.h"
+#include "script/standard.h"
 #include "util.h"
 
 #include "test/test_coin.h"
@@ -580,4 +583,125 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolDACIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+
+    CScript burnScript = GetScriptForDestination(CBitcoinAddress(Params().GetConsensus().BurnAddress).Get());
+
+    // A DWS burn of cpk1
+    CMutableTransaction txDWS;
+    txDWS.vin.resize(1);
+    txDWS.vin[0].scriptSig = CScript() << OP_11;
+    txDWS.vout.resize(2);
+    txDWS.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txDWS.vout[0].nValue = 10 * COIN;
+    txDWS.vout[1].scriptPubKey = burnScript;
+    txDWS.vout[1].nValue = 100 * COIN;
+    txDWS.vout[1].sTxOutMessage = "<MT>DWS</MT><MV><dws><cpk>cpk1</cpk><duration>30</duration></dws></MV>";
+
+    // A DashStake burn of cpk2
+    CMutableTransaction txDashStake;
+    txDashStake.vin.resize(1);
+    txDashStake.vin[0].scriptSig = CScript() << OP_12;
+    txDashStake.vout.resize(1);
+    txDashStake.vout[0].scriptPubKey = burnScript;
+    txDashStake.vout[0].nValue = 1 * COIN;
+    txDashStake.vout[0].sTxOutMessage = "<MT>DASHSTAKE</MT><MV><dashstake><cpk>cpk2</cpk></dashstake></MV>";
+
+    // A GSC message, not a burn
+    CMutableTransaction txGSC;
+    txGSC.vin.resize(1);
+    txGSC.vin[0].scriptSig = CScript() << OP_13;
+    txGSC.vout.resize(1);
+    txGSC.vout[0].scriptPubKey = CScript() << OP_13 << OP_EQUAL;
+    txGSC.vout[0].nValue = 1 * COIN;
+    txGSC.vout[0].sTxOutMessage = "<MT>GSC</MT><cpk>cpk1</cpk>";
+
+    // A plain tx
+    CMutableTransaction txPlain;
+    txPlain.vin.resize(1);
+    txPlain.vin[0].scriptSig = CScript() << OP_14;
+    txPlain.vout.resize(1);
+    txPlain.vout[0].scriptPubKey = CScript() << OP_14 << OP_EQUAL;
+    txPlain.vout[0].nValue = 1 * COIN;
+
+    pool.addUnchecked(txDWS.GetHash(), entry.FromTx(txDWS));
+    pool.addUnchecked(txDashStake.GetHash(), entry.FromTx(txDashStake));
+    pool.addUnchecked(txGSC.GetHash(), entry.FromTx(txGSC));
+    pool.addUnchecked(txPlain.GetHash(), entry.FromTx(txPlain));
+
+    BOOST_CHECK_EQUAL(pool.getDACBurns().size(), 2);
+
+    std::vector<CTransactionRef> vtx = pool.getDACBurnsByCPK("cpk1");
+    BOOST_CHECK_EQUAL(vtx.size(), 1);
+    BOOST_CHECK(vtx[0]->GetHash() == txDWS.GetHash());
+    // the tx is shared with the mempool, not copied
+    BOOST_CHECK(vtx[0] == pool.get(txDWS.GetHash()));
+    BOOST_CHECK_EQUAL(pool.getDACBurnsByCPK("cpk2").size(), 1);
+    BOOST_CHECK_EQUAL(pool.getDACBurnsByCPK("cpk3").size(), 0);
+
+    pool.removeRecursive(txDWS);
+    pool.removeRecursive(txGSC);
+    BOOST_CHECK_EQUAL(pool.getDACBurns().size(), 1);
+    BOOST_CHECK_EQUAL(pool.getDACBurnsByCPK("cpk1").size(), 0);
+    BOOST_CHECK_EQUAL(pool.getDACBurnsByCPK("cpk2").size(), 1);
+
+    pool.clear();
+    BOOST_CHECK_EQUAL(pool.getDACBurns().size(), 0);
+    BOOST_CHECK_EQUAL(pool.getDACBurnsByCPK("cpk2").size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAddressSpentIndexTest)
+{
+    CMempoolAddressIndex addressIndex;
+    CMempoolSpentIndex spentIndex;
+
+    uint160 address1(std::vector<unsigned char>(20, 1)), address2(std::vector<unsigned char>(20, 2));
+    uint256 txhash1 = GetRandHash(), txhash2 = GetRandHash(), prevHash = GetRandHash();
+
+    // tx1 spends a coin of address1 and pays to address1 and address2, tx2 pays to address2
+    addressIndex.Insert(txhash1, {
+        {CMempoolAddressDeltaKey(1, address1, txhash1, 0, 1), CMempoolAddressDelta(1, -3 * COIN, prevHash, 0)},
+        {CMempoolAddressDeltaKey(1, address1, txhash1, 0, 0), CMempoolAddressDelta(1, 1 * COIN)},
+        {CMempoolAddressDeltaKey(1, address2, txhash1, 1, 0), CMempoolAddressDelta(1, 2 * COIN)}});
+    addressIndex.Insert(txhash2, {
+        {CMempoolAddressDeltaKey(1, address2, txhash2, 0, 0), CMempoolAddressDelta(2, 5 * COIN)}});
+    spentIndex.Insert(txhash1, {
+        {CSpentIndexKey(prevHash, 0), CSpentIndexValue(txhash1, 0, -1, 3 * COIN, 1, address1)}});
+
+    std::vector<CMempoolAddressIndex::Entry> results;
+    addressIndex.Get({{address1, 1}}, results);
+    BOOST_CHECK_EQUAL(results.size(), 2);
+    results.clear();
+    addressIndex.Get({{address1, 1}, {address2, 1}}, results);
+    BOOST_CHECK_EQUAL(results.size(), 4);
+    results.clear();
+    // a different address type is a different address
+    addressIndex.Get({{address1, 2}}, results);
+    BOOST_CHECK_EQUAL(results.size(), 0);
+
+    CSpentIndexValue value;
+    BOOST_CHECK(spentIndex.Get(CSpentIndexKey(prevHash, 0), value));
+    BOOST_CHECK(value.txid == txhash1);
+    BOOST_CHECK_EQUAL(value.satoshis, 3 * COIN);
+    BOOST_CHECK(!spentIndex.Get(CSpentIndexKey(prevHash, 1), value));
+
+    addressIndex.Remove(txhash1);
+    spentIndex.Remove(txhash1);
+    addressIndex.Get({{address1, 1}, {address2, 1}}, results);
+    BOOST_CHECK_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0].first.txhash == txhash2);
+    BOOST_CHECK(!spentIndex.Get(CSpentIndexKey(prevHash, 0), value));
+
+    // removing an unknown tx is a no-op
+    addressIndex.Remove(txhash1);
+
+    addressIndex.Clear();
+    results.clear();
+    addressIndex.Get({{address2, 1}}, results);
+    BOOST_CHECK_EQUAL(results.size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/cache.h"
+
+#include "chain.h"
+#include "random.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(rpc_cache_tests, BasicTestingSetup)
+
+static UniValue Params(const std::string& strParam = "")
+{
+    UniValue params(UniValue::VARR);
+    if (!strParam.empty())
+        params.push_back(strParam);
+    return params;
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cache_lookup)
+{
+    CRPCResponseCache cache(1 << 20);
+    std::string strKey;
+    UniValue result;
+
+    // only the calls in the policy table are cacheable
+    BOOST_CHECK(!cache.Lookup("getblock", Params(), strKey, result));
+    BOOST_CHECK(strKey.empty());
+    BOOST_CHECK(!cache.Lookup("gobject", Params("vote-many"), strKey, result));
+    BOOST_CHECK(strKey.empty());
+
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    BOOST_CHECK(!strKey.empty());
+    cache.Insert("getblockchaininfo", Params(), strKey, UniValue("info"));
+    BOOST_CHECK(cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    BOOST_CHECK_EQUAL(result.get_str(), "info");
+
+    // params are part of the key
+    BOOST_CHECK(!cache.Lookup("gobject", Params("list"), strKey, result));
+    cache.Insert("gobject", Params("list"), strKey, UniValue("list"));
+    BOOST_CHECK(!cache.Lookup("gobject", Params("count"), strKey, result));
+    BOOST_CHECK(cache.Lookup("gobject", Params("list"), strKey, result));
+    BOOST_CHECK_EQUAL(result.get_str(), "list");
+
+    CRPCResponseCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nHits, 2U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 3U);
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().nBytes, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cache_expiry)
+{
+    CRPCResponseCache cache(1 << 20);
+    std::string strKey;
+    UniValue result;
+
+    SetMockTime(1000);
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    cache.Insert("getblockchaininfo", Params(), strKey, UniValue("info"));
+    SetMockTime(1009);
+    BOOST_CHECK(cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    SetMockTime(1010);
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cache_invalidation)
+{
+    CRPCResponseCache cache(1 << 20);
+    RegisterValidationInterface(&cache);
+    std::string strKey;
+    UniValue result;
+
+    // a mempool update while the call executes drops its result
+    BOOST_CHECK(!cache.Lookup("getmempoolinfo", Params(), strKey, result));
+    mempool.AddTransactionsUpdated(1);
+    cache.Insert("getmempoolinfo", Params(), strKey, UniValue("mempool"));
+    BOOST_CHECK(!cache.Lookup("getmempoolinfo", Params(), strKey, result));
+    cache.Insert("getmempoolinfo", Params(), strKey, UniValue("mempool"));
+    BOOST_CHECK(cache.Lookup("getmempoolinfo", Params(), strKey, result));
+
+    BOOST_CHECK(!cache.Lookup("getdifficulty", Params(), strKey, result));
+    cache.Insert("getdifficulty", Params(), strKey, UniValue("difficulty"));
+
+    // mempool changes only affect the calls which depend on the mempool
+    mempool.AddTransactionsUpdated(1);
+    BOOST_CHECK(!cache.Lookup("getmempoolinfo", Params(), strKey, result));
+    BOOST_CHECK(cache.Lookup("getdifficulty", Params(), strKey, result));
+
+    GetMainSignals().SyncTransaction(CTransaction(), nullptr, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 1U);
+
+    // a new tip drops everything
+    CBlockIndex index;
+    uint256 hash = GetRandHash();
+    index.phashBlock = &hash;
+    GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+    BOOST_CHECK(!cache.Lookup("getdifficulty", Params(), strKey, result));
+
+    UnregisterValidationInterface(&cache);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cache_eviction)
+{
+    CRPCResponseCache cache(2500);
+    std::string strKey;
+    UniValue result;
+    const UniValue value(std::string(600, 'x'));
+
+    BOOST_CHECK(!cache.Lookup("getdifficulty", Params(), strKey, result));
+    cache.Insert("getdifficulty", Params(), strKey, value);
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+    cache.Insert("getblockchaininfo", Params(), strKey, value);
+
+    // touch getdifficulty so getblockchaininfo is the least recently used one
+    BOOST_CHECK(cache.Lookup("getdifficulty", Params(), strKey, result));
+    BOOST_CHECK(!cache.Lookup("leaderboard", Params(), strKey, result));
+    cache.Insert("leaderboard", Params(), strKey, value);
+
+    CRPCResponseCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nEvicted, 1U);
+    BOOST_CHECK(stats.nBytes <= stats.nMaxBytes);
+    BOOST_CHECK(cache.Lookup("getdifficulty", Params(), strKey, result));
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+
+    // responses larger than the whole cache aren't stored
+    cache.Insert("getblockchaininfo", Params(), strKey, UniValue(std::string(4096, 'x')));
+    BOOST_CHECK(!cache.Lookup("getblockchaininfo", Params(), strKey, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
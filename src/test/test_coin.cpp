@@ -9,6 +9,8 @@
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
+#include "crypto/x11.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -45,6 +47,8 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
+        SHA256AutoDetect();
+        X11AutoDetect();
         ECC_Start();
         BLSInit();
         SetupEnvironment();
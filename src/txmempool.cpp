@@ -5,6 +5,8 @@
 
 #include "txmempool.h"
 
+#include "base58.h"
+#include "chainparams.h"
 #include "clientversion.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
@@ -12,7 +14,9 @@
 #include "validation.h"
 #include "policy/policy.h"
 #include "policy/fees.h"
+#include "rpcpog.h"
 #include "random.h"
+#include "script/standard.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util.h"
@@ -428,6 +432,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     vTxHashes.emplace_back(hash, newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    addDACIndex(tx);
+
     // Invalid ProTxes should never get this far because transactions should be
     // fully checked by AcceptToMemoryPool() at this point, so we just assume that
     // everything is fine here.
@@ -480,9 +486,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
 
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    std::vector<CMempoolAddressIndex::Entry> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -493,20 +498,17 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         }
     }
 
@@ -515,62 +517,38 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    addressIndex.Insert(txhash, inserted);
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
-    LOCK(cs);
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
-    }
+    addressIndex.Get(addresses, results);
     return true;
 }
 
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
-    LOCK(cs);
-    addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
-
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
-        }
-        mapAddressInserted.erase(it);
-    }
-
+    addressIndex.Remove(txhash);
     return true;
 }
 
 void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
-
     const CTransaction& tx = entry.GetTx();
-    std::vector<CSpentIndexKey> inserted;
+    std::vector<CMempoolSpentIndex::Entry> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -597,41 +575,74 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
         CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
-
+        inserted.emplace_back(key, value);
     }
 
-    mapSpentInserted.insert(make_pair(txhash, inserted));
+    spentIndex.Insert(txhash, inserted);
 }
 
 bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
-    LOCK(cs);
-    mapSpentIndex::iterator it;
-
-    it = mapSpent.find(key);
-    if (it != mapSpent.end()) {
-        value = it->second;
-        return true;
-    }
-    return false;
+    return spentIndex.Get(key, value);
 }
 
 bool CTxMemPool::removeSpentIndex(const uint256 txhash)
 {
-    LOCK(cs);
-    mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
+    spentIndex.Remove(txhash);
+    return true;
+}
 
-    if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
+// Whether a tx pays to the burn address and the CPK of its burn message. Parses the same fields
+// GetWhaleStake/GetDashStake do, so that the index doesn't miss anything.
+static void GetDACIndexKeys(const CTransaction& tx, bool& fBurn, std::string& sCPK)
+{
+    fBurn = false;
+    sCPK.clear();
+
+    CTxDestination burnDest = CBitcoinAddress(Params().GetConsensus().BurnAddress).Get();
+    for (const CTxOut& txout : tx.vout) {
+        CTxDestination dest;
+        if (ExtractDestination(txout.scriptPubKey, dest) && dest == burnDest) {
+            fBurn = true;
+            sCPK = ExtractXML(txout.sTxOutMessage, "<cpk>", "</cpk>");
+            return;
         }
-        mapSpentInserted.erase(it);
     }
+}
 
-    return true;
+void CTxMemPool::addDACIndex(const CTransaction& tx)
+{
+    bool fBurn;
+    std::string sCPK;
+    GetDACIndexKeys(tx, fBurn, sCPK);
+
+    if (fBurn) {
+        const uint256& txHash = tx.GetHash();
+        setDACBurns.emplace(txHash);
+        mapDACBurnCPKs.emplace(sCPK, txHash);
+    }
+}
+
+void CTxMemPool::removeDACIndex(const CTransaction& tx)
+{
+    bool fBurn;
+    std::string sCPK;
+    GetDACIndexKeys(tx, fBurn, sCPK);
+
+    if (!fBurn) {
+        return;
+    }
+
+    const uint256& txHash = tx.GetHash();
+    setDACBurns.erase(txHash);
+    auto its = mapDACBurnCPKs.equal_range(sCPK);
+    for (auto it = its.first; it != its.second;) {
+        if (it->second == txHash) {
+            it = mapDACBurnCPKs.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
@@ -650,6 +661,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     } else
         vTxHashes.clear();
 
+    removeDACIndex(it->GetTx());
+
     auto eraseProTxRef = [&](const uint256& proTxHash, const uint256& txHash) {
         auto its = mapProTxRefs.equal_range(proTxHash);
         for (auto it = its.first; it != its.second;) {
@@ -1006,6 +1019,10 @@ void CTxMemPool::_clear()
     mapNextTx.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
+    setDACBurns.clear();
+    mapDACBurnCPKs.clear();
+    addressIndex.Clear();
+    spentIndex.Clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1234,6 +1251,28 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::vector<CTransactionRef> CTxMemPool::getDACBurns() const
+{
+    LOCK(cs);
+    std::vector<CTransactionRef> vtx;
+    vtx.reserve(setDACBurns.size());
+    for (const uint256& txHash : setDACBurns) {
+        vtx.emplace_back(mapTx.find(txHash)->GetSharedTx());
+    }
+    return vtx;
+}
+
+std::vector<CTransactionRef> CTxMemPool::getDACBurnsByCPK(const std::string& sCPK) const
+{
+    LOCK(cs);
+    std::vector<CTransactionRef> vtx;
+    auto its = mapDACBurnCPKs.equal_range(sCPK);
+    for (auto it = its.first; it != its.second; ++it) {
+        vtx.emplace_back(mapTx.find(it->second)->GetSharedTx());
+    }
+    return vtx;
+}
+
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
 {
     LOCK(cs);
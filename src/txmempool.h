@@ -14,6 +14,7 @@
 #include <string>
 
 #include "addressindex.h"
+#include "mempoolindex.h"
 #include "spentindex.h"
 #include "amount.h"
 #include "coins.h"
@@ -504,17 +505,9 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
-
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
-
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
-    mapSpentIndex mapSpent;
-
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
-    mapSpentIndexInserted mapSpentInserted;
+    // -addressindex and -spentindex, guarded by their own locks instead of cs
+    CMempoolAddressIndex addressIndex;
+    CMempoolSpentIndex spentIndex;
 
     std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
     std::map<CService, uint256> mapProTxAddresses;
@@ -522,6 +515,14 @@ private:
     std::map<uint256, uint256> mapProTxBlsPubKeyHashes;
     std::map<COutPoint, uint256> mapProTxCollaterals;
 
+    // DAC transactions, so that the DAC helpers (GetDWS, GetDashStakes, ...) don't need to walk and parse the whole
+    // mempool. Burns are all txs paying to the burn address (DWS and DashStake), the CPK is the one of the burn message.
+    std::set<uint256> setDACBurns;
+    std::multimap<std::string, uint256> mapDACBurnCPKs; // cpk -> burn transaction
+
+    void addDACIndex(const CTransaction& tx);
+    void removeDACIndex(const CTransaction& tx);
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -679,6 +680,11 @@ public:
 
     bool existsProviderTxConflict(const CTransaction &tx) const;
 
+    /** All DAC burn transactions (DWS, DashStake) in the mempool */
+    std::vector<CTransactionRef> getDACBurns() const;
+    /** Burn transactions whose message has the given CPK */
+    std::vector<CTransactionRef> getDACBurnsByCPK(const std::string& sCPK) const;
+
     /** Estimate fee rate needed to get into the next nBlocks
      *  If no answer can be given at nBlocks, return an estimate
      *  at the lowest number of blocks where one can be given
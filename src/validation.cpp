@@ -1204,6 +1204,52 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // WriteBlockToDisk stores the message start and the block size right in front of the block
+    CDiskBlockPos hpos = pos;
+    if (hpos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("ReadRawBlockFromDisk: Invalid block position %s", pos.ToString());
+    hpos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    // Open history file to read
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadRawBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blkStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blkStart) >> nSize;
+
+        if (memcmp(blkStart, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                    HexStr(blkStart, blkStart + CMessageHeader::MESSAGE_START_SIZE),
+                    HexStr(messageStart, messageStart + CMessageHeader::MESSAGE_START_SIZE));
+
+        if (nSize > MAX_SIZE)
+            return error("%s: Block data is larger than maximum deserialization size for %s: %u versus %u", __func__, pos.ToString(), nSize, MAX_SIZE);
+
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+    return ReadRawBlockFromDisk(block, blockPos, messageStart);
+}
+
 double ConvertBitsToDouble(unsigned int nBits)
 {
     int nShift = (nBits >> 24) & 0xff;
@@ -1715,6 +1761,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
@@ -1741,6 +1789,8 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -5166,6 +5216,8 @@ void KillBlockchainFiles()
 	if(boost::filesystem::exists(pathMnpayments)) boost::filesystem::remove(pathIS); 
 	boost::filesystem::path pathGov = GetDataDir() / "governance.dat";
 	if(boost::filesystem::exists(pathGov)) boost::filesystem::remove(pathGov); 
+	boost::filesystem::path pathGovDB = GetDataDir() / "governance";
+	boost::filesystem::remove_all(pathGovDB);
 	boost::filesystem::path pathMncache = GetDataDir() / "mncache.dat";
 	if(boost::filesystem::exists(pathMncache)) boost::filesystem::remove(pathMncache); 
 	boost::filesystem::path pathBanlist = GetDataDir() / "banlist.dat";
@@ -2581,12 +2581,26 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
             "      }\n"
             "      ,...\n"
             "    ]\n"
+            "  \"scanning\": {                (json object) only present while the wallet is rescanning the chain\n"
+            "    \"height\": xxxx,            (numeric) the height of the block being scanned\n"
+            "    \"progress\": x.xxx,         (numeric) the verification progress at that block\n"
+            "    \"blockspersec\": x.x,       (numeric) the number of blocks scanned per second so far\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getwalletinfo", "")
             + HelpExampleRpc("getwalletinfo", "")
         );
 
+    // read before taking the locks, which a rescan takes for every block it applies
+    UniValue scanning;
+    if (pwallet->fScanningWallet) {
+        scanning.setObject();
+        scanning.push_back(Pair("height", pwallet->nScanningHeight.load()));
+        scanning.push_back(Pair("progress", pwallet->dScanningProgress.load()));
+        scanning.push_back(Pair("blockspersec", pwallet->dScanningBlocksPerSec.load()));
+    }
+
     LOCK2(cs_main, pwallet->cs_wallet);
 
     CHDChain hdChainCurrent;
@@ -2627,6 +2641,9 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
         }
         obj.push_back(Pair("hdaccounts", accounts));
     }
+    if (!scanning.isNull()) {
+        obj.push_back(Pair("scanning", scanning));
+    }
     return obj;
 }
 
@@ -6,14 +6,19 @@
 
 #include <set>
 #include <stdint.h>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "base58.h"
+#include "privatesend.h"
 #include "rpc/server.h"
 #include "test/test_coin.h"
+#include "txmempool.h"
 #include "validation.h"
 #include "wallet/test/wallet_test_fixture.h"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 #include <univalue.h>
@@ -21,6 +26,7 @@
 extern UniValue importmulti(const JSONRPCRequest& request);
 extern UniValue dumpwallet(const JSONRPCRequest& request);
 extern UniValue importwallet(const JSONRPCRequest& request);
+extern UniValue getwalletinfo(const JSONRPCRequest& request);
 
 // how many times to run all the tests to have a chance to catch errors that only show up with particular random shuffles
 #define RUN_TESTS 100
@@ -369,29 +375,38 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
     CBlockIndex* newTip = chainActive.Tip();
 
-    LOCK(cs_main);
-
     // Verify ScanForWalletTransactions picks up transactions in both the old
     // and new block files.
     {
         CWallet wallet;
-        LOCK(wallet.cs_wallet);
-        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
-        BOOST_CHECK_EQUAL(oldTip, wallet.ScanForWalletTransactions(oldTip));
+        WalletRescanReserver reserver(&wallet);
+        BOOST_CHECK(reserver.reserve());
+        {
+            LOCK(wallet.cs_wallet);
+            wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+        }
+        BOOST_CHECK_EQUAL(oldTip, wallet.ScanForWalletTransactions(oldTip, reserver));
         BOOST_CHECK_EQUAL(wallet.GetImmatureBalance(), 1000 * COIN);
     }
 
     // Prune the older block file.
-    PruneOneBlockFile(oldTip->GetBlockPos().nFile);
+    {
+        LOCK(cs_main);
+        PruneOneBlockFile(oldTip->GetBlockPos().nFile);
+    }
     UnlinkPrunedFiles({oldTip->GetBlockPos().nFile});
 
     // Verify ScanForWalletTransactions only picks transactions in the new block
     // file.
     {
         CWallet wallet;
-        LOCK(wallet.cs_wallet);
-        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
-        BOOST_CHECK_EQUAL(newTip, wallet.ScanForWalletTransactions(oldTip));
+        WalletRescanReserver reserver(&wallet);
+        BOOST_CHECK(reserver.reserve());
+        {
+            LOCK(wallet.cs_wallet);
+            wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+        }
+        BOOST_CHECK_EQUAL(newTip, wallet.ScanForWalletTransactions(oldTip, reserver));
         BOOST_CHECK_EQUAL(wallet.GetImmatureBalance(), 500 * COIN);
     }
 
@@ -428,6 +443,60 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     }
 }
 
+// Verify that only one rescan of a wallet runs at a time, and that it runs
+// without holding cs_main and cs_wallet, so that getwalletinfo can report it.
+BOOST_FIXTURE_TEST_CASE(rescan_reserver, TestChain100Setup)
+{
+    CWallet wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    }
+
+    WalletRescanReserver reserver(&wallet);
+    BOOST_CHECK(reserver.reserve());
+    {
+        WalletRescanReserver reserver2(&wallet);
+        BOOST_CHECK(!reserver2.reserve());
+    }
+    BOOST_CHECK(reserver.isReserved());
+
+    CWallet *pwalletMainBackup = ::pwalletMain;
+    ::pwalletMain = &wallet;
+    bool fLocked = false;
+    UniValue walletInfo;
+    auto conn = wallet.ShowProgress.connect([&](const std::string&, int nProgress) {
+        if (nProgress != 0) {
+            return;
+        }
+        // another thread must be able to take the locks while the scan runs
+        std::thread t([&] {
+            {
+                TRY_LOCK(cs_main, lockMain);
+                TRY_LOCK(wallet.cs_wallet, lockWallet);
+                fLocked = lockMain && lockWallet;
+            }
+            JSONRPCRequest request;
+            request.params.setArray();
+            walletInfo = ::getwalletinfo(request);
+        });
+        t.join();
+    });
+
+    CBlockIndex* pindexStart;
+    {
+        LOCK(cs_main);
+        pindexStart = chainActive.Genesis();
+    }
+    wallet.ScanForWalletTransactions(pindexStart, reserver);
+    conn.disconnect();
+    ::pwalletMain = pwalletMainBackup;
+
+    BOOST_CHECK(fLocked);
+    BOOST_CHECK(find_value(walletInfo, "scanning").isObject());
+    BOOST_CHECK(wallet.GetWalletTx(coinbaseTxns.back().GetHash()));
+}
+
 // Verify importwallet RPC starts rescan at earliest block with timestamp
 // greater or equal than key birthday. Previously there was a bug where
 // importwallet RPC would start the scan at the latest block with timestamp less
@@ -448,8 +517,6 @@ BOOST_FIXTURE_TEST_CASE(importwallet_rescan, TestChain100Setup)
     SetMockTime(KEY_TIME);
     coinbaseTxns.emplace_back(*CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey())).vtx[0]);
 
-    LOCK(cs_main);
-
     // Import key into wallet and call dumpwallet to create backup file.
     {
         CWallet wallet;
@@ -513,6 +580,260 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(), 500*COIN);
 }
 
+BOOST_FIXTURE_TEST_CASE(coin_age_index, TestChain100Setup)
+{
+    // Make the first coinbase mature, the second one stays immature
+    for (int i = 0; i < 2; i++) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+
+    // Coins need some age to have a weight
+    SetMockTime(chainActive.Tip()->GetBlockTime() - 30 * 24 * 60 * 60);
+    for (int i = 0; i < 2; i++) {
+        CWalletTx wtx(&wallet, MakeTransactionRef(coinbaseTxns[i]));
+        wtx.hashBlock = chainActive[i + 1]->GetBlockHash();
+        wtx.nIndex = 0;
+        wallet.AddToWallet(wtx);
+    }
+    SetMockTime(0);
+
+    std::string sAddress = CBitcoinAddress(coinbaseKey.GetPubKey().GetID()).ToString();
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK(vCoins[0].tx->GetHash() == coinbaseTxns[0].GetHash());
+
+    // Same coins as found by walking the whole wallet
+    std::vector<COutput> vAvailableCoins;
+    wallet.AvailableCoins(vAvailableCoins);
+    BOOST_CHECK_EQUAL(vAvailableCoins.size(), vCoins.size());
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), vCoins[0].tx->tx->vout[vCoins[0].i].nValue);
+
+    wallet.AvailableCoinsByAge(vCoins, "", false);
+    BOOST_CHECK(vCoins.empty());
+
+    wallet.LockCoin(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK(vCoins.empty());
+    wallet.UnlockCoin(COutPoint(coinbaseTxns[0].GetHash(), 0));
+
+    // Spending the coin removes it from the index and resets the cached balance
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue / 2, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spend)));
+
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK(vCoins.empty());
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(coin_age_index_young_coins, TestChain100Setup)
+{
+    // Make the first two coinbases mature
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+
+    // One old coin and one received just now, which has no coin-age yet
+    for (int i = 0; i < 2; i++) {
+        SetMockTime(i == 0 ? chainActive.Tip()->GetBlockTime() - 30 * 24 * 60 * 60 : chainActive.Tip()->GetBlockTime());
+        CWalletTx wtx(&wallet, MakeTransactionRef(coinbaseTxns[i]));
+        wtx.hashBlock = chainActive[i + 1]->GetBlockHash();
+        wtx.nIndex = 0;
+        wallet.AddToWallet(wtx);
+    }
+    SetMockTime(0);
+
+    std::string sAddress = CBitcoinAddress(coinbaseKey.GetPubKey().GetID()).ToString();
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+    // sorted by weight, so the old coin comes first
+    BOOST_CHECK(vCoins[0].tx->GetHash() == coinbaseTxns[0].GetHash());
+
+    wallet.AvailableCoinsByAge(vCoins, sAddress, true);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK(vCoins[0].tx->GetHash() == coinbaseTxns[0].GetHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(coin_age_index_abandon_conflict, TestChain100Setup)
+{
+    // Make the first two coinbases mature
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+
+    SetMockTime(chainActive.Tip()->GetBlockTime() - 30 * 24 * 60 * 60);
+    for (int i = 0; i < 2; i++) {
+        CWalletTx wtx(&wallet, MakeTransactionRef(coinbaseTxns[i]));
+        wtx.hashBlock = chainActive[i + 1]->GetBlockHash();
+        wtx.nIndex = 0;
+        wallet.AddToWallet(wtx);
+    }
+    SetMockTime(0);
+
+    std::string sAddress = CBitcoinAddress(coinbaseKey.GetPubKey().GetID()).ToString();
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+    CAmount nBalance = wallet.GetBalance();
+
+    // Abandoning a spend puts its inputs back into the index
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue / 2, CScript() << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spend)));
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+
+    BOOST_CHECK(wallet.AbandonTransaction(spend.GetHash()));
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), nBalance);
+
+    // A spend conflicted by a block puts back the inputs which the block didn't spend
+    CMutableTransaction spendBoth;
+    spendBoth.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spendBoth.vin.emplace_back(COutPoint(coinbaseTxns[1].GetHash(), 0));
+    spendBoth.vout.emplace_back(coinbaseTxns[0].vout[0].nValue, CScript() << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spendBoth)));
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK(vCoins.empty());
+
+    CMutableTransaction conflict;
+    conflict.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    conflict.vout.emplace_back(coinbaseTxns[0].vout[0].nValue / 2, CScript() << OP_TRUE);
+    wallet.SyncTransaction(conflict, chainActive.Tip(), 1);
+    BOOST_CHECK(wallet.mapWallet.at(spendBoth.GetHash()).GetDepthInMainChain() < 0);
+
+    wallet.AvailableCoinsByAge(vCoins, sAddress, false);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK(vCoins[0].tx->GetHash() == coinbaseTxns[1].GetHash());
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), coinbaseTxns[1].vout[0].nValue);
+}
+
+BOOST_FIXTURE_TEST_CASE(balance_cache_mempool_removal, TestChain100Setup)
+{
+    // Make the first coinbase mature
+    for (int i = 0; i < 2; i++) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+
+    CWallet wallet;
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CWallet::TransactionRemovedFromMempool, &wallet, _1, _2));
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+
+        CWalletTx wtx(&wallet, MakeTransactionRef(coinbaseTxns[0]));
+        wtx.hashBlock = chainActive[1]->GetBlockHash();
+        wtx.nIndex = 0;
+        wallet.AddToWallet(wtx);
+
+        // An own unconfirmed spend is trusted while it's in the mempool
+        CMutableTransaction spend;
+        spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+        spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue / 2, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+        TestMemPoolEntryHelper entry;
+        mempool.addUnchecked(spend.GetHash(), entry.FromTx(spend));
+        wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spend)));
+        BOOST_CHECK_EQUAL(wallet.GetBalance(), spend.vout[0].nValue);
+
+        // Dropping out of the mempool without a block invalidates the cached balance
+        mempool.removeRecursive(spend, MemPoolRemovalReason::EXPIRY);
+        BOOST_CHECK_EQUAL(wallet.GetBalance(), 0);
+    }
+    mempool.NotifyEntryRemoved.disconnect(boost::bind(&CWallet::TransactionRemovedFromMempool, &wallet, _1, _2));
+}
+
+BOOST_FIXTURE_TEST_CASE(privatesend_coin_index, TestChain100Setup)
+{
+    CPrivateSend::InitStandardDenominations();
+    const CAmount nDenom = CPrivateSend::GetSmallestDenomination();
+    const CAmount nCollateral = CPrivateSend::GetCollateralAmount();
+    const CAmount nNonDenom = 5 * COIN;
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    CScript scriptPubKey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    tx.vout.emplace_back(nDenom, scriptPubKey);
+    tx.vout.emplace_back(nDenom, scriptPubKey);
+    tx.vout.emplace_back(nCollateral, scriptPubKey);
+    tx.vout.emplace_back(nNonDenom, scriptPubKey);
+    CWalletTx wtx(&wallet, MakeTransactionRef(tx));
+    wtx.hashBlock = chainActive.Tip()->GetBlockHash();
+    wtx.nIndex = 0;
+    wallet.AddToWallet(wtx);
+
+    BOOST_CHECK(wallet.HasCollateralInputs());
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nDenom), 2);
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nNonDenom), 1);
+
+    // Collaterals are never anonymizable, denominated coins only until they're mixed enough
+    std::vector<CompactTallyItem> vecTally;
+    BOOST_CHECK(wallet.SelectCoinsGroupedByAddresses(vecTally, false, true, true));
+    BOOST_CHECK_EQUAL(vecTally.size(), 1);
+    BOOST_CHECK_EQUAL(vecTally[0].vecOutPoints.size(), 3);
+    BOOST_CHECK_EQUAL(vecTally[0].nAmount, 2 * nDenom + nNonDenom);
+    BOOST_CHECK(wallet.SelectCoinsGroupedByAddresses(vecTally, false, false, true));
+    BOOST_CHECK_EQUAL(vecTally[0].vecOutPoints.size(), 4);
+    BOOST_CHECK_EQUAL(wallet.GetAnonymizableBalance(false, false), 2 * nDenom + nNonDenom);
+    BOOST_CHECK_EQUAL(wallet.GetAnonymizableBalance(true, false), nNonDenom);
+
+    // Spending coins removes them from their buckets and resets the cached balance
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(wtx.GetHash(), 0));
+    spend.vin.emplace_back(COutPoint(wtx.GetHash(), 2));
+    spend.vout.emplace_back(nDenom, CScript() << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spend)));
+
+    BOOST_CHECK(!wallet.HasCollateralInputs());
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nDenom), 1);
+    BOOST_CHECK_EQUAL(wallet.GetAnonymizableBalance(false, false), nDenom + nNonDenom);
+
+    // Abandoning the spend puts its inputs back into their buckets
+    BOOST_CHECK(wallet.AbandonTransaction(spend.GetHash()));
+    BOOST_CHECK(wallet.HasCollateralInputs());
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nDenom), 2);
+    BOOST_CHECK_EQUAL(wallet.GetAnonymizableBalance(false, false), 2 * nDenom + nNonDenom);
+
+    // A spend conflicted by a block puts back the inputs which the block didn't spend
+    CMutableTransaction spendAgain;
+    spendAgain.vin.emplace_back(COutPoint(wtx.GetHash(), 0));
+    spendAgain.vin.emplace_back(COutPoint(wtx.GetHash(), 2));
+    spendAgain.vout.emplace_back(nDenom, CScript() << OP_TRUE << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(spendAgain)));
+    BOOST_CHECK(!wallet.HasCollateralInputs());
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nDenom), 1);
+
+    CMutableTransaction conflict;
+    conflict.vin.emplace_back(COutPoint(wtx.GetHash(), 0));
+    conflict.vout.emplace_back(nDenom, CScript() << OP_TRUE);
+    wallet.SyncTransaction(conflict, chainActive.Tip(), 1);
+    BOOST_CHECK(wallet.mapWallet.at(spendAgain.GetHash()).GetDepthInMainChain() < 0);
+
+    BOOST_CHECK(wallet.HasCollateralInputs());
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(nDenom), 1);
+    BOOST_CHECK_EQUAL(wallet.GetAnonymizableBalance(false, false), nDenom + nNonDenom);
+}
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -566,4 +887,43 @@ BOOST_AUTO_TEST_CASE(ComputeTimeSmart)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(block_filter_elements_bare_multisig)
+{
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    CKey key1, key2, keyOther;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    wallet.AddKeyPubKey(key1, key1.GetPubKey());
+    wallet.AddKeyPubKey(key2, key2.GetPubKey());
+
+    auto hasScript = [](const std::set<std::vector<unsigned char>>& elements, const CScript& script) {
+        return elements.count(std::vector<unsigned char>(script.begin(), script.end())) != 0;
+    };
+
+    CScript multisigMine = GetScriptForMultisig(1, {key1.GetPubKey(), key2.GetPubKey()});
+    CScript multisigShared = GetScriptForMultisig(1, {key1.GetPubKey(), keyOther.GetPubKey()});
+    BOOST_CHECK(!hasScript(wallet.GetBlockFilterElements(), multisigMine));
+
+    // a bare multisig output the wallet received before is watched for
+    CMutableTransaction tx;
+    tx.vout.emplace_back(1 * COIN, multisigMine);
+    tx.vout.emplace_back(1 * COIN, multisigShared);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(tx)));
+
+    std::set<std::vector<unsigned char>> elements = wallet.GetBlockFilterElements();
+    BOOST_CHECK(hasScript(elements, multisigMine));
+    // not ours unless we own all of its keys
+    BOOST_CHECK(!hasScript(elements, multisigShared));
+
+    // a multisig redeem script is watched for as a bare scriptPubKey as well
+    CScript multisigRedeem = GetScriptForMultisig(2, {key1.GetPubKey(), key2.GetPubKey()});
+    wallet.AddCScript(multisigRedeem);
+    elements = wallet.GetBlockFilterElements();
+    BOOST_CHECK(hasScript(elements, multisigRedeem));
+    BOOST_CHECK(hasScript(elements, GetScriptForDestination(CScriptID(multisigRedeem))));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
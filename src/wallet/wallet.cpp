@@ -8,11 +8,13 @@
 #include "wallet/wallet.h"
 
 #include "base58.h"
+#include "blockfilterindex.h"
 #include "checkpoints.h"
 #include "chain.h"
 #include "wallet/coincontrol.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "ctpl.h"
 #include "key.h"
 #include "keystore.h"
 #include "validation.h"
@@ -44,6 +46,7 @@
 #include <assert.h>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -760,6 +763,8 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
     setWalletUTXO.erase(outpoint);
+    RemoveFromCoinAgeIndex(outpoint);
+    RemoveFromPrivateSendIndex(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -778,6 +783,130 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::AddToCoinAgeIndex(const COutPoint& outpoint, const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    const CTxOut& txout = wtx.tx->vout[outpoint.n];
+    if (!(IsMine(txout) & ISMINE_SPENDABLE) || mapCoinsByAddressKeys.count(outpoint))
+        return;
+
+    std::string sAddress = PubKeyToAddress(txout.scriptPubKey);
+    int64_t nTxTime = wtx.GetTxTime();
+    mapCoinsByAddress[sAddress].emplace(nTxTime, outpoint);
+    mapCoinsByAddressKeys.emplace(outpoint, std::make_pair(sAddress, nTxTime));
+}
+
+void CWallet::RemoveFromCoinAgeIndex(const COutPoint& outpoint)
+{
+    auto itKey = mapCoinsByAddressKeys.find(outpoint);
+    if (itKey == mapCoinsByAddressKeys.end())
+        return;
+
+    auto itBucket = mapCoinsByAddress.find(itKey->second.first);
+    itBucket->second.erase(std::make_pair(itKey->second.second, outpoint));
+    if (itBucket->second.empty())
+        mapCoinsByAddress.erase(itBucket);
+    mapCoinsByAddressKeys.erase(itKey);
+}
+
+void CWallet::RestoreUnspentOutput(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_wallet);
+    auto it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || !IsMine(it->second.tx->vout[outpoint.n]) || IsSpent(outpoint.hash, outpoint.n))
+        return;
+
+    setWalletUTXO.insert(outpoint);
+    AddToCoinAgeIndex(outpoint, it->second);
+    AddToPrivateSendIndex(outpoint, it->second);
+}
+
+void CWallet::AddToPrivateSendIndex(const COutPoint& outpoint, const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    if (mapPrivateSendCoins.count(outpoint))
+        return;
+
+    const CTxOut& txout = wtx.tx->vout[outpoint.n];
+    CTxDestination txdest;
+    if (!ExtractDestination(txout.scriptPubKey, txdest) || !(::IsMine(*this, txdest) & ISMINE_SPENDABLE))
+        return;
+
+    mapPrivateSendCoins.emplace(outpoint, CPrivateSendCoin{txdest, txout.nValue, -10});
+    setPrivateSendCoinsPending.insert(outpoint);
+}
+
+void CWallet::RemoveFromPrivateSendIndex(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_wallet);
+    auto itCoin = mapPrivateSendCoins.find(outpoint);
+    if (itCoin == mapPrivateSendCoins.end())
+        return;
+
+    const CPrivateSendCoin& coin = itCoin->second;
+    if (setPrivateSendCoinsPending.erase(outpoint)) {
+        // not classified yet
+    } else if (coin.nRounds == -3) {
+        setCollateralCoins.erase(outpoint);
+    } else if (coin.nRounds == -2) {
+        setNonDenominatedCoins.erase(outpoint);
+    } else {
+        auto itDenom = mapDenominatedCoins.find(coin.nValue);
+        auto itRounds = itDenom->second.find(coin.nRounds);
+        itRounds->second.erase(outpoint);
+        if (itRounds->second.empty())
+            itDenom->second.erase(itRounds);
+        if (itDenom->second.empty())
+            mapDenominatedCoins.erase(itDenom);
+    }
+    mapPrivateSendCoins.erase(itCoin);
+}
+
+void CWallet::UpdatePrivateSendIndex() const
+{
+    AssertLockHeld(cs_wallet);
+    if (setPrivateSendCoinsPending.empty() || CPrivateSend::GetMaxPoolAmount() == 0) // denominations not initialized yet
+        return;
+
+    for (const auto& outpoint : setPrivateSendCoinsPending) {
+        CPrivateSendCoin& coin = mapPrivateSendCoins.at(outpoint);
+        if (CPrivateSend::IsCollateralAmount(coin.nValue)) {
+            coin.nRounds = -3;
+            setCollateralCoins.insert(outpoint);
+        } else if (CPrivateSend::IsDenominatedAmount(coin.nValue)) {
+            coin.nRounds = GetRealOutpointPrivateSendRounds(outpoint);
+            mapDenominatedCoins[coin.nValue][coin.nRounds].insert(outpoint);
+        } else {
+            coin.nRounds = -2;
+            setNonDenominatedCoins.insert(outpoint);
+        }
+    }
+    LogPrint("selectcoins", "CWallet::%s -- classified %d coins\n", __func__, setPrivateSendCoinsPending.size());
+    setPrivateSendCoinsPending.clear();
+}
+
+const CWalletTx* CWallet::GetAvailablePrivateSendCoin(const COutPoint& outpoint, bool fOnlySafe, int& nDepthRet) const
+{
+    auto it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end())
+        return NULL;
+    const CWalletTx* pcoin = &it->second;
+
+    if (!CheckFinalTx(*pcoin))
+        return NULL;
+    if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+        return NULL;
+    nDepthRet = pcoin->GetDepthInMainChain();
+    if (nDepthRet == 0 && !pcoin->InMempool())
+        return NULL;
+    if (fOnlySafe && !pcoin->IsTrusted())
+        return NULL;
+    if (IsSpent(outpoint.hash, outpoint.n) || IsLockedCoin(outpoint.hash, outpoint.n))
+        return NULL;
+
+    return pcoin;
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -1080,6 +1209,8 @@ void CWallet::MarkDirty()
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
@@ -1107,6 +1238,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
                 setWalletUTXO.insert(COutPoint(hash, i));
+                AddToCoinAgeIndex(COutPoint(hash, i), wtx);
+                AddToPrivateSendIndex(COutPoint(hash, i), wtx);
                 if (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || mnList.HasMNByCollateral(COutPoint(hash, i))) {
                     LockCoin(COutPoint(hash, i));
                 }
@@ -1167,6 +1300,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 
     return true;
 }
@@ -1285,16 +1420,21 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             }
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
+            // and put them back into the UTXO indexes
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    RestoreUnspentOutput(txin.prevout);
+                }
             }
         }
     }
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 
     return true;
 }
@@ -1349,16 +1489,21 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             }
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
+            // and put them back into the UTXO indexes
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    RestoreUnspentOutput(txin.prevout);
+                }
             }
         }
     }
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 }
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock)
@@ -1369,6 +1514,8 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     if (pindex != nullptr && (posInBlock == 0 || posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK)) {
         fAnonymizableTallyCached = false;
         fAnonymizableTallyCachedNonDenom = false;
+        mapAnonymizableBalanceCached.clear();
+        fBalanceCached = false;
     }
 
     if (!AddToWalletIfInvolvingMe(tx, pindex, posInBlock, true))
@@ -1385,8 +1532,17 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 }
 
+void CWallet::TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason)
+{
+    // cs_wallet is taken before mempool.cs elsewhere, so just invalidate the cache. Removals for blocks are
+    // followed by SyncTransaction, the rest (expiry, size limit, reorg, conflicts) may make own txes untrusted.
+    if (reason != MemPoolRemovalReason::BLOCK)
+        nMempoolRemovals++;
+}
 
 isminetype CWallet::IsMine(const CTxIn &txin) const
 {
@@ -1879,46 +2035,188 @@ void CWalletTx::GetAccountAmounts(const std::string& strAccount, CAmount& nRecei
     }
 }
 
+std::set<std::vector<unsigned char>> CWallet::GetBlockFilterElements() const
+{
+    GCSFilter::ElementSet elements;
+    auto addScript = [&elements](const CScript& script) {
+        elements.emplace(script.begin(), script.end());
+    };
+
+    LOCK2(cs_wallet, cs_KeyStore);
+
+    std::set<CKeyID> setKeyIds;
+    GetKeys(setKeyIds);
+    for (const auto& pair : mapHdPubKeys) {
+        setKeyIds.insert(pair.first);
+    }
+    for (const auto& pair : mapWatchKeys) {
+        setKeyIds.insert(pair.first);
+    }
+    for (const CKeyID& keyId : setKeyIds) {
+        addScript(GetScriptForDestination(keyId));
+        CPubKey pubKey;
+        if (GetPubKey(keyId, pubKey)) {
+            addScript(GetScriptForRawPubKey(pubKey));
+        }
+    }
+    for (const auto& pair : mapScripts) {
+        addScript(GetScriptForDestination(pair.first));
+        // also covers the redeem script used as a bare (multisig) scriptPubKey
+        addScript(pair.second);
+    }
+    for (const CScript& script : setWatchOnly) {
+        addScript(script);
+    }
+    // Bare multisig outputs we own all keys of are ours without a redeem script, but their scripts can't be derived
+    // from the keys. Take the ones the wallet has received before.
+    for (const auto& pair : mapWallet) {
+        for (const CTxOut& txout : pair.second.tx->vout) {
+            txnouttype whichType;
+            std::vector<std::vector<unsigned char> > vSolutions;
+            if (Solver(txout.scriptPubKey, whichType, vSolutions) && whichType == TX_MULTISIG && IsMine(txout) != ISMINE_NO) {
+                addScript(txout.scriptPubKey);
+            }
+        }
+    }
+    return elements;
+}
+
+namespace {
+/** A block read by a rescan worker, along with the txs paying to one of our scripts */
+struct RescanBlock
+{
+    bool fRead{false};
+    CBlock block;
+    std::vector<bool> vPaysToMe;
+};
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read and checked against the keystore by a few worker
+ * threads ahead of the scan. cs_main and cs_wallet are only taken while
+ * the matches of a single block are applied, in chain order, so that
+ * spends of coins found earlier in the scan are recognized. Callers
+ * reserve the rescan with a WalletRescanReserver and must not hold
+ * either lock, otherwise validation and RPCs block for the whole scan.
+ * With -blockfilterindex, blocks whose filter matches none of our
+ * scripts are skipped without reading them from disk.
+ *
  * Returns pointer to the first block in the last contiguous range that was
  * successfully scanned.
  *
  */
-CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, const WalletRescanReserver& reserver, bool fUpdate)
 {
+    assert(reserver.isReserved());
+    AssertLockNotHeld(cs_main);
+    AssertLockNotHeld(cs_wallet);
+
     CBlockIndex* ret = nullptr;
     int64_t nNow = GetTime();
+    int64_t nStartTimeMillis = GetTimeMillis();
     const CChainParams& chainParams = Params();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart;
+    double dProgressTip;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - TIMESTAMP_WINDOW)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
-        double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex)
+        dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
+        dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+    }
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    nScanningHeight = pindex ? pindex->nHeight : 0;
+    dScanningProgress = 0;
+    dScanningBlocksPerSec = 0;
+
+    int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_RESCAN_THREADS));
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "dash-rescan");
+
+    // with a block filter index, blocks which can't contain any of our scripts (neither as output nor as spent
+    // output) don't need to be read at all
+    GCSFilter::ElementSet filterElements;
+    if (blockFilterIndex) {
+        filterElements = GetBlockFilterElements();
+    }
+    std::atomic<int> nSkippedBlocks{0};
+
+    auto readBlock = [this, &chainParams, &filterElements, &nSkippedBlocks](const CBlockIndex* pindexRead) {
+        auto b = std::make_shared<RescanBlock>();
+        BlockFilter filter;
+        if (blockFilterIndex && blockFilterIndex->LookupFilter(pindexRead, filter) && !filter.GetFilter().MatchAny(filterElements)) {
+            // leave the block empty, there is nothing to apply
+            b->fRead = true;
+            nSkippedBlocks++;
+            return b;
+        }
+        b->fRead = ReadBlockFromDisk(b->block, pindexRead, chainParams.GetConsensus());
+        if (b->fRead) {
+            b->vPaysToMe.resize(b->block.vtx.size());
+            for (size_t i = 0; i < b->block.vtx.size(); i++) {
+                for (const auto& txout : b->block.vtx[i]->vout) {
+                    if (IsMine(txout) != ISMINE_NO) {
+                        b->vPaysToMe[i] = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return b;
+    };
+
+    std::deque<std::pair<CBlockIndex*, std::future<std::shared_ptr<RescanBlock>>>> queue;
+    CBlockIndex* pindexNextRead = pindex;
+    size_t nMaxQueued = nThreads * RESCAN_PREFETCH_PER_THREAD;
+    int nScannedBlocks = 0;
+
+    while (true) {
+        while (pindexNextRead && queue.size() < nMaxQueued) {
+            queue.emplace_back(pindexNextRead, workerPool.push([pindexNextRead, &readBlock](int) {
+                return readBlock(pindexNextRead);
+            }));
+            LOCK(cs_main);
+            pindexNextRead = chainActive.Next(pindexNextRead);
+        }
+        if (queue.empty()) {
+            break;
+        }
+
+        pindex = queue.front().first;
+        auto b = queue.front().second.get();
+        queue.pop_front();
+
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+            LOCK2(cs_main, cs_wallet);
+            // stop when the block got disconnected while we were scanning, the wallet learns about the new chain
+            // through the usual notifications
+            if (!chainActive.Contains(pindex)) {
+                LogPrintf("Rescan aborted at block %d, block %s is no longer in the active chain\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                break;
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+            if (b->fRead) {
+                for (size_t posInBlock = 0; posInBlock < b->block.vtx.size(); ++posInBlock) {
+                    const CTransaction& tx = *b->block.vtx[posInBlock];
+                    bool fRelevant = b->vPaysToMe[posInBlock] || mapWallet.count(tx.GetHash());
+                    for (size_t i = 0; !fRelevant && i < tx.vin.size(); i++) {
+                        // spends of our coins and conflicts with our txes
+                        fRelevant = mapWallet.count(tx.vin[i].prevout.hash) || mapTxSpends.count(tx.vin[i].prevout);
+                    }
+                    if (fRelevant) {
+                        AddToWalletIfInvolvingMe(tx, pindex, posInBlock, fUpdate);
+                    }
                 }
                 if (!ret) {
                     ret = pindex;
@@ -1926,10 +2224,32 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
             } else {
                 ret = nullptr;
             }
-            pindex = chainActive.Next(pindex);
+
+            nScannedBlocks++;
+            if (pindex->nHeight % 100 == 0 || GetTime() >= nNow + 60) {
+                double dProgress = GuessVerificationProgress(chainParams.TxData(), pindex);
+                int64_t nElapsedMillis = std::max<int64_t>(1, GetTimeMillis() - nStartTimeMillis);
+                nScanningHeight = pindex->nHeight;
+                dScanningProgress = dProgress;
+                dScanningBlocksPerSec = nScannedBlocks * 1000.0 / nElapsedMillis;
+                if (dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((dProgress - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LogPrintf("Still rescanning. At block %d. Progress=%f, %.1f blocks/s\n", pindex->nHeight, dProgress, dScanningBlocksPerSec.load());
+                }
+            }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+
+    // drop the blocks which are still queued after an abort
+    workerPool.clear_queue();
+    workerPool.stop(true);
+
+    int64_t nElapsedMillis = std::max<int64_t>(1, GetTimeMillis() - nStartTimeMillis);
+    LogPrintf("Rescanned %d blocks in %dms, %.1f blocks/s, using %d threads, %d blocks skipped by the block filter\n", nScannedBlocks, nElapsedMillis, nScannedBlocks * 1000.0 / nElapsedMillis, nThreads, nSkippedBlocks.load());
+
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -2428,12 +2748,22 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
+        // Reset on the same events which mark wallet txes dirty, on every block and on IS locks. An own unconfirmed
+        // tx which drops out of the mempool only bumps nMempoolRemovals.
+        uint64_t nRemovals = nMempoolRemovals;
+        if (fBalanceCached && nBalanceCachedMempoolRemovals == nRemovals)
+            return nBalanceCached;
+
         for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
+
+        nBalanceCached = nTotal;
+        nBalanceCachedMempoolRemovals = nRemovals;
+        fBalanceCached = true;
     }
 
     return nTotal;
@@ -2443,11 +2773,25 @@ CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated, bool fSkipUnconfi
 {
     if(fLiteMode) return 0;
 
-    std::vector<CompactTallyItem> vecTally;
-    if(!SelectCoinsGroupedByAddresses(vecTally, fSkipDenominated, true, fSkipUnconfirmed)) return 0;
+    LOCK2(cs_main, cs_wallet);
+
+    auto itCached = mapAnonymizableBalanceCached.find(std::make_pair(fSkipDenominated, fSkipUnconfirmed));
+    if (itCached != mapAnonymizableBalanceCached.end()) {
+        return itCached->second;
+    }
 
     CAmount nTotal = 0;
 
+    std::vector<CompactTallyItem> vecTally;
+    bool fFound = SelectCoinsGroupedByAddresses(vecTally, fSkipDenominated, true, fSkipUnconfirmed);
+    // unclassified coins (before the denominations are initialized) are missing from the tally, don't cache that
+    bool fCache = setPrivateSendCoinsPending.empty();
+    if(!fFound) {
+        if (fCache)
+            mapAnonymizableBalanceCached.emplace(std::make_pair(fSkipDenominated, fSkipUnconfirmed), nTotal);
+        return nTotal;
+    }
+
     const CAmount nSmallestDenom = CPrivateSend::GetSmallestDenomination();
     const CAmount nMixingCollateral = CPrivateSend::GetCollateralAmount();
     for (const auto& item : vecTally) {
@@ -2458,6 +2802,8 @@ CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated, bool fSkipUnconfi
             nTotal += item.nAmount;
     }
 
+    if (fCache)
+        mapAnonymizableBalanceCached.emplace(std::make_pair(fSkipDenominated, fSkipUnconfirmed), nTotal);
     return nTotal;
 }
 
@@ -2747,6 +3093,56 @@ double GetCoinWeight(COutput o, double& nAge)
     }
 };
 
+void CWallet::AvailableCoinsByAge(std::vector<COutput>& vCoins, const std::string& sAddress, bool fAntiBotNetRules) const
+{
+    vCoins.clear();
+
+    LOCK2(cs_main, cs_wallet);
+    auto itBucket = mapCoinsByAddress.find(sAddress);
+    if (itBucket == mapCoinsByAddress.end() || !chainActive.Tip() || !chainActive.Tip()->pprev)
+        return;
+
+    // coins from this time on have no age and thus no weight, see GetCoinWeight
+    int64_t nAgeTime = chainActive.Tip()->pprev->GetBlockTime();
+
+    for (const auto& p : itBucket->second) {
+        // only the anti-bot-net rules ask for coin-age, otherwise young coins are as good as any other
+        if (fAntiBotNetRules && p.first >= nAgeTime)
+            break;
+
+        const COutPoint& outpoint = p.second;
+        auto it = mapWallet.find(outpoint.hash);
+        if (it == mapWallet.end())
+            continue;
+        const CWalletTx* pcoin = &it->second;
+
+        if (!CheckFinalTx(*pcoin))
+            continue;
+        if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+            continue;
+        // coin-age is only counted for confirmed coins, without it unconfirmed ones are fine as long as they're safe
+        int nDepth = pcoin->GetDepthInMainChain();
+        if (fAntiBotNetRules && nDepth < 1)
+            continue;
+        if (nDepth == 0 && !pcoin->InMempool())
+            continue;
+        if (!pcoin->IsTrusted())
+            continue;
+        if (IsSpent(outpoint.hash, outpoint.n) || IsLockedCoin(outpoint.hash, outpoint.n))
+            continue;
+
+        CAmount nValue = pcoin->tx->vout[outpoint.n].nValue;
+        if (nValue <= 0)
+            continue;
+        if (fAntiBotNetRules && (nValue <= (GSC_DUST * COIN) || nValue == SANCTUARY_COLLATERAL * COIN))
+            continue;
+
+        vCoins.push_back(COutput(pcoin, outpoint.n, nDepth, true, true, true));
+    }
+
+    std::sort(vCoins.rbegin(), vCoins.rend(), CompareByCoinAge());
+}
+
 static void ApproximateBestSubset(std::vector<std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
                                   std::vector<char>& vfBest, CAmount& nBest, bool fUseInstantSend = false, int iterations = 1000)
 {
@@ -3202,12 +3598,27 @@ bool CWallet::SelectPSInOutPairsByDenominations(int nDenom, CAmount nValueMin, C
         return false;
     }
 
-    AvailableCoins(vCoins, true, NULL, false, ONLY_DENOMINATED);
+    LOCK2(cs_main, cs_wallet);
+    UpdatePrivateSendIndex();
+
+    // only the buckets of the requested denominations which aren't mixed enough yet
+    std::vector<CAmount> vecPrivateSendDenominations = CPrivateSend::GetStandardDenominations();
+    for (const auto& nBit : vecBits) {
+        auto itDenom = mapDenominatedCoins.find(vecPrivateSendDenominations[nBit]);
+        if (itDenom == mapDenominatedCoins.end()) continue;
+        for (const auto& rounds : itDenom->second) {
+            if (rounds.first >= privateSendClient.nPrivateSendRounds) break;
+            for (const auto& outpoint : rounds.second) {
+                int nDepth;
+                const CWalletTx* pcoin = GetAvailablePrivateSendCoin(outpoint, true, nDepth);
+                if (pcoin) vCoins.push_back(COutput(pcoin, outpoint.n, nDepth, true, true, true));
+            }
+        }
+    }
     LogPrintf("CWallet::%s -- vCoins.size(): %d\n", __func__, vCoins.size());
 
     std::random_shuffle(vCoins.rbegin(), vCoins.rend(), GetRandInt);
 
-    std::vector<CAmount> vecPrivateSendDenominations = CPrivateSend::GetStandardDenominations();
     for (const auto& out : vCoins) {
         uint256 txHash = out.tx->GetHash();
         int nValue = out.tx->tx->vout[out.i].nValue;
@@ -3239,8 +3650,6 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
 {
     LOCK2(cs_main, cs_wallet);
 
-    isminefilter filter = ISMINE_SPENDABLE;
-
     // Try using the cache for already confirmed anonymizable inputs.
     // This should only be used if nMaxOupointsPerAddress was NOT specified.
     if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed) {
@@ -3256,54 +3665,66 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
         }
     }
 
+    UpdatePrivateSendIndex();
+
     CAmount nSmallestDenom = CPrivateSend::GetSmallestDenomination();
 
     // Tally
     std::map<CTxDestination, CompactTallyItem> mapTally;
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (!setWalletTxesCounted.emplace(outpoint.hash).second) continue;
-
-        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-
-        const CWalletTx& wtx = (*it).second;
-
-        if(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) continue;
-        if(fSkipUnconfirmed && !wtx.IsTrusted()) continue;
-
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
-            CTxDestination txdest;
-            if (!ExtractDestination(wtx.tx->vout[i].scriptPubKey, txdest)) continue;
-
-            isminefilter mine = ::IsMine(*this, txdest);
-            if(!(mine & filter)) continue;
+    std::map<uint256, bool> mapTxUsable;
+    auto tallyCoin = [&](const COutPoint& outpoint) {
+        const CPrivateSendCoin& coin = mapPrivateSendCoins.at(outpoint);
+
+        auto itTallyItem = mapTally.find(coin.txdest);
+        if (nMaxOupointsPerAddress != -1 && itTallyItem != mapTally.end() && itTallyItem->second.vecOutPoints.size() >= nMaxOupointsPerAddress) return;
+
+        auto itUsable = mapTxUsable.find(outpoint.hash);
+        if (itUsable == mapTxUsable.end()) {
+            bool fUsable = false;
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+            if (it != mapWallet.end()) {
+                const CWalletTx& wtx = (*it).second;
+                fUsable = !(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) && !(fSkipUnconfirmed && !wtx.IsTrusted());
+            }
+            itUsable = mapTxUsable.emplace(outpoint.hash, fUsable).first;
+        }
+        if (!itUsable->second) return;
 
-            auto itTallyItem = mapTally.find(txdest);
-            if (nMaxOupointsPerAddress != -1 && itTallyItem != mapTally.end() && itTallyItem->second.vecOutPoints.size() >= nMaxOupointsPerAddress) continue;
+        if(IsSpent(outpoint.hash, outpoint.n) || IsLockedCoin(outpoint.hash, outpoint.n)) return;
 
-            if(IsSpent(outpoint.hash, i) || IsLockedCoin(outpoint.hash, i)) continue;
+        if(fAnonymizable) {
+            if(fMasternodeMode && coin.nValue == SANCTUARY_COLLATERAL * COIN) return;
+            // ignore outputs that are 10 times smaller then the smallest denomination
+            // otherwise they will just lead to higher fee / lower priority
+            if(coin.nValue <= nSmallestDenom/10) return;
+        }
 
-            if(fSkipDenominated && CPrivateSend::IsDenominatedAmount(wtx.tx->vout[i].nValue)) continue;
+        if (itTallyItem == mapTally.end()) {
+            itTallyItem = mapTally.emplace(coin.txdest, CompactTallyItem()).first;
+            itTallyItem->second.txdest = coin.txdest;
+        }
+        itTallyItem->second.nAmount += coin.nValue;
+        itTallyItem->second.vecOutPoints.emplace_back(outpoint);
+    };
 
-            if(fAnonymizable) {
-                // ignore collaterals
-                if(CPrivateSend::IsCollateralAmount(wtx.tx->vout[i].nValue)) continue;
-                if(fMasternodeMode && wtx.tx->vout[i].nValue == SANCTUARY_COLLATERAL * COIN) continue;
-                // ignore outputs that are 10 times smaller then the smallest denomination
-                // otherwise they will just lead to higher fee / lower priority
-                if(wtx.tx->vout[i].nValue <= nSmallestDenom/10) continue;
+    // anonymizable coins are never collaterals
+    if (!fAnonymizable) {
+        for (const auto& outpoint : setCollateralCoins) {
+            tallyCoin(outpoint);
+        }
+    }
+    for (const auto& outpoint : setNonDenominatedCoins) {
+        tallyCoin(outpoint);
+    }
+    if (!fSkipDenominated) {
+        for (const auto& denom : mapDenominatedCoins) {
+            for (const auto& rounds : denom.second) {
                 // ignore anonymized
-                if(GetCappedOutpointPrivateSendRounds(COutPoint(outpoint.hash, i)) >= privateSendClient.nPrivateSendRounds) continue;
-            }
-
-            if (itTallyItem == mapTally.end()) {
-                itTallyItem = mapTally.emplace(txdest, CompactTallyItem()).first;
-                itTallyItem->second.txdest = txdest;
+                if (fAnonymizable && rounds.first >= privateSendClient.nPrivateSendRounds) break;
+                for (const auto& outpoint : rounds.second) {
+                    tallyCoin(outpoint);
+                }
             }
-            itTallyItem->second.nAmount += wtx.tx->vout[i].nValue;
-            itTallyItem->second.vecOutPoints.emplace_back(outpoint.hash, i);
         }
     }
 
@@ -3316,8 +3737,9 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
     }
 
     // Cache already confirmed anonymizable entries for later use.
-    // This should only be used if nMaxOupointsPerAddress was NOT specified.
-    if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed) {
+    // This should only be used if nMaxOupointsPerAddress was NOT specified, and not while coins are still
+    // unclassified (before the denominations are initialized), as the tally doesn't see those yet.
+    if(nMaxOupointsPerAddress == -1 && fAnonymizable && fSkipUnconfirmed && setPrivateSendCoinsPending.empty()) {
         if(fSkipDenominated) {
             vecAnonymizableTallyCachedNonDenom = vecTallyRet;
             fAnonymizableTallyCachedNonDenom = true;
@@ -3348,7 +3770,25 @@ bool CWallet::SelectPrivateCoins(CAmount nValueMin, CAmount nValueMax, std::vect
     nValueRet = 0;
 
     std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, coinControl, false, nPrivateSendRoundsMin < 0 ? ONLY_NONDENOMINATED : ONLY_DENOMINATED);
+    if (nPrivateSendRoundsMin < 0) {
+        AvailableCoins(vCoins, true, coinControl, false, ONLY_NONDENOMINATED);
+    } else {
+        // only the denominated buckets within the requested rounds
+        LOCK2(cs_main, cs_wallet);
+        UpdatePrivateSendIndex();
+        for (const auto& denom : mapDenominatedCoins) {
+            for (const auto& rounds : denom.second) {
+                int nRounds = std::min(rounds.first, privateSendClient.nPrivateSendRounds);
+                if (nRounds < nPrivateSendRoundsMin) continue;
+                if (nRounds > nPrivateSendRoundsMax) break;
+                for (const auto& outpoint : rounds.second) {
+                    int nDepth;
+                    const CWalletTx* pcoin = GetAvailablePrivateSendCoin(outpoint, true, nDepth);
+                    if (pcoin) vCoins.push_back(COutput(pcoin, outpoint.n, nDepth, true, true, true));
+                }
+            }
+        }
+    }
 
     //order the array so largest nondenom are first, then denominations, then very small inputs.
     std::sort(vCoins.rbegin(), vCoins.rend(), CompareByPriority());
@@ -3382,7 +3822,12 @@ bool CWallet::GetCollateralTxDSIn(CTxDSIn& txdsinRet, CAmount& nValueRet) const
 
     std::vector<COutput> vCoins;
 
-    AvailableCoins(vCoins, true, NULL, false, ONLY_PRIVATESEND_COLLATERAL);
+    UpdatePrivateSendIndex();
+    for (const auto& outpoint : setCollateralCoins) {
+        int nDepth;
+        const CWalletTx* pcoin = GetAvailablePrivateSendCoin(outpoint, true, nDepth);
+        if (pcoin) vCoins.push_back(COutput(pcoin, outpoint.n, nDepth, true, true, true));
+    }
 
     if (vCoins.empty()) {
         return false;
@@ -3457,6 +3902,23 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount) const
 
     LOCK2(cs_main, cs_wallet);
 
+    UpdatePrivateSendIndex();
+    if (CPrivateSend::IsDenominatedAmount(nInputAmount)) {
+        // only the bucket of this denomination
+        auto itDenom = mapDenominatedCoins.find(nInputAmount);
+        if (itDenom == mapDenominatedCoins.end()) return 0;
+        for (const auto& rounds : itDenom->second) {
+            for (const auto& outpoint : rounds.second) {
+                const auto it = mapWallet.find(outpoint.hash);
+                if (it == mapWallet.end()) continue;
+                if (it->second.GetDepthInMainChain() < 0) continue;
+
+                nTotal++;
+            }
+        }
+        return nTotal;
+    }
+
     for (const auto& outpoint : setWalletUTXO) {
         const auto it = mapWallet.find(outpoint.hash);
         if (it == mapWallet.end()) continue;
@@ -3471,10 +3933,15 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount) const
 
 bool CWallet::HasCollateralInputs(bool fOnlyConfirmed) const
 {
-    std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, fOnlyConfirmed, NULL, false, ONLY_PRIVATESEND_COLLATERAL);
+    LOCK2(cs_main, cs_wallet);
+
+    UpdatePrivateSendIndex();
+    for (const auto& outpoint : setCollateralCoins) {
+        int nDepth;
+        if (GetAvailablePrivateSendCoin(outpoint, fOnlyConfirmed, nDepth)) return true;
+    }
 
-    return !vCoins.empty();
+    return false;
 }
 
 bool CWallet::CreateCollateralTransaction(CMutableTransaction& txCollateral, std::string& strReason)
@@ -3608,31 +4075,20 @@ double CWallet::GetAntiBotNetWalletWeight(double nMinCoinAge, CAmount& nTotalReq
 {
 	std::vector<COutput> vAvailableCoins;
 	nTotalRequired = 0;
-	bool fUseInstantSend = false;
 
 	LOCK2(cs_main, cs_wallet);
-    {
-	    AvailableCoins(vAvailableCoins, true, NULL, false, ALL_COINS, fUseInstantSend, nMinCoinAge, 0);
-	}
+	std::string sPubKey = GetEPArg(true);
+	// Only looks at the unspent coins of the purse address, already sorted by coin-age
+	AvailableCoinsByAge(vAvailableCoins, sPubKey, nMinCoinAge > 0);
+
 	double nFoundCoinAge = 0;
 	std::string sCache;
-	std::sort(vAvailableCoins.rbegin(), vAvailableCoins.rend(), CompareByCoinAge());
 	int nInputsConsumed = 0;
 	static int MAX_GSC_INPUTS = 500;  // Using more than this may break size limits
 
-	std::string sPubKey = GetEPArg(true);
-
 	BOOST_FOREACH(const COutput& out, vAvailableCoins)
     {
-		if(!out.fSpendable)
-                continue;
-		// Ensure this is spendable 
 		const CWalletTx *pcoin = out.tx;
-		std::string sActualRecip = PubKeyToAddress(pcoin->tx->vout[out.i].scriptPubKey);
-
-		if (sActualRecip != sPubKey)
-			continue;
-
 		CAmount nAmount = pcoin->tx->vout[out.i].nValue;
 		int nDepth = pcoin->GetDepthInMainChain();
 		double nAge = 0;
@@ -3741,9 +4197,17 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
         LOCK2(cs_main, cs_wallet);
         {
             std::vector<COutput> vAvailableCoins;
-            AvailableCoins(vAvailableCoins, true, coinControl, false, nCoinType, fUseInstantSend, dMinCoinAge, nMinSpend);
-			if (dMinCoinAge > 0)
-				std::sort(vAvailableCoins.rbegin(), vAvailableCoins.rend(), CompareByCoinAge());
+			if (dMinCoinAge > 0 && !sPursePubKey.empty() && !coinControl && nCoinType == ALL_COINS && !fUseInstantSend)
+			{
+				// ABN and GSC transactions only spend coins of the purse, no need to look at the whole wallet
+				AvailableCoinsByAge(vAvailableCoins, sPursePubKey, true);
+			}
+			else
+			{
+				AvailableCoins(vAvailableCoins, true, coinControl, false, nCoinType, fUseInstantSend, dMinCoinAge, nMinSpend);
+				if (dMinCoinAge > 0)
+					std::sort(vAvailableCoins.rbegin(), vAvailableCoins.rend(), CompareByCoinAge());
+			}
             int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
             nFeeRet = 0;
@@ -4232,6 +4696,8 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
             for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
                 if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
                     setWalletUTXO.insert(COutPoint(pair.first, i));
+                    AddToCoinAgeIndex(COutPoint(pair.first, i), pair.second);
+                    AddToPrivateSendIndex(COutPoint(pair.first, i), pair.second);
                 }
             }
         }
@@ -4877,6 +5343,8 @@ void CWallet::LockCoin(const COutPoint& output)
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
@@ -4888,6 +5356,8 @@ void CWallet::UnlockCoin(const COutPoint& output)
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    mapAnonymizableBalanceCached.clear();
+    fBalanceCached = false;
 }
 
 void CWallet::UnlockAllCoins()
@@ -5303,6 +5773,7 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
     LogPrintf(" wallet      %15dms\n", GetTimeMillis() - nStart);
 
     RegisterValidationInterface(walletInstance);
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CWallet::TransactionRemovedFromMempool, walletInstance, _1, _2));
 
     CBlockIndex *pindexRescan = chainActive.Genesis();
     if (!GetBoolArg("-rescan", false))
@@ -5332,7 +5803,12 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
         uiInterface.InitMessage(_("Rescanning..."));
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
         nStart = GetTimeMillis();
-        walletInstance->ScanForWalletTransactions(pindexRescan, true);
+        WalletRescanReserver reserver(walletInstance);
+        if (!reserver.reserve()) {
+            InitError(_("Failed to rescan the wallet during initialization"));
+            return NULL;
+        }
+        walletInstance->ScanForWalletTransactions(pindexRescan, reserver, true);
         LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
         walletInstance->SetBestChain(chainActive.GetLocator());
         CWalletDB::IncrementUpdateCounter();
@@ -5699,6 +6175,11 @@ void CWallet::NotifyTransactionLock(const CTransaction &tx)
     // Only notify UI if this transaction is in this wallet
     std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(tx.GetHash());
     if (mi != mapWallet.end()){
+        // the lock makes an unconfirmed tx trusted
+        fAnonymizableTallyCached = false;
+        fAnonymizableTallyCachedNonDenom = false;
+        mapAnonymizableBalanceCached.clear();
+        fBalanceCached = false;
         NotifyISLockReceived();
     }
 }
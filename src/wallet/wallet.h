@@ -66,6 +66,10 @@ static const bool DEFAULT_WALLET_REJECT_LONG_CHAINS = false;
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! Maximum number of threads reading and filtering blocks during a rescan
+static const int MAX_RESCAN_THREADS = 4;
+//! Number of blocks per rescan thread which are read ahead of the block being applied
+static const int RESCAN_PREFETCH_PER_THREAD = 8;
 
 extern const char * DEFAULT_WALLET_DAT;
 
@@ -82,6 +86,8 @@ class CScript;
 class CScheduler;
 class CTxMemPool;
 class CWalletTx;
+class WalletRescanReserver;
+enum class MemPoolRemovalReason;
 
 /** (client) version numbers for particular wallet features */
 enum WalletFeature
@@ -709,6 +715,16 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    // see GetBalance(), reset together with the anonymizable tallies
+    mutable bool fBalanceCached;
+    mutable CAmount nBalanceCached;
+    // nMempoolRemovals at the time nBalanceCached was computed
+    mutable uint64_t nBalanceCachedMempoolRemovals;
+    // bumped by TransactionRemovedFromMempool(), which can't take cs_wallet
+    std::atomic<uint64_t> nMempoolRemovals{0};
+    // see GetAnonymizableBalance(), by (fSkipDenominated, fSkipUnconfirmed), reset together with the anonymizable tallies
+    mutable std::map<std::pair<bool, bool>, CAmount> mapAnonymizableBalanceCached;
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -721,6 +737,43 @@ private:
 
     std::set<COutPoint> setWalletUTXO;
 
+    /**
+     * The spendable part of setWalletUTXO, bucketed by destination address (as returned by PubKeyToAddress) and
+     * ordered by tx time, oldest first. ABN and GSC transactions only spend coins of a single address, so this lets
+     * us find them without walking mapWallet.
+     */
+    typedef std::set<std::pair<int64_t, COutPoint>> CoinsByAge;
+    std::map<std::string, CoinsByAge> mapCoinsByAddress;
+    std::map<COutPoint, std::pair<std::string, int64_t>> mapCoinsByAddressKeys;
+    void AddToCoinAgeIndex(const COutPoint& outpoint, const CWalletTx& wtx);
+    void RemoveFromCoinAgeIndex(const COutPoint& outpoint);
+    /** Undo AddToSpends() for an outpoint whose spender got abandoned or conflicted */
+    void RestoreUnspentOutput(const COutPoint& outpoint);
+
+    /**
+     * The PrivateSend view of the spendable part of setWalletUTXO: denominated coins bucketed by denomination and
+     * mixing rounds, collaterals and the other (non-denominated) coins in a bucket each. It is maintained at the same
+     * places as setWalletUTXO, but new coins are only classified on the next mixing query (UpdatePrivateSendIndex):
+     * the wallet is loaded before the denominations are initialized, and rounds need the inputs of a coin. This way
+     * a mixing tick only looks at the coins which changed since the last one instead of re-tallying the wallet.
+     */
+    struct CPrivateSendCoin
+    {
+        CTxDestination txdest;
+        CAmount nValue;
+        int nRounds; // as GetRealOutpointPrivateSendRounds, -3 for collaterals and -2 for other coins
+    };
+    mutable std::map<COutPoint, CPrivateSendCoin> mapPrivateSendCoins;
+    mutable std::set<COutPoint> setPrivateSendCoinsPending;
+    mutable std::map<CAmount, std::map<int, std::set<COutPoint> > > mapDenominatedCoins; // denomination -> rounds -> coins
+    mutable std::set<COutPoint> setCollateralCoins;
+    mutable std::set<COutPoint> setNonDenominatedCoins;
+    void AddToPrivateSendIndex(const COutPoint& outpoint, const CWalletTx& wtx);
+    void RemoveFromPrivateSendIndex(const COutPoint& outpoint);
+    void UpdatePrivateSendIndex() const;
+    /** The per coin checks of AvailableCoins() for a coin of the PrivateSend index, returns its tx if it can be spent */
+    const CWalletTx* GetAvailablePrivateSendCoin(const COutPoint& outpoint, bool fOnlySafe, int& nDepthRet) const;
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
@@ -818,6 +871,10 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        fBalanceCached = false;
+        nBalanceCached = 0;
+        nBalanceCachedMempoolRemovals = 0;
+        mapAnonymizableBalanceCached.clear();
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -851,6 +908,13 @@ public:
     void AvailableCoins(std::vector<COutput>& vCoins, bool fOnlySafe=true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue=false, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false
 		,double dMinCoinAge = 0, CAmount nMinimumSpend = 0) const;
 
+    /**
+     * populate vCoins with the safe, spendable coins of sAddress, ordered the same way as AvailableCoins() +
+     * CompareByCoinAge. fAntiBotNetRules restricts them to confirmed coins which have a coin-age weight and skips dust
+     * and collateral coins, like AvailableCoins() does for dMinCoinAge > 0.
+     */
+    void AvailableCoinsByAge(std::vector<COutput>& vCoins, const std::string& sAddress, bool fAntiBotNetRules) const;
+
     /**
      * Shuffle and select coins until nTargetValue is reached while avoiding
      * small change; This method is stochastic for some inputs and upon
@@ -963,8 +1027,18 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
+    /** Connected to mempool.NotifyEntryRemoved, which is signalled with mempool.cs held */
+    void TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
-    CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    /** Must be called without cs_main and cs_wallet held, they are only taken while a block is applied */
+    CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, const WalletRescanReserver& reserver, bool fUpdate = false);
+    /** All scriptPubKeys we watch for (keys, redeem scripts and watch-only), as elements of a BIP158 block filter */
+    std::set<std::vector<unsigned char>> GetBlockFilterElements() const;
+    /** Progress of a running ScanForWalletTransactions(), see getwalletinfo. fScanningWallet is set by WalletRescanReserver. */
+    std::atomic<bool> fScanningWallet{false};
+    std::atomic<int> nScanningHeight{0};
+    std::atomic<double> dScanningProgress{0.0};
+    std::atomic<double> dScanningBlocksPerSec{0.0};
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override;
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
@@ -1226,6 +1300,38 @@ public:
     void KeepScript() override { KeepKey(); }
 };
 
+/** RAII object reserving the single rescan of a wallet, so that a rescan can run without holding cs_main and cs_wallet */
+class WalletRescanReserver
+{
+private:
+    CWallet* pwallet;
+    bool fReserved;
+
+public:
+    explicit WalletRescanReserver(CWallet* pwalletIn) : pwallet(pwalletIn), fReserved(false) {}
+
+    /** Returns false if another rescan of the wallet is running */
+    bool reserve()
+    {
+        assert(!fReserved);
+        bool fExpected = false;
+        fReserved = pwallet->fScanningWallet.compare_exchange_strong(fExpected, true);
+        return fReserved;
+    }
+
+    bool isReserved() const
+    {
+        return fReserved && pwallet->fScanningWallet;
+    }
+
+    ~WalletRescanReserver()
+    {
+        if (fReserved) {
+            pwallet->fScanningWallet = false;
+        }
+    }
+};
+
 
 /** 
  * Account information.
@@ -11,13 +11,25 @@ class CBlockIndex;
 class CGovernanceObject;
 class CGovernanceVote;
 class CZMQAbstractNotifier;
+class CZMQPublisher;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+/** Default outbound message high water mark of a notifier (-zmqpub<type>hwm) */
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
+
+/** Queue counters of a notifier, see getzmqnotifications */
+struct CZMQNotifierStats
+{
+    size_t nPending = 0;     //!< queued for the publisher thread
+    uint64_t nPublished = 0;
+    uint64_t nDropped = 0;   //!< dropped at the high-water mark or after a send failure
+};
+
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(0) { }
+    CZMQAbstractNotifier() : psocket(0), ppublisher(0), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -30,6 +42,14 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    void SetPublisher(CZMQPublisher *p) { ppublisher = p; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(const int sndhwm) {
+        if (sndhwm >= 0) {
+            outbound_message_high_water_mark = sndhwm;
+        }
+    }
+    virtual CZMQNotifierStats GetStats() const { return CZMQNotifierStats(); }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
@@ -42,11 +62,12 @@ public:
     virtual bool NotifyGovernanceObject(const CGovernanceObject &object);
     virtual bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx);
 
-
 protected:
     void *psocket;
+    CZMQPublisher *ppublisher;
     std::string type;
     std::string address;
+    int outbound_message_high_water_mark; // aka SNDHWM (set by the first notifier of a shared address), also bounds the messages queued for the publisher thread
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
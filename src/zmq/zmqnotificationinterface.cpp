@@ -10,6 +10,8 @@
 #include "streams.h"
 #include "util.h"
 
+CZMQNotificationInterface* pzmqNotificationInterface = NULL;
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
@@ -49,6 +51,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubrawgovernancevote"] = CZMQAbstractNotifier::Create<CZMQPublishRawGovernanceVoteNotifier>;
     factories["pubrawgovernanceobject"] = CZMQAbstractNotifier::Create<CZMQPublishRawGovernanceObjectNotifier>;
     factories["pubrawinstantsenddoublespend"] = CZMQAbstractNotifier::Create<CZMQPublishRawInstantSendDoubleSpendNotifier>;
+    factories["pubdacmessage"] = CZMQAbstractNotifier::Create<CZMQPublishDACMessageNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -60,6 +63,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            notifier->SetOutboundMessageHighWaterMark(static_cast<int>(GetArg(arg + "hwm", DEFAULT_ZMQ_SNDHWM)));
             notifiers.push_back(notifier);
         }
     }
@@ -79,6 +83,15 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     return notificationInterface;
 }
 
+std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotifiers() const
+{
+    std::list<const CZMQAbstractNotifier*> result;
+    for (const auto* n : notifiers) {
+        result.push_back(n);
+    }
+    return result;
+}
+
 // Called at startup to conditionally set up ZMQ socket(s)
 bool CZMQNotificationInterface::Initialize()
 {
@@ -97,6 +110,7 @@ bool CZMQNotificationInterface::Initialize()
     for (; i!=notifiers.end(); ++i)
     {
         CZMQAbstractNotifier *notifier = *i;
+        notifier->SetPublisher(&publisher);
         if (notifier->Initialize(pcontext))
         {
             LogPrint("zmq", "  Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
@@ -113,6 +127,8 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    publisher.Start();
+
     return true;
 }
 
@@ -122,6 +138,9 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        // the publisher thread owns the sockets until it has sent what is queued
+        publisher.Stop();
+
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -251,3 +270,8 @@ void CZMQNotificationInterface::NotifyInstantSendDoubleSpendAttempt(const CTrans
         }
     }
 }
+
+void CZMQNotificationInterface::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block)
+{
+    publisher.SetRecentBlock(pindex, block);
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmqpublisher.h"
+#include "zmqpublishnotifier.h"
+
+#include "chainparams.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+#include "version.h"
+
+CZMQPublisher::CZMQPublisher() : fStop(false)
+{
+}
+
+CZMQPublisher::~CZMQPublisher()
+{
+    Stop();
+
+    for (CZMQPublishJob* job : queue) {
+        delete job;
+    }
+}
+
+void CZMQPublisher::Start()
+{
+    assert(!thread.joinable());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStop = false;
+    }
+    thread = std::thread(&CZMQPublisher::ThreadPublish, this);
+}
+
+void CZMQPublisher::Stop()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStop = true;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+void CZMQPublisher::Push(CZMQPublishJob* job)
+{
+    {
+        // numbering and queueing under one lock, so a notifier's jobs can't be queued out of sequence order
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!job->pnotifier->NumberJob(*job)) {
+            delete job;
+            return;
+        }
+        queue.push_back(job);
+    }
+    cond.notify_one();
+}
+
+void CZMQPublisher::ThreadPublish()
+{
+    RenameThread("dac-zmqpub");
+    LogPrint("zmq", "zmq: Publisher thread started\n");
+
+    std::deque<CZMQPublishJob*> jobs;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return fStop || !queue.empty(); });
+            if (queue.empty())
+                break; // stopping and everything was sent
+            // take the whole batch, so pushers aren't blocked while it's sent
+            jobs.swap(queue);
+        }
+
+        for (CZMQPublishJob* job : jobs) {
+            job->pnotifier->Send(*job);
+            delete job;
+        }
+        jobs.clear();
+    }
+
+    LogPrint("zmq", "zmq: Publisher thread exiting\n");
+}
+
+void CZMQPublisher::SetRecentBlock(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock)
+{
+    std::lock_guard<std::mutex> lock(mutexRecentBlock);
+    hashRecentBlock = pindex->GetBlockHash();
+    recentBlock = pblock;
+}
+
+ZMQPayloadRef CZMQPublisher::GetSerializedBlock(const CBlockIndex* pindex)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    // rawblock and rawchainlock usually publish the same block shortly after each other
+    if (lastBlockPayload && hashLastBlock == hash)
+        return lastBlockPayload;
+
+    std::shared_ptr<const CBlock> pblock;
+    {
+        std::lock_guard<std::mutex> lock(mutexRecentBlock);
+        if (recentBlock && hashRecentBlock == hash)
+            pblock = recentBlock;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (pblock) {
+        ss << *pblock;
+    } else {
+        LOCK(cs_main);
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            zmqError("Can't read block from disk");
+            return nullptr;
+        }
+        ss << block;
+    }
+
+    hashLastBlock = hash;
+    lastBlockPayload = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+    return lastBlockPayload;
+}
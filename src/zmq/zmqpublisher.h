@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZMQ_ZMQPUBLISHER_H
+#define BITCOIN_ZMQ_ZMQPUBLISHER_H
+
+#include "uint256.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CZMQAbstractPublishNotifier;
+
+/** Message body, shared by every notifier publishing the same bytes */
+typedef std::shared_ptr<const std::vector<unsigned char> > ZMQPayloadRef;
+/** Builds a message body on the publisher thread, returns null on failure */
+typedef std::function<ZMQPayloadRef()> ZMQPayloadFn;
+
+struct CZMQPublishJob
+{
+    CZMQAbstractPublishNotifier* pnotifier;
+    const char* command;
+    uint32_t nSequence;
+    ZMQPayloadRef payload; //!< null when fnPayload builds it
+    ZMQPayloadFn fnPayload;
+};
+
+/**
+ * Sends the messages of all publish notifiers from a single thread, so validation and InstantSend callbacks
+ * only queue them. Jobs are handed over through a mutex guarded queue and sent in the order they were queued,
+ * which also keeps the (non thread-safe) ZMQ sockets on one thread. Bodies that are expensive to build, like
+ * raw blocks, are only serialized there.
+ */
+class CZMQPublisher
+{
+public:
+    CZMQPublisher();
+    ~CZMQPublisher();
+
+    void Start();
+    /** Send everything still queued and join the publisher thread */
+    void Stop();
+
+    /** Number a job and queue it for the publisher thread, which takes ownership of it; dropped jobs are deleted */
+    void Push(CZMQPublishJob* job);
+
+    /** Remember the block relayed to peers by NewPoWValidBlock, so it doesn't have to be read back from disk */
+    void SetRecentBlock(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock);
+    /** Serialized block, shared between the notifiers publishing it. Only called on the publisher thread. */
+    ZMQPayloadRef GetSerializedBlock(const CBlockIndex* pindex);
+
+private:
+    void ThreadPublish();
+
+    std::mutex mutex;
+    std::deque<CZMQPublishJob*> queue; // guarded by mutex
+    bool fStop;                        // guarded by mutex
+    std::condition_variable cond;
+    std::thread thread;
+
+    std::mutex mutexRecentBlock;
+    uint256 hashRecentBlock;
+    std::shared_ptr<const CBlock> recentBlock;
+
+    // publisher thread only
+    uint256 hashLastBlock;
+    ZMQPayloadRef lastBlockPayload;
+};
+
+#endif // BITCOIN_ZMQ_ZMQPUBLISHER_H
@@ -3,11 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "rpc/server.h"
+#include "script/script.h"
 #include "streams.h"
 #include "zmqpublishnotifier.h"
 #include "validation.h"
 #include "util.h"
 
+#include <univalue.h>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK     = "hashblock";
@@ -24,6 +28,7 @@ static const char *MSG_RAWTXLOCK     = "rawtxlock";
 static const char *MSG_RAWGVOTE      = "rawgovernancevote";
 static const char *MSG_RAWGOBJ       = "rawgovernanceobject";
 static const char *MSG_RAWISCON      = "rawinstantsenddoublespend";
+static const char *MSG_DACMESSAGE    = "dacmessage";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -81,7 +86,17 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint("zmq", "zmq: Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0)
+        {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -97,6 +112,14 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
     {
         LogPrint("zmq", "zmq: Reusing socket for address %s\n", address);
 
+        // ZMQ_SNDHWM is a socket option, so the first notifier bound to the address sets it for all of them.
+        // This notifier's own value still limits the messages it has queued for the publisher thread.
+        if (outbound_message_high_water_mark != i->second->outbound_message_high_water_mark)
+        {
+            LogPrintf("zmq: Outbound message high water mark %d of %s at %s only limits its queued messages, the shared socket uses %d of %s\n",
+                outbound_message_high_water_mark, type, address, i->second->outbound_message_high_water_mark, i->second->type);
+        }
+
         psocket = i->second->psocket;
         mapPublishNotifiers.insert(std::make_pair(address, this));
 
@@ -134,23 +157,92 @@ void CZMQAbstractPublishNotifier::Shutdown()
     psocket = 0;
 }
 
-bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size, uint32_t nMsgSequence)
 {
     assert(psocket);
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
+    WriteLE32(&msgseq[0], nMsgSequence);
     int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
     if (rc == -1)
         return false;
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::NumberJob(CZMQPublishJob& job)
+{
+    // the sequence number is taken even for dropped messages, so subscribers can detect the loss
+    job.nSequence = nSequence++;
+    if (fFailed || (outbound_message_high_water_mark > 0 && nPending >= outbound_message_high_water_mark))
+    {
+        nDropped++;
+        LogPrint("zmq", "zmq: Dropped %s message %u (%d pending)\n", job.command, job.nSequence, nPending);
+        return false;
+    }
+
+    nPending++;
+    return true;
+}
 
+bool CZMQAbstractPublishNotifier::Publish(const char *command, const ZMQPayloadRef& payload)
+{
+    assert(ppublisher);
+    ppublisher->Push(new CZMQPublishJob{this, command, 0, payload, ZMQPayloadFn()});
     return true;
 }
 
+bool CZMQAbstractPublishNotifier::Publish(const char *command, const void* data, size_t size)
+{
+    const unsigned char* begin = static_cast<const unsigned char*>(data);
+    return Publish(command, std::make_shared<const std::vector<unsigned char> >(begin, begin + size));
+}
+
+bool CZMQAbstractPublishNotifier::Publish(const char *command, const ZMQPayloadFn& fnPayload)
+{
+    assert(ppublisher);
+    ppublisher->Push(new CZMQPublishJob{this, command, 0, nullptr, fnPayload});
+    return true;
+}
+
+void CZMQAbstractPublishNotifier::Send(const CZMQPublishJob& job)
+{
+    nPending--;
+    if (fFailed)
+    {
+        nDropped++;
+        return;
+    }
+
+    ZMQPayloadRef payload = job.payload ? job.payload : job.fnPayload();
+    if (!payload)
+    {
+        nDropped++;
+        return;
+    }
+
+    if (!SendMessage(job.command, payload->data(), payload->size(), job.nSequence))
+    {
+        // the socket may be shared with other notifiers, so it is only closed on shutdown
+        LogPrint("zmq", "zmq: Notifier %s at %s failed, dropping its messages\n", type, address);
+        fFailed = true;
+        nDropped++;
+        return;
+    }
+
+    nPublished++;
+}
+
+CZMQNotifierStats CZMQAbstractPublishNotifier::GetStats() const
+{
+    CZMQNotifierStats stats;
+    stats.nPending = std::max(0, nPending.load());
+    stats.nPublished = nPublished;
+    stats.nDropped = nDropped;
+    return stats;
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -158,7 +250,7 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHBLOCK, data, 32);
+    return Publish(MSG_HASHBLOCK, data, 32);
 }
 
 bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex)
@@ -168,7 +260,7 @@ bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHCHAINLOCK, data, 32);
+    return Publish(MSG_HASHCHAINLOCK, data, 32);
 }
 
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -178,7 +270,7 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTX, data, 32);
+    return Publish(MSG_HASHTX, data, 32);
 }
 
 bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
@@ -188,7 +280,7 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTXLOCK, data, 32);
+    return Publish(MSG_HASHTXLOCK, data, 32);
 }
 
 bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
@@ -198,7 +290,7 @@ bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernan
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHGVOTE, data, 32);
+    return Publish(MSG_HASHGVOTE, data, 32);
 }
 
 bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &object)
@@ -208,7 +300,7 @@ bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGove
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHGOBJ, data, 32);
+    return Publish(MSG_HASHGOBJ, data, 32);
 }
 
 bool CZMQPublishHashInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
@@ -220,8 +312,8 @@ bool CZMQPublishHashInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpend
         dataCurrentHash[31 - i] = currentHash.begin()[i];
         dataPreviousHash[31 - i] = previousHash.begin()[i];
     }
-    return SendMessage(MSG_HASHISCON, dataCurrentHash, 32)
-        && SendMessage(MSG_HASHISCON, dataPreviousHash, 32);
+    return Publish(MSG_HASHISCON, dataCurrentHash, 32)
+        && Publish(MSG_HASHISCON, dataPreviousHash, 32);
 }
 
 
@@ -229,42 +321,18 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    // reading and serializing the block is left to the publisher thread
+    CZMQPublisher* publisher = ppublisher;
+    return Publish(MSG_RAWBLOCK, [publisher, pindex] { return publisher->GetSerializedBlock(pindex); });
 }
 
 bool CZMQPublishRawChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawchainlock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWCHAINLOCK, &(*ss.begin()), ss.size());
+    // reading and serializing the block is left to the publisher thread
+    CZMQPublisher* publisher = ppublisher;
+    return Publish(MSG_RAWCHAINLOCK, [publisher, pindex] { return publisher->GetSerializedBlock(pindex); });
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -273,7 +341,7 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    return Publish(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
@@ -282,7 +350,7 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     LogPrint("zmq", "zmq: Publish rawtxlock %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << transaction;
-    return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
+    return Publish(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
@@ -291,7 +359,7 @@ bool CZMQPublishRawGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanc
     LogPrint("gobject", "gobject: Publish rawgovernanceobject: hash = %s, vote = %d\n", nHash.ToString(), vote.ToString());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << vote;
-    return SendMessage(MSG_RAWGVOTE, &(*ss.begin()), ss.size());
+    return Publish(MSG_RAWGVOTE, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &govobj)
@@ -300,7 +368,7 @@ bool CZMQPublishRawGovernanceObjectNotifier::NotifyGovernanceObject(const CGover
     LogPrint("gobject", "gobject: Publish rawgovernanceobject: hash = %s, type = %d\n", nHash.ToString(), govobj.GetObjectType());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << govobj;
-    return SendMessage(MSG_RAWGOBJ, &(*ss.begin()), ss.size());
+    return Publish(MSG_RAWGOBJ, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
@@ -309,6 +377,38 @@ bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendA
     CDataStream ssCurrent(SER_NETWORK, PROTOCOL_VERSION), ssPrevious(SER_NETWORK, PROTOCOL_VERSION);
     ssCurrent << currentTx;
     ssPrevious << previousTx;
-    return SendMessage(MSG_RAWISCON, &(*ssCurrent.begin()), ssCurrent.size())
-        && SendMessage(MSG_RAWISCON, &(*ssPrevious.begin()), ssPrevious.size());
+    return Publish(MSG_RAWISCON, &(*ssCurrent.begin()), ssCurrent.size())
+        && Publish(MSG_RAWISCON, &(*ssPrevious.begin()), ssPrevious.size());
+}
+
+bool CZMQPublishDACMessageNotifier::NotifyTransaction(const CTransaction &transaction)
+{
+    std::string sMessage = transaction.GetTxMessage();
+    if (sMessage.empty())
+        return true;
+
+    uint256 hash = transaction.GetHash();
+    CAmount nValueOut = transaction.GetValueOut();
+    LogPrint("zmq", "zmq: Publish dacmessage %s\n", hash.GetHex());
+
+    // parsing the message is left to the publisher thread
+    return Publish(MSG_DACMESSAGE, [hash, nValueOut, sMessage] {
+        static const std::vector<std::pair<std::string, std::string> > vFields = {
+            {"type", "MT"}, {"key", "MK"}, {"value", "MV"},
+            {"campaign", "gsccampaign"}, {"cpk", "abncpk"}, {"gobject", "gobject"}, {"outcome", "outcome"},
+            {"dws", "dws"}, {"dashstake", "dashstake"}, {"diary", "diary"}, {"ipfshash", "ipfshash"},
+        };
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("txid", hash.GetHex()));
+        obj.push_back(Pair("amount", ValueFromAmount(nValueOut)));
+        for (const auto& field : vFields)
+        {
+            std::string sValue = ExtractXMLValue(sMessage, "<" + field.second + ">", "</" + field.second + ">");
+            if (!sValue.empty())
+                obj.push_back(Pair(field.first, sValue));
+        }
+        std::string strJSON = obj.write();
+        return std::make_shared<const std::vector<unsigned char> >(strJSON.begin(), strJSON.end());
+    });
 }
@@ -6,6 +6,9 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "zmqpublisher.h"
+
+#include <atomic>
 
 class CBlockIndex;
 class CGovernanceVote;
@@ -14,9 +17,14 @@ class CGovernanceObject;
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //!< upcounting per message sequence number
+    uint32_t nSequence; //!< upcounting per message sequence number, guarded by the publisher's queue lock
+    std::atomic<int> nPending;
+    std::atomic<uint64_t> nPublished;
+    std::atomic<uint64_t> nDropped;
+    std::atomic<bool> fFailed;
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0), nPending(0), nPublished(0), nDropped(0), fFailed(false) { }
 
     /* send zmq multipart message
        parts:
@@ -24,7 +32,27 @@ public:
           * data
           * message sequence number
     */
-    bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendMessage(const char *command, const void* data, size_t size, uint32_t nMsgSequence);
+
+    /**
+     * Queue a message for the publisher thread. With more than the high-water mark of messages pending, or after
+     * a send failure, it is dropped instead; it still uses up its sequence number so subscribers see the gap.
+     */
+    bool Publish(const char *command, const ZMQPayloadRef& payload);
+    bool Publish(const char *command, const void* data, size_t size);
+    /** Same, with the body built on the publisher thread */
+    bool Publish(const char *command, const ZMQPayloadFn& fnPayload);
+
+    /**
+     * Assign the next sequence number to a job, or return false if it is dropped instead.
+     * Called by the publisher under the lock it queues jobs with, so each notifier's jobs are queued in sequence order.
+     */
+    bool NumberJob(CZMQPublishJob& job);
+
+    /** Build the body of a queued job if needed and send it, on the publisher thread */
+    void Send(const CZMQPublishJob& job);
+
+    CZMQNotifierStats GetStats() const override;
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
@@ -113,4 +141,12 @@ class CZMQPublishRawInstantSendDoubleSpendNotifier : public CZMQAbstractPublishN
 public:
     bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override;
 };
+
+/** Metadata of DAC transaction messages (prayers, GSC transmissions, DWS burns, ...) as JSON */
+class CZMQPublishDACMessageNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransaction(const CTransaction &transaction) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
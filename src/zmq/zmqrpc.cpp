@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The DAC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmq/zmqrpc.h"
+
+#include "rpc/server.h"
+#include "zmq/zmqabstractnotifier.h"
+#include "zmq/zmqnotificationinterface.h"
+
+#include <univalue.h>
+
+UniValue getzmqnotifications(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            "getzmqnotifications\n"
+            "\nReturns information about the active ZeroMQ notifications.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"type\": \"pubhashtx\",      (string) Type of notification\n"
+            "    \"address\": \"...\",         (string) Address of the publisher\n"
+            "    \"hwm\": n,                   (numeric) Outbound message high water mark\n"
+            "    \"pending\": n,               (numeric) Messages queued for the publisher thread\n"
+            "    \"published\": n,             (numeric) Messages sent\n"
+            "    \"dropped\": n                (numeric) Messages dropped at the high water mark or after a send failure\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getzmqnotifications", "")
+            + HelpExampleRpc("getzmqnotifications", "")
+        );
+    }
+
+    UniValue result(UniValue::VARR);
+    if (pzmqNotificationInterface != NULL) {
+        for (const auto* n : pzmqNotificationInterface->GetActiveNotifiers()) {
+            CZMQNotifierStats stats = n->GetStats();
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("type", n->GetType()));
+            obj.push_back(Pair("address", n->GetAddress()));
+            obj.push_back(Pair("hwm", n->GetOutboundMessageHighWaterMark()));
+            obj.push_back(Pair("pending", (uint64_t)stats.nPending));
+            obj.push_back(Pair("published", stats.nPublished));
+            obj.push_back(Pair("dropped", stats.nDropped));
+            result.push_back(obj);
+        }
+    }
+
+    return result;
+}
+
+static const CRPCCommand commands[] =
+{ //  category              name                      actor (function)         okSafeMode
+  //  --------------------- ------------------------  -----------------------  ----------
+    { "zmq",                "getzmqnotifications",    &getzmqnotifications,    true,  {} },
+};
+
+void RegisterZMQRPCCommands(CRPCTable& t)
+{
+    for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
+        t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+}